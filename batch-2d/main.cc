@@ -0,0 +1,224 @@
+#include "batch_renderer.hpp"
+#include "utils.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+struct Primitive {
+  enum class Shape {
+    kTriangle,
+    kQuad,
+    kHexagon,
+  };
+
+  Shape shape;
+  util::BatchRenderer::Blend blend;
+  glm::vec2 center;
+  float size;
+  float angle;
+  float speed;
+  glm::vec4 color;
+};
+
+glm::mat3 MakeTransform(const glm::vec2 &center, float size, float angle) {
+  float c = std::cos(angle) * size;
+  float s = std::sin(angle) * size;
+
+  glm::mat3 m(1.f);
+  m[0][0] = c;
+  m[0][1] = s;
+  m[1][0] = -s;
+  m[1][1] = c;
+  m[2][0] = center.x;
+  m[2][1] = center.y;
+
+  return m;
+}
+
+} // namespace
+
+class Batch2D : public util::App {
+public:
+  explicit Batch2D(uint32_t primitive_count)
+      : util::App("Batch 2D", 800, 800), m_primitive_count(primitive_count) {}
+
+  ~Batch2D() override = default;
+
+protected:
+  void OnInit() override {
+    InitScene();
+
+    m_batch = std::make_unique<util::BatchRenderer>(
+        GetDevice(), GetQueue(), WGPUTextureFormat_BGRA8Unorm);
+
+    // pixel coordinates, origin at the top left corner
+    m_batch->SetProjection(glm::ortho(0.f, 800.f, 800.f, 0.f, -1.f, 1.f));
+
+    for (uint32_t i = 0; i < 6; i++) {
+      float a = static_cast<float>(i) / 6.f * 2.f * kPi;
+      m_hexagon[i] = {std::cos(a), std::sin(a)};
+    }
+  }
+
+  void OnLoop() override {
+    auto texture_view = AcquireTargetView();
+
+    auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
+
+    auto render_pass = BeginRenderPass(texture_view, encoder);
+
+    Draw(render_pass);
+
+    wgpuRenderPassEncoderEnd(render_pass);
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+
+    wgpuRenderPassEncoderRelease(render_pass);
+    wgpuCommandEncoderRelease(encoder);
+
+    wgpuQueueSubmit(GetQueue(), 1, &cmd);
+    Present();
+
+    wgpuCommandBufferRelease(cmd);
+    wgpuTextureViewRelease(texture_view);
+  }
+
+  void OnTerminal() override { m_batch.reset(); }
+
+private:
+  void InitScene() {
+    std::mt19937 rng{2023};
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    m_primitives.resize(m_primitive_count);
+
+    for (auto &p : m_primitives) {
+      p.shape = static_cast<Primitive::Shape>(rng() % 3);
+
+      // mostly alpha blended, like a typical UI or particle workload
+      uint32_t blend = rng() % 10;
+      p.blend = blend < 2   ? util::BatchRenderer::Blend::kOpaque
+                : blend < 8 ? util::BatchRenderer::Blend::kAlpha
+                            : util::BatchRenderer::Blend::kAdditive;
+
+      p.center = {unit(rng) * 800.f, unit(rng) * 800.f};
+      p.size = 2.f + unit(rng) * 8.f;
+      p.angle = unit(rng) * 2.f * kPi;
+      p.speed = (unit(rng) - 0.5f) * 0.2f;
+      p.color = {unit(rng), unit(rng), unit(rng),
+                 p.blend == util::BatchRenderer::Blend::kOpaque ? 1.f : 0.5f};
+    }
+
+    spdlog::info("scene: {} primitives", m_primitive_count);
+  }
+
+  WGPURenderPassEncoder BeginRenderPass(WGPUTextureView texture_view,
+                                        WGPUCommandEncoder encoder) {
+    WGPURenderPassDescriptor renderpassInfo = {};
+    WGPURenderPassColorAttachment colorAttachment = {};
+
+    colorAttachment.view = texture_view;
+    colorAttachment.resolveTarget = nullptr;
+    colorAttachment.clearValue = {0.1f, 0.1f, 0.1f, 1.f};
+    colorAttachment.loadOp = WGPULoadOp_Clear;
+    colorAttachment.storeOp = WGPUStoreOp_Store;
+    renderpassInfo.colorAttachmentCount = 1;
+    renderpassInfo.colorAttachments = &colorAttachment;
+    renderpassInfo.depthStencilAttachment = nullptr;
+
+    return wgpuCommandEncoderBeginRenderPass(encoder, &renderpassInfo);
+  }
+
+  void Draw(WGPURenderPassEncoder render_pass) {
+    auto start = std::chrono::steady_clock::now();
+
+    m_batch->Begin();
+
+    for (auto &p : m_primitives) {
+      p.angle += p.speed;
+
+      auto transform = MakeTransform(p.center, p.size, p.angle);
+
+      switch (p.shape) {
+      case Primitive::Shape::kTriangle:
+        m_batch->SubmitTriangle({0.f, -1.f}, {0.87f, 0.5f}, {-0.87f, 0.5f},
+                                p.color, transform, p.blend);
+        break;
+      case Primitive::Shape::kQuad:
+        m_batch->SubmitQuad({-1.f, -1.f}, {1.f, 1.f}, p.color, transform,
+                            p.blend);
+        break;
+      case Primitive::Shape::kHexagon:
+        m_batch->SubmitPolygon(m_hexagon, 6, p.color, transform, p.blend);
+        break;
+      }
+    }
+
+    auto submitted = std::chrono::steady_clock::now();
+
+    m_batch->Flush(render_pass);
+
+    auto end = std::chrono::steady_clock::now();
+
+    m_submit_time += std::chrono::duration<double>(submitted - start).count();
+    m_flush_time += std::chrono::duration<double>(end - submitted).count();
+
+    if (++m_frame % 120 == 0) {
+      const auto &stats = m_batch->GetStats();
+
+      double submit_ms = m_submit_time * 1000.0 / 120.0;
+      double flush_ms = m_flush_time * 1000.0 / 120.0;
+
+      spdlog::info("submit: {:.3f} ms ({:.2f} M primitives/s) flush: {:.3f} "
+                   "ms draws: {} vertices: {} upload: {} KB",
+                   submit_ms,
+                   stats.primitives / (m_submit_time / 120.0) / 1e6, flush_ms,
+                   stats.draw_calls, stats.vertices,
+                   stats.upload_bytes / 1024);
+
+      m_submit_time = 0.0;
+      m_flush_time = 0.0;
+    }
+  }
+
+private:
+  uint32_t m_primitive_count;
+  std::unique_ptr<util::BatchRenderer> m_batch;
+  std::vector<Primitive> m_primitives;
+  glm::vec2 m_hexagon[6] = {};
+  uint64_t m_frame = 0;
+  double m_submit_time = 0.0;
+  double m_flush_time = 0.0;
+};
+
+int main(int argc, const char **argv) {
+  auto options = util::App::ParseOptions(argc, argv);
+
+  uint32_t count = 100000;
+
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] != '\0' &&
+        std::strspn(argv[i], "0123456789") == std::strlen(argv[i])) {
+      count = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+    } else {
+      spdlog::warn("unknown option: {}", argv[i]);
+    }
+  }
+
+  Batch2D app{count};
+
+  return app.Run(options) ? 0 : -1;
+}
@@ -0,0 +1,607 @@
+#include "adapter_select.hpp"
+#include "device_log.hpp"
+#include "run_profile.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kTargetSize = 64;
+
+struct Result {
+  std::string name;
+  uint32_t calls = 0;
+  // per call
+  double median_ns = 0.0;
+  double min_ns = 0.0;
+};
+
+double ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+/**
+ * Time the CPU side of single WebGPU calls. Every benchmark runs its call in
+ * a loop and times only that loop, the setup around it is not counted. On the
+ * Null backend nothing reaches a GPU, so what is left is the cost of the
+ * frontend: validation, state tracking and command recording.
+ */
+class ApiOverhead {
+public:
+  ApiOverhead(WGPUDevice device, uint32_t calls, uint32_t repeats)
+      : m_device(device), m_queue(wgpuDeviceGetQueue(device)), m_calls(calls),
+        m_repeats(repeats) {}
+
+  ~ApiOverhead() {
+    for (auto pipeline : m_pipelines) {
+      if (pipeline) {
+        wgpuRenderPipelineRelease(pipeline);
+      }
+    }
+    if (m_group) {
+      wgpuBindGroupRelease(m_group);
+    }
+    if (m_group_layout) {
+      wgpuBindGroupLayoutRelease(m_group_layout);
+    }
+    if (m_uniform_buffer) {
+      wgpuBufferRelease(m_uniform_buffer);
+    }
+    if (m_upload_buffer) {
+      wgpuBufferRelease(m_upload_buffer);
+    }
+    if (m_target_view) {
+      wgpuTextureViewRelease(m_target_view);
+    }
+    if (m_target) {
+      wgpuTextureRelease(m_target);
+    }
+
+    wgpuQueueRelease(m_queue);
+  }
+
+  bool Init();
+
+  std::vector<Result> Run();
+
+private:
+  /**
+   * Warm up once, then run `bench` `m_repeats` times.
+   *
+   * @param bench   makes `calls` calls, returns the nanoseconds they took
+   */
+  Result Measure(std::string name, uint32_t calls,
+                 const std::function<double(uint32_t)> &bench);
+
+  Result CreateBindGroup();
+
+  Result WriteBuffer(uint32_t size);
+
+  Result PassBeginEnd();
+
+  Result SetPipeline();
+
+  Result Draw();
+
+  Result EncoderFinish();
+
+  Result Submit();
+
+  WGPURenderPassEncoder BeginPass(WGPUCommandEncoder encoder);
+
+  /**
+   * Submit and wait, so the next benchmark does not pay for this one's
+   * command buffers and staging memory.
+   */
+  void Flush(WGPUCommandEncoder encoder);
+
+  void WaitIdle();
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+  uint32_t m_calls;
+  uint32_t m_repeats;
+
+  WGPUBindGroupLayout m_group_layout = nullptr;
+  WGPUBindGroup m_group = nullptr;
+  WGPUBuffer m_uniform_buffer = nullptr;
+  WGPUBuffer m_upload_buffer = nullptr;
+  WGPUTexture m_target = nullptr;
+  WGPUTextureView m_target_view = nullptr;
+  // same shader, blending on and off, so SetPipeline changes state
+  WGPURenderPipeline m_pipelines[2] = {};
+
+  std::vector<uint8_t> m_upload_data;
+};
+
+bool ApiOverhead::Init() {
+  const char *raw_shader = util::GetShader("api_overhead.wgsl");
+  if (raw_shader[0] == '\0') {
+    return false;
+  }
+
+  WGPUShaderModule shader = nullptr;
+  {
+    WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+    wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+    wgsl_desc.code = raw_shader;
+
+    WGPUShaderModuleDescriptor desc{};
+    desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+    shader = wgpuDeviceCreateShaderModule(m_device, &desc);
+  }
+
+  {
+    WGPUBindGroupLayoutEntry entry{};
+    entry.binding = 0;
+    entry.visibility = WGPUShaderStage_Fragment;
+    entry.buffer.type = WGPUBufferBindingType_Uniform;
+    entry.buffer.minBindingSize = sizeof(float) * 4;
+
+    WGPUBindGroupLayoutDescriptor desc{};
+    desc.entryCount = 1;
+    desc.entries = &entry;
+
+    m_group_layout = wgpuDeviceCreateBindGroupLayout(m_device, &desc);
+  }
+
+  {
+    WGPUBufferDescriptor desc{};
+    desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+    desc.size = 256;
+
+    m_uniform_buffer = wgpuDeviceCreateBuffer(m_device, &desc);
+  }
+
+  {
+    WGPUBindGroupEntry entry{};
+    entry.binding = 0;
+    entry.buffer = m_uniform_buffer;
+    entry.size = sizeof(float) * 4;
+
+    WGPUBindGroupDescriptor desc{};
+    desc.layout = m_group_layout;
+    desc.entryCount = 1;
+    desc.entries = &entry;
+
+    m_group = wgpuDeviceCreateBindGroup(m_device, &desc);
+  }
+
+  {
+    WGPUTextureDescriptor desc{};
+    desc.usage = WGPUTextureUsage_RenderAttachment;
+    desc.dimension = WGPUTextureDimension_2D;
+    desc.size = {kTargetSize, kTargetSize, 1};
+    desc.format = WGPUTextureFormat_RGBA8Unorm;
+    desc.mipLevelCount = 1;
+    desc.sampleCount = 1;
+
+    m_target = wgpuDeviceCreateTexture(m_device, &desc);
+    m_target_view = wgpuTextureCreateView(m_target, nullptr);
+  }
+
+  WGPUPipelineLayout layout = nullptr;
+  {
+    WGPUPipelineLayoutDescriptor desc{};
+    desc.bindGroupLayoutCount = 1;
+    desc.bindGroupLayouts = &m_group_layout;
+
+    layout = wgpuDeviceCreatePipelineLayout(m_device, &desc);
+  }
+
+  for (uint32_t i = 0; i < 2; i++) {
+    WGPUBlendState blend_state{};
+    blend_state.alpha.operation = WGPUBlendOperation_Add;
+    blend_state.alpha.srcFactor = WGPUBlendFactor_One;
+    blend_state.alpha.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha;
+    blend_state.color = blend_state.alpha;
+
+    WGPUColorTargetState color_target{};
+    color_target.writeMask = WGPUColorWriteMask_All;
+    color_target.blend = i == 0 ? nullptr : &blend_state;
+    color_target.format = WGPUTextureFormat_RGBA8Unorm;
+
+    WGPUFragmentState fs_state{};
+    fs_state.module = shader;
+    fs_state.entryPoint = "fs_main";
+    fs_state.targetCount = 1;
+    fs_state.targets = &color_target;
+
+    WGPURenderPipelineDescriptor desc{};
+    desc.layout = layout;
+    desc.vertex.module = shader;
+    desc.vertex.entryPoint = "vs_main";
+    desc.fragment = &fs_state;
+    desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+    desc.primitive.cullMode = WGPUCullMode_None;
+    desc.multisample.count = 1;
+    desc.multisample.mask = 0xffffffff;
+
+    m_pipelines[i] = wgpuDeviceCreateRenderPipeline(m_device, &desc);
+  }
+
+  wgpuPipelineLayoutRelease(layout);
+  wgpuShaderModuleRelease(shader);
+
+  return m_pipelines[0] && m_pipelines[1] && m_group;
+}
+
+std::vector<Result> ApiOverhead::Run() {
+  std::vector<Result> results;
+
+  results.emplace_back(CreateBindGroup());
+
+  for (uint32_t size : {16u, 256u, 4096u, 65536u, 1048576u}) {
+    results.emplace_back(WriteBuffer(size));
+  }
+
+  results.emplace_back(PassBeginEnd());
+  results.emplace_back(SetPipeline());
+  results.emplace_back(Draw());
+  results.emplace_back(EncoderFinish());
+  results.emplace_back(Submit());
+
+  return results;
+}
+
+Result ApiOverhead::Measure(std::string name, uint32_t calls,
+                            const std::function<double(uint32_t)> &bench) {
+  bench(calls);
+
+  std::vector<double> samples;
+  for (uint32_t i = 0; i < m_repeats; i++) {
+    samples.emplace_back(bench(calls) / calls);
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  Result result{};
+  result.name = std::move(name);
+  result.calls = calls;
+  result.median_ns = samples[samples.size() / 2];
+  result.min_ns = samples.front();
+
+  spdlog::info("{:<24} {:10.1f} ns/call (min {:.1f}, {} calls)", result.name,
+               result.median_ns, result.min_ns, calls);
+
+  return result;
+}
+
+Result ApiOverhead::CreateBindGroup() {
+  return Measure("CreateBindGroup", m_calls, [this](uint32_t calls) {
+    WGPUBindGroupEntry entry{};
+    entry.binding = 0;
+    entry.buffer = m_uniform_buffer;
+    entry.size = sizeof(float) * 4;
+
+    WGPUBindGroupDescriptor desc{};
+    desc.layout = m_group_layout;
+    desc.entryCount = 1;
+    desc.entries = &entry;
+
+    std::vector<WGPUBindGroup> groups(calls);
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+      groups[i] = wgpuDeviceCreateBindGroup(m_device, &desc);
+    }
+    double ns = ElapsedNs(start);
+
+    for (auto group : groups) {
+      wgpuBindGroupRelease(group);
+    }
+
+    return ns;
+  });
+}
+
+Result ApiOverhead::WriteBuffer(uint32_t size) {
+  if (m_upload_buffer == nullptr) {
+    WGPUBufferDescriptor desc{};
+    desc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex;
+    desc.size = 1048576;
+
+    m_upload_buffer = wgpuDeviceCreateBuffer(m_device, &desc);
+    m_upload_data.resize(desc.size, 0x5a);
+  }
+
+  // fewer calls for large sizes, the staging memory of a run stays bounded
+  uint32_t calls =
+      std::max<uint32_t>(m_calls / std::max<uint32_t>(size / 4096, 1), 16);
+
+  return Measure(fmt::format("WriteBuffer {}", size), calls,
+                 [this, size](uint32_t calls) {
+                   auto start = Clock::now();
+                   for (uint32_t i = 0; i < calls; i++) {
+                     wgpuQueueWriteBuffer(m_queue, m_upload_buffer, 0,
+                                          m_upload_data.data(), size);
+                   }
+                   double ns = ElapsedNs(start);
+
+                   WaitIdle();
+
+                   return ns;
+                 });
+}
+
+Result ApiOverhead::PassBeginEnd() {
+  return Measure("BeginRenderPass+End", m_calls, [this](uint32_t calls) {
+    auto encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+      auto pass = BeginPass(encoder);
+      wgpuRenderPassEncoderEnd(pass);
+      wgpuRenderPassEncoderRelease(pass);
+    }
+    double ns = ElapsedNs(start);
+
+    Flush(encoder);
+
+    return ns;
+  });
+}
+
+Result ApiOverhead::SetPipeline() {
+  return Measure("SetPipeline", m_calls, [this](uint32_t calls) {
+    auto encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+    auto pass = BeginPass(encoder);
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+      wgpuRenderPassEncoderSetPipeline(pass, m_pipelines[i & 1]);
+    }
+    double ns = ElapsedNs(start);
+
+    wgpuRenderPassEncoderEnd(pass);
+    wgpuRenderPassEncoderRelease(pass);
+    Flush(encoder);
+
+    return ns;
+  });
+}
+
+Result ApiOverhead::Draw() {
+  return Measure("Draw", m_calls, [this](uint32_t calls) {
+    auto encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+    auto pass = BeginPass(encoder);
+    wgpuRenderPassEncoderSetPipeline(pass, m_pipelines[0]);
+    wgpuRenderPassEncoderSetBindGroup(pass, 0, m_group, 0, nullptr);
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+      wgpuRenderPassEncoderDraw(pass, 3, 1, 0, 0);
+    }
+    double ns = ElapsedNs(start);
+
+    wgpuRenderPassEncoderEnd(pass);
+    wgpuRenderPassEncoderRelease(pass);
+    Flush(encoder);
+
+    return ns;
+  });
+}
+
+Result ApiOverhead::EncoderFinish() {
+  return Measure("CommandEncoder+Finish", m_calls, [this](uint32_t calls) {
+    std::vector<WGPUCommandBuffer> commands(calls);
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+      auto encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+      commands[i] = wgpuCommandEncoderFinish(encoder, nullptr);
+      wgpuCommandEncoderRelease(encoder);
+    }
+    double ns = ElapsedNs(start);
+
+    for (auto command : commands) {
+      wgpuCommandBufferRelease(command);
+    }
+
+    return ns;
+  });
+}
+
+Result ApiOverhead::Submit() {
+  return Measure("Submit", m_calls, [this](uint32_t calls) {
+    // one pass each, an empty command buffer could be skipped
+    std::vector<WGPUCommandBuffer> commands(calls);
+    for (uint32_t i = 0; i < calls; i++) {
+      auto encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+      auto pass = BeginPass(encoder);
+      wgpuRenderPassEncoderEnd(pass);
+      wgpuRenderPassEncoderRelease(pass);
+      commands[i] = wgpuCommandEncoderFinish(encoder, nullptr);
+      wgpuCommandEncoderRelease(encoder);
+    }
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+      wgpuQueueSubmit(m_queue, 1, &commands[i]);
+    }
+    double ns = ElapsedNs(start);
+
+    for (auto command : commands) {
+      wgpuCommandBufferRelease(command);
+    }
+
+    WaitIdle();
+
+    return ns;
+  });
+}
+
+WGPURenderPassEncoder ApiOverhead::BeginPass(WGPUCommandEncoder encoder) {
+  WGPURenderPassColorAttachment attachment{};
+  attachment.view = m_target_view;
+  attachment.loadOp = WGPULoadOp_Clear;
+  attachment.storeOp = WGPUStoreOp_Store;
+  attachment.clearValue = {0.f, 0.f, 0.f, 1.f};
+
+  WGPURenderPassDescriptor desc{};
+  desc.colorAttachmentCount = 1;
+  desc.colorAttachments = &attachment;
+
+  return wgpuCommandEncoderBeginRenderPass(encoder, &desc);
+}
+
+void ApiOverhead::Flush(WGPUCommandEncoder encoder) {
+  auto command = wgpuCommandEncoderFinish(encoder, nullptr);
+  wgpuCommandEncoderRelease(encoder);
+
+  wgpuQueueSubmit(m_queue, 1, &command);
+  wgpuCommandBufferRelease(command);
+
+  WaitIdle();
+}
+
+void ApiOverhead::WaitIdle() {
+  bool done = false;
+
+  wgpuQueueOnSubmittedWorkDone(
+      m_queue, 0,
+      [](WGPUQueueWorkDoneStatus status, void *userdata) {
+        *reinterpret_cast<bool *>(userdata) = true;
+      },
+      &done);
+
+  while (!done) {
+    wgpuDeviceTick(m_device);
+  }
+}
+
+bool WriteJson(const std::string &path, const std::string &adapter,
+               util::RunProfile profile, const std::vector<Result> &results) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    spdlog::error("can not write {}", path);
+    return false;
+  }
+
+  std::string entries;
+  for (const auto &result : results) {
+    if (!entries.empty()) {
+      entries += ", ";
+    }
+    entries += fmt::format("{{\"name\": \"{}\", \"calls\": {}, "
+                           "\"median_ns\": {:.2f}, \"min_ns\": {:.2f}}}",
+                           result.name, result.calls, result.median_ns,
+                           result.min_ns);
+  }
+
+  file << fmt::format("{{\"adapter\": \"{}\", \"profile\": \"{}\", "
+                      "\"results\": [{}]}}\n",
+                      adapter, util::RunProfileName(profile), entries);
+
+  return file.good();
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  // the Null backend, see WEBGPU_ENABLE_NULL
+  std::string adapter_choice = "null";
+  auto profile = util::DefaultRunProfile();
+  uint32_t calls = 10000;
+  uint32_t repeats = 9;
+  std::string json;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--adapter") == 0 && i + 1 < argc) {
+      adapter_choice = argv[++i];
+    } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      if (!util::ParseRunProfile(argv[++i], profile)) {
+        spdlog::warn("unknown profile {}", argv[i]);
+      }
+    } else if (std::strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+      calls = std::max<uint32_t>(
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)), 1);
+    } else if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+      repeats = std::max<uint32_t>(
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)), 1);
+    } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json = argv[++i];
+    } else {
+      spdlog::error("usage: api-overhead [--adapter CHOICE] [--profile "
+                    "PROFILE] [--calls N] [--repeats N] [--json PATH]");
+      return 2;
+    }
+  }
+
+  WGPUInstanceDescriptor instance_desc{};
+  auto instance = wgpuCreateInstance(&instance_desc);
+
+  auto adapter =
+      util::SelectAdapter(instance, nullptr,
+                          util::AdapterChoice::Parse(adapter_choice), false);
+  if (adapter == nullptr) {
+    if (adapter_choice == "null") {
+      spdlog::error("configure with -DWEBGPU_ENABLE_NULL=ON for the Null "
+                    "backend, or pick an adapter with --adapter");
+    }
+    wgpuInstanceRelease(instance);
+    return 2;
+  }
+
+  WGPUAdapterProperties props{};
+  wgpuAdapterGetProperties(adapter, &props);
+  std::string adapter_name = props.name ? props.name : "unknown";
+
+  WGPUDeviceDescriptor device_desc{};
+  util::DeviceToggles toggles(profile);
+  toggles.Chain(device_desc);
+
+  auto device = wgpuAdapterCreateDevice(adapter, &device_desc);
+  if (device == nullptr) {
+    spdlog::error("device creation failed");
+    wgpuAdapterRelease(adapter);
+    wgpuInstanceRelease(instance);
+    return 2;
+  }
+
+  int ret = 0;
+  {
+    util::DeviceLog log;
+    log.Attach(device, profile != util::RunProfile::kRelease);
+
+    spdlog::info("{} on {}, {} calls, median of {} runs",
+                 util::RunProfileName(profile), adapter_name, calls, repeats);
+
+    {
+      ApiOverhead bench(device, calls, repeats);
+      if (bench.Init()) {
+        auto results = bench.Run();
+
+        if (!json.empty() && WriteJson(json, adapter_name, profile, results)) {
+          spdlog::info("results written to {}", json);
+        }
+      } else {
+        ret = 2;
+      }
+    }
+
+    // the log outlives the device, its callbacks point at it
+    wgpuDeviceRelease(device);
+  }
+
+  wgpuAdapterRelease(adapter);
+  wgpuInstanceRelease(instance);
+
+  return ret;
+}
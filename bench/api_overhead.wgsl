@@ -0,0 +1,20 @@
+// Pipeline of the API overhead benchmark: one triangle from the vertex index,
+// colored by a uniform so the bind group is used.
+
+@group(0) @binding(0) var<uniform> color: vec4<f32>;
+
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32) -> @builtin(position) vec4<f32> {
+  var positions = array<vec2<f32>, 3>(
+    vec2<f32>(0.0, 0.5),
+    vec2<f32>(-0.5, -0.5),
+    vec2<f32>(0.5, -0.5),
+  );
+
+  return vec4<f32>(positions[index], 0.0, 1.0);
+}
+
+@fragment
+fn fs_main() -> @location(0) vec4<f32> {
+  return color;
+}
@@ -0,0 +1,22 @@
+# Merge the per sample results in BENCH_DIR into one JSON array in OUTPUT.
+
+file(GLOB results ${BENCH_DIR}/*.json)
+list(REMOVE_ITEM results ${OUTPUT})
+list(SORT results)
+
+set(content "[\n")
+set(separator "")
+
+foreach(result ${results})
+  file(READ ${result} json)
+  string(STRIP "${json}" json)
+  string(APPEND content "${separator}  ${json}")
+  set(separator ",\n")
+endforeach()
+
+string(APPEND content "\n]\n")
+
+file(WRITE ${OUTPUT} "${content}")
+
+list(LENGTH results count)
+message(STATUS "${count} results written to ${OUTPUT}")
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <png.h>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Image {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> rgba;
+};
+
+bool ReadPng(const char *path, Image &image) {
+  png_image png{};
+  png.version = PNG_IMAGE_VERSION;
+
+  if (!png_image_begin_read_from_file(&png, path)) {
+    spdlog::error("can not read {}: {}", path, png.message);
+    return false;
+  }
+
+  png.format = PNG_FORMAT_RGBA;
+
+  image.width = png.width;
+  image.height = png.height;
+  image.rgba.resize(PNG_IMAGE_SIZE(png));
+
+  if (!png_image_finish_read(&png, nullptr, image.rgba.data(), 0, nullptr)) {
+    spdlog::error("can not decode {}: {}", path, png.message);
+    png_image_free(&png);
+    return false;
+  }
+
+  return true;
+}
+
+bool WritePng(const char *path, const Image &image) {
+  png_image png{};
+  png.version = PNG_IMAGE_VERSION;
+  png.width = image.width;
+  png.height = image.height;
+  png.format = PNG_FORMAT_RGBA;
+
+  return png_image_write_to_file(&png, path, 0, image.rgba.data(), 0,
+                                 nullptr) != 0;
+}
+
+// YIQ of the color blended over white
+void ToYIQ(const uint8_t *p, double yiq[3]) {
+  double alpha = p[3] / 255.0;
+  double r = 255.0 + (p[0] - 255.0) * alpha;
+  double g = 255.0 + (p[1] - 255.0) * alpha;
+  double b = 255.0 + (p[2] - 255.0) * alpha;
+
+  yiq[0] = r * 0.29889531 + g * 0.58662247 + b * 0.11448223;
+  yiq[1] = r * 0.59597799 - g * 0.27417610 - b * 0.32180189;
+  yiq[2] = r * 0.21147017 - g * 0.52261711 + b * 0.31114694;
+}
+
+/**
+ * Perceived difference of two pixels, 0 for equal colors up to 1 for the most
+ * distant pair, black against white is about 0.93. Weights luma over chroma like the eye does (Kotsarenko and
+ * Ramos, "Measuring perceived color difference using YIQ NTSC transmission
+ * color space").
+ */
+double ColorDelta(const uint8_t *a, const uint8_t *b) {
+  // largest delta over all color pairs, as pixelmatch uses it
+  constexpr double kMaxDelta = 35215.0;
+
+  double ya[3];
+  double yb[3];
+  ToYIQ(a, ya);
+  ToYIQ(b, yb);
+
+  double y = ya[0] - yb[0];
+  double i = ya[1] - yb[1];
+  double q = ya[2] - yb[2];
+
+  return std::sqrt((0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q) /
+                   kMaxDelta);
+}
+
+/**
+ * image <expected.png> <actual.png> [--threshold T] [--max-pixels P]
+ *       [--diff diff.png]
+ *
+ * A pixel differs when its ColorDelta is above T, the images differ when
+ * more than P percent of the pixels differ.
+ */
+int CompareImages(int argc, const char **argv) {
+  const char *paths[2] = {};
+  uint32_t path_count = 0;
+  double threshold = 0.1;
+  double max_pixels = 0.1;
+  const char *diff_path = nullptr;
+
+  for (int i = 0; i < argc; i++) {
+    if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      threshold = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--max-pixels") == 0 && i + 1 < argc) {
+      max_pixels = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--diff") == 0 && i + 1 < argc) {
+      diff_path = argv[++i];
+    } else if (path_count < 2) {
+      paths[path_count++] = argv[i];
+    }
+  }
+
+  if (path_count != 2) {
+    spdlog::error("usage: regression-check image <expected.png> <actual.png> "
+                  "[--threshold T] [--max-pixels P] [--diff diff.png]");
+    return 2;
+  }
+
+  Image expected;
+  Image actual;
+  if (!ReadPng(paths[0], expected) || !ReadPng(paths[1], actual)) {
+    return 2;
+  }
+
+  if (expected.width != actual.width || expected.height != actual.height) {
+    spdlog::error("size differs: expected {}x{}, got {}x{}", expected.width,
+                  expected.height, actual.width, actual.height);
+    return 1;
+  }
+
+  uint64_t pixels = uint64_t(expected.width) * expected.height;
+  uint64_t different = 0;
+  double max_delta = 0.0;
+
+  // expected faded to gray, differing pixels in red
+  Image diff = expected;
+
+  for (uint64_t i = 0; i < pixels; i++) {
+    const uint8_t *a = expected.rgba.data() + i * 4;
+    const uint8_t *b = actual.rgba.data() + i * 4;
+    uint8_t *d = diff.rgba.data() + i * 4;
+
+    double delta = ColorDelta(a, b);
+    max_delta = std::max(max_delta, delta);
+
+    if (delta > threshold) {
+      different++;
+      d[0] = 255;
+      d[1] = 0;
+      d[2] = 0;
+    } else {
+      double yiq[3];
+      ToYIQ(a, yiq);
+      auto gray = static_cast<uint8_t>(255.0 - (255.0 - yiq[0]) * 0.1);
+      d[0] = gray;
+      d[1] = gray;
+      d[2] = gray;
+    }
+    d[3] = 255;
+  }
+
+  double percent =
+      pixels > 0 ? 100.0 * static_cast<double>(different) / pixels : 0.0;
+
+  if (diff_path && different > 0) {
+    WritePng(diff_path, diff);
+  }
+
+  if (percent > max_pixels) {
+    spdlog::error("{}: {} pixels ({:.3f}%) differ, max delta {:.3f}",
+                  paths[1], different, percent, max_delta);
+    return 1;
+  }
+
+  spdlog::info("{}: {} pixels ({:.3f}%) differ, max delta {:.3f}", paths[1],
+               different, percent, max_delta);
+
+  return 0;
+}
+
+bool ReadFile(const char *path, std::string &content) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    spdlog::error("can not read {}", path);
+    return false;
+  }
+
+  std::stringstream stream;
+  stream << file.rdbuf();
+  content = stream.str();
+
+  return true;
+}
+
+// `"group": {..., "key": value, ...}` as FrameBench writes it
+bool ReadMetric(const std::string &json, const char *group, const char *key,
+                double &value) {
+  auto start = json.find(std::string("\"") + group + "\"");
+  if (start == std::string::npos) {
+    return false;
+  }
+
+  auto end = json.find('}', start);
+  auto pos = json.find(std::string("\"") + key + "\"", start);
+  if (pos == std::string::npos || pos > end) {
+    return false;
+  }
+
+  pos = json.find(':', pos);
+  if (pos == std::string::npos) {
+    return false;
+  }
+
+  value = std::strtod(json.c_str() + pos + 1, nullptr);
+
+  return true;
+}
+
+/**
+ * timing <baseline.json> <result.json> [--tolerance PERCENT] [--min-ms MS]
+ *
+ * Fails when the median CPU or GPU frame time grew by more than PERCENT.
+ * Differences below MS are noise and never fail.
+ */
+int CompareTiming(int argc, const char **argv) {
+  const char *paths[2] = {};
+  uint32_t path_count = 0;
+  double tolerance = 10.0;
+  double min_ms = 0.05;
+
+  for (int i = 0; i < argc; i++) {
+    if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+      min_ms = std::strtod(argv[++i], nullptr);
+    } else if (path_count < 2) {
+      paths[path_count++] = argv[i];
+    }
+  }
+
+  if (path_count != 2) {
+    spdlog::error("usage: regression-check timing <baseline.json> "
+                  "<result.json> [--tolerance PERCENT] [--min-ms MS]");
+    return 2;
+  }
+
+  std::string baseline;
+  std::string result;
+  if (!ReadFile(paths[0], baseline) || !ReadFile(paths[1], result)) {
+    return 2;
+  }
+
+  int ret = 0;
+
+  for (const char *group : {"cpu_ms", "gpu_ms"}) {
+    double expected = 0.0;
+    double actual = 0.0;
+
+    if (!ReadMetric(baseline, group, "p50", expected) ||
+        !ReadMetric(result, group, "p50", actual)) {
+      spdlog::error("{}.p50 missing", group);
+      return 2;
+    }
+
+    double change =
+        expected > 0.0 ? (actual - expected) / expected * 100.0 : 0.0;
+
+    bool regressed = actual - expected > min_ms && change > tolerance;
+
+    if (regressed) {
+      spdlog::error("{}: {} p50 {:.4f} ms, baseline {:.4f} ms ({:+.1f}%, "
+                    "limit {:.1f}%)",
+                    paths[1], group, actual, expected, change, tolerance);
+      ret = 1;
+    } else {
+      spdlog::info("{}: {} p50 {:.4f} ms, baseline {:.4f} ms ({:+.1f}%)",
+                   paths[1], group, actual, expected, change);
+    }
+  }
+
+  return ret;
+}
+
+} // namespace
+
+// exit code 0 passes, 1 is a regression, 2 an error
+int main(int argc, const char **argv) {
+  if (argc >= 2 && std::strcmp(argv[1], "image") == 0) {
+    return CompareImages(argc - 2, argv + 2);
+  }
+
+  if (argc >= 2 && std::strcmp(argv[1], "timing") == 0) {
+    return CompareTiming(argc - 2, argv + 2);
+  }
+
+  spdlog::error("usage: regression-check image|timing ...");
+
+  return 2;
+}
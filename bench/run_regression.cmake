@@ -0,0 +1,106 @@
+# Render every sample in SAMPLES_FILE headless and compare the last frame and
+# the frame times against the goldens in DATA_DIR:
+#
+#   DATA_DIR/<sample>.png    expected last frame
+#   DATA_DIR/<sample>.json   baseline bench result
+#
+# With UPDATE the results of this run become the new goldens instead. A
+# missing golden fails the check unless BOOTSTRAP is set, then it only warns.
+
+include(${SAMPLES_FILE})
+
+file(REMOVE_RECURSE ${OUTPUT_DIR})
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+math(EXPR capture_frame "${FRAMES} - 1")
+
+# ImageSequenceSink names the frames frame_NNNNNN.png
+set(frame_name "${capture_frame}")
+string(LENGTH "${frame_name}" digits)
+while(digits LESS 6)
+  set(frame_name "0${frame_name}")
+  math(EXPR digits "${digits} + 1")
+endwhile()
+
+set(failures)
+
+# a missing golden would otherwise pass every run without checking anything
+function(missing_golden sample what)
+  if(BOOTSTRAP)
+    message(WARNING "${sample}: no ${what}, run webgpu-regression-update")
+  else()
+    set(failures ${failures}
+      "${sample}: no ${what} in ${DATA_DIR}, run webgpu-regression-update"
+      PARENT_SCOPE)
+  endif()
+endfunction()
+
+foreach(sample ${REGRESSION_SAMPLES})
+  set(executable ${REGRESSION_${sample}})
+  set(capture_dir ${OUTPUT_DIR}/${sample})
+  set(result ${OUTPUT_DIR}/${sample}.json)
+
+  set(frame ${capture_dir}/frame_${frame_name}.png)
+
+  set(args --headless --frames ${FRAMES} --bench-json ${result}
+           --capture ${capture_dir} --capture-frame ${capture_frame})
+  if(FALLBACK)
+    list(APPEND args --fallback-adapter)
+  endif()
+
+  message(STATUS "${sample}")
+  execute_process(
+    COMMAND ${executable} ${args}
+    RESULT_VARIABLE status
+    OUTPUT_QUIET
+  )
+
+  if(NOT status EQUAL 0 OR NOT EXISTS ${frame} OR NOT EXISTS ${result})
+    list(APPEND failures "${sample}: run failed (${status})")
+    continue()
+  endif()
+
+  if(UPDATE)
+    configure_file(${frame} ${DATA_DIR}/${sample}.png COPYONLY)
+    configure_file(${result} ${DATA_DIR}/${sample}.json COPYONLY)
+    continue()
+  endif()
+
+  if(EXISTS ${DATA_DIR}/${sample}.png)
+    execute_process(
+      COMMAND ${CHECK} image ${DATA_DIR}/${sample}.png ${frame}
+              --threshold ${THRESHOLD} --max-pixels ${MAX_PIXELS}
+              --diff ${OUTPUT_DIR}/${sample}_diff.png
+      RESULT_VARIABLE status
+    )
+    if(NOT status EQUAL 0)
+      list(APPEND failures "${sample}: image differs")
+    endif()
+  else()
+    missing_golden(${sample} "golden image")
+  endif()
+
+  if(EXISTS ${DATA_DIR}/${sample}.json)
+    execute_process(
+      COMMAND ${CHECK} timing ${DATA_DIR}/${sample}.json ${result}
+              --tolerance ${TOLERANCE}
+      RESULT_VARIABLE status
+    )
+    if(NOT status EQUAL 0)
+      list(APPEND failures "${sample}: frame time regressed")
+    endif()
+  else()
+    missing_golden(${sample} "baseline")
+  endif()
+endforeach()
+
+if(failures)
+  string(REPLACE ";" "\n  " report "${failures}")
+  message(FATAL_ERROR "regression check failed:\n  ${report}")
+endif()
+
+if(UPDATE)
+  message(STATUS "goldens written to ${DATA_DIR}")
+else()
+  message(STATUS "regression check passed")
+endif()
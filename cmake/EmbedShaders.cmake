@@ -0,0 +1,47 @@
+# webgpu_embed_shaders(<target> <shader.wgsl>...)
+#
+# Validate the WGSL files at build time and compile them into <target>, where
+# util::GetShader finds them by file name. An invalid shader fails the build
+# with the compiler messages of Tint, run through Dawn's shader module
+# creation by wgsl-validate on the Null backend, so no GPU is needed.
+#
+# Included before Dawn, WEBGPU_VALIDATE_SHADERS turns on its Null backend.
+
+option(WEBGPU_VALIDATE_SHADERS
+  "Validate WGSL at build time, builds Dawn's Null backend" ON)
+
+set(WEBGPU_EMBED_SHADERS_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/embed_shaders.cmake)
+
+function(webgpu_embed_shaders target)
+  set(shaders)
+  foreach(shader ${ARGN})
+    get_filename_component(path ${shader} ABSOLUTE)
+    list(APPEND shaders ${path})
+  endforeach()
+
+  string(MAKE_C_IDENTIFIER ${target} name)
+  set(output ${CMAKE_CURRENT_BINARY_DIR}/${target}_shaders.cc)
+
+  set(validate)
+  set(validator)
+  if(WEBGPU_VALIDATE_SHADERS)
+    set(validate COMMAND $<TARGET_FILE:wgsl-validate> ${shaders})
+    set(validator wgsl-validate)
+  endif()
+
+  # a list would be split into several arguments
+  string(REPLACE ";" "|" shader_list "${shaders}")
+
+  add_custom_command(
+    OUTPUT ${output}
+    ${validate}
+    COMMAND ${CMAKE_COMMAND} -DOUTPUT=${output} -DNAME=${name}
+            -DSHADERS=${shader_list}
+            -P ${WEBGPU_EMBED_SHADERS_SCRIPT}
+    DEPENDS ${shaders} ${WEBGPU_EMBED_SHADERS_SCRIPT} ${validator}
+    COMMENT "Embedding shaders of ${target}"
+    VERBATIM
+  )
+
+  target_sources(${target} PRIVATE ${output})
+endfunction()
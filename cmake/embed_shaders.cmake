@@ -0,0 +1,55 @@
+# Write the WGSL files in SHADERS, separated by |, into the C++ source OUTPUT,
+# which registers them with util::RegisterShaders. NAME names the registration
+# function, util::embedded::RegisterShaders_<NAME>.
+
+string(REPLACE "|" ";" shaders "${SHADERS}")
+
+# CMake regular expressions have no repetition count
+set(line_pattern "")
+foreach(i RANGE 15)
+  string(APPEND line_pattern "\\\\x..")
+endforeach()
+
+set(tables "")
+set(entries "")
+set(index 0)
+
+foreach(shader ${shaders})
+  get_filename_component(file ${shader} NAME)
+
+  file(READ ${shader} hex HEX)
+  string(LENGTH "${hex}" hex_length)
+  math(EXPR size "${hex_length} / 2")
+
+  # escaped bytes, a brace list of chars would narrow the UTF-8 ones
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "\\\\x\\1" bytes "${hex}")
+  string(REGEX REPLACE "(${line_pattern})" "\\1\"\n    \"" bytes "${bytes}")
+
+  string(APPEND tables
+    "// ${file}\n"
+    "constexpr char kShader${index}[] =\n    \"${bytes}\";\n\n")
+  string(APPEND entries "    {\"${file}\", kShader${index}, ${size}},\n")
+
+  math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE ${OUTPUT}
+  "// generated by webgpu_embed_shaders, do not edit\n\n"
+  "#include \"shader_library.hpp\"\n\n"
+  "namespace {\n\n"
+  "${tables}"
+  "constexpr util::EmbeddedShader kShaders[] = {\n"
+  "${entries}"
+  "};\n\n"
+  "} // namespace\n\n"
+  "namespace util {\n"
+  "namespace embedded {\n\n"
+  "void RegisterShaders_${NAME}() {\n"
+  "  RegisterShaders(kShaders, sizeof(kShaders) / sizeof(kShaders[0]));\n"
+  "}\n\n"
+  "} // namespace embedded\n"
+  "} // namespace util\n\n"
+  "namespace {\n\n"
+  "// executables register at startup, libraries call the function above\n"
+  "const bool kRegistered = (util::embedded::RegisterShaders_${NAME}(), true);\n\n"
+  "} // namespace\n")
@@ -0,0 +1,434 @@
+#include "adapter_select.hpp"
+#include "null_adapter.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+namespace {
+
+// the probe dispatches over 4 MB, large enough to leave the caches
+constexpr uint32_t kProbeElements = 1 << 18;
+constexpr uint32_t kProbeDispatches = 8;
+constexpr uint32_t kProbeRuns = 3;
+
+void RequestAdapterCallback(WGPURequestAdapterStatus status,
+                            WGPUAdapter adapter, char const *message,
+                            void *userdata) {
+  if (status != WGPURequestAdapterStatus_Success) {
+    return;
+  }
+
+  *reinterpret_cast<WGPUAdapter *>(userdata) = adapter;
+}
+
+bool SameAdapter(const WGPUAdapterProperties &a,
+                 const WGPUAdapterProperties &b) {
+  auto name_a = a.name ? a.name : "";
+  auto name_b = b.name ? b.name : "";
+
+  return a.vendorID == b.vendorID && a.deviceID == b.deviceID &&
+         a.backendType == b.backendType && a.adapterType == b.adapterType &&
+         std::strcmp(name_a, name_b) == 0;
+}
+
+std::string Lower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return value;
+}
+
+// lower is preferred
+uint32_t TypeRank(WGPUAdapterType type, bool low_power) {
+  switch (type) {
+  case WGPUAdapterType_DiscreteGPU:
+    return low_power ? 1 : 0;
+  case WGPUAdapterType_IntegratedGPU:
+    return low_power ? 0 : 1;
+  case WGPUAdapterType_CPU:
+    return 3;
+  default:
+    return 2;
+  }
+}
+
+void LogAdapter(uint32_t index, const AdapterInfo &info) {
+  const auto &props = info.properties;
+  const auto &limits = info.limits.limits;
+
+  spdlog::info("adapter {}: {} ({}), {}, {}, vendor 0x{:04x} device 0x{:04x}",
+               index, props.name ? props.name : "unknown",
+               props.driverDescription ? props.driverDescription : "",
+               AdapterTypeName(props.adapterType),
+               BackendTypeName(props.backendType), props.vendorID,
+               props.deviceID);
+
+  spdlog::info("  max texture 2D {}, max buffer {} MB, max storage binding {} "
+               "MB, workgroup storage {} KB, {} invocations per workgroup",
+               limits.maxTextureDimension2D, limits.maxBufferSize >> 20,
+               limits.maxStorageBufferBindingSize >> 20,
+               limits.maxComputeWorkgroupStorageSize >> 10,
+               limits.maxComputeInvocationsPerWorkgroup);
+}
+
+void WaitIdle(WGPUDevice device, WGPUQueue queue) {
+  bool done = false;
+
+  wgpuQueueOnSubmittedWorkDone(
+      queue, 0,
+      [](WGPUQueueWorkDoneStatus status, void *userdata) {
+        *reinterpret_cast<bool *>(userdata) = true;
+      },
+      &done);
+
+  while (!done) {
+    wgpuDeviceTick(device);
+  }
+}
+
+} // namespace
+
+AdapterChoice AdapterChoice::Parse(const std::string &value) {
+  AdapterChoice choice{};
+
+  if (value.empty() || value == "default") {
+    choice.policy = AdapterPolicy::kDefault;
+  } else if (value == "discrete") {
+    choice.policy = AdapterPolicy::kDiscrete;
+  } else if (value == "low-power") {
+    choice.policy = AdapterPolicy::kLowPower;
+  } else if (value == "fastest") {
+    choice.policy = AdapterPolicy::kFastest;
+  } else {
+    choice.policy = AdapterPolicy::kName;
+    choice.name = value;
+  }
+
+  return choice;
+}
+
+std::vector<AdapterInfo> EnumerateAdapters(WGPUInstance instance,
+                                           WGPUSurface surface,
+                                           bool fallback) {
+  // 0 first, it is Null in this header but asks for no particular backend,
+  // the default adapter
+  static const WGPUBackendType backends[] = {
+      WGPUBackendType_Null,   WGPUBackendType_D3D12,  WGPUBackendType_Metal,
+      WGPUBackendType_Vulkan, WGPUBackendType_D3D11,  WGPUBackendType_OpenGL,
+      WGPUBackendType_OpenGLES,
+  };
+
+  static const WGPUPowerPreference preferences[] = {
+      WGPUPowerPreference_Undefined,
+      WGPUPowerPreference_HighPerformance,
+      WGPUPowerPreference_LowPower,
+  };
+
+  std::vector<AdapterInfo> adapters;
+
+  auto add = [&](WGPUAdapter adapter) {
+    if (adapter == nullptr) {
+      return;
+    }
+
+    AdapterInfo info{};
+    info.adapter = adapter;
+    wgpuAdapterGetProperties(adapter, &info.properties);
+    wgpuAdapterGetLimits(adapter, &info.limits);
+
+    bool known = std::any_of(
+        adapters.begin(), adapters.end(), [&](const AdapterInfo &other) {
+          return SameAdapter(other.properties, info.properties);
+        });
+
+    if (known) {
+      wgpuAdapterRelease(adapter);
+    } else {
+      adapters.emplace_back(info);
+    }
+  };
+
+  for (auto backend : backends) {
+    for (auto preference : preferences) {
+      WGPURequestAdapterOptions opts{};
+      opts.compatibleSurface = surface;
+      opts.powerPreference = preference;
+      opts.backendType = backend;
+      opts.forceFallbackAdapter = fallback;
+
+      WGPUAdapter adapter = nullptr;
+      wgpuInstanceRequestAdapter(instance, &opts, &RequestAdapterCallback,
+                                 &adapter);
+
+      add(adapter);
+    }
+  }
+
+  // no request selects the Null backend, it is only returned without a GPU
+  if (!fallback) {
+    add(RequestNullAdapter(instance));
+  }
+
+  return adapters;
+}
+
+double ProbeAdapter(WGPUAdapter adapter) {
+  const char *raw_shader = GetShader("probe.wgsl");
+  if (raw_shader[0] == '\0') {
+    return -1.0;
+  }
+
+  WGPUDeviceDescriptor device_desc{};
+  auto device = wgpuAdapterCreateDevice(adapter, &device_desc);
+  if (device == nullptr) {
+    return -1.0;
+  }
+
+  auto queue = wgpuDeviceGetQueue(device);
+
+  WGPUShaderModule shader = nullptr;
+  {
+    WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+    wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+    wgsl_desc.code = raw_shader;
+
+    WGPUShaderModuleDescriptor desc{};
+    desc.label = "Adapter probe shader";
+    desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+    shader = wgpuDeviceCreateShaderModule(device, &desc);
+  }
+
+  WGPUComputePipeline pipeline = nullptr;
+  {
+    WGPUComputePipelineDescriptor desc{};
+    desc.label = "Adapter probe";
+    desc.compute.module = shader;
+    desc.compute.entryPoint = "cs_main";
+
+    pipeline = wgpuDeviceCreateComputePipeline(device, &desc);
+  }
+
+  WGPUBuffer buffer = nullptr;
+  {
+    WGPUBufferDescriptor desc{};
+    desc.label = "Adapter probe buffer";
+    desc.usage = WGPUBufferUsage_Storage;
+    desc.size = uint64_t(kProbeElements) * sizeof(float) * 4;
+
+    buffer = wgpuDeviceCreateBuffer(device, &desc);
+  }
+
+  auto layout = wgpuComputePipelineGetBindGroupLayout(pipeline, 0);
+
+  WGPUBindGroup group = nullptr;
+  {
+    WGPUBindGroupEntry entry{};
+    entry.binding = 0;
+    entry.buffer = buffer;
+    entry.size = WGPU_WHOLE_SIZE;
+
+    WGPUBindGroupDescriptor desc{};
+    desc.layout = layout;
+    desc.entryCount = 1;
+    desc.entries = &entry;
+
+    group = wgpuDeviceCreateBindGroup(device, &desc);
+  }
+
+  double best = -1.0;
+
+  // the first run pays for pipeline and memory warm up and is not counted
+  for (uint32_t run = 0; run <= kProbeRuns; run++) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto encoder = wgpuDeviceCreateCommandEncoder(device, nullptr);
+    auto pass = wgpuCommandEncoderBeginComputePass(encoder, nullptr);
+
+    wgpuComputePassEncoderSetPipeline(pass, pipeline);
+    wgpuComputePassEncoderSetBindGroup(pass, 0, group, 0, nullptr);
+
+    for (uint32_t i = 0; i < kProbeDispatches; i++) {
+      wgpuComputePassEncoderDispatchWorkgroups(pass, kProbeElements / 64, 1,
+                                               1);
+    }
+
+    wgpuComputePassEncoderEnd(pass);
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+    wgpuQueueSubmit(queue, 1, &cmd);
+
+    wgpuCommandBufferRelease(cmd);
+    wgpuComputePassEncoderRelease(pass);
+    wgpuCommandEncoderRelease(encoder);
+
+    WaitIdle(device, queue);
+
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    if (run > 0 && (best < 0.0 || ms < best)) {
+      best = ms;
+    }
+  }
+
+  wgpuBindGroupRelease(group);
+  wgpuBindGroupLayoutRelease(layout);
+  wgpuBufferDestroy(buffer);
+  wgpuBufferRelease(buffer);
+  wgpuComputePipelineRelease(pipeline);
+  wgpuShaderModuleRelease(shader);
+  wgpuQueueRelease(queue);
+  wgpuDeviceDestroy(device);
+  wgpuDeviceRelease(device);
+
+  return best;
+}
+
+WGPUAdapter SelectAdapter(WGPUInstance instance, WGPUSurface surface,
+                          const AdapterChoice &choice, bool fallback) {
+  auto adapters = EnumerateAdapters(instance, surface, fallback);
+
+  if (adapters.empty()) {
+    spdlog::error("no adapter found");
+    return nullptr;
+  }
+
+  for (uint32_t i = 0; i < adapters.size(); i++) {
+    LogAdapter(i, adapters[i]);
+  }
+
+  // the Null adapter renders nothing and always wins the probe, only a name
+  // picks it
+  auto renders = [&](uint32_t i) {
+    return adapters[i].properties.backendType != WGPUBackendType_Null;
+  };
+
+  // enumeration starts with the default request
+  int32_t selected = -1;
+  for (uint32_t i = 0; i < adapters.size() && selected < 0; i++) {
+    if (renders(i)) {
+      selected = i;
+    }
+  }
+
+  switch (choice.policy) {
+  case AdapterPolicy::kDefault:
+    break;
+  case AdapterPolicy::kDiscrete:
+  case AdapterPolicy::kLowPower: {
+    bool low_power = choice.policy == AdapterPolicy::kLowPower;
+
+    // stable, ties keep the enumeration order
+    for (uint32_t i = selected + 1; selected >= 0 && i < adapters.size();
+         i++) {
+      if (renders(i) &&
+          TypeRank(adapters[i].properties.adapterType, low_power) <
+              TypeRank(adapters[selected].properties.adapterType, low_power)) {
+        selected = i;
+      }
+    }
+  } break;
+  case AdapterPolicy::kName: {
+    auto pattern = Lower(choice.name);
+
+    selected = -1;
+    for (uint32_t i = 0; i < adapters.size() && selected < 0; i++) {
+      const auto &props = adapters[i].properties;
+
+      auto name = Lower(std::string(props.name ? props.name : "") + " " +
+                        (props.driverDescription ? props.driverDescription
+                                                 : ""));
+
+      if (name.find(pattern) != std::string::npos) {
+        selected = i;
+      }
+    }
+
+    if (selected < 0) {
+      spdlog::error("no adapter matches \"{}\"", choice.name);
+    }
+  } break;
+  case AdapterPolicy::kFastest: {
+    double best = -1.0;
+
+    for (uint32_t i = 0; i < adapters.size(); i++) {
+      if (!renders(i)) {
+        continue;
+      }
+
+      double ms = ProbeAdapter(adapters[i].adapter);
+
+      spdlog::info("adapter {}: probe {:.3f} ms", i, ms);
+
+      if (ms >= 0.0 && (best < 0.0 || ms < best)) {
+        best = ms;
+        selected = i;
+      }
+    }
+  } break;
+  }
+
+  WGPUAdapter adapter = nullptr;
+
+  for (uint32_t i = 0; i < adapters.size(); i++) {
+    if (static_cast<int32_t>(i) == selected) {
+      adapter = adapters[i].adapter;
+    } else {
+      wgpuAdapterRelease(adapters[i].adapter);
+    }
+  }
+
+  if (adapter) {
+    spdlog::info("using adapter {}", selected);
+  } else if (choice.policy != AdapterPolicy::kName) {
+    spdlog::error("no adapter besides the Null backend, select it with "
+                  "--adapter null");
+  }
+
+  return adapter;
+}
+
+const char *BackendTypeName(WGPUBackendType type) {
+  switch (type) {
+  case WGPUBackendType_Null:
+    return "null";
+  case WGPUBackendType_WebGPU:
+    return "webgpu";
+  case WGPUBackendType_D3D11:
+    return "d3d11";
+  case WGPUBackendType_D3D12:
+    return "d3d12";
+  case WGPUBackendType_Metal:
+    return "metal";
+  case WGPUBackendType_Vulkan:
+    return "vulkan";
+  case WGPUBackendType_OpenGL:
+    return "opengl";
+  case WGPUBackendType_OpenGLES:
+    return "opengles";
+  default:
+    return "unknown";
+  }
+}
+
+const char *AdapterTypeName(WGPUAdapterType type) {
+  switch (type) {
+  case WGPUAdapterType_DiscreteGPU:
+    return "discrete";
+  case WGPUAdapterType_IntegratedGPU:
+    return "integrated";
+  case WGPUAdapterType_CPU:
+    return "cpu";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace util
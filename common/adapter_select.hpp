@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+enum class AdapterPolicy {
+  // whatever the implementation returns first
+  kDefault,
+  // discrete GPU, then integrated, then CPU
+  kDiscrete,
+  // integrated GPU, then discrete, then CPU
+  kLowPower,
+  // first adapter whose name contains AdapterChoice::name
+  kName,
+  // the adapter that runs a short compute workload fastest
+  kFastest,
+};
+
+struct AdapterChoice {
+  AdapterPolicy policy = AdapterPolicy::kDefault;
+  // case insensitive part of the adapter name, for kName
+  std::string name;
+
+  /**
+   * "default", "discrete", "low-power" or "fastest", anything else matches
+   * the adapter name.
+   */
+  static AdapterChoice Parse(const std::string &value);
+};
+
+struct AdapterInfo {
+  WGPUAdapter adapter = nullptr;
+  // the strings are owned by the adapter
+  WGPUAdapterProperties properties = {};
+  WGPUSupportedLimits limits = {};
+};
+
+/**
+ * Every distinct adapter the instance offers. webgpu.h has no enumeration
+ * entry point, so the adapter is requested once per backend and power
+ * preference and duplicates are dropped. The Null adapter, which no request
+ * can select, comes from RequestNullAdapter. The caller releases the adapters.
+ *
+ * @param surface    adapters must be able to present to it, may be null
+ * @param fallback   only the software adapter
+ */
+std::vector<AdapterInfo> EnumerateAdapters(WGPUInstance instance,
+                                           WGPUSurface surface,
+                                           bool fallback);
+
+/**
+ * Milliseconds one adapter needs for a small ALU and bandwidth bound compute
+ * workload, best of a few runs, negative on failure. Creates and destroys a
+ * device of its own.
+ */
+double ProbeAdapter(WGPUAdapter adapter);
+
+/**
+ * Enumerate, log and pick an adapter by `choice`. The adapters not picked are
+ * released.
+ *
+ * @return null if no adapter matches
+ */
+WGPUAdapter SelectAdapter(WGPUInstance instance, WGPUSurface surface,
+                          const AdapterChoice &choice, bool fallback);
+
+const char *BackendTypeName(WGPUBackendType type);
+
+const char *AdapterTypeName(WGPUAdapterType type);
+
+} // namespace util
@@ -0,0 +1,63 @@
+#include "frame_bench.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions to count them. This translation
+// unit is linked into every sample since App references GetAllocationCount.
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+void *Allocate(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  void *ptr = Allocate(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
+
+namespace util {
+
+uint64_t GetAllocationCount() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace util
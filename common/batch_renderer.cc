@@ -0,0 +1,368 @@
+#include "batch_renderer.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+namespace {
+
+inline uint32_t PackColor(const glm::vec4 &color) {
+  auto channel = [](float value) {
+    return static_cast<uint32_t>(std::min(std::max(value, 0.f), 1.f) * 255.f +
+                                 0.5f);
+  };
+
+  // little endian, matches Unorm8x4 as r, g, b, a
+  return channel(color.x) | (channel(color.y) << 8) |
+         (channel(color.z) << 16) | (channel(color.w) << 24);
+}
+
+} // namespace
+
+BatchRenderer::BatchRenderer(WGPUDevice device, WGPUQueue queue,
+                             WGPUTextureFormat format, uint32_t sample_count)
+    : m_device(device), m_queue(queue) {
+  // uniform buffer
+  {
+    WGPUBufferDescriptor desc{};
+    desc.label = "Batch projection";
+    desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+    desc.size = sizeof(glm::mat4);
+
+    m_uniform_buffer = wgpuDeviceCreateBuffer(m_device, &desc);
+  }
+
+  InitPipelines(format, sample_count);
+
+  SetProjection(glm::mat4(1.f));
+}
+
+BatchRenderer::~BatchRenderer() {
+  for (auto pipeline : m_pipelines) {
+    wgpuRenderPipelineRelease(pipeline);
+  }
+
+  wgpuBindGroupRelease(m_bind_group);
+  wgpuPipelineLayoutRelease(m_layout);
+  wgpuBindGroupLayoutRelease(m_bind0_layout);
+  wgpuBufferRelease(m_uniform_buffer);
+
+  if (m_vertex_buffer) {
+    wgpuBufferRelease(m_vertex_buffer);
+  }
+
+  if (m_index_buffer) {
+    wgpuBufferRelease(m_index_buffer);
+  }
+}
+
+void BatchRenderer::SetProjection(const glm::mat4 &projection) {
+  wgpuQueueWriteBuffer(m_queue, m_uniform_buffer, 0, &projection,
+                       sizeof(projection));
+}
+
+void BatchRenderer::Begin() {
+  // clear keeps the capacity, after the first frames nothing is allocated
+  for (auto &bucket : m_buckets) {
+    bucket.vertices.clear();
+    bucket.indices.clear();
+  }
+
+  m_vertex_offset = 0;
+  m_index_offset = 0;
+
+  m_stats = {};
+}
+
+void BatchRenderer::SubmitTriangle(const glm::vec2 &a, const glm::vec2 &b,
+                                   const glm::vec2 &c, const glm::vec4 &color,
+                                   const glm::mat3 &transform, Blend blend) {
+  glm::vec2 points[3] = {a, b, c};
+
+  SubmitPolygon(points, 3, color, transform, blend);
+}
+
+void BatchRenderer::SubmitQuad(const glm::vec2 &min, const glm::vec2 &max,
+                               const glm::vec4 &color,
+                               const glm::mat3 &transform, Blend blend) {
+  glm::vec2 points[4] = {
+      {min.x, min.y},
+      {max.x, min.y},
+      {max.x, max.y},
+      {min.x, max.y},
+  };
+
+  SubmitPolygon(points, 4, color, transform, blend);
+}
+
+void BatchRenderer::SubmitPolygon(const glm::vec2 *points, uint32_t count,
+                                  const glm::vec4 &color,
+                                  const glm::mat3 &transform, Blend blend) {
+  if (count < 3) {
+    return;
+  }
+
+  auto &bucket = m_buckets[static_cast<uint32_t>(blend)];
+
+  auto first = static_cast<uint32_t>(bucket.vertices.size());
+  auto first_index = bucket.indices.size();
+
+  // grow once, then write through raw pointers
+  bucket.vertices.resize(first + count);
+  bucket.indices.resize(first_index + (count - 2) * 3);
+
+  Vertex *vertex = bucket.vertices.data() + first;
+  uint32_t *index = bucket.indices.data() + first_index;
+
+  uint32_t packed = PackColor(color);
+
+  // only the affine part of the transform is used
+  float m00 = transform[0][0], m01 = transform[0][1];
+  float m10 = transform[1][0], m11 = transform[1][1];
+  float m20 = transform[2][0], m21 = transform[2][1];
+
+  for (uint32_t i = 0; i < count; i++) {
+    float x = points[i].x;
+    float y = points[i].y;
+
+    vertex[i].x = m00 * x + m10 * y + m20;
+    vertex[i].y = m01 * x + m11 * y + m21;
+    vertex[i].color = packed;
+  }
+
+  for (uint32_t i = 1; i + 1 < count; i++) {
+    *index++ = first;
+    *index++ = first + i;
+    *index++ = first + i + 1;
+  }
+
+  m_stats.primitives++;
+}
+
+void BatchRenderer::Flush(WGPURenderPassEncoder pass) {
+  m_vertex_stream.clear();
+  m_index_stream.clear();
+
+  for (const auto &bucket : m_buckets) {
+    m_vertex_stream.insert(m_vertex_stream.end(), bucket.vertices.begin(),
+                           bucket.vertices.end());
+    m_index_stream.insert(m_index_stream.end(), bucket.indices.begin(),
+                          bucket.indices.end());
+  }
+
+  if (m_index_stream.empty()) {
+    return;
+  }
+
+  auto vertex_size = m_vertex_stream.size() * sizeof(Vertex);
+  auto index_size = m_index_stream.size() * sizeof(uint32_t);
+
+  // earlier flushes of this frame keep their ranges, a buffer recreated here
+  // is not referenced by their draws
+  EnsureCapacity(m_vertex_buffer, m_vertex_capacity,
+                 m_vertex_offset + vertex_size, WGPUBufferUsage_Vertex,
+                 "Batch vertex stream");
+  EnsureCapacity(m_index_buffer, m_index_capacity, m_index_offset + index_size,
+                 WGPUBufferUsage_Index, "Batch index stream");
+
+  wgpuQueueWriteBuffer(m_queue, m_vertex_buffer, m_vertex_offset,
+                       m_vertex_stream.data(), vertex_size);
+  wgpuQueueWriteBuffer(m_queue, m_index_buffer, m_index_offset,
+                       m_index_stream.data(), index_size);
+
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 0, m_vertex_buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetIndexBuffer(pass, m_index_buffer,
+                                      WGPUIndexFormat_Uint32, 0,
+                                      WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, m_bind_group, 0, nullptr);
+
+  auto first_vertex = static_cast<uint32_t>(m_vertex_offset / sizeof(Vertex));
+  auto first_index = static_cast<uint32_t>(m_index_offset / sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < static_cast<uint32_t>(Blend::kCount); i++) {
+    auto &bucket = m_buckets[i];
+
+    if (!bucket.indices.empty()) {
+      // indices are relative to the bucket and rebased with baseVertex
+      wgpuRenderPassEncoderSetPipeline(pass, m_pipelines[i]);
+      wgpuRenderPassEncoderDrawIndexed(
+          pass, static_cast<uint32_t>(bucket.indices.size()), 1, first_index,
+          static_cast<int32_t>(first_vertex), 0);
+
+      m_stats.vertices += bucket.vertices.size();
+      m_stats.indices += bucket.indices.size();
+      m_stats.draw_calls++;
+    }
+
+    first_vertex += static_cast<uint32_t>(bucket.vertices.size());
+    first_index += static_cast<uint32_t>(bucket.indices.size());
+
+    bucket.vertices.clear();
+    bucket.indices.clear();
+  }
+
+  m_vertex_offset += vertex_size;
+  m_index_offset += index_size;
+
+  m_stats.upload_bytes += vertex_size + index_size;
+}
+
+void BatchRenderer::InitPipelines(WGPUTextureFormat format,
+                                  uint32_t sample_count) {
+  const char *raw_shader = GetShader("batch.wgsl");
+
+  WGPUShaderModule shader = nullptr;
+  {
+    WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+    wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+    wgsl_desc.code = raw_shader;
+
+    WGPUShaderModuleDescriptor desc{};
+    desc.label = "Batch shader";
+
+    desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+    shader = wgpuDeviceCreateShaderModule(m_device, &desc);
+  }
+
+  // pipeline layout
+  {
+    WGPUBindGroupLayoutEntry entry0{};
+    entry0.binding = 0;
+    entry0.visibility = WGPUShaderStage_Vertex;
+    entry0.buffer.type = WGPUBufferBindingType_Uniform;
+    entry0.buffer.minBindingSize = 0;
+    entry0.buffer.hasDynamicOffset = false;
+
+    WGPUBindGroupLayoutDescriptor binding_desc{};
+    binding_desc.label = "Batch binding 0";
+    binding_desc.entryCount = 1;
+    binding_desc.entries = &entry0;
+
+    m_bind0_layout = wgpuDeviceCreateBindGroupLayout(m_device, &binding_desc);
+
+    WGPUPipelineLayoutDescriptor desc{};
+    desc.label = "Batch pipeline layout";
+    desc.bindGroupLayoutCount = 1;
+    desc.bindGroupLayouts = &m_bind0_layout;
+
+    m_layout = wgpuDeviceCreatePipelineLayout(m_device, &desc);
+  }
+
+  // bind group, shared by every pipeline
+  {
+    WGPUBindGroupEntry binding0{};
+    binding0.binding = 0;
+    binding0.buffer = m_uniform_buffer;
+    binding0.offset = 0;
+    binding0.size = sizeof(glm::mat4);
+
+    WGPUBindGroupDescriptor desc{};
+    desc.label = "Batch group";
+    desc.layout = m_bind0_layout;
+    desc.entryCount = 1;
+    desc.entries = &binding0;
+
+    m_bind_group = wgpuDeviceCreateBindGroup(m_device, &desc);
+  }
+
+  // vertex layout
+  WGPUVertexBufferLayout vertex_layout = {};
+  std::array<WGPUVertexAttribute, 2> attrs{};
+  attrs[0].format = WGPUVertexFormat_Float32x2;
+  attrs[0].offset = offsetof(Vertex, x);
+  attrs[0].shaderLocation = 0;
+  attrs[1].format = WGPUVertexFormat_Unorm8x4;
+  attrs[1].offset = offsetof(Vertex, color);
+  attrs[1].shaderLocation = 1;
+
+  vertex_layout.attributeCount = attrs.size();
+  vertex_layout.attributes = attrs.data();
+  vertex_layout.arrayStride = sizeof(Vertex);
+  vertex_layout.stepMode = WGPUVertexStepMode_Vertex;
+
+  for (uint32_t i = 0; i < static_cast<uint32_t>(Blend::kCount); i++) {
+    auto blend = static_cast<Blend>(i);
+
+    WGPURenderPipelineDescriptor desc{};
+    desc.label = "Batch pipeline";
+
+    desc.layout = m_layout;
+
+    desc.vertex.module = shader;
+    desc.vertex.entryPoint = "vs_main";
+    desc.vertex.bufferCount = 1;
+    desc.vertex.buffers = &vertex_layout;
+
+    WGPUBlendState blend_state{};
+    blend_state.color.operation = WGPUBlendOperation_Add;
+    blend_state.color.srcFactor = WGPUBlendFactor_SrcAlpha;
+    blend_state.color.dstFactor = blend == Blend::kAdditive
+                                      ? WGPUBlendFactor_One
+                                      : WGPUBlendFactor_OneMinusSrcAlpha;
+    blend_state.alpha.operation = WGPUBlendOperation_Add;
+    blend_state.alpha.srcFactor = WGPUBlendFactor_One;
+    blend_state.alpha.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha;
+
+    WGPUColorTargetState color_target{};
+    color_target.writeMask = WGPUColorWriteMask_All;
+    color_target.blend = blend == Blend::kOpaque ? nullptr : &blend_state;
+    color_target.format = format;
+
+    WGPUFragmentState fs_state{};
+    fs_state.module = shader;
+    fs_state.entryPoint = "fs_main";
+    fs_state.targetCount = 1;
+    fs_state.targets = &color_target;
+
+    desc.fragment = &fs_state;
+
+    // 2D primitives can have any winding after a transform
+    desc.primitive.cullMode = WGPUCullMode_None;
+    desc.primitive.frontFace = WGPUFrontFace_CCW;
+    desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+    desc.primitive.stripIndexFormat = WGPUIndexFormat_Undefined;
+
+    desc.multisample.count = sample_count;
+    desc.multisample.mask = 0xffffffff;
+    desc.multisample.alphaToCoverageEnabled = false;
+
+    m_pipelines[i] = wgpuDeviceCreateRenderPipeline(m_device, &desc);
+  }
+
+  wgpuShaderModuleRelease(shader);
+}
+
+void BatchRenderer::EnsureCapacity(WGPUBuffer &buffer, uint64_t &capacity,
+                                   uint64_t size, WGPUBufferUsageFlags usage,
+                                   const char *label) {
+  if (size <= capacity) {
+    return;
+  }
+
+  if (buffer) {
+    wgpuBufferRelease(buffer);
+  }
+
+  // grow geometrically so the buffer is recreated only a few times
+  capacity = std::max<uint64_t>(capacity, 64 * 1024);
+  while (capacity < size) {
+    capacity *= 2;
+  }
+
+  WGPUBufferDescriptor desc{};
+  desc.label = label;
+  desc.usage = usage | WGPUBufferUsage_CopyDst;
+  desc.size = capacity;
+
+  buffer = wgpuDeviceCreateBuffer(m_device, &desc);
+
+  spdlog::info("{} grows to {} KB", label, capacity / 1024);
+}
+
+} // namespace util
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+struct BatchStats {
+  uint64_t primitives = 0;
+  uint64_t vertices = 0;
+  uint64_t indices = 0;
+  uint32_t draw_calls = 0;
+  uint64_t upload_bytes = 0;
+};
+
+/**
+ * Immediate mode 2D renderer which merges every primitive of a frame into one
+ * vertex and one index stream.
+ *
+ * Primitives are appended into one bucket per pipeline (blend mode), which is
+ * an O(1) bucket sort by pipeline. Flush packs the buckets back to back,
+ * uploads them with one write per stream and issues one DrawIndexed per non
+ * empty bucket, so a Flush costs at most `Blend::kCount` draw calls no matter
+ * how many primitives are submitted.
+ *
+ * Draw order is kept inside a bucket, buckets are drawn opaque first, then
+ * alpha, then additive.
+ *
+ * Transforms are 2D affine glm::mat3, applied on the CPU while appending.
+ */
+class BatchRenderer {
+public:
+  enum class Blend : uint32_t {
+    kOpaque,
+    kAlpha,
+    kAdditive,
+    kCount,
+  };
+
+  BatchRenderer(WGPUDevice device, WGPUQueue queue, WGPUTextureFormat format,
+                uint32_t sample_count = 1);
+
+  ~BatchRenderer();
+
+  BatchRenderer(const BatchRenderer &) = delete;
+  BatchRenderer &operator=(const BatchRenderer &) = delete;
+
+  void SetProjection(const glm::mat4 &projection);
+
+  /**
+   * Start a new frame, drop everything submitted before.
+   */
+  void Begin();
+
+  void SubmitTriangle(const glm::vec2 &a, const glm::vec2 &b,
+                      const glm::vec2 &c, const glm::vec4 &color,
+                      const glm::mat3 &transform = glm::mat3(1.f),
+                      Blend blend = Blend::kAlpha);
+
+  /**
+   * Axis aligned rectangle before the transform is applied.
+   */
+  void SubmitQuad(const glm::vec2 &min, const glm::vec2 &max,
+                  const glm::vec4 &color,
+                  const glm::mat3 &transform = glm::mat3(1.f),
+                  Blend blend = Blend::kAlpha);
+
+  /**
+   * Convex polygon, triangulated as a fan.
+   */
+  void SubmitPolygon(const glm::vec2 *points, uint32_t count,
+                     const glm::vec4 &color,
+                     const glm::mat3 &transform = glm::mat3(1.f),
+                     Blend blend = Blend::kAlpha);
+
+  /**
+   * Upload what was submitted since the last Begin or Flush and record the
+   * draws into `pass`.
+   *
+   * Can be called more than once per frame, every Flush appends to the
+   * streams after the previous one, as all writes of a frame land before any
+   * of its draws run.
+   */
+  void Flush(WGPURenderPassEncoder pass);
+
+  const BatchStats &GetStats() const { return m_stats; }
+
+private:
+  struct Vertex {
+    float x;
+    float y;
+    // RGBA8 unorm
+    uint32_t color;
+  };
+
+  struct Bucket {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+  };
+
+  void InitPipelines(WGPUTextureFormat format, uint32_t sample_count);
+
+  void EnsureCapacity(WGPUBuffer &buffer, uint64_t &capacity, uint64_t size,
+                      WGPUBufferUsageFlags usage, const char *label);
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+
+  WGPUBindGroupLayout m_bind0_layout = {};
+  WGPUPipelineLayout m_layout = {};
+  WGPUBindGroup m_bind_group = {};
+  WGPURenderPipeline m_pipelines[static_cast<uint32_t>(Blend::kCount)] = {};
+
+  WGPUBuffer m_uniform_buffer = {};
+  WGPUBuffer m_vertex_buffer = {};
+  WGPUBuffer m_index_buffer = {};
+  uint64_t m_vertex_capacity = 0;
+  uint64_t m_index_capacity = 0;
+
+  Bucket m_buckets[static_cast<uint32_t>(Blend::kCount)];
+
+  // buckets packed for the upload
+  std::vector<Vertex> m_vertex_stream;
+  std::vector<uint32_t> m_index_stream;
+
+  // bytes of the streams written since Begin
+  uint64_t m_vertex_offset = 0;
+  uint64_t m_index_offset = 0;
+
+  BatchStats m_stats = {};
+};
+
+} // namespace util
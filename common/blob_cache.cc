@@ -0,0 +1,315 @@
+#include "blob_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace util {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr char kMagic[4] = {'W', 'B', 'L', 'B'};
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t key_size;
+  uint64_t value_size;
+};
+
+// FNV-1a
+uint64_t Hash(const void *data, size_t size) {
+  auto bytes = static_cast<const uint8_t *>(data);
+
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+/**
+ * Open an entry and check it belongs to `key`.
+ *
+ * @return the file positioned at the value, null if it is missing, from
+ *         another version or for another key
+ */
+std::FILE *OpenEntry(const std::string &path, const void *key,
+                     size_t key_size, Header &header) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+
+  bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+            std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+            header.version == BlobCache::kVersion &&
+            header.key_size == key_size;
+
+  if (ok) {
+    std::vector<uint8_t> stored(key_size);
+    ok = std::fread(stored.data(), 1, key_size, file) == key_size &&
+         std::memcmp(stored.data(), key, key_size) == 0;
+  }
+
+  if (!ok) {
+    std::fclose(file);
+    return nullptr;
+  }
+
+  return file;
+}
+
+} // namespace
+
+BlobCache::BlobCache(std::string directory, uint64_t max_bytes)
+    : m_directory(std::move(directory)), m_max_bytes(max_bytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  Scan();
+  Evict();
+}
+
+size_t BlobCache::Load(const void *key, size_t key_size, void *value,
+                       size_t value_size) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto hash = Hash(key, key_size);
+
+  auto it = m_entries.find(hash);
+  if (it == m_entries.end() && Adopt(hash)) {
+    // adopting can evict, the entry itself too when it is larger than the
+    // whole cache
+    it = m_entries.find(hash);
+  }
+
+  if (it == m_entries.end()) {
+    m_stats.misses++;
+    return 0;
+  }
+
+  Header header{};
+  std::FILE *file = OpenEntry(PathOf(hash), key, key_size, header);
+  if (file == nullptr) {
+    // gone when another process evicted it, otherwise a hash collision or a
+    // stale entry, which the next Store replaces
+    std::error_code error;
+    if (!fs::exists(PathOf(hash), error)) {
+      Remove(it->second);
+    }
+
+    m_stats.misses++;
+    return 0;
+  }
+
+  // size query, the hit is counted when the value is read
+  if (value == nullptr || value_size < header.value_size) {
+    std::fclose(file);
+    return header.value_size;
+  }
+
+  bool ok = std::fread(value, 1, header.value_size, file) == header.value_size;
+  std::fclose(file);
+
+  if (!ok) {
+    m_stats.misses++;
+    return 0;
+  }
+
+  m_stats.hits++;
+  Touch(it->second);
+
+  return header.value_size;
+}
+
+void BlobCache::Store(const void *key, size_t key_size, const void *value,
+                      size_t value_size) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto hash = Hash(key, key_size);
+  auto path = PathOf(hash);
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.key_size = key_size;
+  header.value_size = value_size;
+
+  // written aside and renamed, so readers never see half an entry
+  auto temp = path + ".tmp";
+
+  std::FILE *file = std::fopen(temp.c_str(), "wb");
+  if (file == nullptr) {
+    return;
+  }
+
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(key, 1, key_size, file) == key_size &&
+            std::fwrite(value, 1, value_size, file) == value_size;
+  ok = std::fclose(file) == 0 && ok;
+
+  std::error_code error;
+  if (ok) {
+    fs::rename(temp, path, error);
+  }
+
+  if (!ok || error) {
+    fs::remove(temp, error);
+    spdlog::warn("blob cache: can not write {}", path);
+    return;
+  }
+
+  uint64_t size = sizeof(header) + key_size + value_size;
+
+  auto it = m_entries.find(hash);
+  if (it != m_entries.end()) {
+    m_bytes -= it->second->size;
+    it->second->size = size;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+  } else {
+    m_lru.push_front({hash, size});
+    m_entries[hash] = m_lru.begin();
+  }
+
+  m_bytes += size;
+  m_stats.stores++;
+
+  Evict();
+}
+
+BlobCacheStats BlobCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto stats = m_stats;
+  stats.entries = m_entries.size();
+  stats.bytes = m_bytes;
+
+  return stats;
+}
+
+void BlobCache::LogStats() const {
+  auto stats = GetStats();
+
+  uint64_t lookups = stats.hits + stats.misses;
+  double hit_rate =
+      lookups > 0 ? 100.0 * static_cast<double>(stats.hits) / lookups : 0.0;
+
+  spdlog::info("blob cache: {} hits, {} misses ({:.1f}% hit rate), {} "
+               "stored, {} evicted, {:.1f} MB in {} entries at {}",
+               stats.hits, stats.misses, hit_rate, stats.stores,
+               stats.evictions, stats.bytes / 1048576.0, stats.entries,
+               m_directory);
+}
+
+std::string BlobCache::PathOf(uint64_t hash) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.blob",
+                static_cast<unsigned long long>(hash));
+
+  return (fs::path(m_directory) / name).string();
+}
+
+void BlobCache::Scan() {
+  std::error_code error;
+  fs::create_directories(m_directory, error);
+
+  struct Found {
+    uint64_t hash;
+    uint64_t size;
+    fs::file_time_type time;
+  };
+
+  std::vector<Found> found;
+
+  for (auto it = fs::directory_iterator(m_directory, error);
+       !error && it != fs::directory_iterator(); it.increment(error)) {
+    const auto &path = it->path();
+
+    if (path.extension() == ".tmp") {
+      // left behind by a process that died while storing
+      fs::remove(path, error);
+      continue;
+    }
+
+    if (path.extension() != ".blob") {
+      continue;
+    }
+
+    auto stem = path.stem().string();
+    char *end = nullptr;
+    uint64_t hash = std::strtoull(stem.c_str(), &end, 16);
+    if (end == stem.c_str() || *end != '\0') {
+      continue;
+    }
+
+    std::error_code entry_error;
+    auto size = fs::file_size(path, entry_error);
+    auto time = fs::last_write_time(path, entry_error);
+    if (entry_error) {
+      continue;
+    }
+
+    found.push_back({hash, size, time});
+  }
+
+  // most recently used first
+  std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+    return a.time > b.time;
+  });
+
+  for (const auto &entry : found) {
+    m_lru.push_back({entry.hash, entry.size});
+    m_entries[entry.hash] = std::prev(m_lru.end());
+    m_bytes += entry.size;
+  }
+}
+
+bool BlobCache::Adopt(uint64_t hash) {
+  std::error_code error;
+  auto size = fs::file_size(PathOf(hash), error);
+  if (error) {
+    return false;
+  }
+
+  m_lru.push_front({hash, size});
+  m_entries[hash] = m_lru.begin();
+  m_bytes += size;
+
+  Evict();
+
+  return true;
+}
+
+void BlobCache::Touch(EntryList::iterator entry) {
+  m_lru.splice(m_lru.begin(), m_lru, entry);
+
+  // the order has to survive a restart
+  std::error_code error;
+  fs::last_write_time(PathOf(entry->hash), fs::file_time_type::clock::now(),
+                      error);
+}
+
+void BlobCache::Remove(EntryList::iterator entry) {
+  std::error_code error;
+  fs::remove(PathOf(entry->hash), error);
+
+  m_bytes -= entry->size;
+  m_entries.erase(entry->hash);
+  m_lru.erase(entry);
+}
+
+void BlobCache::Evict() {
+  while (m_bytes > m_max_bytes && !m_lru.empty()) {
+    Remove(std::prev(m_lru.end()));
+    m_stats.evictions++;
+  }
+}
+
+} // namespace util
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace util {
+
+struct BlobCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t stores = 0;
+  uint64_t evictions = 0;
+  uint64_t entries = 0;
+  uint64_t bytes = 0;
+};
+
+/**
+ * Persistent key value store for compiled shaders and pipelines, one file per
+ * entry named by the hash of the key.
+ *
+ * Entries are evicted least recently used first once the cache grows over
+ * `max_bytes`. Use is tracked through the file modification time, so the
+ * order survives restarts. Several processes can share a directory: a key
+ * missing from the index is looked up on disk, so entries another process
+ * stored after Scan are found and from then on counted and evicted here too.
+ * Entries written by another cache version are ignored and replaced.
+ * Thread safe.
+ */
+class BlobCache {
+public:
+  // bump when the entry layout or what callers store changes
+  static constexpr uint32_t kVersion = 1;
+
+  BlobCache(std::string directory, uint64_t max_bytes);
+
+  BlobCache(const BlobCache &) = delete;
+  BlobCache &operator=(const BlobCache &) = delete;
+
+  /**
+   * Copy the value stored for `key` into `value`, if it fits.
+   *
+   * @return the size of the value, 0 if there is none. Call with a null
+   *         `value` to get the size first.
+   */
+  size_t Load(const void *key, size_t key_size, void *value,
+              size_t value_size);
+
+  void Store(const void *key, size_t key_size, const void *value,
+             size_t value_size);
+
+  BlobCacheStats GetStats() const;
+
+  void LogStats() const;
+
+  const std::string &GetDirectory() const { return m_directory; }
+
+private:
+  struct Entry {
+    uint64_t hash = 0;
+    uint64_t size = 0;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  std::string PathOf(uint64_t hash) const;
+
+  void Scan();
+
+  // index an entry stored by another process, false if there is none
+  bool Adopt(uint64_t hash);
+
+  void Touch(EntryList::iterator entry);
+
+  void Remove(EntryList::iterator entry);
+
+  void Evict();
+
+private:
+  std::string m_directory;
+  uint64_t m_max_bytes;
+
+  mutable std::mutex m_mutex;
+  // most recently used first
+  EntryList m_lru;
+  std::unordered_map<uint64_t, EntryList::iterator> m_entries;
+  uint64_t m_bytes = 0;
+
+  BlobCacheStats m_stats = {};
+};
+
+} // namespace util
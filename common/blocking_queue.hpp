@@ -0,0 +1,124 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace util {
+
+/**
+ * Bounded multi-producer multi-consumer queue.
+ *
+ * Producers block in Push when the queue is full, which is what keeps memory
+ * bounded when producers are faster than the consumer. TryPush never blocks
+ * and is meant for threads that must not stall, like the render loop.
+ */
+template <typename T> class BlockingQueue {
+public:
+  explicit BlockingQueue(size_t capacity) : m_capacity(capacity) {}
+
+  BlockingQueue(const BlockingQueue &) = delete;
+  BlockingQueue &operator=(const BlockingQueue &) = delete;
+
+  /**
+   * @return false if the queue is closed
+   */
+  bool Push(T value) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_not_full.wait(lock,
+                    [this] { return m_closed || m_items.size() < m_capacity; });
+
+    if (m_closed) {
+      return false;
+    }
+
+    m_items.emplace_back(std::move(value));
+    m_not_empty.notify_one();
+
+    return true;
+  }
+
+  /**
+   * @return false if the queue is full or closed, value is left untouched
+   */
+  bool TryPush(T &value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_closed || m_items.size() >= m_capacity) {
+      return false;
+    }
+
+    m_items.emplace_back(std::move(value));
+    m_not_empty.notify_one();
+
+    return true;
+  }
+
+  /**
+   * Block until an item is available.
+   *
+   * @return false if the queue is closed and drained
+   */
+  bool Pop(T &value) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_not_empty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+
+    if (m_items.empty()) {
+      return false;
+    }
+
+    value = std::move(m_items.front());
+    m_items.pop_front();
+    m_not_full.notify_one();
+
+    return true;
+  }
+
+  /**
+   * @return false if no item is available right now
+   */
+  bool TryPop(T &value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_items.empty()) {
+      return false;
+    }
+
+    value = std::move(m_items.front());
+    m_items.pop_front();
+    m_not_full.notify_one();
+
+    return true;
+  }
+
+  /**
+   * Wake up every waiting thread, pending items can still be popped.
+   */
+  void Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_closed = true;
+    m_not_empty.notify_all();
+    m_not_full.notify_all();
+  }
+
+  size_t Size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_items.size();
+  }
+
+  size_t Capacity() const { return m_capacity; }
+
+private:
+  size_t m_capacity;
+  bool m_closed = false;
+  std::deque<T> m_items;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_not_empty;
+  std::condition_variable m_not_full;
+};
+
+} // namespace util
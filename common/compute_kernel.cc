@@ -0,0 +1,50 @@
+#include "compute_kernel.hpp"
+
+#include <utility>
+
+namespace util {
+
+ComputeKernel::ComputeKernel(WGPUDevice device, WGPUShaderModule module,
+                             const char *entry_point,
+                             WGPUPipelineLayout layout) {
+  WGPUComputePipelineDescriptor desc{};
+  desc.label = entry_point;
+  desc.layout = layout;
+  desc.compute.module = module;
+  desc.compute.entryPoint = entry_point;
+
+  m_pipeline = wgpuDeviceCreateComputePipeline(device, &desc);
+}
+
+ComputeKernel::~ComputeKernel() {
+  if (m_pipeline) {
+    wgpuComputePipelineRelease(m_pipeline);
+  }
+}
+
+ComputeKernel::ComputeKernel(ComputeKernel &&other) noexcept
+    : m_pipeline(std::exchange(other.m_pipeline, nullptr)) {}
+
+ComputeKernel &ComputeKernel::operator=(ComputeKernel &&other) noexcept {
+  if (this != &other) {
+    if (m_pipeline) {
+      wgpuComputePipelineRelease(m_pipeline);
+    }
+
+    m_pipeline = std::exchange(other.m_pipeline, nullptr);
+  }
+
+  return *this;
+}
+
+void ComputeKernel::Dispatch(WGPUComputePassEncoder pass, WGPUBindGroup group,
+                             uint32_t dynamic_offset_count,
+                             const uint32_t *dynamic_offsets, uint32_t x,
+                             uint32_t y, uint32_t z) const {
+  wgpuComputePassEncoderSetPipeline(pass, m_pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass, 0, group, dynamic_offset_count,
+                                     dynamic_offsets);
+  wgpuComputePassEncoderDispatchWorkgroups(pass, x, y, z);
+}
+
+} // namespace util
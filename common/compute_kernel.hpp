@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+/**
+ * One compute pipeline, built from an entry point of a shader module.
+ *
+ * The layout is given explicitly so several kernels of one module can share
+ * bind groups, a null layout lets Dawn derive it from the shader.
+ */
+class ComputeKernel {
+public:
+  ComputeKernel() = default;
+
+  ComputeKernel(WGPUDevice device, WGPUShaderModule module,
+                const char *entry_point, WGPUPipelineLayout layout);
+
+  ~ComputeKernel();
+
+  ComputeKernel(const ComputeKernel &) = delete;
+  ComputeKernel &operator=(const ComputeKernel &) = delete;
+
+  ComputeKernel(ComputeKernel &&other) noexcept;
+  ComputeKernel &operator=(ComputeKernel &&other) noexcept;
+
+  /**
+   * Bind `group` at index 0 and dispatch the given number of workgroups.
+   */
+  void Dispatch(WGPUComputePassEncoder pass, WGPUBindGroup group,
+                uint32_t dynamic_offset_count, const uint32_t *dynamic_offsets,
+                uint32_t x, uint32_t y = 1, uint32_t z = 1) const;
+
+  WGPUComputePipeline Get() const { return m_pipeline; }
+
+  /**
+   * Number of workgroups of `group_size` needed to cover `count` items.
+   */
+  static uint32_t GroupCount(uint32_t count, uint32_t group_size) {
+    return (count + group_size - 1) / group_size;
+  }
+
+private:
+  WGPUComputePipeline m_pipeline = nullptr;
+};
+
+} // namespace util
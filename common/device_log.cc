@@ -0,0 +1,217 @@
+#include "device_log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace util {
+
+namespace {
+
+// how long the worker sleeps when the queue is empty
+constexpr std::chrono::milliseconds kPollInterval{10};
+
+} // namespace
+
+DeviceLog::DeviceLog(size_t capacity, uint32_t max_per_second)
+    : m_queue(capacity), m_max_per_second(std::max(max_per_second, 1u)),
+      m_tokens(m_max_per_second), m_refill(Clock::now()) {
+  // same sinks and pattern as everything else, the worker writes through it
+  const auto &sinks = spdlog::default_logger()->sinks();
+  m_logger =
+      std::make_shared<spdlog::logger>("device", sinks.begin(), sinks.end());
+  m_logger->set_level(spdlog::default_logger()->level());
+
+  m_worker = std::thread([this] { Work(); });
+}
+
+DeviceLog::~DeviceLog() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+
+  m_worker.join();
+}
+
+void DeviceLog::Push(spdlog::level::level_enum level, const char *message) {
+  m_received.fetch_add(1, std::memory_order_relaxed);
+
+  Message entry;
+  entry.level = level;
+  entry.length = message ? static_cast<uint32_t>(std::min(
+                               std::strlen(message), kMaxMessage))
+                         : 0;
+  if (entry.length > 0) {
+    std::memcpy(entry.text, message, entry.length);
+  }
+
+  // the worker polls, waking it would cost a syscall per message
+  if (!m_queue.TryPush(entry)) {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void DeviceLog::Attach(WGPUDevice device, bool logging) {
+  if (logging) {
+    wgpuDeviceSetLoggingCallback(device, &LoggingCallback, this);
+  }
+  wgpuDeviceSetUncapturedErrorCallback(device, &ErrorCallback, this);
+}
+
+DeviceLogStats DeviceLog::GetStats() const {
+  DeviceLogStats stats{};
+  stats.received = m_received.load(std::memory_order_relaxed);
+  stats.written = m_written.load(std::memory_order_relaxed);
+  stats.deduplicated = m_deduplicated.load(std::memory_order_relaxed);
+  stats.rate_limited = m_rate_limited.load(std::memory_order_relaxed);
+  stats.dropped = m_dropped.load(std::memory_order_relaxed);
+
+  return stats;
+}
+
+void DeviceLog::LogStats() const {
+  auto stats = GetStats();
+
+  spdlog::info("device log: {} received, {} written, {} deduplicated, {} rate "
+               "limited, {} dropped",
+               stats.received, stats.written, stats.deduplicated,
+               stats.rate_limited, stats.dropped);
+}
+
+void DeviceLog::LoggingCallback(WGPULoggingType type, char const *message,
+                                void *userdata) {
+  auto level = spdlog::level::info;
+  switch (type) {
+  case WGPULoggingType_Error:
+    level = spdlog::level::err;
+    break;
+  case WGPULoggingType_Warning:
+    level = spdlog::level::warn;
+    break;
+  default:
+    break;
+  }
+
+  static_cast<DeviceLog *>(userdata)->Push(level, message);
+}
+
+void DeviceLog::ErrorCallback(WGPUErrorType type, char const *message,
+                              void *userdata) {
+  static_cast<DeviceLog *>(userdata)->Push(spdlog::level::err, message);
+}
+
+void DeviceLog::Work() {
+  uint64_t reported_drops = 0;
+
+  for (;;) {
+    bool stop;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      stop = m_wake.wait_for(lock, kPollInterval, [this] { return m_stop; });
+    }
+
+    Drain();
+
+    auto drops = m_dropped.load(std::memory_order_relaxed);
+    if (drops > reported_drops) {
+      Write(spdlog::level::warn,
+            fmt::format("{} messages dropped, queue full",
+                        drops - reported_drops));
+      reported_drops = drops;
+    }
+
+    ExpireRepeats(Clock::now(), stop);
+
+    if (stop) {
+      break;
+    }
+  }
+
+  WriteLimited();
+
+  m_logger->flush();
+}
+
+void DeviceLog::Drain() {
+  Message entry;
+  while (m_queue.TryPop(entry)) {
+    auto now = Clock::now();
+    std::string text(entry.text, entry.length);
+
+    auto it = m_repeats.find(text);
+    if (it != m_repeats.end()) {
+      if (now - it->second.written < kDedupWindow) {
+        it->second.count++;
+        m_deduplicated.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+
+      // the window is over, the next expiry pass would summarize it
+      if (it->second.count > 0) {
+        Write(it->second.level, fmt::format("{} (repeated {} times)", text,
+                                            it->second.count));
+      }
+      m_repeats.erase(it);
+    }
+
+    if (!TakeToken(now)) {
+      m_limited++;
+      m_rate_limited.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    WriteLimited();
+    Write(entry.level, text);
+    m_repeats.emplace(std::move(text), Repeat{entry.level, now, 0});
+  }
+}
+
+void DeviceLog::Write(spdlog::level::level_enum level,
+                      const std::string &text) {
+  m_logger->log(level, "[ {} ]", text);
+  m_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DeviceLog::WriteLimited() {
+  if (m_limited == 0) {
+    return;
+  }
+
+  Write(spdlog::level::warn, fmt::format("{} messages over the limit of {}/s",
+                                         m_limited, m_max_per_second));
+  m_limited = 0;
+}
+
+void DeviceLog::ExpireRepeats(Clock::time_point now, bool all) {
+  for (auto it = m_repeats.begin(); it != m_repeats.end();) {
+    if (!all && now - it->second.written < kDedupWindow) {
+      ++it;
+      continue;
+    }
+
+    if (it->second.count > 0) {
+      Write(it->second.level, fmt::format("{} (repeated {} times)", it->first,
+                                          it->second.count));
+    }
+    it = m_repeats.erase(it);
+  }
+}
+
+bool DeviceLog::TakeToken(Clock::time_point now) {
+  double elapsed = std::chrono::duration<double>(now - m_refill).count();
+  m_refill = now;
+
+  // a burst of up to one second worth of messages passes
+  m_tokens = std::min<double>(m_tokens + elapsed * m_max_per_second,
+                              m_max_per_second);
+
+  if (m_tokens < 1.0) {
+    return false;
+  }
+
+  m_tokens -= 1.0;
+  return true;
+}
+
+} // namespace util
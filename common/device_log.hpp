@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <webgpu/webgpu.h>
+
+#include "ring_queue.hpp"
+
+namespace util {
+
+struct DeviceLogStats {
+  // messages the device reported
+  uint64_t received = 0;
+  // messages written, including repeat and suppression summaries
+  uint64_t written = 0;
+  // repeats of a message already written within the dedup window
+  uint64_t deduplicated = 0;
+  // messages over the rate limit
+  uint64_t rate_limited = 0;
+  // messages lost to a full queue
+  uint64_t dropped = 0;
+};
+
+/**
+ * Writes device messages off the thread that reports them.
+ *
+ * The Dawn callbacks only copy the message into a lock-free queue; a worker
+ * drains it, folds repeats of the same message within `kDedupWindow` into one
+ * "repeated N times" line, and keeps the rest under `max_per_second` with a
+ * token bucket before formatting and writing through the "device" logger. A
+ * burst of validation errors in the render loop costs one copy per message
+ * instead of a formatted, flushed line.
+ */
+class DeviceLog {
+public:
+  static constexpr std::chrono::milliseconds kDedupWindow{1000};
+  // longer messages are truncated
+  static constexpr size_t kMaxMessage = 1024;
+
+  explicit DeviceLog(size_t capacity = 1024, uint32_t max_per_second = 20);
+
+  /**
+   * Writes what is still queued.
+   */
+  ~DeviceLog();
+
+  DeviceLog(const DeviceLog &) = delete;
+  DeviceLog &operator=(const DeviceLog &) = delete;
+
+  /**
+   * Queue `message`, never blocks. Thread safe.
+   */
+  void Push(spdlog::level::level_enum level, const char *message);
+
+  /**
+   * Install the logging and uncaptured error callbacks of `device`, this has
+   * to outlive the device.
+   */
+  void Attach(WGPUDevice device, bool logging);
+
+  DeviceLogStats GetStats() const;
+
+  void LogStats() const;
+
+  static void LoggingCallback(WGPULoggingType type, char const *message,
+                              void *userdata);
+
+  static void ErrorCallback(WGPUErrorType type, char const *message,
+                            void *userdata);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Message {
+    spdlog::level::level_enum level = spdlog::level::info;
+    uint32_t length = 0;
+    char text[kMaxMessage];
+  };
+
+  struct Repeat {
+    spdlog::level::level_enum level;
+    Clock::time_point written;
+    uint64_t count;
+  };
+
+  void Work();
+
+  void Drain();
+
+  void Write(spdlog::level::level_enum level, const std::string &text);
+
+  /**
+   * Tell how many messages the rate limit held back since the last call.
+   */
+  void WriteLimited();
+
+  /**
+   * Summarize the repeats whose window is over, all of them if `all`.
+   */
+  void ExpireRepeats(Clock::time_point now, bool all);
+
+  bool TakeToken(Clock::time_point now);
+
+private:
+  RingQueue<Message> m_queue;
+  uint32_t m_max_per_second;
+  std::shared_ptr<spdlog::logger> m_logger;
+
+  // worker only
+  std::unordered_map<std::string, Repeat> m_repeats;
+  double m_tokens;
+  Clock::time_point m_refill;
+  uint64_t m_limited = 0;
+
+  std::atomic<uint64_t> m_received = {0};
+  std::atomic<uint64_t> m_written = {0};
+  std::atomic<uint64_t> m_deduplicated = {0};
+  std::atomic<uint64_t> m_rate_limited = {0};
+  std::atomic<uint64_t> m_dropped = {0};
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stop = false;
+  std::thread m_worker;
+};
+
+} // namespace util
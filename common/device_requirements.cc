@@ -0,0 +1,224 @@
+#include "device_requirements.hpp"
+
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace util {
+
+namespace {
+
+struct U32Limit {
+  const char *name;
+  uint32_t WGPULimits::*field;
+  // smaller is better, like the buffer offset alignments
+  bool alignment;
+};
+
+struct U64Limit {
+  const char *name;
+  uint64_t WGPULimits::*field;
+};
+
+#define U32_LIMIT(name) {#name, &WGPULimits::name, false}
+
+const U32Limit kU32Limits[] = {
+    U32_LIMIT(maxTextureDimension1D),
+    U32_LIMIT(maxTextureDimension2D),
+    U32_LIMIT(maxTextureDimension3D),
+    U32_LIMIT(maxTextureArrayLayers),
+    U32_LIMIT(maxBindGroups),
+    U32_LIMIT(maxDynamicUniformBuffersPerPipelineLayout),
+    U32_LIMIT(maxDynamicStorageBuffersPerPipelineLayout),
+    U32_LIMIT(maxSampledTexturesPerShaderStage),
+    U32_LIMIT(maxSamplersPerShaderStage),
+    U32_LIMIT(maxStorageBuffersPerShaderStage),
+    U32_LIMIT(maxStorageTexturesPerShaderStage),
+    U32_LIMIT(maxUniformBuffersPerShaderStage),
+    {"minUniformBufferOffsetAlignment",
+     &WGPULimits::minUniformBufferOffsetAlignment, true},
+    {"minStorageBufferOffsetAlignment",
+     &WGPULimits::minStorageBufferOffsetAlignment, true},
+    U32_LIMIT(maxVertexBuffers),
+    U32_LIMIT(maxVertexAttributes),
+    U32_LIMIT(maxVertexBufferArrayStride),
+    U32_LIMIT(maxInterStageShaderComponents),
+    U32_LIMIT(maxInterStageShaderVariables),
+    U32_LIMIT(maxColorAttachments),
+    U32_LIMIT(maxColorAttachmentBytesPerSample),
+    U32_LIMIT(maxComputeWorkgroupStorageSize),
+    U32_LIMIT(maxComputeInvocationsPerWorkgroup),
+    U32_LIMIT(maxComputeWorkgroupSizeX),
+    U32_LIMIT(maxComputeWorkgroupSizeY),
+    U32_LIMIT(maxComputeWorkgroupSizeZ),
+    U32_LIMIT(maxComputeWorkgroupsPerDimension),
+};
+
+#undef U32_LIMIT
+
+const U64Limit kU64Limits[] = {
+    {"maxUniformBufferBindingSize", &WGPULimits::maxUniformBufferBindingSize},
+    {"maxStorageBufferBindingSize", &WGPULimits::maxStorageBufferBindingSize},
+    {"maxBufferSize", &WGPULimits::maxBufferSize},
+};
+
+} // namespace
+
+WGPULimits UndefinedLimits() {
+  WGPULimits limits{};
+
+  for (const auto &limit : kU32Limits) {
+    limits.*limit.field = WGPU_LIMIT_U32_UNDEFINED;
+  }
+
+  for (const auto &limit : kU64Limits) {
+    limits.*limit.field = WGPU_LIMIT_U64_UNDEFINED;
+  }
+
+  return limits;
+}
+
+void DeviceRequest::Apply(WGPUDeviceDescriptor &desc) const {
+  desc.requiredFeaturesCount = features.size();
+  desc.requiredFeatures = features.data();
+  desc.requiredLimits = &limits;
+}
+
+bool NegotiateDevice(WGPUAdapter adapter,
+                     const DeviceRequirements &requirements,
+                     DeviceRequest &request) {
+  bool ok = true;
+
+  request.features.clear();
+
+  for (auto feature : requirements.required_features) {
+    if (wgpuAdapterHasFeature(adapter, feature)) {
+      request.features.emplace_back(feature);
+    } else {
+      spdlog::error("adapter lacks required feature {}", FeatureName(feature));
+      ok = false;
+    }
+  }
+
+  for (auto feature : requirements.optional_features) {
+    if (wgpuAdapterHasFeature(adapter, feature)) {
+      request.features.emplace_back(feature);
+    } else {
+      spdlog::info("optional feature {} not available", FeatureName(feature));
+    }
+  }
+
+  WGPUSupportedLimits supported{};
+  wgpuAdapterGetLimits(adapter, &supported);
+
+  const auto &required = requirements.required_limits;
+
+  request.limits = {};
+  request.limits.limits =
+      requirements.adapter_limits ? supported.limits : UndefinedLimits();
+
+  for (const auto &limit : kU32Limits) {
+    auto value = required.*limit.field;
+    if (value == WGPU_LIMIT_U32_UNDEFINED) {
+      continue;
+    }
+
+    auto available = supported.limits.*limit.field;
+
+    if (limit.alignment ? value < available : value > available) {
+      spdlog::error("adapter {} is {}, {} is required", limit.name, available,
+                    value);
+      ok = false;
+    } else if (!requirements.adapter_limits) {
+      request.limits.limits.*limit.field = value;
+    }
+  }
+
+  for (const auto &limit : kU64Limits) {
+    auto value = required.*limit.field;
+    if (value == WGPU_LIMIT_U64_UNDEFINED) {
+      continue;
+    }
+
+    auto available = supported.limits.*limit.field;
+
+    if (value > available) {
+      spdlog::error("adapter {} is {}, {} is required", limit.name, available,
+                    value);
+      ok = false;
+    } else if (!requirements.adapter_limits) {
+      request.limits.limits.*limit.field = value;
+    }
+  }
+
+  return ok;
+}
+
+void LogDeviceCapabilities(WGPUDevice device) {
+  std::vector<WGPUFeatureName> features(
+      wgpuDeviceEnumerateFeatures(device, nullptr));
+  wgpuDeviceEnumerateFeatures(device, features.data());
+
+  std::string names;
+  for (auto feature : features) {
+    if (!names.empty()) {
+      names += ", ";
+    }
+    names += FeatureName(feature);
+  }
+
+  WGPUSupportedLimits limits{};
+  wgpuDeviceGetLimits(device, &limits);
+
+  spdlog::info("device features: {}", names.empty() ? "none" : names);
+  spdlog::info("device limits: max buffer {} MB, max storage binding {} MB, "
+               "{} bind groups, {} storage buffers per stage",
+               limits.limits.maxBufferSize >> 20,
+               limits.limits.maxStorageBufferBindingSize >> 20,
+               limits.limits.maxBindGroups,
+               limits.limits.maxStorageBuffersPerShaderStage);
+}
+
+const char *FeatureName(WGPUFeatureName feature) {
+  switch (feature) {
+  case WGPUFeatureName_DepthClipControl:
+    return "depth-clip-control";
+  case WGPUFeatureName_Depth32FloatStencil8:
+    return "depth32float-stencil8";
+  case WGPUFeatureName_TimestampQuery:
+    return "timestamp-query";
+  case WGPUFeatureName_PipelineStatisticsQuery:
+    return "pipeline-statistics-query";
+  case WGPUFeatureName_TextureCompressionBC:
+    return "texture-compression-bc";
+  case WGPUFeatureName_TextureCompressionETC2:
+    return "texture-compression-etc2";
+  case WGPUFeatureName_TextureCompressionASTC:
+    return "texture-compression-astc";
+  case WGPUFeatureName_IndirectFirstInstance:
+    return "indirect-first-instance";
+  case WGPUFeatureName_ShaderF16:
+    return "shader-f16";
+  case WGPUFeatureName_RG11B10UfloatRenderable:
+    return "rg11b10ufloat-renderable";
+  case WGPUFeatureName_BGRA8UnormStorage:
+    return "bgra8unorm-storage";
+  case WGPUFeatureName_DawnShaderFloat16:
+    return "dawn-shader-float16";
+  case WGPUFeatureName_DawnInternalUsages:
+    return "dawn-internal-usages";
+  case WGPUFeatureName_DawnMultiPlanarFormats:
+    return "dawn-multi-planar-formats";
+  case WGPUFeatureName_DawnNative:
+    return "dawn-native";
+  case WGPUFeatureName_ChromiumExperimentalDp4a:
+    return "chromium-experimental-dp4a";
+  case WGPUFeatureName_TimestampQueryInsidePasses:
+    return "timestamp-query-inside-passes";
+  case WGPUFeatureName_ImplicitDeviceSynchronization:
+    return "implicit-device-synchronization";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace util
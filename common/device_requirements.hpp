@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+/**
+ * Limits with every field undefined, which requires nothing.
+ */
+WGPULimits UndefinedLimits();
+
+/**
+ * What a sample needs from its device, see App::GetDeviceRequirements.
+ */
+struct DeviceRequirements {
+  // device creation fails without them
+  std::vector<WGPUFeatureName> required_features;
+  // enabled when the adapter has them, check App::HasFeature
+  std::vector<WGPUFeatureName> optional_features;
+  // device creation fails if the adapter can not do at least this, fields
+  // left undefined are not checked
+  WGPULimits required_limits = UndefinedLimits();
+  // ask for everything the adapter supports instead of the WebGPU defaults
+  bool adapter_limits = true;
+};
+
+/**
+ * The features and limits to create a device with. The descriptor points into
+ * this, so it has to outlive the device creation.
+ */
+struct DeviceRequest {
+  std::vector<WGPUFeatureName> features;
+  WGPURequiredLimits limits = {};
+
+  void Apply(WGPUDeviceDescriptor &desc) const;
+};
+
+/**
+ * Check `requirements` against the adapter. Requests every required and every
+ * supported optional feature, and the adapter's limits or the required ones.
+ *
+ * @return false if the adapter misses a required feature or limit, the
+ *         reason is logged
+ */
+bool NegotiateDevice(WGPUAdapter adapter,
+                     const DeviceRequirements &requirements,
+                     DeviceRequest &request);
+
+/**
+ * Log the features and the main limits the device was granted.
+ */
+void LogDeviceCapabilities(WGPUDevice device);
+
+const char *FeatureName(WGPUFeatureName feature);
+
+} // namespace util
@@ -0,0 +1,175 @@
+#include "draw_list.hpp"
+
+#include <algorithm>
+
+namespace util {
+
+namespace {
+
+constexpr uint32_t kPassBits = 4;
+constexpr uint32_t kPipelineBits = 10;
+constexpr uint32_t kBindGroupBits = 16;
+constexpr uint32_t kGeometryBits = 10;
+constexpr uint32_t kDepthBits = 24;
+
+static_assert(kPassBits + kPipelineBits + kBindGroupBits + kGeometryBits +
+                      kDepthBits ==
+                  64,
+              "sort key must fill 64 bits");
+
+constexpr uint64_t Field(uint64_t value, uint32_t bits, uint32_t shift) {
+  return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+uint64_t MakeKey(uint32_t pass, uint32_t pipeline, uint32_t bind_group,
+                 uint32_t geometry, float depth) {
+  constexpr uint32_t depth_shift = 0;
+  constexpr uint32_t geometry_shift = depth_shift + kDepthBits;
+  constexpr uint32_t bind_group_shift = geometry_shift + kGeometryBits;
+  constexpr uint32_t pipeline_shift = bind_group_shift + kBindGroupBits;
+  constexpr uint32_t pass_shift = pipeline_shift + kPipelineBits;
+
+  depth = std::min(std::max(depth, 0.f), 1.f);
+
+  auto quantized = static_cast<uint64_t>(
+      depth * static_cast<float>((uint64_t(1) << kDepthBits) - 1));
+
+  return Field(pass, kPassBits, pass_shift) |
+         Field(pipeline, kPipelineBits, pipeline_shift) |
+         Field(bind_group, kBindGroupBits, bind_group_shift) |
+         Field(geometry, kGeometryBits, geometry_shift) |
+         Field(quantized, kDepthBits, depth_shift);
+}
+
+} // namespace
+
+void DrawList::Clear() {
+  m_commands.clear();
+  m_items.clear();
+}
+
+void DrawList::Add(uint32_t pass, float depth, const DrawCommand &command) {
+  uint64_t key =
+      MakeKey(pass, PipelineId(command.pipeline),
+              BindGroupSetId(command.bind_groups),
+              GeometryId(command.vertex_buffer, command.index_buffer), depth);
+
+  m_items.emplace_back(Item{key, static_cast<uint32_t>(m_commands.size())});
+  m_commands.emplace_back(command);
+}
+
+void DrawList::Sort() {
+  if (m_items.size() < 2) {
+    return;
+  }
+
+  m_scratch.resize(m_items.size());
+
+  // bits which differ between at least two keys, the other bytes need no pass
+  uint64_t first = m_items.front().key;
+  uint64_t diff = 0;
+  for (const auto &item : m_items) {
+    diff |= item.key ^ first;
+  }
+
+  for (uint32_t shift = 0; shift < 64; shift += 8) {
+    if (((diff >> shift) & 0xff) == 0) {
+      continue;
+    }
+
+    uint32_t histogram[256] = {};
+    for (const auto &item : m_items) {
+      histogram[(item.key >> shift) & 0xff]++;
+    }
+
+    uint32_t offset = 0;
+    for (auto &count : histogram) {
+      uint32_t c = count;
+      count = offset;
+      offset += c;
+    }
+
+    // stable scatter, keeps the order of the lower bytes
+    for (const auto &item : m_items) {
+      m_scratch[histogram[(item.key >> shift) & 0xff]++] = item;
+    }
+
+    m_items.swap(m_scratch);
+  }
+}
+
+RenderPassStats DrawList::CountStateChanges() const {
+  RenderPassEncoder dry_run{nullptr};
+
+  Emit(dry_run);
+
+  return dry_run.GetStats();
+}
+
+void DrawList::Emit(RenderPassEncoder &encoder) const {
+  for (const auto &item : m_items) {
+    const auto &cmd = m_commands[item.index];
+
+    encoder.SetPipeline(cmd.pipeline);
+
+    for (uint32_t i = 0; i < kMaxBindGroups && cmd.bind_groups[i]; i++) {
+      encoder.SetBindGroup(i, cmd.bind_groups[i]);
+    }
+
+    if (cmd.vertex_buffer) {
+      encoder.SetVertexBuffer(0, cmd.vertex_buffer, cmd.vertex_offset);
+    }
+
+    if (cmd.index_buffer) {
+      encoder.SetIndexBuffer(cmd.index_buffer, cmd.index_format);
+
+      encoder.DrawIndexed(cmd.count, cmd.instance_count, cmd.first,
+                          cmd.base_vertex, cmd.first_instance);
+    } else {
+      encoder.Draw(cmd.count, cmd.instance_count, cmd.first,
+                   cmd.first_instance);
+    }
+  }
+}
+
+uint32_t DrawList::PipelineId(WGPURenderPipeline pipeline) {
+  auto it = m_pipeline_ids.find(pipeline);
+  if (it != m_pipeline_ids.end()) {
+    return it->second;
+  }
+
+  auto id = static_cast<uint32_t>(m_pipeline_ids.size());
+  m_pipeline_ids[pipeline] = id;
+
+  return id;
+}
+
+uint32_t DrawList::BindGroupSetId(
+    const std::array<WGPUBindGroup, kMaxBindGroups> &bind_groups) {
+  auto it = m_bind_group_ids.find(bind_groups);
+  if (it != m_bind_group_ids.end()) {
+    return it->second;
+  }
+
+  auto id = static_cast<uint32_t>(m_bind_group_ids.size());
+  m_bind_group_ids[bind_groups] = id;
+
+  return id;
+}
+
+uint32_t DrawList::GeometryId(WGPUBuffer vertex_buffer,
+                              WGPUBuffer index_buffer) {
+  std::array<WGPUBuffer, 2> geometry{vertex_buffer, index_buffer};
+
+  auto it = m_geometry_ids.find(geometry);
+  if (it != m_geometry_ids.end()) {
+    return it->second;
+  }
+
+  auto id = static_cast<uint32_t>(m_geometry_ids.size());
+  m_geometry_ids[geometry] = id;
+
+  return id;
+}
+
+} // namespace util
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+#include "render_pass_encoder.hpp"
+
+namespace util {
+
+/**
+ * Everything needed to record one draw call. A null `index_buffer` means a
+ * non indexed draw, bind groups stop at the first null entry.
+ */
+struct DrawCommand {
+  WGPURenderPipeline pipeline = nullptr;
+  std::array<WGPUBindGroup, kMaxBindGroups> bind_groups = {};
+  WGPUBuffer vertex_buffer = nullptr;
+  uint64_t vertex_offset = 0;
+  WGPUBuffer index_buffer = nullptr;
+  WGPUIndexFormat index_format = WGPUIndexFormat_Uint32;
+  // vertex or index count
+  uint32_t count = 0;
+  uint32_t instance_count = 1;
+  // first vertex or first index
+  uint32_t first = 0;
+  int32_t base_vertex = 0;
+  uint32_t first_instance = 0;
+};
+
+/**
+ * A frame's draws, sorted by a 64 bit key before they are recorded.
+ *
+ * Key layout, from the most significant bit:
+ *
+ *      pass      :  4 bits
+ *      pipeline  : 10 bits
+ *      bind group: 16 bits  (the whole set of bind groups)
+ *      geometry  : 10 bits  (vertex and index buffer)
+ *      depth     : 24 bits
+ *
+ * Ids are handed out the first time a handle is seen and kept across frames,
+ * so the order is stable. Ids wrap around once a field is full, which only
+ * makes the sort less effective, Emit compares the real handles. Handles
+ * created every frame make the id tables grow, reuse them instead.
+ *
+ * `pass` orders groups of draws inside one render pass, like opaque before
+ * transparent. `depth` is in [0, 1], pass `1 - depth` for back to front.
+ */
+class DrawList {
+public:
+  void Clear();
+
+  void Add(uint32_t pass, float depth, const DrawCommand &command);
+
+  /**
+   * LSD radix sort on the keys, bytes which are equal for every key are
+   * skipped.
+   */
+  void Sort();
+
+  /**
+   * Commands Emit would record in the current order, without recording.
+   */
+  RenderPassStats CountStateChanges() const;
+
+  /**
+   * Record every draw in the current order, `encoder` drops the state which
+   * is already bound.
+   */
+  void Emit(RenderPassEncoder &encoder) const;
+
+  size_t GetSize() const { return m_items.size(); }
+
+private:
+  struct Item {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  struct HandleArrayHash {
+    template <typename T, size_t N>
+    size_t operator()(const std::array<T, N> &handles) const {
+      size_t hash = 0;
+      for (auto handle : handles) {
+        hash = hash * 31 + std::hash<T>{}(handle);
+      }
+      return hash;
+    }
+  };
+
+  uint32_t PipelineId(WGPURenderPipeline pipeline);
+
+  uint32_t BindGroupSetId(
+      const std::array<WGPUBindGroup, kMaxBindGroups> &bind_groups);
+
+  uint32_t GeometryId(WGPUBuffer vertex_buffer, WGPUBuffer index_buffer);
+
+private:
+  std::vector<DrawCommand> m_commands;
+  std::vector<Item> m_items;
+  // radix sort ping pong buffer
+  std::vector<Item> m_scratch;
+
+  std::unordered_map<WGPURenderPipeline, uint32_t> m_pipeline_ids;
+  std::unordered_map<std::array<WGPUBindGroup, kMaxBindGroups>, uint32_t,
+                     HandleArrayHash>
+      m_bind_group_ids;
+  std::unordered_map<std::array<WGPUBuffer, 2>, uint32_t, HandleArrayHash>
+      m_geometry_ids;
+};
+
+} // namespace util
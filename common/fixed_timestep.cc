@@ -0,0 +1,33 @@
+#include "fixed_timestep.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace util {
+
+FixedTimestep::FixedTimestep(double step, uint32_t max_steps)
+    : m_step(step > 0.0 ? step : 1.0 / 60.0),
+      m_max_steps(std::max(max_steps, 1u)) {}
+
+uint32_t FixedTimestep::Advance(double elapsed) {
+  m_accumulator += std::max(elapsed, 0.0);
+
+  uint32_t steps = 0;
+  while (m_accumulator >= m_step && steps < m_max_steps) {
+    m_accumulator -= m_step;
+    steps++;
+  }
+
+  if (m_accumulator >= m_step) {
+    // a stall or a breakpoint, catching up would only stall the next frames
+    auto behind = std::floor(m_accumulator / m_step);
+    m_dropped += static_cast<uint64_t>(behind);
+    m_accumulator -= behind * m_step;
+  }
+
+  m_time += steps * m_step;
+
+  return steps;
+}
+
+} // namespace util
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace util {
+
+/**
+ * Accumulates frame time and turns it into whole simulation steps, so the
+ * simulation advances at the same rate whatever the frame rate.
+ *
+ * The time left over after the last step is reported as an interpolation
+ * factor: rendering the state between the previous and the current step at
+ * `GetAlpha()` hides the stepping when frames and steps do not line up.
+ */
+class FixedTimestep {
+public:
+  /**
+   * @param step        simulated seconds per step
+   * @param max_steps   steps run at most per frame, the rest of a long frame
+   *                    is dropped instead of falling further behind
+   */
+  explicit FixedTimestep(double step = 1.0 / 60.0, uint32_t max_steps = 8);
+
+  /**
+   * Add `elapsed` seconds of frame time.
+   *
+   * @return the number of steps to simulate now
+   */
+  uint32_t Advance(double elapsed);
+
+  double GetStep() const { return m_step; }
+
+  /**
+   * Fraction of a step accumulated past the last one, in [0, 1).
+   */
+  double GetAlpha() const { return m_accumulator / m_step; }
+
+  /**
+   * Simulated seconds after the steps returned so far.
+   */
+  double GetTime() const { return m_time; }
+
+  // steps skipped because frames took too long
+  uint64_t GetDroppedSteps() const { return m_dropped; }
+
+private:
+  double m_step;
+  uint32_t m_max_steps;
+  double m_accumulator = 0.0;
+  double m_time = 0.0;
+  uint64_t m_dropped = 0;
+};
+
+} // namespace util
@@ -0,0 +1,152 @@
+#include "frame_bench.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+namespace {
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+
+  return sorted[index];
+}
+
+std::string ToJson(const Distribution &d) {
+  return fmt::format("{{\"avg\": {:.4f}, \"min\": {:.4f}, \"p50\": {:.4f}, "
+                     "\"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f}}}",
+                     d.avg, d.min, d.p50, d.p95, d.p99, d.max);
+}
+
+// the adapter description comes from the driver
+std::string Escape(const std::string &str) {
+  std::string result;
+
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) >= 0x20) {
+      result += c;
+    }
+  }
+
+  return result;
+}
+
+} // namespace
+
+Distribution Distribution::From(std::vector<double> values) {
+  Distribution d{};
+
+  if (values.empty()) {
+    return d;
+  }
+
+  std::sort(values.begin(), values.end());
+
+  for (auto v : values) {
+    d.avg += v;
+  }
+
+  d.avg /= static_cast<double>(values.size());
+  d.min = values.front();
+  d.p50 = Percentile(values, 0.50);
+  d.p95 = Percentile(values, 0.95);
+  d.p99 = Percentile(values, 0.99);
+  d.max = values.back();
+
+  return d;
+}
+
+void FrameBench::BeginInit() {
+  m_start_allocations = GetAllocationCount();
+  m_start = Clock::now();
+}
+
+void FrameBench::EndInit() {
+  m_init_time =
+      std::chrono::duration<double, std::milli>(Clock::now() - m_start)
+          .count();
+  m_init_allocations = GetAllocationCount() - m_start_allocations;
+}
+
+void FrameBench::BeginFrame() {
+  m_start_allocations = GetAllocationCount();
+  m_start = Clock::now();
+}
+
+void FrameBench::EndFrame() {
+  m_cpu_times.emplace_back(
+      std::chrono::duration<double, std::milli>(Clock::now() - m_start)
+          .count());
+  m_allocations.emplace_back(GetAllocationCount() - m_start_allocations);
+}
+
+void FrameBench::AddGpuTime(double ms) { m_gpu_times.emplace_back(ms); }
+
+void FrameBench::SetStartup(double total, std::vector<StartupPhase> phases) {
+  m_startup_time = total;
+  m_startup_phases = std::move(phases);
+}
+
+void FrameBench::SetLoop(const std::string &mode, double fps,
+                         double cpu_percent) {
+  m_loop_mode = mode;
+  m_loop_fps = fps;
+  m_loop_cpu = cpu_percent;
+}
+
+bool FrameBench::WriteJson(const std::string &path, const std::string &name,
+                           const std::string &adapter,
+                           const std::string &profile) const {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    spdlog::error("can not write bench result: {}", path);
+    return false;
+  }
+
+  uint64_t frame_allocations = 0;
+  uint64_t max_allocations = 0;
+  for (auto count : m_allocations) {
+    frame_allocations += count;
+    max_allocations = std::max(max_allocations, count);
+  }
+
+  double avg_allocations =
+      m_allocations.empty() ? 0.0
+                            : static_cast<double>(frame_allocations) /
+                                  static_cast<double>(m_allocations.size());
+
+  // phase durations, background ones overlap the others
+  std::string startup = fmt::format("{{\"total\": {:.4f}", m_startup_time);
+  for (const auto &phase : m_startup_phases) {
+    startup += fmt::format(", \"{}\": {:.4f}", Escape(phase.name),
+                           phase.duration);
+  }
+  startup += "}";
+
+  // process CPU time over the whole loop, 100 is one core
+  auto loop = fmt::format(
+      "{{\"mode\": \"{}\", \"fps\": {:.2f}, \"cpu_percent\": {:.2f}}}",
+      Escape(m_loop_mode), m_loop_fps, m_loop_cpu);
+
+  file << fmt::format(
+      "{{\"name\": \"{}\", \"adapter\": \"{}\", \"profile\": \"{}\", "
+      "\"frames\": {}, \"init_ms\": {:.4f}, \"init_allocations\": {}, "
+      "\"startup_ms\": {}, \"loop\": {}, \"cpu_ms\": {}, \"gpu_ms\": {}, "
+      "\"frame_allocations\": {{\"total\": {}, \"avg\": {:.2f}, "
+      "\"max\": {}}}}}\n",
+      Escape(name), Escape(adapter), Escape(profile), m_cpu_times.size(),
+      m_init_time, m_init_allocations, startup, loop,
+      ToJson(Distribution::From(m_cpu_times)),
+      ToJson(Distribution::From(m_gpu_times)), frame_allocations,
+      avg_allocations, max_allocations);
+
+  return file.good();
+}
+
+} // namespace util
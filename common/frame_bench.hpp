@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "startup_trace.hpp"
+
+namespace util {
+
+/**
+ * Number of operator new calls made by the process so far, Dawn included.
+ */
+uint64_t GetAllocationCount();
+
+struct Distribution {
+  double avg = 0.0;
+  double min = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+
+  static Distribution From(std::vector<double> values);
+};
+
+/**
+ * Collects init time, CPU and GPU frame times and allocations of an App run.
+ *
+ * CPU time is the time spent in OnLoop. GPU time is measured from the end of
+ * OnLoop until wgpuQueueOnSubmittedWorkDone fires, so it includes the queue
+ * latency, but works on every adapter since no timestamp query is needed.
+ */
+class FrameBench {
+public:
+  void BeginInit();
+
+  void EndInit();
+
+  void BeginFrame();
+
+  void EndFrame();
+
+  void AddGpuTime(double ms);
+
+  /**
+   * @param total   milliseconds to the first presented frame
+   */
+  void SetStartup(double total, std::vector<StartupPhase> phases);
+
+  /**
+   * @param mode          the loop mode, see LoopMode
+   * @param fps           frames rendered per second of wall time
+   * @param cpu_percent   process CPU time over wall time, 100 is one core
+   */
+  void SetLoop(const std::string &mode, double fps, double cpu_percent);
+
+  /**
+   * Write the results as one JSON object.
+   *
+   * @param name      the sample name
+   * @param adapter   the adapter description, to compare runs
+   * @param profile   the run profile, see RunProfile
+   */
+  bool WriteJson(const std::string &path, const std::string &name,
+                 const std::string &adapter, const std::string &profile) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point m_start = {};
+  uint64_t m_start_allocations = 0;
+
+  double m_init_time = 0.0;
+  uint64_t m_init_allocations = 0;
+
+  double m_startup_time = 0.0;
+  std::vector<StartupPhase> m_startup_phases;
+
+  std::string m_loop_mode;
+  double m_loop_fps = 0.0;
+  double m_loop_cpu = 0.0;
+
+  // per frame, in milliseconds
+  std::vector<double> m_cpu_times;
+  std::vector<double> m_gpu_times;
+  std::vector<uint64_t> m_allocations;
+};
+
+} // namespace util
@@ -0,0 +1,108 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace util {
+
+namespace {
+
+constexpr std::chrono::microseconds kMinMargin{200};
+constexpr std::chrono::microseconds kInitialMargin{2000};
+
+} // namespace
+
+bool ParseLoopMode(const char *name, LoopMode &mode) {
+  for (auto candidate :
+       {LoopMode::kContinuous, LoopMode::kCapped, LoopMode::kOnDemand}) {
+    if (std::strcmp(name, LoopModeName(candidate)) == 0) {
+      mode = candidate;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const char *LoopModeName(LoopMode mode) {
+  switch (mode) {
+  case LoopMode::kContinuous:
+    return "continuous";
+  case LoopMode::kCapped:
+    return "capped";
+  case LoopMode::kOnDemand:
+    return "on-demand";
+  }
+
+  return "unknown";
+}
+
+double GetProcessCpuTime() {
+#if defined(_WIN32)
+  FILETIME creation, exited, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exited, &kernel,
+                       &user)) {
+    return 0.0;
+  }
+
+  auto ticks = [](const FILETIME &time) {
+    return (static_cast<uint64_t>(time.dwHighDateTime) << 32) |
+           time.dwLowDateTime;
+  };
+
+  // 100 ns ticks
+  return static_cast<double>(ticks(kernel) + ticks(user)) * 1e-7;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) *
+             1e-6;
+#endif
+}
+
+FramePacer::FramePacer(double fps)
+    : m_period(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / std::max(fps, 1.0)))),
+      m_margin(kInitialMargin), m_deadline(Clock::now()) {}
+
+void FramePacer::Wait() {
+  auto now = Clock::now();
+
+  m_deadline += m_period;
+  if (m_deadline <= now) {
+    m_deadline = now;
+    return;
+  }
+
+  auto wake = m_deadline - m_margin;
+  if (wake > now) {
+    std::this_thread::sleep_until(wake);
+
+    auto late = Clock::now() - wake;
+    if (late > m_margin) {
+      m_margin = late;
+    } else {
+      m_margin -= (m_margin - late) / 16;
+    }
+
+    // std::clamp would need kMinMargin <= m_period, not true above 5000 fps
+    m_margin = std::min<Clock::duration>(
+        std::max<Clock::duration>(m_margin, kMinMargin), m_period);
+  }
+
+  while (Clock::now() < m_deadline) {
+    std::this_thread::yield();
+  }
+}
+
+} // namespace util
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+
+namespace util {
+
+enum class LoopMode {
+  // render as fast as the swapchain takes frames
+  kContinuous,
+  // render at most at the target frame rate
+  kCapped,
+  // sleep in glfwWaitEvents until the window or the sample asks for a frame
+  kOnDemand,
+};
+
+/**
+ * "continuous", "capped" or "on-demand".
+ */
+bool ParseLoopMode(const char *name, LoopMode &mode);
+
+const char *LoopModeName(LoopMode mode);
+
+/**
+ * CPU time used by all threads of the process so far, in seconds.
+ */
+double GetProcessCpuTime();
+
+/**
+ * Holds a loop to a fixed frame rate.
+ *
+ * Sleeping alone overshoots by the scheduler's wake-up latency and spinning
+ * alone burns the core the cap is meant to save, so Wait sleeps until shortly
+ * before the deadline and yields for the rest. The margin follows the
+ * oversleep actually observed: it grows at once when a wake-up is late and
+ * shrinks slowly while they are on time.
+ */
+class FramePacer {
+public:
+  explicit FramePacer(double fps);
+
+  /**
+   * Block until the next frame is due. A frame that overran its slot starts
+   * the next one right away, without catching up on the lost time.
+   */
+  void Wait();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::duration m_period;
+  Clock::duration m_margin;
+  Clock::time_point m_deadline;
+};
+
+} // namespace util
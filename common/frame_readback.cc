@@ -0,0 +1,205 @@
+#include "frame_readback.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+FrameReadback::FrameReadback(WGPUDevice device, WGPUQueue queue,
+                             uint32_t width, uint32_t height,
+                             WGPUTextureFormat format,
+                             std::unique_ptr<FrameSink> sink,
+                             uint32_t ring_size)
+    : m_device(device), m_queue(queue), m_width(width), m_height(height),
+      m_format(format), m_sink(std::move(sink)),
+      m_mapped(std::max(1u, ring_size)), m_written(std::max(1u, ring_size)) {
+  m_padded_row = (width * 4 + 255) & ~255u;
+
+  for (uint32_t i = 0; i < std::max(1u, ring_size); i++) {
+    auto slot = std::make_unique<Slot>();
+    slot->owner = this;
+
+    WGPUBufferDescriptor desc{};
+    desc.label = "Readback buffer";
+    desc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    desc.size = uint64_t(m_padded_row) * m_height;
+
+    slot->buffer = wgpuDeviceCreateBuffer(m_device, &desc);
+
+    m_slots.emplace_back(std::move(slot));
+  }
+
+  m_consumer = std::thread([this] { Consume(); });
+}
+
+FrameReadback::~FrameReadback() {
+  Finish();
+
+  for (auto &slot : m_slots) {
+    wgpuBufferRelease(slot->buffer);
+  }
+}
+
+bool FrameReadback::Capture(WGPUTexture texture, uint64_t frame) {
+  auto start = std::chrono::steady_clock::now();
+
+  // fires the map callbacks of earlier captures
+  wgpuDeviceTick(m_device);
+
+  ReleaseWritten();
+
+  auto it = std::find_if(m_slots.begin(), m_slots.end(), [](const auto &s) {
+    return s->state == State::kFree;
+  });
+
+  if (it == m_slots.end()) {
+    m_skipped++;
+    return false;
+  }
+
+  auto slot = it->get();
+  slot->state = State::kMapping;
+  slot->frame = frame;
+
+  auto encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+
+  WGPUImageCopyTexture src{};
+  src.texture = texture;
+  src.mipLevel = 0;
+  src.aspect = WGPUTextureAspect_All;
+
+  WGPUImageCopyBuffer dst{};
+  dst.buffer = slot->buffer;
+  dst.layout.offset = 0;
+  dst.layout.bytesPerRow = m_padded_row;
+  dst.layout.rowsPerImage = m_height;
+
+  WGPUExtent3D size{m_width, m_height, 1};
+
+  wgpuCommandEncoderCopyTextureToBuffer(encoder, &src, &dst, &size);
+
+  auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+  wgpuCommandEncoderRelease(encoder);
+
+  wgpuQueueSubmit(m_queue, 1, &cmd);
+  wgpuCommandBufferRelease(cmd);
+
+  wgpuBufferMapAsync(slot->buffer, WGPUMapMode_Read, 0,
+                     uint64_t(m_padded_row) * m_height, &MapCallback, slot);
+
+  m_captured++;
+
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  m_capture_time += ms;
+  m_max_capture_time = std::max(m_max_capture_time, ms);
+
+  return true;
+}
+
+void FrameReadback::Finish() {
+  if (!m_consumer.joinable()) {
+    return;
+  }
+
+  auto mapping = [this] {
+    return std::any_of(m_slots.begin(), m_slots.end(), [](const auto &s) {
+      return s->state == State::kMapping;
+    });
+  };
+
+  while (mapping()) {
+    wgpuDeviceTick(m_device);
+  }
+
+  // the consumer writes what is left and stops
+  m_mapped.Close();
+  m_consumer.join();
+
+  ReleaseWritten();
+
+  m_sink->Finish();
+
+  if (m_captured > 0) {
+    spdlog::info("readback: {} frames captured, {} skipped, "
+                 "render thread avg: {:.3f} ms max: {:.3f} ms",
+                 m_captured, m_skipped, m_capture_time / m_captured,
+                 m_max_capture_time);
+  }
+}
+
+void FrameReadback::MapCallback(WGPUBufferMapAsyncStatus status,
+                                void *userdata) {
+  auto slot = reinterpret_cast<Slot *>(userdata);
+
+  if (status != WGPUBufferMapAsyncStatus_Success) {
+    spdlog::error("readback of frame {} failed: {}", slot->frame,
+                  static_cast<int>(status));
+    slot->state = State::kFree;
+    return;
+  }
+
+  auto owner = slot->owner;
+  auto size = uint64_t(owner->m_padded_row) * owner->m_height;
+
+  slot->mapped = reinterpret_cast<const uint8_t *>(
+      wgpuBufferGetConstMappedRange(slot->buffer, 0, size));
+  slot->state = State::kWriting;
+
+  // never blocks, the queue holds the whole ring
+  owner->m_mapped.Push(slot);
+}
+
+void FrameReadback::Consume() {
+  std::vector<uint8_t> rgba;
+
+  Slot *slot = nullptr;
+  while (m_mapped.Pop(slot)) {
+    Convert(*slot, rgba);
+
+    m_sink->WriteFrame(slot->frame, m_width, m_height, rgba.data());
+
+    m_written.Push(slot);
+  }
+}
+
+void FrameReadback::Convert(const Slot &slot,
+                            std::vector<uint8_t> &rgba) const {
+  uint32_t row = m_width * 4;
+
+  rgba.resize(uint64_t(row) * m_height);
+
+  bool swap = m_format == WGPUTextureFormat_BGRA8Unorm ||
+              m_format == WGPUTextureFormat_BGRA8UnormSrgb;
+
+  for (uint32_t y = 0; y < m_height; y++) {
+    const uint8_t *src = slot.mapped + uint64_t(y) * m_padded_row;
+    uint8_t *dst = rgba.data() + uint64_t(y) * row;
+
+    if (!swap) {
+      std::copy(src, src + row, dst);
+      continue;
+    }
+
+    for (uint32_t x = 0; x < row; x += 4) {
+      dst[x + 0] = src[x + 2];
+      dst[x + 1] = src[x + 1];
+      dst[x + 2] = src[x + 0];
+      dst[x + 3] = src[x + 3];
+    }
+  }
+}
+
+void FrameReadback::ReleaseWritten() {
+  Slot *slot = nullptr;
+  while (m_written.TryPop(slot)) {
+    wgpuBufferUnmap(slot->buffer);
+
+    slot->mapped = nullptr;
+    slot->state = State::kFree;
+  }
+}
+
+} // namespace util
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+#include "blocking_queue.hpp"
+#include "frame_sink.hpp"
+
+namespace util {
+
+/**
+ * Reads frames back from the GPU without stalling the render loop.
+ *
+ * Capture records a copy of the frame into one buffer of a ring of MapRead
+ * buffers and starts mapping it. Map callbacks fire on the thread ticking the
+ * device and hand the mapped memory to a consumer thread. The consumer
+ * thread drops the row padding, converts BGRA to RGBA and passes the frame
+ * to `sink`. The buffer is unmapped on the render thread during a later
+ * Capture.
+ *
+ * When every buffer is still in flight the frame is skipped instead of
+ * waiting, so the render thread only pays for recording the copy.
+ */
+class FrameReadback {
+public:
+  /**
+   * @param format   BGRA8Unorm or RGBA8Unorm
+   */
+  FrameReadback(WGPUDevice device, WGPUQueue queue, uint32_t width,
+                uint32_t height, WGPUTextureFormat format,
+                std::unique_ptr<FrameSink> sink, uint32_t ring_size = 3);
+
+  ~FrameReadback();
+
+  FrameReadback(const FrameReadback &) = delete;
+  FrameReadback &operator=(const FrameReadback &) = delete;
+
+  /**
+   * Copy `texture` into a free buffer, after the frame has been submitted.
+   * The texture needs the CopySrc usage.
+   *
+   * @return false if the frame was skipped
+   */
+  bool Capture(WGPUTexture texture, uint64_t frame);
+
+  /**
+   * Wait until every captured frame is passed to the sink, then finish it.
+   */
+  void Finish();
+
+  uint32_t GetCapturedCount() const { return m_captured; }
+
+  uint32_t GetSkippedCount() const { return m_skipped; }
+
+private:
+  enum class State {
+    kFree,
+    kMapping,
+    // owned by the consumer thread
+    kWriting,
+  };
+
+  struct Slot {
+    FrameReadback *owner = nullptr;
+    WGPUBuffer buffer = nullptr;
+    State state = State::kFree;
+    uint64_t frame = 0;
+    const uint8_t *mapped = nullptr;
+  };
+
+  static void MapCallback(WGPUBufferMapAsyncStatus status, void *userdata);
+
+  void Consume();
+
+  void Convert(const Slot &slot, std::vector<uint8_t> &rgba) const;
+
+  void ReleaseWritten();
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+  uint32_t m_width;
+  uint32_t m_height;
+  WGPUTextureFormat m_format;
+  std::unique_ptr<FrameSink> m_sink;
+
+  // copyTextureToBuffer needs rows aligned to 256 bytes
+  uint32_t m_padded_row = 0;
+
+  std::vector<std::unique_ptr<Slot>> m_slots;
+
+  // mapped slots waiting for the consumer, and slots it is done with
+  BlockingQueue<Slot *> m_mapped;
+  BlockingQueue<Slot *> m_written;
+  std::thread m_consumer;
+
+  uint32_t m_captured = 0;
+  uint32_t m_skipped = 0;
+  // render thread time spent in Capture, in milliseconds
+  double m_capture_time = 0.0;
+  double m_max_capture_time = 0.0;
+};
+
+} // namespace util
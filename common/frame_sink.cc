@@ -0,0 +1,208 @@
+#include "frame_sink.hpp"
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <png.h>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+namespace {
+
+bool WritePng(const std::string &path, uint32_t width, uint32_t height,
+              const uint8_t *rgba) {
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  auto png =
+      png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  auto info = png ? png_create_info_struct(png) : nullptr;
+
+  if (info == nullptr || setjmp(png_jmpbuf(png))) {
+    png_destroy_write_struct(&png, &info);
+    std::fclose(file);
+    return false;
+  }
+
+  png_init_io(png, file);
+
+  // captures are written while the app runs, speed matters more than size
+  png_set_compression_level(png, 1);
+  png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+
+  png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA,
+               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+               PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+
+  for (uint32_t y = 0; y < height; y++) {
+    png_write_row(png, rgba + uint64_t(y) * width * 4);
+  }
+
+  png_write_end(png, nullptr);
+  png_destroy_write_struct(&png, &info);
+
+  return std::fclose(file) == 0;
+}
+
+bool WriteRaw(const std::string &path, const uint8_t *data, uint64_t size) {
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool ok = std::fwrite(data, 1, size, file) == size;
+
+  return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+ImageSequenceSink::ImageSequenceSink(std::string directory,
+                                     CaptureFormat format)
+    : m_directory(std::move(directory)), m_format(format) {
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+}
+
+void ImageSequenceSink::WriteFrame(uint64_t frame, uint32_t width,
+                                   uint32_t height, const uint8_t *rgba) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "frame_%06llu.%s",
+                static_cast<unsigned long long>(frame),
+                m_format == CaptureFormat::kPng ? "png" : "raw");
+
+  auto path = (std::filesystem::path(m_directory) / name).string();
+
+  bool ok = m_format == CaptureFormat::kPng
+                ? WritePng(path, width, height, rgba)
+                : WriteRaw(path, rgba, uint64_t(width) * height * 4);
+
+  if (!ok) {
+    spdlog::error("can not write {}", path);
+  }
+}
+
+VideoSink::VideoSink(std::string path, VideoFormat format, uint32_t fps,
+                     uint32_t buffer_count)
+    : m_path(std::move(path)), m_format(format), m_fps(std::max(1u, fps)),
+      m_frames(std::max(1u, buffer_count)), m_free(m_frames.size()),
+      m_filled(m_frames.size()) {
+  if (m_format == VideoFormat::kY4M && !CheckRgbaToI420()) {
+    spdlog::error("video: SIMD RGBA to YUV differs from the scalar path, "
+                  "using the scalar path");
+    m_simd = false;
+  }
+
+  if (m_path == "-") {
+    m_file = stdout;
+  } else {
+    m_file = std::fopen(m_path.c_str(), "wb");
+  }
+
+  if (m_file == nullptr) {
+    spdlog::error("can not open {}", m_path);
+    m_failed = true;
+  }
+
+  for (auto &frame : m_frames) {
+    m_free.Push(&frame);
+  }
+
+  m_writer = std::thread([this] { Run(); });
+}
+
+VideoSink::~VideoSink() { Finish(); }
+
+void VideoSink::WriteFrame(uint64_t frame, uint32_t width, uint32_t height,
+                           const uint8_t *rgba) {
+  if (!m_first && frame > m_last_frame + 1) {
+    m_skipped += frame - m_last_frame - 1;
+  }
+
+  m_first = false;
+  m_last_frame = frame;
+
+  // waits while the writer is behind, this is not the render thread
+  Frame *out = nullptr;
+  if (!m_free.Pop(out)) {
+    return;
+  }
+
+  out->width = width;
+  out->height = height;
+
+  if (m_format == VideoFormat::kY4M) {
+    out->data.resize(I420Size(width, height));
+    (m_simd ? RgbaToI420 : RgbaToI420Scalar)(rgba, width, height,
+                                             out->data.data());
+  } else {
+    out->data.assign(rgba, rgba + uint64_t(width) * height * 4);
+  }
+
+  m_filled.Push(out);
+}
+
+void VideoSink::Finish() {
+  if (!m_writer.joinable()) {
+    return;
+  }
+
+  m_filled.Close();
+  m_writer.join();
+
+  m_free.Close();
+
+  if (m_file && m_file != stdout) {
+    std::fclose(m_file);
+  } else if (m_file) {
+    std::fflush(m_file);
+  }
+  m_file = nullptr;
+
+  spdlog::info("video: {} frames written to {}, {} skipped", m_written, m_path,
+               m_skipped);
+}
+
+void VideoSink::Run() {
+  Frame *frame = nullptr;
+  while (m_filled.Pop(frame)) {
+    if (!m_failed) {
+      // every frame of a stream has the size of the first one
+      bool ok = m_header_written || WriteHeader(*frame);
+      m_header_written = true;
+
+      if (ok && m_format == VideoFormat::kY4M) {
+        ok = std::fputs("FRAME\n", m_file) != EOF;
+      }
+
+      ok = ok && std::fwrite(frame->data.data(), 1, frame->data.size(),
+                             m_file) == frame->data.size();
+
+      if (ok) {
+        m_written++;
+      } else {
+        spdlog::error("can not write {}", m_path);
+        m_failed = true;
+      }
+    }
+
+    m_free.Push(frame);
+  }
+}
+
+bool VideoSink::WriteHeader(const Frame &frame) {
+  if (m_format != VideoFormat::kY4M) {
+    spdlog::info("video: raw RGBA8 {}x{} at {} fps", frame.width,
+                 frame.height, m_fps);
+    return true;
+  }
+
+  return std::fprintf(m_file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n",
+                      frame.width, frame.height, m_fps) > 0;
+}
+
+} // namespace util
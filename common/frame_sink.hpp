@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blocking_queue.hpp"
+
+namespace util {
+
+/**
+ * Receives the frames FrameReadback reads back, on its consumer thread.
+ */
+class FrameSink {
+public:
+  virtual ~FrameSink() = default;
+
+  /**
+   * @param rgba   tightly packed RGBA8 rows, only valid during the call
+   */
+  virtual void WriteFrame(uint64_t frame, uint32_t width, uint32_t height,
+                          const uint8_t *rgba) = 0;
+
+  /**
+   * Called once after the last frame.
+   */
+  virtual void Finish() {}
+};
+
+enum class CaptureFormat {
+  kPng,
+  // tightly packed RGBA8 rows, no header
+  kRaw,
+};
+
+/**
+ * One file per frame, `directory/frame_NNNNNN.png` or `.raw`, where NNNNNN
+ * is the frame index.
+ */
+class ImageSequenceSink : public FrameSink {
+public:
+  ImageSequenceSink(std::string directory, CaptureFormat format);
+
+  void WriteFrame(uint64_t frame, uint32_t width, uint32_t height,
+                  const uint8_t *rgba) override;
+
+private:
+  std::string m_directory;
+  CaptureFormat m_format;
+};
+
+enum class VideoFormat {
+  // YUV4MPEG2, 4:2:0, readable by ffmpeg and most players
+  kY4M,
+  // consecutive RGBA8 frames, no header
+  kRaw,
+};
+
+/**
+ * Streams consecutive frames into one file or pipe, "-" is stdout.
+ *
+ * WriteFrame converts the frame into one of `buffer_count` buffers and
+ * queues it, a writer thread does the I/O. When the writer falls behind the
+ * converting thread waits for a free buffer, which fills the readback ring,
+ * which makes FrameReadback skip frames: the render loop never waits for
+ * the disk. Skipped frames are counted from the gaps in the frame indices.
+ */
+class VideoSink : public FrameSink {
+public:
+  VideoSink(std::string path, VideoFormat format, uint32_t fps = 60,
+            uint32_t buffer_count = 4);
+
+  ~VideoSink() override;
+
+  void WriteFrame(uint64_t frame, uint32_t width, uint32_t height,
+                  const uint8_t *rgba) override;
+
+  void Finish() override;
+
+private:
+  struct Frame {
+    std::vector<uint8_t> data;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+
+  void Run();
+
+  bool WriteHeader(const Frame &frame);
+
+private:
+  std::string m_path;
+  VideoFormat m_format;
+  uint32_t m_fps;
+
+  std::FILE *m_file = nullptr;
+  bool m_header_written = false;
+  bool m_failed = false;
+  // RgbaToI420 when it passed CheckRgbaToI420
+  bool m_simd = true;
+
+  std::vector<Frame> m_frames;
+  BlockingQueue<Frame *> m_free;
+  BlockingQueue<Frame *> m_filled;
+  std::thread m_writer;
+
+  bool m_first = true;
+  uint64_t m_last_frame = 0;
+  uint64_t m_written = 0;
+  uint64_t m_skipped = 0;
+};
+
+} // namespace util
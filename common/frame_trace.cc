@@ -0,0 +1,1301 @@
+#include "frame_trace.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <type_traits>
+
+namespace util {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x52544757; // "WGTR"
+constexpr uint32_t kVersion = 2;
+// id of null handles
+constexpr uint32_t kNull = 0;
+// id of views which were not recorded, replaced by the frame target
+constexpr uint32_t kFrameTarget = 1;
+
+enum TraceOp : uint8_t {
+  kCreateBuffer = 1,
+  kCreateTexture,
+  kCreateTextureView,
+  kCreateSampler,
+  kCreateShaderModule,
+  kCreateBindGroupLayout,
+  kCreatePipelineLayout,
+  kCreateRenderPipeline,
+  kCreateBindGroup,
+  kWriteBuffer,
+  kBeginFrame,
+  kEndFrame,
+  kBeginRenderPass,
+  kSetPipeline,
+  kSetBindGroup,
+  kSetVertexBuffer,
+  kSetIndexBuffer,
+  kSetViewport,
+  kSetScissorRect,
+  kSetBlendConstant,
+  kSetStencilReference,
+  kDraw,
+  kDrawIndexed,
+  kEndRenderPass,
+  kSubmit,
+};
+
+} // namespace
+
+/**
+ * Every op is stored as:
+ *
+ *      op   : uint8
+ *      size : uint32, payload size in bytes
+ *      payload
+ *
+ * so the replayer can skip ops it does not know. Handles are stored as
+ * uint32 ids: 0 is null, 1 the frame target, recorded handles count from 2.
+ * A handle used without being recorded fails the recording, replaying it as
+ * null would hide the missing call.
+ */
+TraceRecorder::TraceRecorder(bool enabled) : m_enabled(enabled) {
+  if (m_enabled) {
+    Put(kMagic);
+    Put(kVersion);
+  }
+}
+
+void TraceRecorder::CreateBuffer(WGPUBuffer buffer,
+                                 const WGPUBufferDescriptor &desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateBuffer);
+  Put(NewId(buffer));
+  Put(static_cast<uint32_t>(desc.usage));
+  Put(desc.size);
+}
+
+void TraceRecorder::CreateTexture(WGPUTexture texture,
+                                  const WGPUTextureDescriptor &desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateTexture);
+  Put(NewId(texture));
+  Put(static_cast<uint32_t>(desc.usage));
+  Put(static_cast<uint32_t>(desc.dimension));
+  Put(desc.size);
+  Put(static_cast<uint32_t>(desc.format));
+  Put(desc.mipLevelCount);
+  Put(desc.sampleCount);
+}
+
+void TraceRecorder::CreateTextureView(WGPUTextureView view, WGPUTexture texture,
+                                      const WGPUTextureViewDescriptor *desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateTextureView);
+  Put(NewId(view));
+  Put(Id(texture));
+  Put(static_cast<uint8_t>(desc != nullptr));
+
+  if (desc) {
+    Put(static_cast<uint32_t>(desc->format));
+    Put(static_cast<uint32_t>(desc->dimension));
+    Put(desc->baseMipLevel);
+    Put(desc->mipLevelCount);
+    Put(desc->baseArrayLayer);
+    Put(desc->arrayLayerCount);
+    Put(static_cast<uint32_t>(desc->aspect));
+  }
+}
+
+void TraceRecorder::CreateSampler(WGPUSampler sampler,
+                                  const WGPUSamplerDescriptor &desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateSampler);
+  Put(NewId(sampler));
+  Put(static_cast<uint32_t>(desc.addressModeU));
+  Put(static_cast<uint32_t>(desc.addressModeV));
+  Put(static_cast<uint32_t>(desc.addressModeW));
+  Put(static_cast<uint32_t>(desc.magFilter));
+  Put(static_cast<uint32_t>(desc.minFilter));
+  Put(static_cast<uint32_t>(desc.mipmapFilter));
+  Put(desc.lodMinClamp);
+  Put(desc.lodMaxClamp);
+  Put(static_cast<uint32_t>(desc.compare));
+  Put(desc.maxAnisotropy);
+}
+
+void TraceRecorder::CreateShaderModule(WGPUShaderModule module,
+                                       const std::string &wgsl) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateShaderModule);
+  Put(NewId(module));
+  PutString(wgsl.c_str());
+}
+
+void TraceRecorder::CreateBindGroupLayout(
+    WGPUBindGroupLayout layout, const WGPUBindGroupLayoutDescriptor &desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateBindGroupLayout);
+  Put(NewId(layout));
+  Put(static_cast<uint32_t>(desc.entryCount));
+
+  for (size_t i = 0; i < desc.entryCount; i++) {
+    const auto &entry = desc.entries[i];
+
+    Put(entry.binding);
+    Put(static_cast<uint32_t>(entry.visibility));
+    Put(static_cast<uint32_t>(entry.buffer.type));
+    Put(static_cast<uint8_t>(entry.buffer.hasDynamicOffset));
+    Put(entry.buffer.minBindingSize);
+    Put(static_cast<uint32_t>(entry.sampler.type));
+    Put(static_cast<uint32_t>(entry.texture.sampleType));
+    Put(static_cast<uint32_t>(entry.texture.viewDimension));
+    Put(static_cast<uint8_t>(entry.texture.multisampled));
+    Put(static_cast<uint32_t>(entry.storageTexture.access));
+    Put(static_cast<uint32_t>(entry.storageTexture.format));
+    Put(static_cast<uint32_t>(entry.storageTexture.viewDimension));
+  }
+}
+
+void TraceRecorder::CreatePipelineLayout(
+    WGPUPipelineLayout layout, const WGPUPipelineLayoutDescriptor &desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreatePipelineLayout);
+  Put(NewId(layout));
+  Put(static_cast<uint32_t>(desc.bindGroupLayoutCount));
+
+  for (size_t i = 0; i < desc.bindGroupLayoutCount; i++) {
+    Put(Id(desc.bindGroupLayouts[i]));
+  }
+}
+
+void TraceRecorder::CreateRenderPipeline(
+    WGPURenderPipeline pipeline, const WGPURenderPipelineDescriptor &desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateRenderPipeline);
+  Put(NewId(pipeline));
+  Put(Id(desc.layout));
+
+  // vertex
+  Put(Id(desc.vertex.module));
+  PutString(desc.vertex.entryPoint);
+  Put(static_cast<uint32_t>(desc.vertex.bufferCount));
+  for (size_t i = 0; i < desc.vertex.bufferCount; i++) {
+    const auto &buffer = desc.vertex.buffers[i];
+
+    Put(buffer.arrayStride);
+    Put(static_cast<uint32_t>(buffer.stepMode));
+    Put(static_cast<uint32_t>(buffer.attributeCount));
+    for (size_t j = 0; j < buffer.attributeCount; j++) {
+      Put(static_cast<uint32_t>(buffer.attributes[j].format));
+      Put(buffer.attributes[j].offset);
+      Put(buffer.attributes[j].shaderLocation);
+    }
+  }
+
+  // primitive
+  Put(static_cast<uint32_t>(desc.primitive.topology));
+  Put(static_cast<uint32_t>(desc.primitive.stripIndexFormat));
+  Put(static_cast<uint32_t>(desc.primitive.frontFace));
+  Put(static_cast<uint32_t>(desc.primitive.cullMode));
+
+  // depth stencil
+  Put(static_cast<uint8_t>(desc.depthStencil != nullptr));
+  if (desc.depthStencil) {
+    const auto &ds = *desc.depthStencil;
+
+    Put(static_cast<uint32_t>(ds.format));
+    Put(static_cast<uint8_t>(ds.depthWriteEnabled));
+    Put(static_cast<uint32_t>(ds.depthCompare));
+    for (const auto &face : {ds.stencilFront, ds.stencilBack}) {
+      Put(static_cast<uint32_t>(face.compare));
+      Put(static_cast<uint32_t>(face.failOp));
+      Put(static_cast<uint32_t>(face.depthFailOp));
+      Put(static_cast<uint32_t>(face.passOp));
+    }
+    Put(ds.stencilReadMask);
+    Put(ds.stencilWriteMask);
+    Put(ds.depthBias);
+    Put(ds.depthBiasSlopeScale);
+    Put(ds.depthBiasClamp);
+  }
+
+  // multisample
+  Put(desc.multisample.count);
+  Put(desc.multisample.mask);
+  Put(static_cast<uint8_t>(desc.multisample.alphaToCoverageEnabled));
+
+  // fragment
+  Put(static_cast<uint8_t>(desc.fragment != nullptr));
+  if (desc.fragment) {
+    Put(Id(desc.fragment->module));
+    PutString(desc.fragment->entryPoint);
+    Put(static_cast<uint32_t>(desc.fragment->targetCount));
+    for (size_t i = 0; i < desc.fragment->targetCount; i++) {
+      const auto &target = desc.fragment->targets[i];
+
+      Put(static_cast<uint32_t>(target.format));
+      Put(static_cast<uint32_t>(target.writeMask));
+      Put(static_cast<uint8_t>(target.blend != nullptr));
+      if (target.blend) {
+        for (const auto &c : {target.blend->color, target.blend->alpha}) {
+          Put(static_cast<uint32_t>(c.operation));
+          Put(static_cast<uint32_t>(c.srcFactor));
+          Put(static_cast<uint32_t>(c.dstFactor));
+        }
+      }
+    }
+  }
+}
+
+void TraceRecorder::CreateBindGroup(WGPUBindGroup group,
+                                    const WGPUBindGroupDescriptor &desc) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kCreateBindGroup);
+  Put(NewId(group));
+  Put(Id(desc.layout));
+  Put(static_cast<uint32_t>(desc.entryCount));
+
+  for (size_t i = 0; i < desc.entryCount; i++) {
+    const auto &entry = desc.entries[i];
+
+    Put(entry.binding);
+    Put(Id(entry.buffer));
+    Put(entry.offset);
+    Put(entry.size);
+    Put(Id(entry.sampler));
+    Put(Id(entry.textureView));
+  }
+}
+
+void TraceRecorder::WriteBuffer(WGPUBuffer buffer, uint64_t offset,
+                                const void *data, uint64_t size) {
+  if (!m_enabled) {
+    return;
+  }
+
+  Op(kWriteBuffer);
+  Put(Id(buffer));
+  Put(offset);
+  Put(size);
+  PutBytes(data, size);
+}
+
+void TraceRecorder::BeginFrame(uint32_t width, uint32_t height,
+                               WGPUTextureFormat format) {
+  if (!m_enabled) {
+    return;
+  }
+
+  m_in_frame = true;
+
+  Op(kBeginFrame);
+  Put(width);
+  Put(height);
+  Put(static_cast<uint32_t>(format));
+}
+
+void TraceRecorder::EndFrame() {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kEndFrame);
+
+  m_in_frame = false;
+  m_frame_count++;
+}
+
+void TraceRecorder::BeginRenderPass(const WGPURenderPassDescriptor &desc) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kBeginRenderPass);
+  Put(static_cast<uint32_t>(desc.colorAttachmentCount));
+  for (size_t i = 0; i < desc.colorAttachmentCount; i++) {
+    const auto &color = desc.colorAttachments[i];
+
+    Put(ViewId(color.view));
+    Put(ViewId(color.resolveTarget));
+    Put(static_cast<uint32_t>(color.loadOp));
+    Put(static_cast<uint32_t>(color.storeOp));
+    Put(color.clearValue);
+  }
+
+  Put(static_cast<uint8_t>(desc.depthStencilAttachment != nullptr));
+  if (desc.depthStencilAttachment) {
+    const auto &ds = *desc.depthStencilAttachment;
+
+    Put(ViewId(ds.view));
+    Put(static_cast<uint32_t>(ds.depthLoadOp));
+    Put(static_cast<uint32_t>(ds.depthStoreOp));
+    Put(ds.depthClearValue);
+    Put(static_cast<uint8_t>(ds.depthReadOnly));
+    Put(static_cast<uint32_t>(ds.stencilLoadOp));
+    Put(static_cast<uint32_t>(ds.stencilStoreOp));
+    Put(ds.stencilClearValue);
+    Put(static_cast<uint8_t>(ds.stencilReadOnly));
+  }
+}
+
+void TraceRecorder::SetPipeline(WGPURenderPipeline pipeline) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetPipeline);
+  Put(Id(pipeline));
+}
+
+void TraceRecorder::SetBindGroup(uint32_t index, WGPUBindGroup group,
+                                 uint32_t dynamic_offset_count,
+                                 const uint32_t *dynamic_offsets) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetBindGroup);
+  Put(index);
+  Put(Id(group));
+  Put(dynamic_offset_count);
+  PutBytes(dynamic_offsets, dynamic_offset_count * sizeof(uint32_t));
+}
+
+void TraceRecorder::SetVertexBuffer(uint32_t slot, WGPUBuffer buffer,
+                                    uint64_t offset, uint64_t size) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetVertexBuffer);
+  Put(slot);
+  Put(Id(buffer));
+  Put(offset);
+  Put(size);
+}
+
+void TraceRecorder::SetIndexBuffer(WGPUBuffer buffer, WGPUIndexFormat format,
+                                   uint64_t offset, uint64_t size) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetIndexBuffer);
+  Put(Id(buffer));
+  Put(static_cast<uint32_t>(format));
+  Put(offset);
+  Put(size);
+}
+
+void TraceRecorder::SetViewport(float x, float y, float width, float height,
+                                float min_depth, float max_depth) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetViewport);
+  for (float v : {x, y, width, height, min_depth, max_depth}) {
+    Put(v);
+  }
+}
+
+void TraceRecorder::SetScissorRect(uint32_t x, uint32_t y, uint32_t width,
+                                   uint32_t height) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetScissorRect);
+  for (uint32_t v : {x, y, width, height}) {
+    Put(v);
+  }
+}
+
+void TraceRecorder::SetBlendConstant(const WGPUColor &color) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetBlendConstant);
+  Put(color);
+}
+
+void TraceRecorder::SetStencilReference(uint32_t reference) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSetStencilReference);
+  Put(reference);
+}
+
+void TraceRecorder::Draw(uint32_t vertex_count, uint32_t instance_count,
+                         uint32_t first_vertex, uint32_t first_instance) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kDraw);
+  for (uint32_t v : {vertex_count, instance_count, first_vertex,
+                     first_instance}) {
+    Put(v);
+  }
+}
+
+void TraceRecorder::DrawIndexed(uint32_t index_count, uint32_t instance_count,
+                                uint32_t first_index, int32_t base_vertex,
+                                uint32_t first_instance) {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kDrawIndexed);
+  Put(index_count);
+  Put(instance_count);
+  Put(first_index);
+  Put(base_vertex);
+  Put(first_instance);
+}
+
+void TraceRecorder::EndRenderPass() {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kEndRenderPass);
+}
+
+void TraceRecorder::Submit() {
+  if (!IsInFrame()) {
+    return;
+  }
+
+  Op(kSubmit);
+}
+
+bool TraceRecorder::Save(const std::string &path) {
+  if (!m_enabled) {
+    return false;
+  }
+
+  CloseOp();
+
+  m_enabled = false;
+
+  if (m_failed) {
+    spdlog::error("trace {} not written, it uses handles which were not "
+                  "recorded",
+                  path);
+    return false;
+  }
+
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    spdlog::error("can not write trace {}", path);
+    return false;
+  }
+
+  out.write(reinterpret_cast<const char *>(m_data.data()), m_data.size());
+
+  spdlog::info("trace {}: {} frames, {} KB", path, m_frame_count,
+               m_data.size() / 1024);
+
+  m_data.clear();
+  m_data.shrink_to_fit();
+
+  return true;
+}
+
+uint32_t TraceRecorder::NewId(const void *handle) {
+  // a released handle can be reused by a new object, the new id wins
+  uint32_t id = m_next_id++;
+  m_ids[handle] = id;
+  return id;
+}
+
+uint32_t TraceRecorder::Id(const void *handle) {
+  if (handle == nullptr) {
+    return kNull;
+  }
+
+  auto it = m_ids.find(handle);
+  if (it != m_ids.end()) {
+    return it->second;
+  }
+
+  if (!m_failed) {
+    spdlog::error("trace: handle {} was used but not recorded", handle);
+  }
+
+  m_failed = true;
+
+  return kNull;
+}
+
+uint32_t TraceRecorder::ViewId(WGPUTextureView view) {
+  if (view != nullptr && m_ids.find(view) == m_ids.end()) {
+    return kFrameTarget;
+  }
+
+  return Id(view);
+}
+
+void TraceRecorder::Op(uint8_t op) {
+  CloseOp();
+
+  m_last_op = m_data.size();
+
+  Put(op);
+  // patched by CloseOp
+  Put(uint32_t(0));
+}
+
+void TraceRecorder::CloseOp() {
+  if (m_last_op == SIZE_MAX) {
+    return;
+  }
+
+  // payload of the last op ends here
+  auto size = static_cast<uint32_t>(m_data.size() - m_last_op - 5);
+  std::memcpy(m_data.data() + m_last_op + 1, &size, sizeof(size));
+
+  m_last_op = SIZE_MAX;
+}
+
+template <typename T> void TraceRecorder::Put(const T &value) {
+  static_assert(std::is_trivially_copyable<T>::value, "POD only");
+
+  auto bytes = reinterpret_cast<const uint8_t *>(&value);
+  m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+}
+
+void TraceRecorder::PutString(const char *str) {
+  auto length = static_cast<uint32_t>(str ? std::strlen(str) : 0);
+
+  Put(length);
+  PutBytes(str, length);
+}
+
+void TraceRecorder::PutBytes(const void *data, uint64_t size) {
+  if (size == 0) {
+    return;
+  }
+
+  auto bytes = static_cast<const uint8_t *>(data);
+  m_data.insert(m_data.end(), bytes, bytes + size);
+}
+
+struct TraceReplayer::Reader {
+  const uint8_t *ptr;
+  const uint8_t *end;
+  bool ok = true;
+
+  template <typename T> T Get() {
+    T value{};
+
+    if (static_cast<size_t>(end - ptr) < sizeof(T)) {
+      ok = false;
+      return value;
+    }
+
+    std::memcpy(&value, ptr, sizeof(T));
+    ptr += sizeof(T);
+
+    return value;
+  }
+
+  template <typename E> E GetEnum() { return static_cast<E>(Get<uint32_t>()); }
+
+  bool GetBool() { return Get<uint8_t>() != 0; }
+
+  const uint8_t *GetBytes(uint64_t size) {
+    if (static_cast<uint64_t>(end - ptr) < size) {
+      ok = false;
+      return nullptr;
+    }
+
+    auto data = ptr;
+    ptr += size;
+    return data;
+  }
+
+  std::string GetString() {
+    auto length = Get<uint32_t>();
+    auto data = GetBytes(length);
+
+    return data ? std::string(reinterpret_cast<const char *>(data), length)
+                : std::string{};
+  }
+};
+
+TraceReplayer::TraceReplayer(WGPUDevice device, WGPUQueue queue)
+    : m_device(device), m_queue(queue) {}
+
+TraceReplayer::~TraceReplayer() {
+  WaitIdle();
+
+  for (auto &it : m_objects) {
+    Release(it.second.first, it.second.second);
+  }
+
+  if (m_target_view) {
+    wgpuTextureViewRelease(m_target_view);
+    wgpuTextureRelease(m_target);
+  }
+}
+
+void TraceReplayer::Release(uint8_t kind, void *handle) {
+  if (handle == nullptr) {
+    return;
+  }
+
+  switch (kind) {
+  case kCreateBuffer:
+    wgpuBufferDestroy(static_cast<WGPUBuffer>(handle));
+    wgpuBufferRelease(static_cast<WGPUBuffer>(handle));
+    break;
+  case kCreateTexture:
+    wgpuTextureRelease(static_cast<WGPUTexture>(handle));
+    break;
+  case kCreateTextureView:
+    wgpuTextureViewRelease(static_cast<WGPUTextureView>(handle));
+    break;
+  case kCreateSampler:
+    wgpuSamplerRelease(static_cast<WGPUSampler>(handle));
+    break;
+  case kCreateShaderModule:
+    wgpuShaderModuleRelease(static_cast<WGPUShaderModule>(handle));
+    break;
+  case kCreateBindGroupLayout:
+    wgpuBindGroupLayoutRelease(static_cast<WGPUBindGroupLayout>(handle));
+    break;
+  case kCreatePipelineLayout:
+    wgpuPipelineLayoutRelease(static_cast<WGPUPipelineLayout>(handle));
+    break;
+  case kCreateRenderPipeline:
+    wgpuRenderPipelineRelease(static_cast<WGPURenderPipeline>(handle));
+    break;
+  case kCreateBindGroup:
+    wgpuBindGroupRelease(static_cast<WGPUBindGroup>(handle));
+    break;
+  default:
+    break;
+  }
+}
+
+bool TraceReplayer::Load(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    spdlog::error("can not open trace {}", path);
+    return false;
+  }
+
+  m_data.assign(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+
+  Reader reader{m_data.data(), m_data.data() + m_data.size()};
+
+  if (reader.Get<uint32_t>() != kMagic || reader.Get<uint32_t>() != kVersion) {
+    spdlog::error("{} is not a trace of version {}", path, kVersion);
+    return false;
+  }
+
+  // resources are created once, frames are only located here
+  bool in_frame = false;
+  while (reader.ptr < reader.end) {
+    auto start = reader.ptr;
+    auto op = reader.Get<uint8_t>();
+    auto size = reader.Get<uint32_t>();
+
+    Reader payload{reader.ptr, reader.ptr + size};
+    if (!reader.ok || !reader.GetBytes(size)) {
+      // a cut off last op would otherwise be dropped silently
+      spdlog::error("trace {} is truncated", path);
+      return false;
+    }
+
+    if (op == kBeginFrame) {
+      m_frames.push_back(start - m_data.data());
+      in_frame = true;
+    } else if (op == kEndFrame) {
+      in_frame = false;
+    } else if (!in_frame && !ReadResource(payload, op)) {
+      spdlog::warn("skip unknown trace op {}", op);
+    }
+
+    if (!payload.ok) {
+      spdlog::error("trace {} is corrupted", path);
+      return false;
+    }
+  }
+
+  if (m_failed) {
+    spdlog::error("trace {} references resources it does not create", path);
+    return false;
+  }
+
+  spdlog::info("trace {}: {} resources {} frames", path, m_objects.size(),
+               m_frames.size());
+
+  return !m_frames.empty();
+}
+
+TraceReplayStats TraceReplayer::Replay(uint32_t iterations) {
+  TraceReplayStats stats{};
+
+  using clock = std::chrono::steady_clock;
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (auto frame : m_frames) {
+      Reader reader{m_data.data() + frame, m_data.data() + m_data.size()};
+
+      WGPUCommandEncoder encoder = nullptr;
+      WGPURenderPassEncoder pass = nullptr;
+
+      auto start = clock::now();
+      auto submitted = start;
+
+      while (reader.ptr < reader.end) {
+        auto op = reader.Get<uint8_t>();
+        auto size = reader.Get<uint32_t>();
+
+        Reader payload{reader.ptr, reader.ptr + size};
+        reader.GetBytes(size);
+
+        if (op == kEndFrame) {
+          break;
+        }
+
+        if (op == kSubmit) {
+          submitted = clock::now();
+        }
+
+        if (!ReadCommand(payload, op, encoder, pass)) {
+          ReadResource(payload, op);
+        }
+
+        stats.commands++;
+      }
+
+      // a frame captured without its submit leaves them open
+      if (pass) {
+        wgpuRenderPassEncoderEnd(pass);
+        wgpuRenderPassEncoderRelease(pass);
+        pass = nullptr;
+      }
+
+      if (encoder) {
+        wgpuCommandEncoderRelease(encoder);
+        encoder = nullptr;
+      }
+
+      auto encoded = clock::now();
+
+      WaitIdle();
+
+      auto done = clock::now();
+
+      stats.frames++;
+      stats.cpu_encode.push_back(
+          std::chrono::duration<double, std::milli>(encoded - start).count());
+      stats.gpu.push_back(
+          std::chrono::duration<double, std::milli>(done - submitted).count());
+
+      if (m_failed) {
+        stats.ok = false;
+        return stats;
+      }
+    }
+  }
+
+  return stats;
+}
+
+bool TraceReplayer::ReadResource(Reader &reader, uint8_t op) {
+  auto id = reader.Get<uint32_t>();
+  void *handle = nullptr;
+
+  switch (op) {
+  case kCreateBuffer: {
+    WGPUBufferDescriptor desc{};
+    desc.label = "Trace buffer";
+    desc.usage = reader.Get<uint32_t>();
+    desc.size = reader.Get<uint64_t>();
+
+    handle = wgpuDeviceCreateBuffer(m_device, &desc);
+  } break;
+  case kCreateTexture: {
+    WGPUTextureDescriptor desc{};
+    desc.label = "Trace texture";
+    desc.usage = reader.Get<uint32_t>();
+    desc.dimension = reader.GetEnum<WGPUTextureDimension>();
+    desc.size = reader.Get<WGPUExtent3D>();
+    desc.format = reader.GetEnum<WGPUTextureFormat>();
+    desc.mipLevelCount = reader.Get<uint32_t>();
+    desc.sampleCount = reader.Get<uint32_t>();
+
+    handle = wgpuDeviceCreateTexture(m_device, &desc);
+  } break;
+  case kCreateTextureView: {
+    auto texture = Get<WGPUTexture>(reader.Get<uint32_t>());
+
+    WGPUTextureViewDescriptor desc{};
+    bool has_desc = reader.GetBool();
+    if (has_desc) {
+      desc.format = reader.GetEnum<WGPUTextureFormat>();
+      desc.dimension = reader.GetEnum<WGPUTextureViewDimension>();
+      desc.baseMipLevel = reader.Get<uint32_t>();
+      desc.mipLevelCount = reader.Get<uint32_t>();
+      desc.baseArrayLayer = reader.Get<uint32_t>();
+      desc.arrayLayerCount = reader.Get<uint32_t>();
+      desc.aspect = reader.GetEnum<WGPUTextureAspect>();
+    }
+
+    handle = wgpuTextureCreateView(texture, has_desc ? &desc : nullptr);
+  } break;
+  case kCreateSampler: {
+    WGPUSamplerDescriptor desc{};
+    desc.addressModeU = reader.GetEnum<WGPUAddressMode>();
+    desc.addressModeV = reader.GetEnum<WGPUAddressMode>();
+    desc.addressModeW = reader.GetEnum<WGPUAddressMode>();
+    desc.magFilter = reader.GetEnum<WGPUFilterMode>();
+    desc.minFilter = reader.GetEnum<WGPUFilterMode>();
+    desc.mipmapFilter = reader.GetEnum<WGPUMipmapFilterMode>();
+    desc.lodMinClamp = reader.Get<float>();
+    desc.lodMaxClamp = reader.Get<float>();
+    desc.compare = reader.GetEnum<WGPUCompareFunction>();
+    desc.maxAnisotropy = reader.Get<uint16_t>();
+
+    handle = wgpuDeviceCreateSampler(m_device, &desc);
+  } break;
+  case kCreateShaderModule: {
+    auto code = reader.GetString();
+
+    WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+    wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+    wgsl_desc.code = code.c_str();
+
+    WGPUShaderModuleDescriptor desc{};
+    desc.label = "Trace shader";
+    desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+    handle = wgpuDeviceCreateShaderModule(m_device, &desc);
+  } break;
+  case kCreateBindGroupLayout: {
+    std::vector<WGPUBindGroupLayoutEntry> entries(reader.Get<uint32_t>());
+    for (auto &entry : entries) {
+      entry.binding = reader.Get<uint32_t>();
+      entry.visibility = reader.Get<uint32_t>();
+      entry.buffer.type = reader.GetEnum<WGPUBufferBindingType>();
+      entry.buffer.hasDynamicOffset = reader.GetBool();
+      entry.buffer.minBindingSize = reader.Get<uint64_t>();
+      entry.sampler.type = reader.GetEnum<WGPUSamplerBindingType>();
+      entry.texture.sampleType = reader.GetEnum<WGPUTextureSampleType>();
+      entry.texture.viewDimension = reader.GetEnum<WGPUTextureViewDimension>();
+      entry.texture.multisampled = reader.GetBool();
+      entry.storageTexture.access = reader.GetEnum<WGPUStorageTextureAccess>();
+      entry.storageTexture.format = reader.GetEnum<WGPUTextureFormat>();
+      entry.storageTexture.viewDimension =
+          reader.GetEnum<WGPUTextureViewDimension>();
+    }
+
+    WGPUBindGroupLayoutDescriptor desc{};
+    desc.label = "Trace bind group layout";
+    desc.entryCount = entries.size();
+    desc.entries = entries.data();
+
+    handle = wgpuDeviceCreateBindGroupLayout(m_device, &desc);
+  } break;
+  case kCreatePipelineLayout: {
+    std::vector<WGPUBindGroupLayout> layouts(reader.Get<uint32_t>());
+    for (auto &layout : layouts) {
+      layout = Get<WGPUBindGroupLayout>(reader.Get<uint32_t>());
+    }
+
+    WGPUPipelineLayoutDescriptor desc{};
+    desc.label = "Trace pipeline layout";
+    desc.bindGroupLayoutCount = layouts.size();
+    desc.bindGroupLayouts = layouts.data();
+
+    handle = wgpuDeviceCreatePipelineLayout(m_device, &desc);
+  } break;
+  case kCreateRenderPipeline: {
+    WGPURenderPipelineDescriptor desc{};
+    desc.label = "Trace pipeline";
+    desc.layout = Get<WGPUPipelineLayout>(reader.Get<uint32_t>());
+
+    // vertex
+    desc.vertex.module = Get<WGPUShaderModule>(reader.Get<uint32_t>());
+    auto vs_entry = reader.GetString();
+    desc.vertex.entryPoint = vs_entry.c_str();
+
+    std::vector<WGPUVertexBufferLayout> buffers(reader.Get<uint32_t>());
+    std::vector<std::vector<WGPUVertexAttribute>> attributes(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+      buffers[i].arrayStride = reader.Get<uint64_t>();
+      buffers[i].stepMode = reader.GetEnum<WGPUVertexStepMode>();
+
+      attributes[i].resize(reader.Get<uint32_t>());
+      for (auto &attr : attributes[i]) {
+        attr.format = reader.GetEnum<WGPUVertexFormat>();
+        attr.offset = reader.Get<uint64_t>();
+        attr.shaderLocation = reader.Get<uint32_t>();
+      }
+
+      buffers[i].attributeCount = attributes[i].size();
+      buffers[i].attributes = attributes[i].data();
+    }
+    desc.vertex.bufferCount = buffers.size();
+    desc.vertex.buffers = buffers.data();
+
+    // primitive
+    desc.primitive.topology = reader.GetEnum<WGPUPrimitiveTopology>();
+    desc.primitive.stripIndexFormat = reader.GetEnum<WGPUIndexFormat>();
+    desc.primitive.frontFace = reader.GetEnum<WGPUFrontFace>();
+    desc.primitive.cullMode = reader.GetEnum<WGPUCullMode>();
+
+    // depth stencil
+    WGPUDepthStencilState depth_stencil{};
+    if (reader.GetBool()) {
+      depth_stencil.format = reader.GetEnum<WGPUTextureFormat>();
+      depth_stencil.depthWriteEnabled = reader.GetBool();
+      depth_stencil.depthCompare = reader.GetEnum<WGPUCompareFunction>();
+      for (auto face : {&depth_stencil.stencilFront,
+                        &depth_stencil.stencilBack}) {
+        face->compare = reader.GetEnum<WGPUCompareFunction>();
+        face->failOp = reader.GetEnum<WGPUStencilOperation>();
+        face->depthFailOp = reader.GetEnum<WGPUStencilOperation>();
+        face->passOp = reader.GetEnum<WGPUStencilOperation>();
+      }
+      depth_stencil.stencilReadMask = reader.Get<uint32_t>();
+      depth_stencil.stencilWriteMask = reader.Get<uint32_t>();
+      depth_stencil.depthBias = reader.Get<int32_t>();
+      depth_stencil.depthBiasSlopeScale = reader.Get<float>();
+      depth_stencil.depthBiasClamp = reader.Get<float>();
+
+      desc.depthStencil = &depth_stencil;
+    }
+
+    // multisample
+    desc.multisample.count = reader.Get<uint32_t>();
+    desc.multisample.mask = reader.Get<uint32_t>();
+    desc.multisample.alphaToCoverageEnabled = reader.GetBool();
+
+    // fragment
+    WGPUFragmentState fragment{};
+    std::string fs_entry;
+    std::vector<WGPUColorTargetState> targets;
+    std::vector<WGPUBlendState> blends;
+    if (reader.GetBool()) {
+      fragment.module = Get<WGPUShaderModule>(reader.Get<uint32_t>());
+      fs_entry = reader.GetString();
+      fragment.entryPoint = fs_entry.c_str();
+
+      targets.resize(reader.Get<uint32_t>());
+      // reserved, so pointers into it stay valid
+      blends.reserve(targets.size());
+      for (auto &target : targets) {
+        target.format = reader.GetEnum<WGPUTextureFormat>();
+        target.writeMask = reader.Get<uint32_t>();
+
+        if (reader.GetBool()) {
+          WGPUBlendState blend{};
+          for (auto c : {&blend.color, &blend.alpha}) {
+            c->operation = reader.GetEnum<WGPUBlendOperation>();
+            c->srcFactor = reader.GetEnum<WGPUBlendFactor>();
+            c->dstFactor = reader.GetEnum<WGPUBlendFactor>();
+          }
+          blends.push_back(blend);
+          target.blend = &blends.back();
+        }
+      }
+
+      fragment.targetCount = targets.size();
+      fragment.targets = targets.data();
+
+      desc.fragment = &fragment;
+    }
+
+    if (reader.ok) {
+      handle = wgpuDeviceCreateRenderPipeline(m_device, &desc);
+    }
+  } break;
+  case kCreateBindGroup: {
+    WGPUBindGroupDescriptor desc{};
+    desc.label = "Trace bind group";
+    desc.layout = Get<WGPUBindGroupLayout>(reader.Get<uint32_t>());
+
+    std::vector<WGPUBindGroupEntry> entries(reader.Get<uint32_t>());
+    for (auto &entry : entries) {
+      entry.binding = reader.Get<uint32_t>();
+      entry.buffer = Get<WGPUBuffer>(reader.Get<uint32_t>());
+      entry.offset = reader.Get<uint64_t>();
+      entry.size = reader.Get<uint64_t>();
+      entry.sampler = Get<WGPUSampler>(reader.Get<uint32_t>());
+      entry.textureView = Get<WGPUTextureView>(reader.Get<uint32_t>());
+    }
+
+    desc.entryCount = entries.size();
+    desc.entries = entries.data();
+
+    handle = wgpuDeviceCreateBindGroup(m_device, &desc);
+  } break;
+  case kWriteBuffer: {
+    auto buffer = Get<WGPUBuffer>(id);
+    auto offset = reader.Get<uint64_t>();
+    auto size = reader.Get<uint64_t>();
+    auto data = reader.GetBytes(size);
+
+    if (buffer && data) {
+      wgpuQueueWriteBuffer(m_queue, buffer, offset, data, size);
+    }
+  }
+    return true;
+  default:
+    return false;
+  }
+
+  // the id is known already when a resource is created inside a frame and
+  // the frame is replayed again
+  auto it = m_objects.find(id);
+  if (it != m_objects.end()) {
+    Release(it->second.first, it->second.second);
+  }
+
+  m_objects[id] = {op, handle};
+
+  return true;
+}
+
+bool TraceReplayer::ReadCommand(Reader &reader, uint8_t op,
+                                WGPUCommandEncoder &encoder,
+                                WGPURenderPassEncoder &pass) {
+  switch (op) {
+  case kBeginFrame: {
+    auto width = reader.Get<uint32_t>();
+    auto height = reader.Get<uint32_t>();
+    auto format = reader.GetEnum<WGPUTextureFormat>();
+
+    if (m_target == nullptr) {
+      CreateFrameTarget(width, height, format);
+    }
+  } break;
+  case kBeginRenderPass: {
+    if (encoder == nullptr) {
+      encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+    }
+
+    auto view = [this](uint32_t id) {
+      return id == kFrameTarget ? m_target_view : Get<WGPUTextureView>(id);
+    };
+
+    std::vector<WGPURenderPassColorAttachment> colors(reader.Get<uint32_t>());
+    for (auto &color : colors) {
+      color.view = view(reader.Get<uint32_t>());
+      color.resolveTarget = view(reader.Get<uint32_t>());
+      color.loadOp = reader.GetEnum<WGPULoadOp>();
+      color.storeOp = reader.GetEnum<WGPUStoreOp>();
+      color.clearValue = reader.Get<WGPUColor>();
+    }
+
+    WGPURenderPassDescriptor desc{};
+    desc.colorAttachmentCount = colors.size();
+    desc.colorAttachments = colors.data();
+
+    WGPURenderPassDepthStencilAttachment depth_stencil{};
+    if (reader.GetBool()) {
+      depth_stencil.view = view(reader.Get<uint32_t>());
+      depth_stencil.depthLoadOp = reader.GetEnum<WGPULoadOp>();
+      depth_stencil.depthStoreOp = reader.GetEnum<WGPUStoreOp>();
+      depth_stencil.depthClearValue = reader.Get<float>();
+      depth_stencil.depthReadOnly = reader.GetBool();
+      depth_stencil.stencilLoadOp = reader.GetEnum<WGPULoadOp>();
+      depth_stencil.stencilStoreOp = reader.GetEnum<WGPUStoreOp>();
+      depth_stencil.stencilClearValue = reader.Get<uint32_t>();
+      depth_stencil.stencilReadOnly = reader.GetBool();
+
+      desc.depthStencilAttachment = &depth_stencil;
+    }
+
+    pass = wgpuCommandEncoderBeginRenderPass(encoder, &desc);
+  } break;
+  case kSetPipeline:
+    wgpuRenderPassEncoderSetPipeline(
+        pass, Get<WGPURenderPipeline>(reader.Get<uint32_t>()));
+    break;
+  case kSetBindGroup: {
+    auto index = reader.Get<uint32_t>();
+    auto group = Get<WGPUBindGroup>(reader.Get<uint32_t>());
+    auto count = reader.Get<uint32_t>();
+
+    std::vector<uint32_t> offsets(count);
+    auto data = reader.GetBytes(count * sizeof(uint32_t));
+    if (data) {
+      std::memcpy(offsets.data(), data, count * sizeof(uint32_t));
+    }
+
+    wgpuRenderPassEncoderSetBindGroup(pass, index, group, count,
+                                      offsets.data());
+  } break;
+  case kSetVertexBuffer: {
+    auto slot = reader.Get<uint32_t>();
+    auto buffer = Get<WGPUBuffer>(reader.Get<uint32_t>());
+    auto offset = reader.Get<uint64_t>();
+    auto size = reader.Get<uint64_t>();
+
+    wgpuRenderPassEncoderSetVertexBuffer(pass, slot, buffer, offset, size);
+  } break;
+  case kSetIndexBuffer: {
+    auto buffer = Get<WGPUBuffer>(reader.Get<uint32_t>());
+    auto format = reader.GetEnum<WGPUIndexFormat>();
+    auto offset = reader.Get<uint64_t>();
+    auto size = reader.Get<uint64_t>();
+
+    wgpuRenderPassEncoderSetIndexBuffer(pass, buffer, format, offset, size);
+  } break;
+  case kSetViewport: {
+    float v[6];
+    for (auto &f : v) {
+      f = reader.Get<float>();
+    }
+
+    wgpuRenderPassEncoderSetViewport(pass, v[0], v[1], v[2], v[3], v[4], v[5]);
+  } break;
+  case kSetScissorRect: {
+    uint32_t v[4];
+    for (auto &u : v) {
+      u = reader.Get<uint32_t>();
+    }
+
+    wgpuRenderPassEncoderSetScissorRect(pass, v[0], v[1], v[2], v[3]);
+  } break;
+  case kSetBlendConstant: {
+    auto color = reader.Get<WGPUColor>();
+
+    wgpuRenderPassEncoderSetBlendConstant(pass, &color);
+  } break;
+  case kSetStencilReference:
+    wgpuRenderPassEncoderSetStencilReference(pass, reader.Get<uint32_t>());
+    break;
+  case kDraw: {
+    uint32_t v[4];
+    for (auto &u : v) {
+      u = reader.Get<uint32_t>();
+    }
+
+    wgpuRenderPassEncoderDraw(pass, v[0], v[1], v[2], v[3]);
+  } break;
+  case kDrawIndexed: {
+    auto index_count = reader.Get<uint32_t>();
+    auto instance_count = reader.Get<uint32_t>();
+    auto first_index = reader.Get<uint32_t>();
+    auto base_vertex = reader.Get<int32_t>();
+    auto first_instance = reader.Get<uint32_t>();
+
+    wgpuRenderPassEncoderDrawIndexed(pass, index_count, instance_count,
+                                     first_index, base_vertex, first_instance);
+  } break;
+  case kEndRenderPass:
+    wgpuRenderPassEncoderEnd(pass);
+    wgpuRenderPassEncoderRelease(pass);
+    pass = nullptr;
+    break;
+  case kSubmit: {
+    if (encoder == nullptr) {
+      break;
+    }
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+    wgpuCommandEncoderRelease(encoder);
+    encoder = nullptr;
+
+    wgpuQueueSubmit(m_queue, 1, &cmd);
+    wgpuCommandBufferRelease(cmd);
+  } break;
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+void TraceReplayer::CreateFrameTarget(uint32_t width, uint32_t height,
+                                      WGPUTextureFormat format) {
+  WGPUTextureDescriptor desc{};
+  desc.label = "Trace frame target";
+  desc.dimension = WGPUTextureDimension_2D;
+  desc.format = format;
+  desc.size.width = width;
+  desc.size.height = height;
+  desc.size.depthOrArrayLayers = 1;
+  desc.sampleCount = 1;
+  desc.mipLevelCount = 1;
+  desc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc;
+
+  m_target = wgpuDeviceCreateTexture(m_device, &desc);
+  m_target_view = wgpuTextureCreateView(m_target, nullptr);
+}
+
+template <typename T> T TraceReplayer::Get(uint32_t id) {
+  if (id == kNull) {
+    return nullptr;
+  }
+
+  auto it = m_objects.find(id);
+  if (it != m_objects.end()) {
+    return static_cast<T>(it->second.second);
+  }
+
+  if (!m_failed) {
+    spdlog::error("trace: id {} was never created", id);
+  }
+
+  m_failed = true;
+
+  return nullptr;
+}
+
+void TraceReplayer::WaitIdle() {
+  bool done = false;
+
+  wgpuQueueOnSubmittedWorkDone(
+      m_queue, 0,
+      [](WGPUQueueWorkDoneStatus, void *userdata) {
+        *static_cast<bool *>(userdata) = true;
+      },
+      &done);
+
+  while (!done) {
+    wgpuDeviceTick(m_device);
+  }
+}
+
+} // namespace util
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+/**
+ * Records the WebGPU calls of an application into a compact binary trace,
+ * which TraceReplayer can issue again without the application.
+ *
+ * Dawn is linked as one monolithic library, so calls can not be intercepted
+ * through the proc table. The application reports its calls instead: every
+ * resource creation and queue write right after it is made, and render pass
+ * commands through util::RenderPassEncoder, which records what it forwards.
+ *
+ * Resources and writes are recorded from construction, pass commands and
+ * submits only between BeginFrame and EndFrame. Texture views which are not
+ * recorded, like the swapchain view, are replaced by the frame target when
+ * replaying if used as attachments. Any other handle that was not recorded
+ * fails the recording and Save writes nothing.
+ *
+ * Only data uploaded with wgpuQueueWriteBuffer is captured, buffers filled
+ * through a mapping keep undefined content.
+ */
+class TraceRecorder {
+public:
+  explicit TraceRecorder(bool enabled);
+
+  bool IsEnabled() const { return m_enabled; }
+
+  bool IsInFrame() const { return m_enabled && m_in_frame; }
+
+  void CreateBuffer(WGPUBuffer buffer, const WGPUBufferDescriptor &desc);
+
+  void CreateTexture(WGPUTexture texture, const WGPUTextureDescriptor &desc);
+
+  void CreateTextureView(WGPUTextureView view, WGPUTexture texture,
+                         const WGPUTextureViewDescriptor *desc);
+
+  void CreateSampler(WGPUSampler sampler, const WGPUSamplerDescriptor &desc);
+
+  void CreateShaderModule(WGPUShaderModule module, const std::string &wgsl);
+
+  void CreateBindGroupLayout(WGPUBindGroupLayout layout,
+                             const WGPUBindGroupLayoutDescriptor &desc);
+
+  void CreatePipelineLayout(WGPUPipelineLayout layout,
+                            const WGPUPipelineLayoutDescriptor &desc);
+
+  void CreateRenderPipeline(WGPURenderPipeline pipeline,
+                            const WGPURenderPipelineDescriptor &desc);
+
+  void CreateBindGroup(WGPUBindGroup group,
+                       const WGPUBindGroupDescriptor &desc);
+
+  void WriteBuffer(WGPUBuffer buffer, uint64_t offset, const void *data,
+                   uint64_t size);
+
+  /**
+   * Start capturing a frame rendered into a `width` x `height` target.
+   */
+  void BeginFrame(uint32_t width, uint32_t height, WGPUTextureFormat format);
+
+  void EndFrame();
+
+  void BeginRenderPass(const WGPURenderPassDescriptor &desc);
+
+  void SetPipeline(WGPURenderPipeline pipeline);
+
+  void SetBindGroup(uint32_t index, WGPUBindGroup group,
+                    uint32_t dynamic_offset_count,
+                    const uint32_t *dynamic_offsets);
+
+  void SetVertexBuffer(uint32_t slot, WGPUBuffer buffer, uint64_t offset,
+                       uint64_t size);
+
+  void SetIndexBuffer(WGPUBuffer buffer, WGPUIndexFormat format,
+                      uint64_t offset, uint64_t size);
+
+  void SetViewport(float x, float y, float width, float height, float min_depth,
+                   float max_depth);
+
+  void SetScissorRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+  void SetBlendConstant(const WGPUColor &color);
+
+  void SetStencilReference(uint32_t reference);
+
+  void Draw(uint32_t vertex_count, uint32_t instance_count,
+            uint32_t first_vertex, uint32_t first_instance);
+
+  void DrawIndexed(uint32_t index_count, uint32_t instance_count,
+                   uint32_t first_index, int32_t base_vertex,
+                   uint32_t first_instance);
+
+  void EndRenderPass();
+
+  void Submit();
+
+  /**
+   * Write the trace to `path` and stop recording.
+   *
+   * @return false when nothing was written, also when a handle was used
+   *         without being recorded
+   */
+  bool Save(const std::string &path);
+
+  uint32_t GetFrameCount() const { return m_frame_count; }
+
+private:
+  uint32_t NewId(const void *handle);
+
+  uint32_t Id(const void *handle);
+
+  // unrecorded views are the frame target
+  uint32_t ViewId(WGPUTextureView view);
+
+  void Op(uint8_t op);
+
+  void CloseOp();
+
+  template <typename T> void Put(const T &value);
+
+  void PutString(const char *str);
+
+  void PutBytes(const void *data, uint64_t size);
+
+private:
+  bool m_enabled;
+  bool m_in_frame = false;
+  bool m_failed = false;
+  uint32_t m_frame_count = 0;
+  // 0 and 1 are reserved for null and the frame target
+  uint32_t m_next_id = 2;
+  // start of the op being written
+  size_t m_last_op = SIZE_MAX;
+  std::unordered_map<const void *, uint32_t> m_ids;
+  std::vector<uint8_t> m_data;
+};
+
+struct TraceReplayStats {
+  // false when the trace referenced an id it never created
+  bool ok = true;
+  uint32_t frames = 0;
+  uint32_t commands = 0;
+  // per replayed frame, in milliseconds
+  std::vector<double> cpu_encode;
+  std::vector<double> gpu;
+};
+
+/**
+ * Issues a trace written by TraceRecorder again.
+ *
+ * Load creates every resource, Replay re-issues the captured frames into an
+ * offscreen target as fast as possible. CPU time covers decoding, encoding
+ * and submitting a frame. GPU time is measured from submit until
+ * wgpuQueueOnSubmittedWorkDone fires, which includes the queue latency but
+ * needs no optional feature.
+ */
+class TraceReplayer {
+public:
+  TraceReplayer(WGPUDevice device, WGPUQueue queue);
+
+  ~TraceReplayer();
+
+  TraceReplayer(const TraceReplayer &) = delete;
+  TraceReplayer &operator=(const TraceReplayer &) = delete;
+
+  bool Load(const std::string &path);
+
+  /**
+   * Replay every captured frame `iterations` times.
+   */
+  TraceReplayStats Replay(uint32_t iterations);
+
+private:
+  struct Reader;
+
+  bool ReadResource(Reader &reader, uint8_t op);
+
+  bool ReadCommand(Reader &reader, uint8_t op, WGPUCommandEncoder &encoder,
+                   WGPURenderPassEncoder &pass);
+
+  void CreateFrameTarget(uint32_t width, uint32_t height,
+                         WGPUTextureFormat format);
+
+  // null for id 0, unknown ids fail the replay
+  template <typename T> T Get(uint32_t id);
+
+  static void Release(uint8_t kind, void *handle);
+
+  void WaitIdle();
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+  bool m_failed = false;
+
+  std::vector<uint8_t> m_data;
+  // start of each frame in m_data
+  std::vector<uint64_t> m_frames;
+
+  // id to handle, the kind is needed to release them
+  std::unordered_map<uint32_t, std::pair<uint8_t, void *>> m_objects;
+
+  WGPUTexture m_target = nullptr;
+  WGPUTextureView m_target_view = nullptr;
+};
+
+} // namespace util
@@ -0,0 +1,1016 @@
+#include "mesh_loader.hpp"
+#include "blocking_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <thread>
+
+namespace util {
+
+struct MeshLoader::ObjRange {
+  // bytes of the file, a line belongs to the range it starts in
+  uint64_t begin = 0;
+  uint64_t end = 0;
+  uint64_t vertex_count = 0;
+  uint64_t index_count = 0;
+  // filled by prefix sum of the counts above
+  uint64_t vertex_base = 0;
+  uint64_t index_base = 0;
+};
+
+struct MeshLoader::Job {
+  std::string path;
+  uint64_t file_offset = 0;
+  // element count and distance between elements in the file
+  uint64_t count = 0;
+  uint32_t stride = 0;
+  uint32_t component_type = 0;
+  bool is_index = false;
+  // element offset in the destination buffer
+  uint64_t dst_element = 0;
+  uint32_t base_vertex = 0;
+};
+
+namespace {
+
+constexpr uint64_t kReadBlockSize = 1024 * 1024;
+
+// glTF component types
+constexpr uint32_t kUnsignedByte = 5121;
+constexpr uint32_t kUnsignedShort = 5123;
+constexpr uint32_t kUnsignedInt = 5125;
+constexpr uint32_t kFloat = 5126;
+
+/**
+ * Call `fn(begin, end)` for every line which starts inside [begin, end) of the
+ * file. The file is read in blocks, only one block and the current partial
+ * line are in memory.
+ */
+template <typename F>
+bool ForEachLine(const std::string &path, uint64_t begin, uint64_t end,
+                 F &&fn) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  // start one byte early, so a line starting exactly at `begin` is detected
+  bool skip_partial = begin > 0;
+  // file position of buffer[0]
+  uint64_t base = skip_partial ? begin - 1 : 0;
+
+  file.seekg(static_cast<std::streamoff>(base));
+
+  std::vector<char> block(kReadBlockSize);
+  std::string buffer;
+
+  for (;;) {
+    file.read(block.data(), block.size());
+    auto count = static_cast<size_t>(file.gcount());
+    bool eof = count == 0;
+
+    buffer.append(block.data(), count);
+
+    size_t cursor = 0;
+
+    if (skip_partial) {
+      auto nl = buffer.find('\n');
+      if (nl == std::string::npos) {
+        if (eof) {
+          return true;
+        }
+
+        base += buffer.size();
+        buffer.clear();
+        continue;
+      }
+
+      cursor = nl + 1;
+      skip_partial = false;
+    }
+
+    for (;;) {
+      if (base + cursor >= end) {
+        return true;
+      }
+
+      auto nl = buffer.find('\n', cursor);
+      if (nl == std::string::npos) {
+        break;
+      }
+
+      fn(buffer.data() + cursor, buffer.data() + nl);
+      cursor = nl + 1;
+    }
+
+    if (eof) {
+      // last line without line break
+      if (cursor < buffer.size()) {
+        fn(buffer.data() + cursor, buffer.data() + buffer.size());
+      }
+      return true;
+    }
+
+    buffer.erase(0, cursor);
+    base += cursor;
+  }
+}
+
+inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char *SkipSpace(const char *p, const char *end) {
+  while (p < end && IsSpace(*p)) {
+    p++;
+  }
+  return p;
+}
+
+inline const char *SkipToken(const char *p, const char *end) {
+  while (p < end && !IsSpace(*p)) {
+    p++;
+  }
+  return p;
+}
+
+/**
+ * @return 'v' for a position, 'f' for a face and 0 for anything else, `p` is
+ *         moved after the keyword
+ */
+inline char ObjKeyword(const char *&p, const char *end) {
+  p = SkipSpace(p, end);
+
+  if (end - p < 2 || !IsSpace(p[1])) {
+    return 0;
+  }
+
+  char c = p[0];
+  if (c != 'v' && c != 'f') {
+    return 0;
+  }
+
+  p += 2;
+  return c;
+}
+
+// just enough JSON for glTF
+struct Json {
+  enum class Type {
+    kNull,
+    kBool,
+    kNumber,
+    kString,
+    kArray,
+    kObject,
+  };
+
+  Type type = Type::kNull;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<Json> array;
+  std::vector<std::pair<std::string, Json>> object;
+
+  const Json *Find(const char *key) const {
+    for (const auto &member : object) {
+      if (member.first == key) {
+        return &member.second;
+      }
+    }
+    return nullptr;
+  }
+
+  double Number(const char *key, double fallback) const {
+    auto value = Find(key);
+    return value && value->type == Type::kNumber ? value->number : fallback;
+  }
+
+  /**
+   * @return false unless this is a non negative integer, as glTF indices are
+   */
+  bool Index(size_t &index) const {
+    if (type != Type::kNumber || number < 0.0 ||
+        number != static_cast<double>(static_cast<uint64_t>(number))) {
+      return false;
+    }
+
+    index = static_cast<size_t>(number);
+    return true;
+  }
+
+  const Json *At(const char *key, size_t index) const {
+    auto value = Find(key);
+    if (value == nullptr || value->type != Type::kArray ||
+        index >= value->array.size()) {
+      return nullptr;
+    }
+    return &value->array[index];
+  }
+};
+
+class JsonParser {
+public:
+  JsonParser(const char *begin, const char *end) : m_p(begin), m_end(end) {}
+
+  bool Parse(Json &value) {
+    if (!ParseValue(value, 0)) {
+      return false;
+    }
+
+    Skip();
+    return m_p == m_end;
+  }
+
+private:
+  void Skip() {
+    while (m_p < m_end &&
+           (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t')) {
+      m_p++;
+    }
+  }
+
+  bool Expect(char c) {
+    Skip();
+    if (m_p < m_end && *m_p == c) {
+      m_p++;
+      return true;
+    }
+    return false;
+  }
+
+  bool Literal(const char *text) {
+    size_t length = std::strlen(text);
+    if (static_cast<size_t>(m_end - m_p) < length ||
+        std::strncmp(m_p, text, length) != 0) {
+      return false;
+    }
+    m_p += length;
+    return true;
+  }
+
+  bool ParseString(std::string &out) {
+    if (!Expect('"')) {
+      return false;
+    }
+
+    while (m_p < m_end && *m_p != '"') {
+      char c = *m_p++;
+
+      if (c != '\\') {
+        out.push_back(c);
+        continue;
+      }
+
+      if (m_p == m_end) {
+        return false;
+      }
+
+      c = *m_p++;
+      switch (c) {
+      case 'b':
+        out.push_back('\b');
+        break;
+      case 'f':
+        out.push_back('\f');
+        break;
+      case 'n':
+        out.push_back('\n');
+        break;
+      case 'r':
+        out.push_back('\r');
+        break;
+      case 't':
+        out.push_back('\t');
+        break;
+      case 'u': {
+        if (m_end - m_p < 4) {
+          return false;
+        }
+        auto code = std::strtoul(std::string(m_p, 4).c_str(), nullptr, 16);
+        m_p += 4;
+        // keys and uris used here are ascii, anything else is replaced
+        out.push_back(code < 0x80 ? static_cast<char>(code) : '?');
+      } break;
+      default:
+        out.push_back(c);
+        break;
+      }
+    }
+
+    return Expect('"');
+  }
+
+  bool ParseValue(Json &value, int depth) {
+    // glTF documents are shallow, this only guards against bad input
+    if (depth > 64) {
+      return false;
+    }
+
+    Skip();
+    if (m_p == m_end) {
+      return false;
+    }
+
+    switch (*m_p) {
+    case '{': {
+      m_p++;
+      value.type = Json::Type::kObject;
+
+      if (Expect('}')) {
+        return true;
+      }
+
+      do {
+        std::string key;
+        Json member;
+        if (!ParseString(key) || !Expect(':') ||
+            !ParseValue(member, depth + 1)) {
+          return false;
+        }
+        value.object.emplace_back(std::move(key), std::move(member));
+      } while (Expect(','));
+
+      return Expect('}');
+    }
+    case '[': {
+      m_p++;
+      value.type = Json::Type::kArray;
+
+      if (Expect(']')) {
+        return true;
+      }
+
+      do {
+        Json element;
+        if (!ParseValue(element, depth + 1)) {
+          return false;
+        }
+        value.array.emplace_back(std::move(element));
+      } while (Expect(','));
+
+      return Expect(']');
+    }
+    case '"':
+      value.type = Json::Type::kString;
+      return ParseString(value.string);
+    case 't':
+      value.type = Json::Type::kBool;
+      value.boolean = true;
+      return Literal("true");
+    case 'f':
+      value.type = Json::Type::kBool;
+      return Literal("false");
+    case 'n':
+      return Literal("null");
+    default: {
+      // the document is null terminated, so strtod stops in time
+      char *number_end = nullptr;
+      value.type = Json::Type::kNumber;
+      value.number = std::strtod(m_p, &number_end);
+      if (number_end == m_p) {
+        return false;
+      }
+      m_p = number_end;
+      return true;
+    }
+    }
+  }
+
+private:
+  const char *m_p;
+  const char *m_end;
+};
+
+bool EndsWith(const std::string &text, const char *suffix) {
+  size_t length = std::strlen(suffix);
+  if (text.size() < length) {
+    return false;
+  }
+
+  for (size_t i = 0; i < length; i++) {
+    char c = text[text.size() - length + i];
+    if (std::tolower(static_cast<unsigned char>(c)) != suffix[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MergeBounds(float dst[6], const float src[6]) {
+  for (int i = 0; i < 3; i++) {
+    dst[i] = std::min(dst[i], src[i]);
+    dst[i + 3] = std::max(dst[i + 3], src[i + 3]);
+  }
+}
+
+} // namespace
+
+MeshLoader::MeshLoader(uint32_t worker_count, uint64_t chunk_size)
+    : m_worker_count(worker_count), m_chunk_size(chunk_size) {
+  if (m_worker_count == 0) {
+    m_worker_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // keep chunks a multiple of a whole vertex and a whole index
+  m_chunk_size = std::max<uint64_t>(m_chunk_size / 12 * 12, 12);
+}
+
+MeshLoader::~MeshLoader() = default;
+
+bool MeshLoader::Open(const std::string &path) {
+  m_path = path;
+  m_info = {};
+  m_obj_ranges.clear();
+  m_jobs.clear();
+
+  {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      spdlog::error("can not open mesh file: {}", path);
+      return false;
+    }
+
+    m_file_size = static_cast<uint64_t>(file.tellg());
+  }
+
+  m_is_obj = EndsWith(path, ".obj");
+
+  if (m_is_obj) {
+    return OpenObj();
+  }
+
+  if (EndsWith(path, ".gltf") || EndsWith(path, ".glb")) {
+    return OpenGltf();
+  }
+
+  spdlog::error("unknown mesh format: {}", path);
+  return false;
+}
+
+bool MeshLoader::OpenObj() {
+  // small files are not worth the threads
+  uint32_t range_count = static_cast<uint32_t>(
+      std::min<uint64_t>(m_worker_count, m_file_size / kReadBlockSize + 1));
+
+  m_obj_ranges.resize(range_count);
+
+  for (uint32_t i = 0; i < range_count; i++) {
+    m_obj_ranges[i].begin = m_file_size * i / range_count;
+    m_obj_ranges[i].end = m_file_size * (i + 1) / range_count;
+  }
+
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> workers;
+
+  for (auto &range : m_obj_ranges) {
+    workers.emplace_back([this, &range, &failed] {
+      bool ok =
+          ForEachLine(m_path, range.begin, range.end,
+                      [&range](const char *p, const char *end) {
+                        char keyword = ObjKeyword(p, end);
+
+                        if (keyword == 'v') {
+                          range.vertex_count++;
+                        } else if (keyword == 'f') {
+                          uint64_t corners = 0;
+                          for (p = SkipSpace(p, end); p < end;
+                               p = SkipSpace(SkipToken(p, end), end)) {
+                            corners++;
+                          }
+
+                          if (corners >= 3) {
+                            range.index_count += (corners - 2) * 3;
+                          }
+                        }
+                      });
+
+      if (!ok) {
+        failed = true;
+      }
+    });
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  if (failed) {
+    spdlog::error("failed to scan obj file: {}", m_path);
+    return false;
+  }
+
+  for (auto &range : m_obj_ranges) {
+    range.vertex_base = m_info.vertex_count;
+    range.index_base = m_info.index_count;
+
+    m_info.vertex_count += range.vertex_count;
+    m_info.index_count += range.index_count;
+  }
+
+  if (m_info.vertex_count > std::numeric_limits<uint32_t>::max()) {
+    spdlog::error("too many vertices for 32 bit indices: {}",
+                  m_info.vertex_count);
+    return false;
+  }
+
+  return true;
+}
+
+bool MeshLoader::OpenGltf() {
+  std::string json;
+  // file offset of the glb BIN chunk
+  uint64_t bin_offset = 0;
+  bool has_bin = false;
+
+  {
+    std::ifstream file(m_path, std::ios::binary);
+
+    uint32_t header[3] = {};
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+
+    // 'glTF'
+    if (file.gcount() == sizeof(header) && header[0] == 0x46546C67) {
+      uint32_t chunk[2] = {};
+      file.read(reinterpret_cast<char *>(chunk), sizeof(chunk));
+
+      // 'JSON'
+      if (chunk[1] != 0x4E4F534A) {
+        spdlog::error("glb first chunk is not JSON: {}", m_path);
+        return false;
+      }
+
+      json.resize(chunk[0]);
+      file.read(&json[0], chunk[0]);
+
+      uint32_t bin[2] = {};
+      file.read(reinterpret_cast<char *>(bin), sizeof(bin));
+
+      // 'BIN'
+      if (file.gcount() == sizeof(bin) && bin[1] == 0x004E4942) {
+        has_bin = true;
+        bin_offset = 12 + 8 + chunk[0] + 8;
+      }
+    } else {
+      json.resize(m_file_size);
+      file.seekg(0);
+      file.read(&json[0], m_file_size);
+    }
+  }
+
+  Json root;
+  if (!JsonParser(json.data(), json.data() + json.size()).Parse(root)) {
+    spdlog::error("invalid glTF json: {}", m_path);
+    return false;
+  }
+
+  // buffers as (path, offset in that file)
+  std::vector<std::pair<std::string, uint64_t>> buffers;
+  {
+    auto base_dir = m_path.substr(0, m_path.find_last_of("/\\") + 1);
+
+    auto list = root.Find("buffers");
+    for (size_t i = 0; list && i < list->array.size(); i++) {
+      auto uri = list->array[i].Find("uri");
+
+      if (uri == nullptr) {
+        if (!has_bin) {
+          spdlog::error("glTF buffer {} has no data", i);
+          return false;
+        }
+        buffers.emplace_back(m_path, bin_offset);
+      } else if (uri->string.rfind("data:", 0) == 0) {
+        spdlog::error("embedded data uri is not supported, use .glb");
+        return false;
+      } else {
+        buffers.emplace_back(base_dir + uri->string, 0);
+      }
+    }
+  }
+
+  // build one job list per accessor, split into chunk sized pieces
+  auto add_accessor = [&](size_t accessor_index, bool is_index,
+                          uint32_t base_vertex, uint64_t dst_element) -> bool {
+    auto accessor = root.At("accessors", accessor_index);
+    if (accessor == nullptr) {
+      return false;
+    }
+
+    auto view_value = accessor->Find("bufferView");
+    size_t view_index = 0;
+
+    auto view = view_value && view_value->Index(view_index)
+                    ? root.At("bufferViews", view_index)
+                    : nullptr;
+    if (view == nullptr) {
+      spdlog::error("sparse or empty accessors are not supported");
+      return false;
+    }
+
+    auto buffer_index = static_cast<size_t>(view->Number("buffer", 0));
+    if (buffer_index >= buffers.size()) {
+      return false;
+    }
+
+    uint32_t component_type =
+        static_cast<uint32_t>(accessor->Number("componentType", 0));
+    uint32_t element_size = 0;
+
+    if (is_index) {
+      element_size = component_type == kUnsignedByte    ? 1
+                     : component_type == kUnsignedShort ? 2
+                     : component_type == kUnsignedInt   ? 4
+                                                        : 0;
+    } else if (component_type == kFloat) {
+      element_size = 12;
+    }
+
+    if (element_size == 0) {
+      spdlog::error("unsupported accessor component type: {}",
+                    component_type);
+      return false;
+    }
+
+    auto count = static_cast<uint64_t>(accessor->Number("count", 0));
+    auto stride = static_cast<uint32_t>(view->Number("byteStride", 0));
+    if (stride == 0) {
+      stride = element_size;
+    }
+
+    uint64_t offset = buffers[buffer_index].second +
+                      static_cast<uint64_t>(view->Number("byteOffset", 0)) +
+                      static_cast<uint64_t>(accessor->Number("byteOffset", 0));
+
+    // output is 12 bytes per vertex, 4 per index
+    uint64_t per_job = m_chunk_size / (is_index ? 4 : 12);
+
+    for (uint64_t first = 0; first < count; first += per_job) {
+      Job job{};
+      job.path = buffers[buffer_index].first;
+      job.file_offset = offset + first * stride;
+      job.count = std::min(per_job, count - first);
+      job.stride = stride;
+      job.component_type = component_type;
+      job.is_index = is_index;
+      job.dst_element = dst_element + first;
+      job.base_vertex = base_vertex;
+
+      m_jobs.emplace_back(std::move(job));
+    }
+
+    return true;
+  };
+
+  auto meshes = root.Find("meshes");
+  for (size_t m = 0; meshes && m < meshes->array.size(); m++) {
+    auto primitives = meshes->array[m].Find("primitives");
+
+    for (size_t p = 0; primitives && p < primitives->array.size(); p++) {
+      const auto &primitive = primitives->array[p];
+
+      // only triangle lists
+      if (primitive.Number("mode", 4) != 4) {
+        spdlog::warn("skip mesh {} primitive {}: not a triangle list", m, p);
+        continue;
+      }
+
+      auto attributes = primitive.Find("attributes");
+      auto position = attributes ? attributes->Find("POSITION") : nullptr;
+      if (position == nullptr) {
+        continue;
+      }
+
+      size_t position_index = 0;
+      if (!position->Index(position_index)) {
+        spdlog::error("mesh {} primitive {}: invalid POSITION accessor", m, p);
+        return false;
+      }
+
+      auto position_accessor = root.At("accessors", position_index);
+      if (position_accessor == nullptr) {
+        return false;
+      }
+
+      auto vertex_count =
+          static_cast<uint64_t>(position_accessor->Number("count", 0));
+      auto base_vertex = static_cast<uint32_t>(m_info.vertex_count);
+
+      if (!add_accessor(position_index, false, 0, m_info.vertex_count)) {
+        return false;
+      }
+
+      auto indices = primitive.Find("indices");
+      if (indices) {
+        size_t index_index = 0;
+        if (!indices->Index(index_index)) {
+          spdlog::error("mesh {} primitive {}: invalid indices accessor", m, p);
+          return false;
+        }
+
+        auto index_accessor = root.At("accessors", index_index);
+        if (index_accessor == nullptr ||
+            !add_accessor(index_index, true, base_vertex, m_info.index_count)) {
+          return false;
+        }
+
+        m_info.index_count +=
+            static_cast<uint64_t>(index_accessor->Number("count", 0));
+      } else {
+        // non indexed primitive, generated by the worker
+        for (uint64_t first = 0; first < vertex_count;
+             first += m_chunk_size / 4) {
+          Job job{};
+          job.count = std::min(m_chunk_size / 4, vertex_count - first);
+          job.is_index = true;
+          job.dst_element = m_info.index_count + first;
+          job.base_vertex = static_cast<uint32_t>(base_vertex + first);
+
+          m_jobs.emplace_back(std::move(job));
+        }
+
+        m_info.index_count += vertex_count;
+      }
+
+      m_info.vertex_count += vertex_count;
+    }
+  }
+
+  if (m_info.vertex_count > std::numeric_limits<uint32_t>::max()) {
+    spdlog::error("too many vertices for 32 bit indices: {}",
+                  m_info.vertex_count);
+    return false;
+  }
+
+  return true;
+}
+
+bool MeshLoader::Stream(
+    const std::function<void(const MeshChunk &)> &consumer) {
+  // two chunks per worker, one being filled and one waiting in the queue
+  BlockingQueue<MeshChunk> queue(m_worker_count * 2);
+
+  std::atomic<uint32_t> next_work{0};
+  std::atomic<uint32_t> running{m_worker_count};
+  std::atomic<bool> failed{false};
+  std::mutex bounds_mutex;
+
+  constexpr float kMax = std::numeric_limits<float>::max();
+  constexpr float kLowest = std::numeric_limits<float>::lowest();
+
+  // workers start from the empty bounds, not from `bounds`, which the first
+  // finished worker already merges into
+  const float empty[6] = {kMax, kMax, kMax, kLowest, kLowest, kLowest};
+  float bounds[6] = {kMax, kMax, kMax, kLowest, kLowest, kLowest};
+
+  auto emit = [&queue](MeshChunk &&chunk) {
+    return queue.Push(std::move(chunk));
+  };
+
+  uint32_t work_count = static_cast<uint32_t>(m_is_obj ? m_obj_ranges.size()
+                                                       : m_jobs.size());
+
+  std::vector<std::thread> workers;
+  for (uint32_t i = 0; i < m_worker_count; i++) {
+    workers.emplace_back([&, this] {
+      float local[6];
+      std::copy(empty, empty + 6, local);
+
+      for (uint32_t work = next_work++; work < work_count && !failed;
+           work = next_work++) {
+        bool ok = m_is_obj ? StreamObj(m_obj_ranges[work], emit, local)
+                           : StreamJob(m_jobs[work], emit, local);
+
+        if (!ok) {
+          // closing unblocks the other workers, their next emit fails
+          failed = true;
+          queue.Close();
+          break;
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        MergeBounds(bounds, local);
+      }
+
+      // the last worker wakes up the consumer
+      if (--running == 0) {
+        queue.Close();
+      }
+    });
+  }
+
+  MeshChunk chunk;
+  while (queue.Pop(chunk)) {
+    consumer(chunk);
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  if (failed) {
+    spdlog::error("streaming {} failed", m_path);
+    return false;
+  }
+
+  if (m_info.vertex_count > 0) {
+    std::copy(bounds, bounds + 3, m_info.min);
+    std::copy(bounds + 3, bounds + 6, m_info.max);
+  }
+
+  return true;
+}
+
+bool MeshLoader::StreamObj(const ObjRange &range,
+                           const std::function<bool(MeshChunk &&)> &emit,
+                           float bounds[6]) {
+  uint64_t vertex_count = range.vertex_base;
+  uint64_t index_count = range.index_base;
+  uint64_t total_vertices = m_info.vertex_count;
+  bool warned = false;
+  // the queue was closed, the other lines are skipped
+  bool closed = false;
+
+  MeshChunk vertices{MeshChunk::Kind::kVertex, vertex_count * 12, {}};
+  MeshChunk indices{MeshChunk::Kind::kIndex, index_count * 4, {}};
+  vertices.data.reserve(m_chunk_size);
+  indices.data.reserve(m_chunk_size);
+
+  auto flush = [&](MeshChunk &chunk, uint64_t next_offset) {
+    if (chunk.data.empty() || closed) {
+      return;
+    }
+
+    MeshChunk full{chunk.kind, chunk.offset, {}};
+    full.data.reserve(m_chunk_size);
+    std::swap(full.data, chunk.data);
+
+    closed = !emit(std::move(full));
+
+    chunk.offset = next_offset;
+  };
+
+  auto push = [](MeshChunk &chunk, const void *data, size_t size) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    chunk.data.insert(chunk.data.end(), bytes, bytes + size);
+  };
+
+  bool read = ForEachLine(m_path, range.begin, range.end, [&](const char *p,
+                                                              const char *end) {
+    if (closed) {
+      return;
+    }
+
+    char keyword = ObjKeyword(p, end);
+
+    if (keyword == 'v') {
+      float position[3] = {};
+      for (int i = 0; i < 3; i++) {
+        char *next = nullptr;
+        position[i] = std::strtof(p, &next);
+        p = next;
+
+        bounds[i] = std::min(bounds[i], position[i]);
+        bounds[i + 3] = std::max(bounds[i + 3], position[i]);
+      }
+
+      push(vertices, position, sizeof(position));
+      vertex_count++;
+
+      if (vertices.data.size() + sizeof(position) > m_chunk_size) {
+        flush(vertices, vertex_count * 12);
+      }
+    } else if (keyword == 'f') {
+      uint32_t first = 0;
+      uint32_t previous = 0;
+      uint32_t corner = 0;
+
+      for (p = SkipSpace(p, end); p < end;
+           p = SkipSpace(SkipToken(p, end), end)) {
+        // only the position index before the first '/' matters
+        long value = std::strtol(p, nullptr, 10);
+
+        int64_t index = value > 0 ? value - 1
+                                  : static_cast<int64_t>(vertex_count) + value;
+
+        if (index < 0 || static_cast<uint64_t>(index) >= total_vertices) {
+          if (!warned) {
+            spdlog::warn("obj face references invalid vertex {}", value);
+            warned = true;
+          }
+          index = 0;
+        }
+
+        auto current = static_cast<uint32_t>(index);
+
+        if (corner == 0) {
+          first = current;
+        } else if (corner >= 2) {
+          uint32_t triangle[3] = {first, previous, current};
+          push(indices, triangle, sizeof(triangle));
+          index_count += 3;
+
+          if (indices.data.size() + sizeof(triangle) > m_chunk_size) {
+            flush(indices, index_count * 4);
+          }
+        }
+
+        previous = current;
+        corner++;
+      }
+    }
+  });
+
+  if (!read) {
+    spdlog::error("can not read {}", m_path);
+    return false;
+  }
+
+  flush(vertices, vertex_count * 12);
+  flush(indices, index_count * 4);
+
+  return !closed;
+}
+
+bool MeshLoader::StreamJob(const Job &job,
+                           const std::function<bool(MeshChunk &&)> &emit,
+                           float bounds[6]) {
+  MeshChunk chunk{};
+  chunk.kind = job.is_index ? MeshChunk::Kind::kIndex
+                            : MeshChunk::Kind::kVertex;
+  chunk.offset = job.dst_element * (job.is_index ? 4 : 12);
+
+  if (job.path.empty()) {
+    // generated indices for a non indexed primitive
+    chunk.data.resize(job.count * 4);
+    auto out = reinterpret_cast<uint32_t *>(chunk.data.data());
+    for (uint64_t i = 0; i < job.count; i++) {
+      out[i] = job.base_vertex + static_cast<uint32_t>(i);
+    }
+
+    return emit(std::move(chunk));
+  }
+
+  uint32_t element_size = job.is_index
+                              ? (job.component_type == kUnsignedByte    ? 1
+                                 : job.component_type == kUnsignedShort ? 2
+                                                                        : 4)
+                              : 12;
+
+  std::vector<uint8_t> raw(job.stride * (job.count - 1) + element_size);
+
+  std::ifstream file(job.path, std::ios::binary);
+  file.seekg(static_cast<std::streamoff>(job.file_offset));
+  file.read(reinterpret_cast<char *>(raw.data()), raw.size());
+
+  if (static_cast<size_t>(file.gcount()) != raw.size()) {
+    spdlog::error("glTF buffer is truncated: {}", job.path);
+    return false;
+  }
+
+  if (job.is_index) {
+    chunk.data.resize(job.count * 4);
+    auto out = reinterpret_cast<uint32_t *>(chunk.data.data());
+
+    for (uint64_t i = 0; i < job.count; i++) {
+      const uint8_t *src = raw.data() + i * job.stride;
+      uint32_t value = 0;
+
+      if (job.component_type == kUnsignedByte) {
+        value = src[0];
+      } else if (job.component_type == kUnsignedShort) {
+        uint16_t v16;
+        std::memcpy(&v16, src, sizeof(v16));
+        value = v16;
+      } else {
+        std::memcpy(&value, src, sizeof(value));
+      }
+
+      out[i] = value + job.base_vertex;
+    }
+  } else {
+    chunk.data.resize(job.count * 12);
+    auto out = reinterpret_cast<float *>(chunk.data.data());
+
+    for (uint64_t i = 0; i < job.count; i++) {
+      std::memcpy(out + i * 3, raw.data() + i * job.stride, 12);
+
+      for (int k = 0; k < 3; k++) {
+        bounds[k] = std::min(bounds[k], out[i * 3 + k]);
+        bounds[k + 3] = std::max(bounds[k + 3], out[i * 3 + k]);
+      }
+    }
+  }
+
+  return emit(std::move(chunk));
+}
+
+} // namespace util
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace util {
+
+/**
+ * A piece of parsed mesh data and where it belongs in the final buffers.
+ *
+ * Vertices are tightly packed float3 positions, indices are uint32 and already
+ * rebased to the global vertex numbering.
+ */
+struct MeshChunk {
+  enum class Kind {
+    kVertex,
+    kIndex,
+  };
+
+  Kind kind = Kind::kVertex;
+  // byte offset in the vertex or index buffer
+  uint64_t offset = 0;
+  std::vector<uint8_t> data;
+};
+
+struct MeshInfo {
+  uint64_t vertex_count = 0;
+  uint64_t index_count = 0;
+  // only valid after MeshLoader::Stream
+  float min[3] = {0.f, 0.f, 0.f};
+  float max[3] = {0.f, 0.f, 0.f};
+};
+
+/**
+ * Streaming OBJ and glTF (.gltf with external buffers, or .glb) loader.
+ *
+ * Loading is two steps:
+ *  - Open: find out the final vertex and index count, so GPU buffers can be
+ *          created with their exact size. For OBJ this is a parallel scan
+ *          which only counts lines, for glTF it reads the accessors.
+ *  - Stream: worker threads parse the file and hand out chunks of at most
+ *            `chunk_size` bytes. Chunks arrive in any order, each one knows its
+ *            destination offset. At most `worker_count * 2` chunks are alive,
+ *            so memory use does not depend on the model size.
+ *
+ * Only positions are loaded, OBJ faces are fan triangulated and glTF node
+ * transforms are ignored.
+ */
+class MeshLoader {
+public:
+  explicit MeshLoader(uint32_t worker_count = 0,
+                      uint64_t chunk_size = 4 * 1024 * 1024);
+
+  ~MeshLoader();
+
+  MeshLoader(const MeshLoader &) = delete;
+  MeshLoader &operator=(const MeshLoader &) = delete;
+
+  bool Open(const std::string &path);
+
+  /**
+   * Parse the file opened by Open, `consumer` is always called on the calling
+   * thread, so it is safe to touch WebGPU objects inside.
+   *
+   * @return false if a read failed, the chunks consumed so far do not cover
+   *         the buffers then
+   */
+  bool Stream(const std::function<void(const MeshChunk &)> &consumer);
+
+  const MeshInfo &GetInfo() const { return m_info; }
+
+  uint64_t GetFileSize() const { return m_file_size; }
+
+private:
+  struct Job;
+  struct ObjRange;
+
+  bool OpenObj();
+
+  bool OpenGltf();
+
+  bool StreamObj(const ObjRange &range,
+                 const std::function<bool(MeshChunk &&)> &emit,
+                 float bounds[6]);
+
+  bool StreamJob(const Job &job, const std::function<bool(MeshChunk &&)> &emit,
+                 float bounds[6]);
+
+private:
+  uint32_t m_worker_count;
+  uint64_t m_chunk_size;
+  std::string m_path;
+  uint64_t m_file_size = 0;
+  bool m_is_obj = false;
+  MeshInfo m_info = {};
+
+  std::vector<ObjRange> m_obj_ranges;
+  std::vector<Job> m_jobs;
+};
+
+} // namespace util
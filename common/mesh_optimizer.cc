@@ -0,0 +1,479 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace util {
+
+namespace {
+
+// the LRU cache size Forsyth's scoring is modeled on
+constexpr int kCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriScore = 0.75f;
+constexpr float kValenceBoostScale = 2.f;
+constexpr float kValenceBoostPower = 0.5f;
+
+float VertexScore(int cache_position, uint32_t live_triangles) {
+  if (live_triangles == 0) {
+    // no triangle needs this vertex
+    return -1.f;
+  }
+
+  float score = 0.f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // used by the last triangle, fixed score so the next triangle does not
+      // prefer any of the three
+      score = kLastTriScore;
+    } else {
+      float scaler = 1.f / (kCacheSize - 3);
+      score = 1.f - (cache_position - 3) * scaler;
+      score = std::pow(score, kCacheDecayPower);
+    }
+  }
+
+  // boost vertices with few triangles left, so they are finished and do not
+  // linger as lonely triangles at the end
+  score += kValenceBoostScale *
+           std::pow(static_cast<float>(live_triangles), -kValenceBoostPower);
+
+  return score;
+}
+
+struct Adjacency {
+  // triangles of vertex i are triangles[offsets[i], offsets[i] + counts[i])
+  std::vector<uint32_t> counts;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+};
+
+Adjacency BuildAdjacency(const std::vector<uint32_t> &indices,
+                         uint32_t vertex_count) {
+  Adjacency adj{};
+  adj.counts.resize(vertex_count, 0);
+  adj.offsets.resize(vertex_count, 0);
+  adj.triangles.resize(indices.size());
+
+  for (auto index : indices) {
+    adj.counts[index]++;
+  }
+
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < vertex_count; i++) {
+    adj.offsets[i] = offset;
+    offset += adj.counts[i];
+  }
+
+  std::vector<uint32_t> fill = adj.offsets;
+  for (size_t i = 0; i < indices.size(); i++) {
+    adj.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  return adj;
+}
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices,
+                                    uint32_t vertex_count,
+                                    uint32_t cache_size) {
+  if (indices.empty() || vertex_count == 0) {
+    return {};
+  }
+
+  VertexCacheScratch scratch(vertex_count);
+
+  return AnalyzeVertexCache(indices.data(), indices.size(), scratch,
+                            cache_size);
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t *indices,
+                                    size_t index_count,
+                                    VertexCacheScratch &scratch,
+                                    uint32_t cache_size) {
+  VertexCacheStats stats{};
+
+  if (index_count == 0) {
+    return stats;
+  }
+
+  // a vertex is in the FIFO if it missed less than cache_size misses ago,
+  // start far enough so no vertex is cached initially
+  auto &timestamps = scratch.timestamps;
+  uint32_t start = scratch.time + cache_size + 1;
+  uint32_t time = start;
+  uint32_t unique = 0;
+
+  for (size_t i = 0; i < index_count; i++) {
+    auto index = indices[i];
+
+    if (time - timestamps[index] > cache_size) {
+      // the first reference always misses, and only it finds a timestamp
+      // from before this range
+      if (timestamps[index] < start) {
+        unique++;
+      }
+
+      timestamps[index] = time++;
+      stats.vertices_transformed++;
+    }
+  }
+
+  scratch.time = time;
+
+  stats.acmr = static_cast<float>(stats.vertices_transformed) /
+               static_cast<float>(index_count / 3);
+  stats.atvr = static_cast<float>(stats.vertices_transformed) /
+               static_cast<float>(unique);
+
+  return stats;
+}
+
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t> &indices,
+                                          uint32_t vertex_count) {
+  size_t triangle_count = indices.size() / 3;
+
+  std::vector<uint32_t> result;
+  result.reserve(triangle_count * 3);
+
+  if (triangle_count == 0) {
+    return result;
+  }
+
+  auto adj = BuildAdjacency(indices, vertex_count);
+
+  // triangles not yet emitted that reference this vertex
+  std::vector<uint32_t> live = adj.counts;
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+
+  for (uint32_t i = 0; i < vertex_count; i++) {
+    vertex_score[i] = VertexScore(-1, live[i]);
+  }
+
+  std::vector<float> triangle_score(triangle_count);
+  std::vector<bool> emitted(triangle_count, false);
+
+  for (size_t t = 0; t < triangle_count; t++) {
+    triangle_score[t] = vertex_score[indices[t * 3 + 0]] +
+                        vertex_score[indices[t * 3 + 1]] +
+                        vertex_score[indices[t * 3 + 2]];
+  }
+
+  // 3 extra slots hold the vertices pushed out by the last triangle
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> next_cache;
+  cache.reserve(kCacheSize + 3);
+  next_cache.reserve(kCacheSize + 3);
+
+  // fallback cursor when no cached vertex has triangles left
+  size_t input_cursor = 0;
+
+  int64_t best_triangle = 0;
+  for (size_t t = 1; t < triangle_count; t++) {
+    if (triangle_score[t] > triangle_score[best_triangle]) {
+      best_triangle = t;
+    }
+  }
+
+  while (best_triangle >= 0) {
+    const uint32_t *tri = &indices[best_triangle * 3];
+
+    result.insert(result.end(), tri, tri + 3);
+    emitted[best_triangle] = true;
+
+    // the emitted triangle goes to the front of the LRU cache
+    next_cache.clear();
+    next_cache.insert(next_cache.end(), tri, tri + 3);
+
+    for (auto v : cache) {
+      if (v != tri[0] && v != tri[1] && v != tri[2]) {
+        next_cache.push_back(v);
+      }
+    }
+
+    for (int i = 0; i < 3; i++) {
+      auto v = tri[i];
+      live[v]--;
+
+      // remove the triangle from the adjacency so it is not scored again
+      auto begin = adj.triangles.begin() + adj.offsets[v];
+      auto end = begin + adj.counts[v];
+      auto it = std::find(begin, end, static_cast<uint32_t>(best_triangle));
+      if (it != end) {
+        std::iter_swap(it, end - 1);
+        adj.counts[v]--;
+      }
+    }
+
+    std::swap(cache, next_cache);
+
+    // update scores of every vertex in the cache and its triangles, while
+    // looking for the best next candidate
+    best_triangle = -1;
+    float best_score = -std::numeric_limits<float>::max();
+
+    for (size_t i = 0; i < cache.size(); i++) {
+      auto v = cache[i];
+      int position = i < static_cast<size_t>(kCacheSize) ? static_cast<int>(i)
+                                                         : -1;
+      cache_position[v] = position;
+
+      float score = VertexScore(position, live[v]);
+      float delta = score - vertex_score[v];
+      vertex_score[v] = score;
+
+      for (uint32_t k = 0; k < adj.counts[v]; k++) {
+        auto t = adj.triangles[adj.offsets[v] + k];
+        triangle_score[t] += delta;
+
+        if (triangle_score[t] > best_score) {
+          best_score = triangle_score[t];
+          best_triangle = t;
+        }
+      }
+    }
+
+    if (cache.size() > static_cast<size_t>(kCacheSize)) {
+      cache.resize(kCacheSize);
+    }
+
+    if (best_triangle < 0) {
+      // nothing left around the cache, start over from any triangle left
+      while (input_cursor < triangle_count && emitted[input_cursor]) {
+        input_cursor++;
+      }
+
+      if (input_cursor < triangle_count) {
+        best_triangle = static_cast<int64_t>(input_cursor);
+      }
+    }
+  }
+
+  return result;
+}
+
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t> &indices,
+                                       const float *positions,
+                                       uint32_t vertex_count, uint32_t stride,
+                                       float threshold) {
+  size_t triangle_count = indices.size() / 3;
+
+  if (triangle_count == 0 || positions == nullptr) {
+    return indices;
+  }
+
+  auto position = [&](uint32_t index) {
+    const float *p = reinterpret_cast<const float *>(
+        reinterpret_cast<const uint8_t *>(positions) +
+        static_cast<size_t>(index) * stride);
+    return p;
+  };
+
+  constexpr uint32_t kFifoSize = 16;
+
+  // one FIFO simulation for every pass and cluster, restarted by moving the
+  // time past the cache size instead of clearing it
+  VertexCacheScratch scratch(vertex_count);
+  auto &timestamps = scratch.timestamps;
+
+  // hard boundaries, where the FIFO cache misses all three vertices the
+  // optimized order is restarted and the clusters are independent
+  std::vector<uint32_t> hard_clusters;
+  {
+    uint32_t time = kFifoSize + 1;
+
+    for (size_t t = 0; t < triangle_count; t++) {
+      uint32_t misses = 0;
+      for (int i = 0; i < 3; i++) {
+        auto v = indices[t * 3 + i];
+        if (time - timestamps[v] > kFifoSize) {
+          timestamps[v] = time++;
+          misses++;
+        }
+      }
+
+      if (t == 0 || misses == 3) {
+        hard_clusters.push_back(static_cast<uint32_t>(t));
+      }
+    }
+
+    scratch.time = time;
+  }
+
+  // soft boundaries, split a hard cluster when the prefix is cache friendly
+  // enough that restarting will not cost more than `threshold`
+  std::vector<uint32_t> clusters;
+  for (size_t c = 0; c < hard_clusters.size(); c++) {
+    uint32_t begin = hard_clusters[c];
+    uint32_t end = c + 1 < hard_clusters.size()
+                       ? hard_clusters[c + 1]
+                       : static_cast<uint32_t>(triangle_count);
+
+    float cluster_acmr =
+        AnalyzeVertexCache(indices.data() + begin * 3,
+                           static_cast<size_t>(end - begin) * 3, scratch,
+                           kFifoSize)
+            .acmr;
+
+    uint32_t time = scratch.time + kFifoSize + 1;
+    uint32_t misses = 0;
+    uint32_t start = begin;
+
+    clusters.push_back(begin);
+
+    for (uint32_t t = begin; t < end; t++) {
+      for (int i = 0; i < 3; i++) {
+        auto v = indices[t * 3 + i];
+        if (time - timestamps[v] > kFifoSize) {
+          timestamps[v] = time++;
+          misses++;
+        }
+      }
+
+      uint32_t count = t - start + 1;
+      float acmr = static_cast<float>(misses) / static_cast<float>(count);
+
+      // only split into reasonably sized clusters
+      if (t + 1 < end && count >= 16 && acmr <= cluster_acmr * threshold) {
+        clusters.push_back(t + 1);
+        start = t + 1;
+        misses = 0;
+        // restart the cache as the reordered cluster will do on the GPU
+        time += kFifoSize + 1;
+      }
+    }
+
+    scratch.time = time;
+  }
+
+  // area weighted centroid of the whole mesh
+  float mesh_centroid[3] = {0.f, 0.f, 0.f};
+  float mesh_area = 0.f;
+
+  struct Cluster {
+    uint32_t begin;
+    uint32_t end;
+    float sort_key;
+  };
+
+  std::vector<Cluster> sorted(clusters.size());
+  std::vector<float> cluster_data(clusters.size() * 7, 0.f);
+
+  for (size_t c = 0; c < clusters.size(); c++) {
+    uint32_t begin = clusters[c];
+    uint32_t end = c + 1 < clusters.size()
+                       ? clusters[c + 1]
+                       : static_cast<uint32_t>(triangle_count);
+
+    float *centroid = &cluster_data[c * 7];
+    float *normal = centroid + 3;
+    float &area = centroid[6];
+
+    for (uint32_t t = begin; t < end; t++) {
+      const float *a = position(indices[t * 3 + 0]);
+      const float *b = position(indices[t * 3 + 1]);
+      const float *p = position(indices[t * 3 + 2]);
+
+      float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      float e2[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+      // cross product length is twice the triangle area
+      float n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                    e1[2] * e2[0] - e1[0] * e2[2],
+                    e1[0] * e2[1] - e1[1] * e2[0]};
+      float w = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+      for (int i = 0; i < 3; i++) {
+        centroid[i] += (a[i] + b[i] + p[i]) / 3.f * w;
+        normal[i] += n[i];
+      }
+      area += w;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      mesh_centroid[i] += centroid[i];
+    }
+    mesh_area += area;
+
+    if (area > 0.f) {
+      for (int i = 0; i < 3; i++) {
+        centroid[i] /= area;
+      }
+    }
+
+    sorted[c].begin = begin;
+    sorted[c].end = end;
+  }
+
+  if (mesh_area > 0.f) {
+    for (int i = 0; i < 3; i++) {
+      mesh_centroid[i] /= mesh_area;
+    }
+  }
+
+  for (size_t c = 0; c < clusters.size(); c++) {
+    const float *centroid = &cluster_data[c * 7];
+    const float *normal = centroid + 3;
+
+    float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
+                             normal[2] * normal[2]);
+    float inv = length > 0.f ? 1.f / length : 0.f;
+
+    // clusters far from the center facing outward are likely to occlude
+    // others, so draw them first
+    float dot = 0.f;
+    for (int i = 0; i < 3; i++) {
+      dot += (centroid[i] - mesh_centroid[i]) * normal[i] * inv;
+    }
+
+    sorted[c].sort_key = dot;
+  }
+
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Cluster &a, const Cluster &b) {
+                     return a.sort_key > b.sort_key;
+                   });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+
+  for (const auto &cluster : sorted) {
+    result.insert(result.end(), indices.begin() + cluster.begin * 3,
+                  indices.begin() + cluster.end * 3);
+  }
+
+  return result;
+}
+
+uint32_t OptimizeVertexFetch(std::vector<uint32_t> &indices,
+                             std::vector<float> &vertices,
+                             uint32_t floats_per_vertex) {
+  uint32_t vertex_count =
+      static_cast<uint32_t>(vertices.size() / floats_per_vertex);
+
+  constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> remap(vertex_count, kUnused);
+  std::vector<float> result;
+  result.reserve(vertices.size());
+
+  uint32_t next = 0;
+  for (auto &index : indices) {
+    if (remap[index] == kUnused) {
+      remap[index] = next++;
+
+      auto src = vertices.begin() + static_cast<size_t>(index) *
+                                        floats_per_vertex;
+      result.insert(result.end(), src, src + floats_per_vertex);
+    }
+
+    index = remap[index];
+  }
+
+  vertices.swap(result);
+
+  return next;
+}
+
+} // namespace util
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+/**
+ * Post-transform vertex cache statistics of an indexed triangle list.
+ *
+ *  ACMR: average cache miss ratio, transformed vertices per triangle.
+ *        (0.5 is the theoretical best for regular grids, 3.0 the worst)
+ *  ATVR: average transform to vertex ratio, transformed vertices per unique
+ *        vertex. (1.0 means every vertex is transformed exactly once)
+ */
+struct VertexCacheStats {
+  uint32_t vertices_transformed = 0;
+  float acmr = 0.f;
+  float atvr = 0.f;
+};
+
+/**
+ * State of the FIFO cache simulation, reused so analyzing many ranges of one
+ * mesh neither allocates nor clears per range.
+ */
+struct VertexCacheScratch {
+  explicit VertexCacheScratch(uint32_t vertex_count)
+      : timestamps(vertex_count, 0) {}
+
+  // per vertex, the time of its last miss
+  std::vector<uint32_t> timestamps;
+  // only grows, every range starts past the cache size so nothing is cached
+  uint32_t time = 0;
+};
+
+/**
+ * Simulate a FIFO post-transform cache with `cache_size` entries, which is
+ * close to what most desktop and mobile GPUs do.
+ */
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices,
+                                    uint32_t vertex_count,
+                                    uint32_t cache_size = 16);
+
+/**
+ * AnalyzeVertexCache of `index_count` indices, starting with an empty cache.
+ * `scratch` must cover every referenced vertex.
+ */
+VertexCacheStats AnalyzeVertexCache(const uint32_t *indices,
+                                    size_t index_count,
+                                    VertexCacheScratch &scratch,
+                                    uint32_t cache_size = 16);
+
+/**
+ * Reorder triangles for post-transform cache locality.
+ * This is the Tom Forsyth linear-speed algorithm:
+ * https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+ */
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t> &indices,
+                                          uint32_t vertex_count);
+
+/**
+ * Reorder triangles to reduce overdraw, should be called after
+ * OptimizeVertexCache.
+ *
+ * The triangle list is split into clusters on cache flushes, clusters are
+ * further split as long as their ACMR stays below `threshold` times the
+ * original one. Then clusters are sorted so the ones facing outward are drawn
+ * first (Sander et al. 2007, "Fast Triangle Reordering for Vertex Locality and
+ * Reduced Overdraw").
+ *
+ * `positions` points to the first float3 position, `stride` is the vertex size
+ * in bytes.
+ */
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t> &indices,
+                                       const float *positions,
+                                       uint32_t vertex_count, uint32_t stride,
+                                       float threshold = 1.05f);
+
+/**
+ * Reorder vertices in the order they are first referenced, so vertex fetch
+ * reads memory linearly. `vertices` is rewritten in place and `indices` is
+ * remapped.
+ *
+ * @return the number of referenced vertices, unreferenced ones are dropped
+ */
+uint32_t OptimizeVertexFetch(std::vector<uint32_t> &indices,
+                             std::vector<float> &vertices,
+                             uint32_t floats_per_vertex);
+
+} // namespace util
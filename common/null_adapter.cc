@@ -0,0 +1,33 @@
+#include "null_adapter.hpp"
+
+#if defined(WEBGPU_BACKEND_DAWN) && __has_include(<dawn/native/DawnNative.h>)
+#define UTIL_DAWN_NATIVE 1
+#include <dawn/native/DawnNative.h>
+#endif
+
+namespace util {
+
+WGPUAdapter RequestNullAdapter(WGPUInstance instance) {
+#ifdef UTIL_DAWN_NATIVE
+  // a WGPUInstance is Dawn's InstanceBase, wrapped only to reach its list
+  dawn::native::Instance native{
+      reinterpret_cast<dawn::native::InstanceBase *>(instance)};
+  native.DiscoverDefaultAdapters();
+
+  for (const auto &adapter : native.GetAdapters()) {
+    WGPUAdapterProperties props{};
+    adapter.GetProperties(&props);
+
+    if (props.backendType == WGPUBackendType_Null) {
+      // the list drops its reference when it goes out of scope
+      WGPUAdapter handle = adapter.Get();
+      wgpuAdapterReference(handle);
+      return handle;
+    }
+  }
+#endif
+
+  return nullptr;
+}
+
+} // namespace util
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+/**
+ * The adapter of Dawn's Null backend, which does no GPU work. Null when Dawn
+ * is built without it (DAWN_ENABLE_NULL) or the backend is not Dawn.
+ *
+ * WGPUBackendType_Null is 0 in this header, which a request reads as no
+ * particular backend, so wgpuInstanceRequestAdapter returns the default
+ * adapter wherever there is a GPU. The adapter is taken from Dawn's own list
+ * instead. The caller releases it.
+ */
+WGPUAdapter RequestNullAdapter(WGPUInstance instance);
+
+} // namespace util
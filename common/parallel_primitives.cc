@@ -0,0 +1,302 @@
+#include "parallel_primitives.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+namespace {
+
+// minUniformBufferOffsetAlignment of the default limits
+constexpr uint64_t kParamStride = 256;
+
+// maxComputeWorkgroupsPerDimension of the default limits
+constexpr uint32_t kMaxGroups = 65535;
+
+} // namespace
+
+ParallelPrimitives::ParallelPrimitives(WGPUDevice device, WGPUQueue queue,
+                                       uint32_t capacity)
+    : m_device(device), m_queue(queue), m_capacity(capacity) {
+  uint64_t max_capacity = uint64_t(kMaxGroups) * kBlockSize;
+
+  // input and output are bound whole
+  WGPUSupportedLimits limits{};
+  if (wgpuDeviceGetLimits(m_device, &limits)) {
+    max_capacity = std::min<uint64_t>(
+        max_capacity, limits.limits.maxStorageBufferBindingSize /
+                          sizeof(uint32_t));
+  }
+
+  if (m_capacity > max_capacity) {
+    spdlog::warn("parallel primitives capacity {} clamped to {}", m_capacity,
+                 max_capacity);
+    m_capacity = static_cast<uint32_t>(max_capacity);
+  }
+
+  InitPipelines();
+
+  InitBuffers();
+}
+
+ParallelPrimitives::~ParallelPrimitives() {
+  for (auto &it : m_bind_groups) {
+    wgpuBindGroupRelease(it.second);
+  }
+
+  for (auto buffer : {m_params, m_flags, m_offsets, m_unused_input,
+                      m_unused_aux, m_unused_total}) {
+    wgpuBufferRelease(buffer);
+  }
+
+  for (uint32_t i = 0; i < kMaxLevels; i++) {
+    wgpuBufferRelease(m_sums[i]);
+    wgpuBufferRelease(m_scanned_sums[i]);
+  }
+
+  wgpuPipelineLayoutRelease(m_layout);
+  wgpuBindGroupLayoutRelease(m_group_layout);
+}
+
+void ParallelPrimitives::Reduce(WGPUComputePassEncoder pass, WGPUBuffer input,
+                                uint32_t count, WGPUBuffer result) {
+  ReduceLevel(pass, input, std::min(count, m_capacity), result, 0);
+}
+
+void ParallelPrimitives::InclusiveScan(WGPUComputePassEncoder pass,
+                                       WGPUBuffer input, WGPUBuffer output,
+                                       uint32_t count) {
+  ScanLevel(pass, input, output, std::min(count, m_capacity), true, 0);
+}
+
+void ParallelPrimitives::ExclusiveScan(WGPUComputePassEncoder pass,
+                                       WGPUBuffer input, WGPUBuffer output,
+                                       uint32_t count) {
+  ScanLevel(pass, input, output, std::min(count, m_capacity), false, 0);
+}
+
+void ParallelPrimitives::Compact(WGPUComputePassEncoder pass,
+                                 WGPUBuffer input, uint32_t count,
+                                 uint32_t threshold, WGPUBuffer output,
+                                 WGPUBuffer kept_count) {
+  count = std::min(count, m_capacity);
+
+  Params params{};
+  params.count = count;
+  params.threshold = threshold;
+
+  uint32_t groups = ComputeKernel::GroupCount(count, kBlockSize);
+
+  Dispatch(pass, m_compact_flags, params, groups, input, m_flags);
+
+  ScanLevel(pass, m_flags, m_offsets, count, false, 0);
+
+  // at least one workgroup, which writes the count of an empty input
+  Dispatch(pass, m_compact_scatter, params, std::max(groups, 1u), input,
+           output, m_offsets, kept_count);
+}
+
+void ParallelPrimitives::Release(WGPUBuffer buffer) {
+  for (auto it = m_bind_groups.begin(); it != m_bind_groups.end();) {
+    const auto &buffers = it->first;
+
+    if (std::find(buffers.begin(), buffers.end(), buffer) != buffers.end()) {
+      wgpuBindGroupRelease(it->second);
+      it = m_bind_groups.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ParallelPrimitives::ReduceLevel(WGPUComputePassEncoder pass,
+                                     WGPUBuffer input, uint32_t count,
+                                     WGPUBuffer result, uint32_t level) {
+  Params params{};
+  params.count = count;
+
+  uint32_t groups = ComputeKernel::GroupCount(count, kBlockSize);
+
+  if (groups <= 1) {
+    Dispatch(pass, m_reduce, params, 1, input, result);
+    return;
+  }
+
+  // one partial sum per block, then reduce those
+  Dispatch(pass, m_reduce, params, groups, input, m_sums[level]);
+
+  ReduceLevel(pass, m_sums[level], groups, result, level + 1);
+}
+
+void ParallelPrimitives::ScanLevel(WGPUComputePassEncoder pass,
+                                   WGPUBuffer input, WGPUBuffer output,
+                                   uint32_t count, bool inclusive,
+                                   uint32_t level) {
+  if (count == 0) {
+    return;
+  }
+
+  Params params{};
+  params.count = count;
+  params.inclusive = inclusive ? 1 : 0;
+
+  uint32_t groups = ComputeKernel::GroupCount(count, kBlockSize);
+
+  Dispatch(pass, m_scan_blocks, params, groups, input, output, m_sums[level]);
+
+  if (groups == 1) {
+    return;
+  }
+
+  // offset of every block is the exclusive scan of the block totals
+  ScanLevel(pass, m_sums[level], m_scanned_sums[level], groups, false,
+            level + 1);
+
+  Dispatch(pass, m_add_block_sums, params, groups, nullptr, output,
+           m_scanned_sums[level]);
+}
+
+void ParallelPrimitives::Dispatch(WGPUComputePassEncoder pass,
+                                  const ComputeKernel &kernel,
+                                  const Params &params, uint32_t groups,
+                                  WGPUBuffer input, WGPUBuffer output,
+                                  WGPUBuffer aux, WGPUBuffer total) {
+  uint32_t offset = static_cast<uint32_t>(m_next_slot * kParamStride);
+  m_next_slot = (m_next_slot + 1) % kParamSlots;
+
+  wgpuQueueWriteBuffer(m_queue, m_params, offset, &params, sizeof(Params));
+
+  auto group = GetBindGroup({input ? input : m_unused_input, output,
+                             aux ? aux : m_unused_aux,
+                             total ? total : m_unused_total});
+
+  kernel.Dispatch(pass, group, 1, &offset, groups);
+}
+
+WGPUBindGroup ParallelPrimitives::GetBindGroup(const Bindings &buffers) {
+  auto it = m_bind_groups.find(buffers);
+  if (it != m_bind_groups.end()) {
+    return it->second;
+  }
+
+  std::array<WGPUBindGroupEntry, 5> entries{};
+
+  entries[0].binding = 0;
+  entries[0].buffer = m_params;
+  entries[0].offset = 0;
+  entries[0].size = sizeof(Params);
+
+  for (uint32_t i = 0; i < buffers.size(); i++) {
+    entries[i + 1].binding = i + 1;
+    entries[i + 1].buffer = buffers[i];
+    entries[i + 1].offset = 0;
+    entries[i + 1].size = WGPU_WHOLE_SIZE;
+  }
+
+  WGPUBindGroupDescriptor desc{};
+  desc.layout = m_group_layout;
+  desc.entryCount = entries.size();
+  desc.entries = entries.data();
+
+  auto group = wgpuDeviceCreateBindGroup(m_device, &desc);
+
+  m_bind_groups[buffers] = group;
+
+  return group;
+}
+
+void ParallelPrimitives::InitPipelines() {
+  const char *raw_shader = GetShader("parallel.wgsl");
+
+  WGPUShaderModule shader = nullptr;
+  {
+    WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+    wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+    wgsl_desc.code = raw_shader;
+
+    WGPUShaderModuleDescriptor desc{};
+    desc.label = "Parallel primitives shader";
+
+    desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+    shader = wgpuDeviceCreateShaderModule(m_device, &desc);
+  }
+
+  // every kernel shares one layout, so bind groups can be shared too
+  {
+    std::array<WGPUBindGroupLayoutEntry, 5> entries{};
+
+    for (uint32_t i = 0; i < entries.size(); i++) {
+      entries[i].binding = i;
+      entries[i].visibility = WGPUShaderStage_Compute;
+      entries[i].buffer.type = WGPUBufferBindingType_Storage;
+    }
+
+    entries[0].buffer.type = WGPUBufferBindingType_Uniform;
+    entries[0].buffer.hasDynamicOffset = true;
+    entries[0].buffer.minBindingSize = sizeof(Params);
+
+    entries[1].buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+
+    WGPUBindGroupLayoutDescriptor desc{};
+    desc.entryCount = entries.size();
+    desc.entries = entries.data();
+
+    m_group_layout = wgpuDeviceCreateBindGroupLayout(m_device, &desc);
+  }
+
+  {
+    WGPUPipelineLayoutDescriptor desc{};
+    desc.bindGroupLayoutCount = 1;
+    desc.bindGroupLayouts = &m_group_layout;
+
+    m_layout = wgpuDeviceCreatePipelineLayout(m_device, &desc);
+  }
+
+  m_reduce = ComputeKernel(m_device, shader, "reduce", m_layout);
+  m_scan_blocks = ComputeKernel(m_device, shader, "scan_blocks", m_layout);
+  m_add_block_sums =
+      ComputeKernel(m_device, shader, "add_block_sums", m_layout);
+  m_compact_flags = ComputeKernel(m_device, shader, "compact_flags", m_layout);
+  m_compact_scatter =
+      ComputeKernel(m_device, shader, "compact_scatter", m_layout);
+
+  wgpuShaderModuleRelease(shader);
+}
+
+void ParallelPrimitives::InitBuffers() {
+  {
+    WGPUBufferDescriptor desc{};
+    desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+    desc.size = kParamStride * kParamSlots;
+
+    m_params = wgpuDeviceCreateBuffer(m_device, &desc);
+  }
+
+  uint32_t count = m_capacity;
+  for (uint32_t i = 0; i < kMaxLevels; i++) {
+    count = ComputeKernel::GroupCount(count, kBlockSize);
+
+    m_sums[i] = CreateStorage(std::max(count, 1u) * sizeof(uint32_t));
+    m_scanned_sums[i] = CreateStorage(std::max(count, 1u) * sizeof(uint32_t));
+  }
+
+  m_flags = CreateStorage(std::max(m_capacity, 1u) * sizeof(uint32_t));
+  m_offsets = CreateStorage(std::max(m_capacity, 1u) * sizeof(uint32_t));
+
+  m_unused_input = CreateStorage(sizeof(uint32_t));
+  m_unused_aux = CreateStorage(sizeof(uint32_t));
+  m_unused_total = CreateStorage(sizeof(uint32_t));
+}
+
+WGPUBuffer ParallelPrimitives::CreateStorage(uint64_t size) {
+  WGPUBufferDescriptor desc{};
+  desc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc;
+  // storage bindings need a multiple of 4 bytes
+  desc.size = (size + 3) & ~uint64_t(3);
+
+  return wgpuDeviceCreateBuffer(m_device, &desc);
+}
+
+} // namespace util
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+#include <webgpu/webgpu.h>
+
+#include "compute_kernel.hpp"
+
+namespace util {
+
+/**
+ * GPU reduction, prefix scan and stream compaction of u32 arrays.
+ *
+ * Every kernel works on blocks of kBlockSize elements in workgroup memory.
+ * Longer arrays run the kernel again on the per block results, so a call is
+ * one to three levels of dispatches, all recorded into the given compute
+ * pass.
+ *
+ * Kernel parameters are uploaded with wgpuQueueWriteBuffer into a ring of
+ * kParamSlots uniform slots, one per dispatch. All dispatches of one submit
+ * must fit into the ring.
+ *
+ * Buffers passed in need the Storage usage and must be distinct from each
+ * other. Bind groups are cached per buffer combination and hold a reference
+ * to their buffers, call Release before dropping a buffer passed in, or its
+ * bind groups stay alive and a new buffer at the same address reuses them.
+ */
+class ParallelPrimitives {
+public:
+  static constexpr uint32_t kBlockSize = 512;
+  static constexpr uint32_t kParamSlots = 256;
+
+  /**
+   * @param capacity   the longest array any call will process, clamped to
+   *                   what one dispatch and one storage binding can reach
+   */
+  ParallelPrimitives(WGPUDevice device, WGPUQueue queue, uint32_t capacity);
+
+  ~ParallelPrimitives();
+
+  ParallelPrimitives(const ParallelPrimitives &) = delete;
+  ParallelPrimitives &operator=(const ParallelPrimitives &) = delete;
+
+  uint32_t GetCapacity() const { return m_capacity; }
+
+  /**
+   * result[0] = input[0] + ... + input[count - 1], wrapping on overflow.
+   */
+  void Reduce(WGPUComputePassEncoder pass, WGPUBuffer input, uint32_t count,
+              WGPUBuffer result);
+
+  /**
+   * output[i] = input[0] + ... + input[i]
+   */
+  void InclusiveScan(WGPUComputePassEncoder pass, WGPUBuffer input,
+                     WGPUBuffer output, uint32_t count);
+
+  /**
+   * output[i] = input[0] + ... + input[i - 1], output[0] = 0
+   */
+  void ExclusiveScan(WGPUComputePassEncoder pass, WGPUBuffer input,
+                     WGPUBuffer output, uint32_t count);
+
+  /**
+   * Copy the values less than `threshold` into output, in their original
+   * order. The number of copied values is written into kept_count[0].
+   */
+  void Compact(WGPUComputePassEncoder pass, WGPUBuffer input, uint32_t count,
+               uint32_t threshold, WGPUBuffer output, WGPUBuffer kept_count);
+
+  /**
+   * Drop the cached bind groups that use `buffer`. Dispatches already
+   * recorded keep theirs alive.
+   */
+  void Release(WGPUBuffer buffer);
+
+private:
+  // scan block totals have to fit into one level below, three levels cover
+  // every count a one dimensional dispatch can reach
+  static constexpr uint32_t kMaxLevels = 3;
+
+  struct Params {
+    uint32_t count = 0;
+    uint32_t inclusive = 0;
+    uint32_t threshold = 0;
+    uint32_t pad = 0;
+  };
+
+  // input, output, aux, total
+  using Bindings = std::array<WGPUBuffer, 4>;
+
+  struct BindingsHash {
+    size_t operator()(const Bindings &buffers) const {
+      size_t hash = 0;
+      for (auto buffer : buffers) {
+        hash = hash * 31 + std::hash<WGPUBuffer>{}(buffer);
+      }
+      return hash;
+    }
+  };
+
+  void InitPipelines();
+
+  void InitBuffers();
+
+  WGPUBuffer CreateStorage(uint64_t size);
+
+  void Dispatch(WGPUComputePassEncoder pass, const ComputeKernel &kernel,
+                const Params &params, uint32_t groups, WGPUBuffer input,
+                WGPUBuffer output, WGPUBuffer aux = nullptr,
+                WGPUBuffer total = nullptr);
+
+  void ReduceLevel(WGPUComputePassEncoder pass, WGPUBuffer input,
+                   uint32_t count, WGPUBuffer result, uint32_t level);
+
+  void ScanLevel(WGPUComputePassEncoder pass, WGPUBuffer input,
+                 WGPUBuffer output, uint32_t count, bool inclusive,
+                 uint32_t level);
+
+  WGPUBindGroup GetBindGroup(const Bindings &buffers);
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+  uint32_t m_capacity;
+
+  WGPUBindGroupLayout m_group_layout = nullptr;
+  WGPUPipelineLayout m_layout = nullptr;
+
+  ComputeKernel m_reduce;
+  ComputeKernel m_scan_blocks;
+  ComputeKernel m_add_block_sums;
+  ComputeKernel m_compact_flags;
+  ComputeKernel m_compact_scatter;
+
+  WGPUBuffer m_params = nullptr;
+  uint32_t m_next_slot = 0;
+
+  // block totals of each level and their scan
+  std::array<WGPUBuffer, kMaxLevels> m_sums = {};
+  std::array<WGPUBuffer, kMaxLevels> m_scanned_sums = {};
+  // compaction flags and destinations
+  WGPUBuffer m_flags = nullptr;
+  WGPUBuffer m_offsets = nullptr;
+  // bound to the bindings a kernel does not use
+  WGPUBuffer m_unused_input = nullptr;
+  WGPUBuffer m_unused_aux = nullptr;
+  WGPUBuffer m_unused_total = nullptr;
+
+  std::unordered_map<Bindings, WGPUBindGroup, BindingsHash> m_bind_groups;
+};
+
+} // namespace util
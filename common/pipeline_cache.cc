@@ -0,0 +1,119 @@
+#include "pipeline_cache.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <spdlog/fmt/fmt.h>
+
+#if defined(WEBGPU_BACKEND_DAWN) && __has_include(<dawn/native/DawnNative.h>)
+#define UTIL_DAWN_PLATFORM 1
+#include <dawn/native/DawnNative.h>
+#include <dawn/platform/DawnPlatform.h>
+#endif
+
+namespace util {
+
+#ifdef UTIL_DAWN_PLATFORM
+
+namespace {
+
+class CachingInterface : public dawn::platform::CachingInterface {
+public:
+  explicit CachingInterface(BlobCache *cache) : m_cache(cache) {}
+
+  size_t LoadData(const void *key, size_t key_size, void *value,
+                  size_t value_size) override {
+    return m_cache->Load(key, key_size, value, value_size);
+  }
+
+  void StoreData(const void *key, size_t key_size, const void *value,
+                 size_t value_size) override {
+    m_cache->Store(key, key_size, value, value_size);
+  }
+
+private:
+  BlobCache *m_cache;
+};
+
+} // namespace
+
+struct PipelineCache::Platform : public dawn::platform::Platform {
+  explicit Platform(BlobCache *cache) : caching(cache) {}
+
+  dawn::platform::CachingInterface *GetCachingInterface() override {
+    return &caching;
+  }
+
+  CachingInterface caching;
+  dawn::native::DawnInstanceDescriptor instance_desc;
+};
+
+#else
+
+struct PipelineCache::Platform {
+  explicit Platform(BlobCache *cache) {}
+};
+
+#endif // UTIL_DAWN_PLATFORM
+
+PipelineCache::PipelineCache(std::string directory, uint64_t max_bytes)
+    : m_cache(std::move(directory), max_bytes),
+      m_platform(std::make_unique<Platform>(&m_cache)) {}
+
+PipelineCache::~PipelineCache() = default;
+
+void PipelineCache::ChainInstance(WGPUInstanceDescriptor &desc) {
+#ifdef UTIL_DAWN_PLATFORM
+  auto &instance_desc = m_platform->instance_desc;
+  instance_desc.platform = m_platform.get();
+  instance_desc.nextInChain =
+      reinterpret_cast<const wgpu::ChainedStruct *>(desc.nextInChain);
+
+  desc.nextInChain = reinterpret_cast<const WGPUChainedStruct *>(&instance_desc);
+#endif
+}
+
+void PipelineCache::ChainDevice(WGPUDeviceDescriptor &desc,
+                                WGPUAdapter adapter) {
+#ifdef UTIL_DAWN_PLATFORM
+  WGPUAdapterProperties props{};
+  wgpuAdapterGetProperties(adapter, &props);
+
+  // a driver update invalidates what it compiled
+  m_isolation_key = fmt::format(
+      "{:04x}-{:04x}-{}-{}-v{}", props.vendorID, props.deviceID,
+      static_cast<uint32_t>(props.backendType),
+      props.driverDescription ? props.driverDescription : "",
+      BlobCache::kVersion);
+
+  m_device_desc.chain.sType = WGPUSType_DawnCacheDeviceDescriptor;
+  m_device_desc.chain.next = desc.nextInChain;
+  m_device_desc.isolationKey = m_isolation_key.c_str();
+
+  desc.nextInChain = &m_device_desc.chain;
+#endif
+}
+
+std::string PipelineCache::DefaultDirectory() {
+  namespace fs = std::filesystem;
+
+#if defined(_WIN32)
+  if (auto base = std::getenv("LOCALAPPDATA")) {
+    return (fs::path(base) / "learn-webgpu" / "cache").string();
+  }
+#elif defined(__APPLE__)
+  if (auto home = std::getenv("HOME")) {
+    return (fs::path(home) / "Library" / "Caches" / "learn-webgpu").string();
+  }
+#else
+  if (auto base = std::getenv("XDG_CACHE_HOME")) {
+    return (fs::path(base) / "learn-webgpu").string();
+  }
+  if (auto home = std::getenv("HOME")) {
+    return (fs::path(home) / ".cache" / "learn-webgpu").string();
+  }
+#endif
+
+  return "";
+}
+
+} // namespace util
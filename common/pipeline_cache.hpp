@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <webgpu/webgpu.h>
+
+#include "blob_cache.hpp"
+
+namespace util {
+
+/**
+ * Keeps the shaders and pipelines Dawn compiles in a BlobCache across runs,
+ * through the caching interface of the Dawn platform. Dawn looks every
+ * compilation up by its own key before running the compiler, so warm starts
+ * skip it. Other implementations do not expose a cache and ignore it.
+ */
+class PipelineCache {
+public:
+  PipelineCache(std::string directory, uint64_t max_bytes);
+
+  ~PipelineCache();
+
+  PipelineCache(const PipelineCache &) = delete;
+  PipelineCache &operator=(const PipelineCache &) = delete;
+
+  /**
+   * Hand the cache to the instance created with `desc`, it has to outlive the
+   * instance.
+   */
+  void ChainInstance(WGPUInstanceDescriptor &desc);
+
+  /**
+   * Keep the entries of different adapters and drivers apart.
+   */
+  void ChainDevice(WGPUDeviceDescriptor &desc, WGPUAdapter adapter);
+
+  const BlobCache &GetBlobCache() const { return m_cache; }
+
+  /**
+   * The per user cache directory, empty if there is none.
+   */
+  static std::string DefaultDirectory();
+
+private:
+  struct Platform;
+
+  BlobCache m_cache;
+  std::unique_ptr<Platform> m_platform;
+
+  std::string m_isolation_key;
+  WGPUDawnCacheDeviceDescriptor m_device_desc = {};
+};
+
+} // namespace util
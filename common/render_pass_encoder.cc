@@ -0,0 +1,246 @@
+#include "render_pass_encoder.hpp"
+#include "frame_trace.hpp"
+
+#include <algorithm>
+
+namespace util {
+
+RenderPassEncoder::RenderPassEncoder(WGPURenderPassEncoder encoder,
+                                     TraceRecorder *recorder)
+    : m_encoder(encoder), m_recorder(recorder) {}
+
+void RenderPassEncoder::SetPipeline(WGPURenderPipeline pipeline) {
+  if (pipeline == m_pipeline) {
+    m_stats.skipped++;
+    return;
+  }
+
+  m_pipeline = pipeline;
+  m_stats.pipelines++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetPipeline(m_encoder, pipeline);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetPipeline(pipeline);
+  }
+}
+
+void RenderPassEncoder::SetBindGroup(uint32_t index, WGPUBindGroup group,
+                                     uint32_t dynamic_offset_count,
+                                     const uint32_t *dynamic_offsets) {
+  // out of range indices are left to Dawn validation
+  bool filter =
+      index < kMaxBindGroups && dynamic_offset_count <= kMaxDynamicOffsets;
+
+  if (filter) {
+    auto &state = m_bind_groups[index];
+
+    if (state.group == group && state.offset_count == dynamic_offset_count &&
+        std::equal(dynamic_offsets, dynamic_offsets + dynamic_offset_count,
+                   state.offsets.begin())) {
+      m_stats.skipped++;
+      return;
+    }
+
+    state.group = group;
+    state.offset_count = dynamic_offset_count;
+    std::copy(dynamic_offsets, dynamic_offsets + dynamic_offset_count,
+              state.offsets.begin());
+  } else if (index < kMaxBindGroups) {
+    // can not be compared next time
+    m_bind_groups[index] = {};
+  }
+
+  m_stats.bind_groups++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetBindGroup(m_encoder, index, group,
+                                      dynamic_offset_count, dynamic_offsets);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetBindGroup(index, group, dynamic_offset_count,
+                             dynamic_offsets);
+  }
+}
+
+void RenderPassEncoder::SetVertexBuffer(uint32_t slot, WGPUBuffer buffer,
+                                        uint64_t offset, uint64_t size) {
+  if (slot < kMaxVertexBuffers) {
+    auto &state = m_vertex_buffers[slot];
+
+    if (state.buffer == buffer && state.offset == offset &&
+        state.size == size) {
+      m_stats.skipped++;
+      return;
+    }
+
+    state = {buffer, offset, size};
+  }
+
+  m_stats.vertex_buffers++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetVertexBuffer(m_encoder, slot, buffer, offset,
+                                         size);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetVertexBuffer(slot, buffer, offset, size);
+  }
+}
+
+void RenderPassEncoder::SetIndexBuffer(WGPUBuffer buffer,
+                                       WGPUIndexFormat format, uint64_t offset,
+                                       uint64_t size) {
+  if (m_index_buffer.buffer == buffer && m_index_buffer.offset == offset &&
+      m_index_buffer.size == size && m_index_format == format) {
+    m_stats.skipped++;
+    return;
+  }
+
+  m_index_buffer = {buffer, offset, size};
+  m_index_format = format;
+  m_stats.index_buffers++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetIndexBuffer(m_encoder, buffer, format, offset,
+                                        size);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetIndexBuffer(buffer, format, offset, size);
+  }
+}
+
+void RenderPassEncoder::SetViewport(float x, float y, float width,
+                                    float height, float min_depth,
+                                    float max_depth) {
+  std::array<float, 6> viewport{x, y, width, height, min_depth, max_depth};
+
+  if (m_has_viewport && viewport == m_viewport) {
+    m_stats.skipped++;
+    return;
+  }
+
+  m_has_viewport = true;
+  m_viewport = viewport;
+  m_stats.dynamic_states++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetViewport(m_encoder, x, y, width, height, min_depth,
+                                     max_depth);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetViewport(x, y, width, height, min_depth, max_depth);
+  }
+}
+
+void RenderPassEncoder::SetScissorRect(uint32_t x, uint32_t y, uint32_t width,
+                                       uint32_t height) {
+  std::array<uint32_t, 4> scissor{x, y, width, height};
+
+  if (m_has_scissor && scissor == m_scissor) {
+    m_stats.skipped++;
+    return;
+  }
+
+  m_has_scissor = true;
+  m_scissor = scissor;
+  m_stats.dynamic_states++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetScissorRect(m_encoder, x, y, width, height);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetScissorRect(x, y, width, height);
+  }
+}
+
+void RenderPassEncoder::SetBlendConstant(const WGPUColor &color) {
+  if (m_has_blend_constant && color.r == m_blend_constant.r &&
+      color.g == m_blend_constant.g && color.b == m_blend_constant.b &&
+      color.a == m_blend_constant.a) {
+    m_stats.skipped++;
+    return;
+  }
+
+  m_has_blend_constant = true;
+  m_blend_constant = color;
+  m_stats.dynamic_states++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetBlendConstant(m_encoder, &color);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetBlendConstant(color);
+  }
+}
+
+void RenderPassEncoder::SetStencilReference(uint32_t reference) {
+  if (m_has_stencil_reference && reference == m_stencil_reference) {
+    m_stats.skipped++;
+    return;
+  }
+
+  m_has_stencil_reference = true;
+  m_stencil_reference = reference;
+  m_stats.dynamic_states++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderSetStencilReference(m_encoder, reference);
+  }
+
+  if (m_recorder) {
+    m_recorder->SetStencilReference(reference);
+  }
+}
+
+void RenderPassEncoder::Draw(uint32_t vertex_count, uint32_t instance_count,
+                             uint32_t first_vertex, uint32_t first_instance) {
+  m_stats.draws++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderDraw(m_encoder, vertex_count, instance_count,
+                              first_vertex, first_instance);
+  }
+
+  if (m_recorder) {
+    m_recorder->Draw(vertex_count, instance_count, first_vertex,
+                     first_instance);
+  }
+}
+
+void RenderPassEncoder::DrawIndexed(uint32_t index_count,
+                                    uint32_t instance_count,
+                                    uint32_t first_index, int32_t base_vertex,
+                                    uint32_t first_instance) {
+  m_stats.draws++;
+
+  if (m_encoder) {
+    wgpuRenderPassEncoderDrawIndexed(m_encoder, index_count, instance_count,
+                                     first_index, base_vertex, first_instance);
+  }
+
+  if (m_recorder) {
+    m_recorder->DrawIndexed(index_count, instance_count, first_index,
+                            base_vertex, first_instance);
+  }
+}
+
+void RenderPassEncoder::End() {
+  if (m_encoder) {
+    wgpuRenderPassEncoderEnd(m_encoder);
+  }
+
+  if (m_recorder) {
+    m_recorder->EndRenderPass();
+  }
+}
+
+} // namespace util
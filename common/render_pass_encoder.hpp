@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+class TraceRecorder;
+
+// WebGPU default limits.maxBindGroups
+constexpr uint32_t kMaxBindGroups = 4;
+// WebGPU default limits.maxVertexBuffers
+constexpr uint32_t kMaxVertexBuffers = 8;
+// dynamic offsets compared per bind group, more than this is never filtered
+constexpr uint32_t kMaxDynamicOffsets = 4;
+
+/**
+ * Commands forwarded to Dawn and commands dropped because the state was
+ * already bound.
+ */
+struct RenderPassStats {
+  uint32_t pipelines = 0;
+  uint32_t bind_groups = 0;
+  uint32_t vertex_buffers = 0;
+  uint32_t index_buffers = 0;
+  // viewport, scissor, blend constant and stencil reference
+  uint32_t dynamic_states = 0;
+  uint32_t draws = 0;
+
+  uint32_t skipped = 0;
+
+  uint32_t StateChanges() const {
+    return pipelines + bind_groups + vertex_buffers + index_buffers +
+           dynamic_states;
+  }
+
+  uint32_t Issued() const { return StateChanges() + draws; }
+};
+
+/**
+ * Thin wrapper over WGPURenderPassEncoder which remembers the bound state and
+ * drops calls which would not change it, every dropped call is validation
+ * work Dawn does not have to do.
+ *
+ * Bound state is the state of the whole pass, as in WebGPU bind groups and
+ * buffers stay bound when the pipeline changes.
+ *
+ * The wrapper does not own the encoder. A null encoder records nothing and
+ * only counts, which is handy to measure a command stream. Forwarded
+ * commands are also reported to `recorder` when one is given.
+ */
+class RenderPassEncoder {
+public:
+  explicit RenderPassEncoder(WGPURenderPassEncoder encoder,
+                             TraceRecorder *recorder = nullptr);
+
+  void SetPipeline(WGPURenderPipeline pipeline);
+
+  void SetBindGroup(uint32_t index, WGPUBindGroup group,
+                    uint32_t dynamic_offset_count = 0,
+                    const uint32_t *dynamic_offsets = nullptr);
+
+  void SetVertexBuffer(uint32_t slot, WGPUBuffer buffer, uint64_t offset = 0,
+                       uint64_t size = WGPU_WHOLE_SIZE);
+
+  void SetIndexBuffer(WGPUBuffer buffer, WGPUIndexFormat format,
+                      uint64_t offset = 0, uint64_t size = WGPU_WHOLE_SIZE);
+
+  void SetViewport(float x, float y, float width, float height, float min_depth,
+                   float max_depth);
+
+  void SetScissorRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+  void SetBlendConstant(const WGPUColor &color);
+
+  void SetStencilReference(uint32_t reference);
+
+  void Draw(uint32_t vertex_count, uint32_t instance_count = 1,
+            uint32_t first_vertex = 0, uint32_t first_instance = 0);
+
+  void DrawIndexed(uint32_t index_count, uint32_t instance_count = 1,
+                   uint32_t first_index = 0, int32_t base_vertex = 0,
+                   uint32_t first_instance = 0);
+
+  void End();
+
+  WGPURenderPassEncoder Get() const { return m_encoder; }
+
+  const RenderPassStats &GetStats() const { return m_stats; }
+
+private:
+  struct BindGroupState {
+    WGPUBindGroup group = nullptr;
+    uint32_t offset_count = 0;
+    std::array<uint32_t, kMaxDynamicOffsets> offsets = {};
+  };
+
+  struct BufferState {
+    WGPUBuffer buffer = nullptr;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+  };
+
+private:
+  WGPURenderPassEncoder m_encoder;
+  TraceRecorder *m_recorder;
+
+  WGPURenderPipeline m_pipeline = nullptr;
+  std::array<BindGroupState, kMaxBindGroups> m_bind_groups = {};
+  std::array<BufferState, kMaxVertexBuffers> m_vertex_buffers = {};
+  BufferState m_index_buffer = {};
+  WGPUIndexFormat m_index_format = WGPUIndexFormat_Undefined;
+
+  // dynamic state has a defined default at the beginning of a pass, but not
+  // one the wrapper knows (viewport is the attachment size), so the first
+  // call always goes through
+  bool m_has_viewport = false;
+  std::array<float, 6> m_viewport = {};
+  bool m_has_scissor = false;
+  std::array<uint32_t, 4> m_scissor = {};
+  bool m_has_blend_constant = false;
+  WGPUColor m_blend_constant = {};
+  bool m_has_stencil_reference = false;
+  uint32_t m_stencil_reference = 0;
+
+  RenderPassStats m_stats = {};
+};
+
+} // namespace util
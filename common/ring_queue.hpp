@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace util {
+
+/**
+ * Bounded lock-free multi-producer multi-consumer queue, after Dmitry Vyukov's
+ * bounded MPMC queue.
+ *
+ * Every cell carries a sequence number telling whether it is free for the
+ * producer at a position or filled for the consumer at it, so producers and
+ * consumers only contend on their own counter. Neither side ever blocks or
+ * allocates: TryPush fails when the queue is full, TryPop when it is empty.
+ * Callers that need to wait use BlockingQueue.
+ */
+template <typename T> class RingQueue {
+public:
+  /**
+   * @param capacity rounded up to a power of two
+   */
+  explicit RingQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size *= 2;
+    }
+
+    m_mask = size - 1;
+    m_cells = std::make_unique<Cell[]>(size);
+
+    for (size_t i = 0; i < size; i++) {
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  RingQueue(const RingQueue &) = delete;
+  RingQueue &operator=(const RingQueue &) = delete;
+
+  /**
+   * @return false if the queue is full, value is left untouched
+   */
+  bool TryPush(T &value) {
+    size_t pos = m_tail.load(std::memory_order_relaxed);
+
+    Cell *cell;
+    for (;;) {
+      cell = &m_cells[pos & m_mask];
+
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+      if (diff == 0) {
+        if (m_tail.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // the consumer has not freed the cell of the previous lap yet
+        return false;
+      } else {
+        pos = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  /**
+   * @return false if no item is available right now
+   */
+  bool TryPop(T &value) {
+    size_t pos = m_head.load(std::memory_order_relaxed);
+
+    Cell *cell;
+    for (;;) {
+      cell = &m_cells[pos & m_mask];
+
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+      if (diff == 0) {
+        if (m_head.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_head.load(std::memory_order_relaxed);
+      }
+    }
+
+    value = std::move(cell->value);
+    // free for the producer one lap ahead
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  size_t Capacity() const { return m_mask + 1; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // separate cache lines, producers and consumers do not share one
+  alignas(64) std::atomic<size_t> m_tail = {0};
+  alignas(64) std::atomic<size_t> m_head = {0};
+  alignas(64) size_t m_mask = 0;
+  std::unique_ptr<Cell[]> m_cells;
+};
+
+} // namespace util
@@ -0,0 +1,70 @@
+#include "run_profile.hpp"
+
+#include <cstring>
+
+namespace util {
+
+RunProfile DefaultRunProfile() {
+#ifdef NDEBUG
+  return RunProfile::kProfile;
+#else
+  return RunProfile::kDebug;
+#endif
+}
+
+bool ParseRunProfile(const char *name, RunProfile &profile) {
+  for (auto candidate :
+       {RunProfile::kDebug, RunProfile::kProfile, RunProfile::kRelease}) {
+    if (std::strcmp(name, RunProfileName(candidate)) == 0) {
+      profile = candidate;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const char *RunProfileName(RunProfile profile) {
+  switch (profile) {
+  case RunProfile::kDebug:
+    return "debug";
+  case RunProfile::kProfile:
+    return "profile";
+  case RunProfile::kRelease:
+    return "release";
+  }
+
+  return "unknown";
+}
+
+DeviceToggles::DeviceToggles(RunProfile profile) {
+  switch (profile) {
+  case RunProfile::kDebug:
+    m_enabled.emplace_back("use_user_defined_labels_in_backend");
+    break;
+  case RunProfile::kProfile:
+    m_enabled.emplace_back("use_user_defined_labels_in_backend");
+    // bounds checks injected into every shader
+    m_enabled.emplace_back("disable_robustness");
+    break;
+  case RunProfile::kRelease:
+    m_enabled.emplace_back("skip_validation");
+    m_enabled.emplace_back("disable_robustness");
+    // samples write every resource before reading it
+    m_disabled.emplace_back("lazy_clear_resource_on_first_use");
+    break;
+  }
+}
+
+void DeviceToggles::Chain(WGPUDeviceDescriptor &desc) {
+  m_desc.chain.sType = WGPUSType_DawnTogglesDescriptor;
+  m_desc.chain.next = desc.nextInChain;
+  m_desc.enabledTogglesCount = m_enabled.size();
+  m_desc.enabledToggles = m_enabled.data();
+  m_desc.disabledTogglesCount = m_disabled.size();
+  m_desc.disabledToggles = m_disabled.data();
+
+  desc.nextInChain = &m_desc.chain;
+}
+
+} // namespace util
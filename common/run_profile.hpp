@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+/**
+ * How much checking the device does, traded against CPU time per call.
+ */
+enum class RunProfile {
+  // full validation, labels passed to the backend, error scopes around every
+  // frame
+  kDebug,
+  // full validation and labels for GPU profilers, no robustness transform
+  kProfile,
+  // no validation, no robustness transform, no lazy clearing, only for code
+  // known to be valid
+  kRelease,
+};
+
+/**
+ * kDebug in debug builds, kProfile with NDEBUG.
+ */
+RunProfile DefaultRunProfile();
+
+/**
+ * "debug", "profile" or "release".
+ */
+bool ParseRunProfile(const char *name, RunProfile &profile);
+
+const char *RunProfileName(RunProfile profile);
+
+/**
+ * The Dawn toggles of a profile, chained into the device descriptor. Other
+ * implementations ignore them.
+ */
+class DeviceToggles {
+public:
+  explicit DeviceToggles(RunProfile profile);
+
+  DeviceToggles(const DeviceToggles &) = delete;
+  DeviceToggles &operator=(const DeviceToggles &) = delete;
+
+  /**
+   * `this` has to outlive the device creation.
+   */
+  void Chain(WGPUDeviceDescriptor &desc);
+
+private:
+  std::vector<const char *> m_enabled;
+  std::vector<const char *> m_disabled;
+  WGPUDawnTogglesDescriptor m_desc = {};
+};
+
+} // namespace util
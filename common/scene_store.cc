@@ -0,0 +1,183 @@
+#include "scene_store.hpp"
+#include "frame_trace.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace util {
+
+namespace {
+
+uint32_t CountTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+// first index in [index, end) whose bit is `set`, or end
+uint32_t FindBit(const std::vector<uint64_t> &words, uint32_t index,
+                 uint32_t end, bool set) {
+  while (index < end) {
+    uint64_t word = set ? words[index / 64] : ~words[index / 64];
+    word &= ~uint64_t(0) << (index % 64);
+
+    uint32_t base = index & ~63u;
+
+    if (word != 0) {
+      return std::min(end, base + CountTrailingZeros(word));
+    }
+
+    index = base + 64;
+  }
+
+  return end;
+}
+
+} // namespace
+
+SceneStore::SceneStore(WGPUDevice device, WGPUQueue queue, uint32_t capacity,
+                       TraceRecorder *recorder)
+    : m_device(device), m_queue(queue), m_capacity(capacity),
+      m_recorder(recorder) {}
+
+SceneStore::~SceneStore() {
+  for (auto &component : m_components) {
+    wgpuBufferRelease(component.buffer);
+  }
+}
+
+uint32_t SceneStore::AddComponent(const char *label, uint32_t stride,
+                                  WGPUBufferUsageFlags usage) {
+  assert(stride % 4 == 0);
+
+  Component component{};
+  component.stride = stride;
+  component.data.resize(uint64_t(stride) * m_capacity);
+  component.dirty.resize((m_capacity + 63) / 64);
+
+  WGPUBufferDescriptor desc{};
+  desc.label = label;
+  desc.usage = usage | WGPUBufferUsage_CopyDst;
+  // zero sized buffers can not be bound
+  desc.size = std::max<uint64_t>(component.data.size(), stride);
+
+  component.buffer = wgpuDeviceCreateBuffer(m_device, &desc);
+
+  if (m_recorder) {
+    m_recorder->CreateBuffer(component.buffer, desc);
+  }
+
+  m_components.emplace_back(std::move(component));
+
+  auto index = static_cast<uint32_t>(m_components.size() - 1);
+
+  MarkAllDirty(index);
+
+  return index;
+}
+
+void SceneStore::MarkDirty(uint32_t component, uint32_t first,
+                           uint32_t count) {
+  auto &c = m_components[component];
+
+  uint32_t end = std::min(m_capacity, first + count);
+  if (first >= end) {
+    return;
+  }
+
+  for (uint32_t index = first; index < end;) {
+    uint32_t bit = index % 64;
+    uint32_t bits = std::min(64 - bit, end - index);
+    uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+
+    c.dirty[index / 64] |= mask << bit;
+
+    index += bits;
+  }
+
+  uint32_t first_word = first / 64;
+  uint32_t last_word = (end + 63) / 64;
+
+  if (c.first_word == c.last_word) {
+    c.first_word = first_word;
+    c.last_word = last_word;
+  } else {
+    c.first_word = std::min(c.first_word, first_word);
+    c.last_word = std::max(c.last_word, last_word);
+  }
+}
+
+void SceneStore::MarkAllDirty(uint32_t component) {
+  MarkDirty(component, 0, m_capacity);
+}
+
+SceneUploadStats SceneStore::Upload() {
+  SceneUploadStats stats{};
+
+  for (auto &component : m_components) {
+    Upload(component, stats);
+  }
+
+  return stats;
+}
+
+void SceneStore::Upload(Component &component, SceneUploadStats &stats) {
+  if (component.first_word == component.last_word) {
+    return;
+  }
+
+  uint32_t end = std::min(m_capacity, component.last_word * 64);
+  uint32_t index = component.first_word * 64;
+
+  // clean objects a run may span to reach the next one
+  uint64_t max_gap = m_merge_gap / component.stride;
+
+  // every run of dirty objects, and the gaps merged into it, is one write
+  while ((index = FindBit(component.dirty, index, end, true)) < end) {
+    uint32_t run_end = FindBit(component.dirty, index, end, false);
+    stats.dirty_bytes += uint64_t(run_end - index) * component.stride;
+
+    for (;;) {
+      uint32_t next = FindBit(component.dirty, run_end, end, true);
+      if (next == end || next - run_end > max_gap) {
+        break;
+      }
+
+      uint32_t next_end = FindBit(component.dirty, next, end, false);
+      stats.dirty_bytes += uint64_t(next_end - next) * component.stride;
+      run_end = next_end;
+    }
+
+    uint64_t offset = uint64_t(index) * component.stride;
+    uint64_t size = uint64_t(run_end - index) * component.stride;
+
+    wgpuQueueWriteBuffer(m_queue, component.buffer, offset,
+                         component.data.data() + offset, size);
+
+    if (m_recorder) {
+      m_recorder->WriteBuffer(component.buffer, offset,
+                              component.data.data() + offset, size);
+    }
+
+    stats.bytes += size;
+    stats.writes++;
+
+    index = run_end;
+  }
+
+  std::fill(component.dirty.begin() + component.first_word,
+            component.dirty.begin() + component.last_word, 0);
+
+  component.first_word = 0;
+  component.last_word = 0;
+}
+
+} // namespace util
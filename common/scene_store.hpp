@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+class TraceRecorder;
+
+/**
+ * What one SceneStore::Upload wrote.
+ */
+struct SceneUploadStats {
+  // written, including the clean objects between merged runs
+  uint64_t bytes = 0;
+  // of changed objects only
+  uint64_t dirty_bytes = 0;
+  // wgpuQueueWriteBuffer calls
+  uint32_t writes = 0;
+};
+
+/**
+ * Per object scene data kept as one array per component, each backed by a
+ * GPU buffer of the same layout.
+ *
+ * Changes are tracked per object and component in a bitmap. Upload writes
+ * only the byte ranges of objects changed since the last upload, so the bytes
+ * uploaded follow the number of changed objects instead of the scene size.
+ * Runs of changed objects at most the merge gap apart are written
+ * with one wgpuQueueWriteBuffer, as copying a few clean objects along costs
+ * less than another call once changes are scattered.
+ *
+ * Buffers and writes are reported to `recorder` when one is given.
+ */
+class SceneStore {
+public:
+  // in bytes, 16 4x4 float matrices
+  static constexpr uint64_t kDefaultMergeGap = 1024;
+
+  SceneStore(WGPUDevice device, WGPUQueue queue, uint32_t capacity,
+             TraceRecorder *recorder = nullptr);
+
+  ~SceneStore();
+
+  SceneStore(const SceneStore &) = delete;
+  SceneStore &operator=(const SceneStore &) = delete;
+
+  /**
+   * Add an array of `stride` bytes per object, zero initialized and marked
+   * dirty. CopyDst is added to `usage`.
+   *
+   * @param stride   a multiple of 4, as wgpuQueueWriteBuffer requires
+   * @return the component index
+   */
+  uint32_t AddComponent(const char *label, uint32_t stride,
+                        WGPUBufferUsageFlags usage);
+
+  uint32_t GetCapacity() const { return m_capacity; }
+
+  WGPUBuffer GetBuffer(uint32_t component) const {
+    return m_components[component].buffer;
+  }
+
+  /**
+   * Size of the whole component buffer in bytes.
+   */
+  uint64_t GetSize(uint32_t component) const {
+    return uint64_t(m_components[component].stride) * m_capacity;
+  }
+
+  /**
+   * CPU copy of a component. Writes through it need a MarkDirty.
+   */
+  template <typename T> T *Data(uint32_t component) {
+    assert(sizeof(T) == m_components[component].stride);
+    return reinterpret_cast<T *>(m_components[component].data.data());
+  }
+
+  template <typename T>
+  void Set(uint32_t component, uint32_t index, const T &value) {
+    Data<T>(component)[index] = value;
+    MarkDirty(component, index);
+  }
+
+  void MarkDirty(uint32_t component, uint32_t first, uint32_t count = 1);
+
+  void MarkAllDirty(uint32_t component);
+
+  /**
+   * Merge runs of changed objects at most `bytes` apart, 0 merges only
+   * adjacent ones.
+   */
+  void SetMergeGap(uint64_t bytes) { m_merge_gap = bytes; }
+
+  /**
+   * Write every dirty range into the component buffers.
+   */
+  SceneUploadStats Upload();
+
+private:
+  struct Component {
+    uint32_t stride = 0;
+    WGPUBuffer buffer = nullptr;
+    std::vector<uint8_t> data;
+    // one bit per object
+    std::vector<uint64_t> dirty;
+    // dirty words are within [first_word, last_word)
+    uint32_t first_word = 0;
+    uint32_t last_word = 0;
+  };
+
+  void Upload(Component &component, SceneUploadStats &stats);
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+  uint32_t m_capacity;
+  TraceRecorder *m_recorder;
+  uint64_t m_merge_gap = kDefaultMergeGap;
+
+  std::vector<Component> m_components;
+};
+
+} // namespace util
@@ -0,0 +1,95 @@
+#include "shader_library.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+
+namespace util {
+
+namespace embedded {
+
+// generated by webgpu_embed_shaders for util itself, a static library would
+// drop a source nothing refers to
+void RegisterShaders_util();
+
+} // namespace embedded
+
+namespace {
+
+struct ShaderLibrary {
+  ShaderLibrary() {
+    if (auto env = std::getenv("WEBGPU_SHADER_DIR")) {
+      directory = env;
+    }
+  }
+
+  std::mutex mutex;
+  std::unordered_map<std::string, const EmbeddedShader *> embedded;
+  std::string directory;
+  // read from the directory, never replaced so the sources stay valid
+  std::unordered_map<std::string, std::string> overrides;
+};
+
+ShaderLibrary &Library() {
+  static ShaderLibrary library;
+  return library;
+}
+
+} // namespace
+
+void RegisterShaders(const EmbeddedShader *shaders, size_t count) {
+  auto &library = Library();
+  std::lock_guard<std::mutex> lock(library.mutex);
+
+  for (size_t i = 0; i < count; i++) {
+    library.embedded.emplace(shaders[i].name, &shaders[i]);
+  }
+}
+
+const char *GetShader(const std::string &name) {
+  static std::once_flag util_shaders;
+  std::call_once(util_shaders, &embedded::RegisterShaders_util);
+
+  auto &library = Library();
+  std::lock_guard<std::mutex> lock(library.mutex);
+
+  auto loaded = library.overrides.find(name);
+  if (loaded != library.overrides.end()) {
+    return loaded->second.c_str();
+  }
+
+  if (!library.directory.empty()) {
+    auto path = std::filesystem::path(library.directory) / name;
+
+    std::ifstream file(path);
+    if (file.is_open()) {
+      std::string content((std::istreambuf_iterator<char>(file)),
+                          (std::istreambuf_iterator<char>()));
+
+      spdlog::info("shader {} read from {}", name, path.string());
+
+      return library.overrides.emplace(name, std::move(content))
+          .first->second.c_str();
+    }
+  }
+
+  auto it = library.embedded.find(name);
+  if (it == library.embedded.end()) {
+    spdlog::error("no shader {}", name);
+    return "";
+  }
+
+  return it->second->source;
+}
+
+void SetShaderDirectory(std::string directory) {
+  auto &library = Library();
+  std::lock_guard<std::mutex> lock(library.mutex);
+
+  library.directory = std::move(directory);
+}
+
+} // namespace util
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace util {
+
+struct EmbeddedShader {
+  // file name, without directory
+  const char *name;
+  // NUL terminated WGSL
+  const char *source;
+  size_t size;
+};
+
+/**
+ * Make `shaders` available to GetShader. Called by the sources
+ * webgpu_embed_shaders generates, the first registration of a name wins.
+ */
+void RegisterShaders(const EmbeddedShader *shaders, size_t count);
+
+/**
+ * The WGSL source of the shader file `name`, as embedded into the binary at
+ * build time. Thread safe.
+ *
+ * @return NUL terminated, valid for the rest of the process, empty if there
+ *         is no shader of that name
+ */
+const char *GetShader(const std::string &name);
+
+/**
+ * Files in `directory` take precedence over the embedded shaders, to edit
+ * shaders without rebuilding. Each file is read once, on its first lookup.
+ * Defaults to the WEBGPU_SHADER_DIR environment variable, empty turns it off.
+ */
+void SetShaderDirectory(std::string directory);
+
+} // namespace util
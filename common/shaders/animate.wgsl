@@ -0,0 +1,46 @@
+// Evaluates one transform per object from its animation parameters, so only
+// the time has to be uploaded every frame.
+
+struct Animation {
+  pivot: vec2<f32>,
+  // radians at time 0
+  angle: f32,
+  // radians per second
+  speed: f32,
+  scale: f32,
+  pad0: f32,
+  pad1: f32,
+  pad2: f32,
+};
+
+struct Frame {
+  time: f32,
+  count: u32,
+  pad0: u32,
+  pad1: u32,
+};
+
+@group(0) @binding(0) var<uniform> frame: Frame;
+@group(0) @binding(1) var<storage, read> animations: array<Animation>;
+@group(0) @binding(2) var<storage, read_write> transforms: array<mat4x4<f32>>;
+
+// translate(pivot) * rotate_z(angle) * scale, same as
+// TransformAnimator::Evaluate
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id: vec3<u32>) {
+  if (id.x >= frame.count) {
+    return;
+  }
+
+  let animation = animations[id.x];
+
+  let angle = animation.angle + animation.speed * frame.time;
+  let c = cos(angle) * animation.scale;
+  let s = sin(angle) * animation.scale;
+
+  transforms[id.x] = mat4x4<f32>(
+      vec4<f32>(c, s, 0.0, 0.0),
+      vec4<f32>(-s, c, 0.0, 0.0),
+      vec4<f32>(0.0, 0.0, animation.scale, 0.0),
+      vec4<f32>(animation.pivot, 0.0, 1.0));
+}
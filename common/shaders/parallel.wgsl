@@ -0,0 +1,195 @@
+// Parallel primitives over arrays of u32.
+//
+// Every workgroup handles one block of BLOCK_SIZE elements, two per
+// invocation, and keeps it in workgroup memory. Arrays longer than one block
+// are handled by the host, which runs the kernels again on the per block
+// results.
+
+const WORKGROUP_SIZE: u32 = 256u;
+const BLOCK_SIZE: u32 = 512u;
+
+struct Params {
+  count: u32,
+  // scan_blocks: 0 exclusive, 1 inclusive
+  inclusive: u32,
+  // compaction keeps values less than this
+  threshold: u32,
+  pad: u32,
+};
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read> input: array<u32>;
+@group(0) @binding(2) var<storage, read_write> output: array<u32>;
+// one value per block: block totals, or scanned offsets when adding them back
+@group(0) @binding(3) var<storage, read_write> aux: array<u32>;
+@group(0) @binding(4) var<storage, read_write> total: array<u32>;
+
+var<workgroup> shared_data: array<u32, BLOCK_SIZE>;
+
+fn load(index: u32) -> u32 {
+  if (index < params.count) {
+    return input[index];
+  }
+
+  return 0u;
+}
+
+fn keep(value: u32) -> bool {
+  return value < params.threshold;
+}
+
+// output[block] = sum of the block
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn reduce(@builtin(local_invocation_index) local_index: u32,
+          @builtin(workgroup_id) group_id: vec3<u32>) {
+  let base = group_id.x * BLOCK_SIZE;
+
+  // first level of the tree is done while loading
+  let index = base + local_index;
+  shared_data[local_index] = load(index) + load(index + WORKGROUP_SIZE);
+
+  workgroupBarrier();
+
+  for (var stride = WORKGROUP_SIZE / 2u; stride > 0u; stride = stride / 2u) {
+    if (local_index < stride) {
+      shared_data[local_index] =
+          shared_data[local_index] + shared_data[local_index + stride];
+    }
+
+    workgroupBarrier();
+  }
+
+  if (local_index == 0u) {
+    output[group_id.x] = shared_data[0];
+  }
+}
+
+// work efficient (Blelloch) scan of one block, aux[block] = block total
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scan_blocks(@builtin(local_invocation_index) local_index: u32,
+               @builtin(workgroup_id) group_id: vec3<u32>) {
+  let base = group_id.x * BLOCK_SIZE;
+  let a = 2u * local_index;
+  let b = a + 1u;
+
+  let value_a = load(base + a);
+  let value_b = load(base + b);
+
+  shared_data[a] = value_a;
+  shared_data[b] = value_b;
+
+  // up-sweep, builds partial sums in place
+  var offset = 1u;
+  for (var d = BLOCK_SIZE / 2u; d > 0u; d = d / 2u) {
+    workgroupBarrier();
+
+    if (local_index < d) {
+      let ai = offset * (2u * local_index + 1u) - 1u;
+      let bi = offset * (2u * local_index + 2u) - 1u;
+      shared_data[bi] = shared_data[bi] + shared_data[ai];
+    }
+
+    offset = offset * 2u;
+  }
+
+  workgroupBarrier();
+
+  if (local_index == 0u) {
+    aux[group_id.x] = shared_data[BLOCK_SIZE - 1u];
+    shared_data[BLOCK_SIZE - 1u] = 0u;
+  }
+
+  // down-sweep, turns the partial sums into an exclusive scan
+  for (var d = 1u; d < BLOCK_SIZE; d = d * 2u) {
+    offset = offset / 2u;
+
+    workgroupBarrier();
+
+    if (local_index < d) {
+      let ai = offset * (2u * local_index + 1u) - 1u;
+      let bi = offset * (2u * local_index + 2u) - 1u;
+      let t = shared_data[ai];
+      shared_data[ai] = shared_data[bi];
+      shared_data[bi] = shared_data[bi] + t;
+    }
+  }
+
+  workgroupBarrier();
+
+  var result_a = shared_data[a];
+  var result_b = shared_data[b];
+
+  if (params.inclusive != 0u) {
+    result_a = result_a + value_a;
+    result_b = result_b + value_b;
+  }
+
+  if (base + a < params.count) {
+    output[base + a] = result_a;
+  }
+
+  if (base + b < params.count) {
+    output[base + b] = result_b;
+  }
+}
+
+// output += scanned block totals, one workgroup per block of scan_blocks
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn add_block_sums(@builtin(local_invocation_index) local_index: u32,
+                  @builtin(workgroup_id) group_id: vec3<u32>) {
+  let base = group_id.x * BLOCK_SIZE;
+  let sum = aux[group_id.x];
+
+  for (var i = 0u; i < 2u; i = i + 1u) {
+    let index = base + local_index + i * WORKGROUP_SIZE;
+
+    if (index < params.count) {
+      output[index] = output[index] + sum;
+    }
+  }
+}
+
+// output = 1 for the values compaction keeps, 0 otherwise
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn compact_flags(@builtin(local_invocation_index) local_index: u32,
+                 @builtin(workgroup_id) group_id: vec3<u32>) {
+  let base = group_id.x * BLOCK_SIZE;
+
+  for (var i = 0u; i < 2u; i = i + 1u) {
+    let index = base + local_index + i * WORKGROUP_SIZE;
+
+    if (index < params.count) {
+      output[index] = select(0u, 1u, keep(input[index]));
+    }
+  }
+}
+
+// aux holds the exclusive scan of the flags, which is the destination of
+// every kept value, total[0] = number of kept values
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn compact_scatter(@builtin(local_invocation_index) local_index: u32,
+                   @builtin(workgroup_id) group_id: vec3<u32>) {
+  let base = group_id.x * BLOCK_SIZE;
+
+  // the host still dispatches one workgroup for an empty input
+  if (params.count == 0u && group_id.x == 0u && local_index == 0u) {
+    total[0] = 0u;
+  }
+
+  for (var i = 0u; i < 2u; i = i + 1u) {
+    let index = base + local_index + i * WORKGROUP_SIZE;
+
+    if (index < params.count) {
+      let value = input[index];
+      let kept = keep(value);
+
+      if (kept) {
+        output[aux[index]] = value;
+      }
+
+      if (index == params.count - 1u) {
+        total[0] = aux[index] + select(0u, 1u, kept);
+      }
+    }
+  }
+}
@@ -0,0 +1,18 @@
+// Workload of the adapter probe: every invocation loads one vec4, runs a
+// chain of dependent multiply-adds on it and stores it back.
+
+@group(0) @binding(0) var<storage, read_write> data: array<vec4<f32>>;
+
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id: vec3<u32>) {
+  if (id.x >= arrayLength(&data)) {
+    return;
+  }
+
+  var value = data[id.x];
+  for (var i = 0u; i < 64u; i = i + 1u) {
+    value = value * 0.999 + vec4<f32>(0.001);
+  }
+
+  data[id.x] = value;
+}
@@ -0,0 +1,166 @@
+#include "staging_belt.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+StagingBelt::StagingBelt(WGPUDevice device, WGPUQueue queue,
+                         uint64_t chunk_size, uint32_t max_chunks)
+    : m_device(device), m_queue(queue),
+      m_chunk_size(std::max<uint64_t>(4, chunk_size & ~uint64_t(3))),
+      m_max_chunks(std::max(1u, max_chunks)) {}
+
+StagingBelt::~StagingBelt() {
+  Finish();
+
+  for (auto &chunk : m_chunks) {
+    wgpuBufferRelease(chunk->buffer);
+  }
+}
+
+void StagingBelt::Write(WGPUBuffer dst, uint64_t offset, const void *data,
+                        uint64_t size) {
+  assert(offset % 4 == 0 && size % 4 == 0);
+
+  auto src = static_cast<const uint8_t *>(data);
+
+  while (size > 0) {
+    if (m_current == nullptr || m_current->used == m_chunk_size) {
+      m_current = AcquireChunk();
+      m_used.emplace_back(m_current);
+    }
+
+    uint64_t length = std::min(size, m_chunk_size - m_current->used);
+
+    std::memcpy(m_current->mapped + m_current->used, src, length);
+
+    m_copies.emplace_back(
+        Copy{m_current, m_current->used, dst, offset, length});
+
+    m_current->used += length;
+    m_bytes_uploaded += length;
+
+    src += length;
+    offset += length;
+    size -= length;
+  }
+}
+
+void StagingBelt::Flush() {
+  if (m_copies.empty()) {
+    return;
+  }
+
+  // mapped buffers can not be used in a submit
+  for (auto chunk : m_used) {
+    wgpuBufferUnmap(chunk->buffer);
+    chunk->mapped = nullptr;
+  }
+
+  auto encoder = wgpuDeviceCreateCommandEncoder(m_device, nullptr);
+
+  for (const auto &copy : m_copies) {
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, copy.chunk->buffer,
+                                         copy.src_offset, copy.dst,
+                                         copy.dst_offset, copy.size);
+  }
+
+  auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+  wgpuCommandEncoderRelease(encoder);
+
+  wgpuQueueSubmit(m_queue, 1, &cmd);
+  wgpuCommandBufferRelease(cmd);
+
+  m_submit_count++;
+
+  // map again, the callback fires once the GPU is done reading the chunk
+  for (auto chunk : m_used) {
+    chunk->pending = true;
+    chunk->used = 0;
+
+    wgpuBufferMapAsync(chunk->buffer, WGPUMapMode_Write, 0, m_chunk_size,
+                       &MapCallback, chunk);
+  }
+
+  m_used.clear();
+  m_copies.clear();
+  m_current = nullptr;
+}
+
+void StagingBelt::Finish() {
+  Flush();
+
+  auto pending = [this] {
+    return std::any_of(m_chunks.begin(), m_chunks.end(),
+                       [](const auto &chunk) { return chunk->pending; });
+  };
+
+  while (pending()) {
+    wgpuDeviceTick(m_device);
+  }
+}
+
+StagingBelt::Chunk *StagingBelt::AcquireChunk() {
+  for (;;) {
+    // drop chunks which failed to map again, a new one will replace them
+    m_chunks.erase(std::remove_if(m_chunks.begin(), m_chunks.end(),
+                                  [](const auto &chunk) {
+                                    if (chunk->pending ||
+                                        chunk->mapped != nullptr) {
+                                      return false;
+                                    }
+                                    wgpuBufferRelease(chunk->buffer);
+                                    return true;
+                                  }),
+                   m_chunks.end());
+
+    for (auto &chunk : m_chunks) {
+      if (!chunk->pending && chunk->used == 0) {
+        return chunk.get();
+      }
+    }
+
+    if (m_chunks.size() < m_max_chunks) {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Staging chunk";
+      desc.usage = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc;
+      desc.size = m_chunk_size;
+      desc.mappedAtCreation = true;
+
+      auto chunk = std::make_unique<Chunk>();
+      chunk->buffer = wgpuDeviceCreateBuffer(m_device, &desc);
+      chunk->mapped = static_cast<uint8_t *>(
+          wgpuBufferGetMappedRange(chunk->buffer, 0, m_chunk_size));
+
+      m_chunks.emplace_back(std::move(chunk));
+
+      return m_chunks.back().get();
+    }
+
+    // every chunk is in use, submit what was recorded so far and wait for the
+    // GPU to hand one back
+    Flush();
+
+    wgpuDeviceTick(m_device);
+  }
+}
+
+void StagingBelt::MapCallback(WGPUBufferMapAsyncStatus status,
+                              void *userdata) {
+  auto chunk = static_cast<Chunk *>(userdata);
+
+  chunk->pending = false;
+
+  if (status != WGPUBufferMapAsyncStatus_Success) {
+    spdlog::error("staging chunk map failed: {}", static_cast<int>(status));
+    return;
+  }
+
+  chunk->mapped = static_cast<uint8_t *>(
+      wgpuBufferGetMappedRange(chunk->buffer, 0, WGPU_WHOLE_MAP_SIZE));
+}
+
+} // namespace util
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <webgpu/webgpu.h>
+
+namespace util {
+
+/**
+ * Upload data through a bounded ring of mapped staging buffers.
+ *
+ * Instead of one wgpuQueueWriteBuffer per resource, which makes Dawn allocate
+ * an internal staging copy as large as the data, data is copied into
+ * MapWrite | CopySrc buffers of `chunk_size` bytes and transferred with
+ * copyBufferToBuffer. At most `max_chunks` buffers exist at the same time, so
+ * uploading hundreds of MB never needs more than
+ * `chunk_size * max_chunks` bytes of staging memory.
+ *
+ * Offsets and sizes must be multiples of 4, as copyBufferToBuffer requires.
+ */
+class StagingBelt {
+public:
+  StagingBelt(WGPUDevice device, WGPUQueue queue, uint64_t chunk_size,
+              uint32_t max_chunks);
+
+  ~StagingBelt();
+
+  StagingBelt(const StagingBelt &) = delete;
+  StagingBelt &operator=(const StagingBelt &) = delete;
+
+  /**
+   * Copy `size` bytes into `dst` at `offset`, data larger than a chunk is
+   * split. The copy is visible to the GPU after the next Flush.
+   *
+   * May block when all chunks are in flight until one is mapped again.
+   */
+  void Write(WGPUBuffer dst, uint64_t offset, const void *data, uint64_t size);
+
+  /**
+   * Submit every recorded copy and start re-mapping the used chunks.
+   */
+  void Flush();
+
+  /**
+   * Flush and wait until every chunk is mapped again, after this all uploaded
+   * data is on the GPU.
+   */
+  void Finish();
+
+  uint64_t GetBytesUploaded() const { return m_bytes_uploaded; }
+
+  uint32_t GetSubmitCount() const { return m_submit_count; }
+
+private:
+  struct Chunk {
+    WGPUBuffer buffer = nullptr;
+    uint8_t *mapped = nullptr;
+    uint64_t used = 0;
+    // still waiting the map callback
+    bool pending = false;
+  };
+
+  struct Copy {
+    Chunk *chunk;
+    uint64_t src_offset;
+    WGPUBuffer dst;
+    uint64_t dst_offset;
+    uint64_t size;
+  };
+
+  Chunk *AcquireChunk();
+
+  static void MapCallback(WGPUBufferMapAsyncStatus status, void *userdata);
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+  uint64_t m_chunk_size;
+  uint32_t m_max_chunks;
+
+  std::vector<std::unique_ptr<Chunk>> m_chunks;
+  // chunk being filled
+  Chunk *m_current = nullptr;
+  // chunks filled since last flush
+  std::vector<Chunk *> m_used;
+  std::vector<Copy> m_copies;
+
+  uint64_t m_bytes_uploaded = 0;
+  uint32_t m_submit_count = 0;
+};
+
+} // namespace util
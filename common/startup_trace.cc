@@ -0,0 +1,85 @@
+#include "startup_trace.hpp"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace util {
+
+StartupTrace::Scope::Scope(StartupTrace *trace, const char *name,
+                           bool background)
+    : m_trace(trace), m_name(name), m_background(background),
+      m_start(trace->Now()) {}
+
+StartupTrace::Scope::~Scope() {
+  m_trace->Add({m_name, m_start, m_trace->Now() - m_start, m_background});
+}
+
+StartupTrace::StartupTrace() : m_start(Clock::now()) {}
+
+void StartupTrace::Reset() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_start = Clock::now();
+  m_phases.clear();
+  m_finished = false;
+  m_total = 0.0;
+}
+
+void StartupTrace::Finish(const char *last_phase) {
+  if (m_finished) {
+    return;
+  }
+
+  m_total = Now();
+  m_finished = true;
+
+  double last_end = 0.0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &phase : m_phases) {
+      if (!phase.background) {
+        last_end = std::max(last_end, phase.start + phase.duration);
+      }
+    }
+  }
+
+  Add({last_phase, last_end, m_total - last_end, false});
+
+  auto phases = GetPhases();
+
+  spdlog::info("startup: {:.1f} ms to first present", m_total);
+
+  for (const auto &phase : phases) {
+    spdlog::info("  {:<16} {:8.2f} ms at {:8.2f} ms{}", phase.name,
+                 phase.duration, phase.start,
+                 phase.background ? " (background)" : "");
+  }
+}
+
+std::vector<StartupPhase> StartupTrace::GetPhases() const {
+  std::vector<StartupPhase> phases;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    phases = m_phases;
+  }
+
+  std::stable_sort(phases.begin(), phases.end(),
+                   [](const StartupPhase &a, const StartupPhase &b) {
+                     return a.start < b.start;
+                   });
+
+  return phases;
+}
+
+double StartupTrace::Now() const {
+  return std::chrono::duration<double, std::milli>(Clock::now() - m_start)
+      .count();
+}
+
+void StartupTrace::Add(StartupPhase phase) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_phases.emplace_back(std::move(phase));
+}
+
+} // namespace util
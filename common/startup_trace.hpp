@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace util {
+
+struct StartupPhase {
+  std::string name;
+  // milliseconds since the trace started
+  double start = 0.0;
+  double duration = 0.0;
+  // ran on a worker thread, overlapping the main thread phases
+  bool background = false;
+};
+
+/**
+ * Breaks the time to the first presented frame down by startup phase.
+ * Phases may be recorded from any thread.
+ */
+class StartupTrace {
+public:
+  class Scope {
+  public:
+    Scope(StartupTrace *trace, const char *name, bool background);
+
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    StartupTrace *m_trace;
+    const char *m_name;
+    bool m_background;
+    double m_start;
+  };
+
+  StartupTrace();
+
+  /**
+   * Start over, phase times are relative to this call.
+   */
+  void Reset();
+
+  /**
+   * Record a phase from now until the returned scope is destroyed.
+   */
+  Scope Phase(const char *name, bool background = false) {
+    return Scope{this, name, background};
+  }
+
+  /**
+   * End the trace at the first presented frame and log the breakdown.
+   *
+   * @param last_phase   name of the phase from the end of the latest main
+   *                     thread phase until now
+   */
+  void Finish(const char *last_phase);
+
+  bool IsFinished() const { return m_finished; }
+
+  // milliseconds from Reset to Finish
+  double GetTotal() const { return m_total; }
+
+  std::vector<StartupPhase> GetPhases() const;
+
+private:
+  double Now() const;
+
+  void Add(StartupPhase phase);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point m_start;
+  mutable std::mutex m_mutex;
+  std::vector<StartupPhase> m_phases;
+  bool m_finished = false;
+  double m_total = 0.0;
+};
+
+} // namespace util
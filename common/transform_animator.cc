@@ -0,0 +1,145 @@
+#include "transform_animator.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace util {
+
+namespace {
+
+constexpr uint32_t kWorkgroupSize = 64;
+
+} // namespace
+
+TransformAnimator::TransformAnimator(
+    WGPUDevice device, WGPUQueue queue,
+    const std::vector<TransformAnimation> &animations)
+    : m_device(device), m_queue(queue),
+      m_count(static_cast<uint32_t>(animations.size())) {
+  // frame uniform, the only per frame upload
+  {
+    WGPUBufferDescriptor desc{};
+    desc.label = "Animation frame";
+    desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+    desc.size = sizeof(Frame);
+
+    m_frame = wgpuDeviceCreateBuffer(m_device, &desc);
+  }
+
+  // animation parameters, uploaded once
+  {
+    WGPUBufferDescriptor desc{};
+    desc.label = "Animations";
+    desc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+    desc.size = std::max(m_count, 1u) * sizeof(TransformAnimation);
+
+    m_animations = wgpuDeviceCreateBuffer(m_device, &desc);
+
+    if (m_count > 0) {
+      wgpuQueueWriteBuffer(m_queue, m_animations, 0, animations.data(),
+                           animations.size() * sizeof(TransformAnimation));
+    }
+  }
+
+  {
+    WGPUBufferDescriptor desc{};
+    desc.label = "Transforms";
+    desc.usage = WGPUBufferUsage_Storage;
+    desc.size = std::max(m_count, 1u) * sizeof(glm::mat4);
+
+    m_transforms = wgpuDeviceCreateBuffer(m_device, &desc);
+  }
+
+  InitPipeline();
+}
+
+TransformAnimator::~TransformAnimator() {
+  wgpuBindGroupRelease(m_group);
+  wgpuBufferRelease(m_frame);
+  wgpuBufferRelease(m_animations);
+  wgpuBufferRelease(m_transforms);
+}
+
+void TransformAnimator::Update(WGPUCommandEncoder encoder, float time) {
+  Frame frame{};
+  frame.time = time;
+  frame.count = m_count;
+
+  wgpuQueueWriteBuffer(m_queue, m_frame, 0, &frame, sizeof(Frame));
+
+  auto pass = wgpuCommandEncoderBeginComputePass(encoder, nullptr);
+
+  m_kernel.Dispatch(pass, m_group, 0, nullptr,
+                    ComputeKernel::GroupCount(m_count, kWorkgroupSize));
+
+  wgpuComputePassEncoderEnd(pass);
+  wgpuComputePassEncoderRelease(pass);
+}
+
+glm::mat4 TransformAnimator::Evaluate(const TransformAnimation &animation,
+                                      float time) {
+  float angle = animation.angle + animation.speed * time;
+  float c = std::cos(angle) * animation.scale;
+  float s = std::sin(angle) * animation.scale;
+
+  glm::mat4 m(1.f);
+  m[0] = {c, s, 0.f, 0.f};
+  m[1] = {-s, c, 0.f, 0.f};
+  m[2] = {0.f, 0.f, animation.scale, 0.f};
+  m[3] = {animation.pivot, 0.f, 1.f};
+
+  return m;
+}
+
+void TransformAnimator::InitPipeline() {
+  const char *raw_shader = GetShader("animate.wgsl");
+
+  WGPUShaderModule shader = nullptr;
+  {
+    WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+    wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+    wgsl_desc.code = raw_shader;
+
+    WGPUShaderModuleDescriptor desc{};
+    desc.label = "Animate shader";
+
+    desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+    shader = wgpuDeviceCreateShaderModule(m_device, &desc);
+  }
+
+  // layout derived from the shader
+  m_kernel = ComputeKernel(m_device, shader, "cs_main", nullptr);
+
+  wgpuShaderModuleRelease(shader);
+
+  std::array<WGPUBindGroupEntry, 3> entries{};
+
+  entries[0].binding = 0;
+  entries[0].buffer = m_frame;
+  entries[0].size = sizeof(Frame);
+
+  entries[1].binding = 1;
+  entries[1].buffer = m_animations;
+  entries[1].size = WGPU_WHOLE_SIZE;
+
+  entries[2].binding = 2;
+  entries[2].buffer = m_transforms;
+  entries[2].size = WGPU_WHOLE_SIZE;
+
+  auto layout = wgpuComputePipelineGetBindGroupLayout(m_kernel.Get(), 0);
+
+  WGPUBindGroupDescriptor desc{};
+  desc.label = "Animate group";
+  desc.layout = layout;
+  desc.entryCount = entries.size();
+  desc.entries = entries.data();
+
+  m_group = wgpuDeviceCreateBindGroup(m_device, &desc);
+
+  wgpuBindGroupLayoutRelease(layout);
+}
+
+} // namespace util
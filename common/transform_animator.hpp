@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <webgpu/webgpu.h>
+
+#include "compute_kernel.hpp"
+
+namespace util {
+
+/**
+ * Animation of one object, a rotation around the z axis at a constant speed.
+ * Laid out like `Animation` in animate.wgsl.
+ */
+struct TransformAnimation {
+  glm::vec2 pivot = {};
+  // radians at time 0
+  float angle = 0.f;
+  // radians per second
+  float speed = 0.f;
+  float scale = 1.f;
+  float pad[3] = {};
+};
+
+static_assert(sizeof(TransformAnimation) == 32,
+              "must match the WGSL array stride");
+
+/**
+ * Generates the transforms of many animated objects on the GPU.
+ *
+ * The animation parameters are uploaded once. Every frame Update writes the
+ * 16 byte time uniform and records a compute pass that evaluates all
+ * matrices into GetTransforms(), a storage buffer which the vertex shader
+ * indexes with the instance index.
+ */
+class TransformAnimator {
+public:
+  TransformAnimator(WGPUDevice device, WGPUQueue queue,
+                    const std::vector<TransformAnimation> &animations);
+
+  ~TransformAnimator();
+
+  TransformAnimator(const TransformAnimator &) = delete;
+  TransformAnimator &operator=(const TransformAnimator &) = delete;
+
+  /**
+   * Record the compute pass evaluating every transform at `time` seconds.
+   */
+  void Update(WGPUCommandEncoder encoder, float time);
+
+  /**
+   * Storage buffer of GetCount() mat4.
+   */
+  WGPUBuffer GetTransforms() const { return m_transforms; }
+
+  uint32_t GetCount() const { return m_count; }
+
+  /**
+   * The same math on the CPU.
+   */
+  static glm::mat4 Evaluate(const TransformAnimation &animation, float time);
+
+private:
+  struct Frame {
+    float time = 0.f;
+    uint32_t count = 0;
+    uint32_t pad[2] = {};
+  };
+
+  void InitPipeline();
+
+private:
+  WGPUDevice m_device;
+  WGPUQueue m_queue;
+  uint32_t m_count;
+
+  WGPUBuffer m_frame = nullptr;
+  WGPUBuffer m_animations = nullptr;
+  WGPUBuffer m_transforms = nullptr;
+
+  ComputeKernel m_kernel;
+  WGPUBindGroup m_group = nullptr;
+};
+
+} // namespace util
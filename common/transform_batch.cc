@@ -0,0 +1,347 @@
+#include "transform_batch.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define UTIL_TRANSFORM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows every intrinsic without a target attribute
+#if defined(UTIL_TRANSFORM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define UTIL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define UTIL_TARGET_AVX2
+#endif
+
+namespace util {
+
+namespace {
+
+void BuildScalar(const TransformSoA &soa, uint32_t begin, uint32_t end,
+                 float *out) {
+  for (uint32_t i = begin; i < end; i++) {
+    float qx = soa.rotation[0][i];
+    float qy = soa.rotation[1][i];
+    float qz = soa.rotation[2][i];
+    float qw = soa.rotation[3][i];
+
+    float xx = qx * qx;
+    float yy = qy * qy;
+    float zz = qz * qz;
+    float xy = qx * qy;
+    float xz = qx * qz;
+    float yz = qy * qz;
+    float wx = qw * qx;
+    float wy = qw * qy;
+    float wz = qw * qz;
+
+    float sx = soa.scale[0][i];
+    float sy = soa.scale[1][i];
+    float sz = soa.scale[2][i];
+
+    float *m = out + i * 16;
+
+    m[0] = (1.f - 2.f * (yy + zz)) * sx;
+    m[1] = (2.f * (xy + wz)) * sx;
+    m[2] = (2.f * (xz - wy)) * sx;
+    m[3] = 0.f;
+
+    m[4] = (2.f * (xy - wz)) * sy;
+    m[5] = (1.f - 2.f * (xx + zz)) * sy;
+    m[6] = (2.f * (yz + wx)) * sy;
+    m[7] = 0.f;
+
+    m[8] = (2.f * (xz + wy)) * sz;
+    m[9] = (2.f * (yz - wx)) * sz;
+    m[10] = (1.f - 2.f * (xx + yy)) * sz;
+    m[11] = 0.f;
+
+    m[12] = soa.position[0][i];
+    m[13] = soa.position[1][i];
+    m[14] = soa.position[2][i];
+    m[15] = 1.f;
+  }
+}
+
+#ifdef UTIL_TRANSFORM_X86
+
+// SSE2 is part of x86-64, this path needs no detection
+uint32_t BuildSSE(const TransformSoA &soa, uint32_t count, float *out) {
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 two = _mm_set1_ps(2.f);
+
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 qx = _mm_loadu_ps(soa.rotation[0] + i);
+    __m128 qy = _mm_loadu_ps(soa.rotation[1] + i);
+    __m128 qz = _mm_loadu_ps(soa.rotation[2] + i);
+    __m128 qw = _mm_loadu_ps(soa.rotation[3] + i);
+
+    __m128 xx = _mm_mul_ps(qx, qx);
+    __m128 yy = _mm_mul_ps(qy, qy);
+    __m128 zz = _mm_mul_ps(qz, qz);
+    __m128 xy = _mm_mul_ps(qx, qy);
+    __m128 xz = _mm_mul_ps(qx, qz);
+    __m128 yz = _mm_mul_ps(qy, qz);
+    __m128 wx = _mm_mul_ps(qw, qx);
+    __m128 wy = _mm_mul_ps(qw, qy);
+    __m128 wz = _mm_mul_ps(qw, qz);
+
+    __m128 sx = _mm_loadu_ps(soa.scale[0] + i);
+    __m128 sy = _mm_loadu_ps(soa.scale[1] + i);
+    __m128 sz = _mm_loadu_ps(soa.scale[2] + i);
+
+    // one register per matrix element, one lane per instance
+    __m128 c0[4] = {
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+        _mm_setzero_ps(),
+    };
+    __m128 c1[4] = {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+        _mm_setzero_ps(),
+    };
+    __m128 c2[4] = {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+        _mm_setzero_ps(),
+    };
+    __m128 c3[4] = {
+        _mm_loadu_ps(soa.position[0] + i),
+        _mm_loadu_ps(soa.position[1] + i),
+        _mm_loadu_ps(soa.position[2] + i),
+        one,
+    };
+
+    __m128 *columns[4] = {c0, c1, c2, c3};
+
+    float *m = out + i * 16;
+
+    // after the transpose register k holds the column of instance k
+    for (uint32_t c = 0; c < 4; c++) {
+      __m128 *r = columns[c];
+
+      _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+      for (uint32_t k = 0; k < 4; k++) {
+        _mm_storeu_ps(m + k * 16 + c * 4, r[k]);
+      }
+    }
+  }
+
+  return i;
+}
+
+// the 4x4 transposes of both 128 bit halves, the low half of result k
+// belongs to instance k, the high half to instance k + 4
+UTIL_TARGET_AVX2 void Transpose8(const __m256 rows[4], __m256 result[4]) {
+  __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+  __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+  __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+  __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+
+  result[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  result[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  result[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  result[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// two columns of the same instance are next to each other in the output,
+// so every store writes 32 bytes
+UTIL_TARGET_AVX2 void StoreColumns(const __m256 first[4],
+                                   const __m256 second[4], float *out) {
+  __m256 a[4];
+  __m256 b[4];
+
+  Transpose8(first, a);
+  Transpose8(second, b);
+
+  for (uint32_t k = 0; k < 4; k++) {
+    _mm256_storeu_ps(out + k * 16, _mm256_permute2f128_ps(a[k], b[k], 0x20));
+    _mm256_storeu_ps(out + (k + 4) * 16,
+                     _mm256_permute2f128_ps(a[k], b[k], 0x31));
+  }
+}
+
+UTIL_TARGET_AVX2 uint32_t BuildAVX2(const TransformSoA &soa, uint32_t count,
+                                    float *out) {
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 two = _mm256_set1_ps(2.f);
+  const __m256 zero = _mm256_setzero_ps();
+
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 qx = _mm256_loadu_ps(soa.rotation[0] + i);
+    __m256 qy = _mm256_loadu_ps(soa.rotation[1] + i);
+    __m256 qz = _mm256_loadu_ps(soa.rotation[2] + i);
+    __m256 qw = _mm256_loadu_ps(soa.rotation[3] + i);
+
+    __m256 xx = _mm256_mul_ps(qx, qx);
+    __m256 yy = _mm256_mul_ps(qy, qy);
+    __m256 zz = _mm256_mul_ps(qz, qz);
+    __m256 xy = _mm256_mul_ps(qx, qy);
+    __m256 xz = _mm256_mul_ps(qx, qz);
+    __m256 yz = _mm256_mul_ps(qy, qz);
+    __m256 wx = _mm256_mul_ps(qw, qx);
+    __m256 wy = _mm256_mul_ps(qw, qy);
+    __m256 wz = _mm256_mul_ps(qw, qz);
+
+    __m256 sx = _mm256_loadu_ps(soa.scale[0] + i);
+    __m256 sy = _mm256_loadu_ps(soa.scale[1] + i);
+    __m256 sz = _mm256_loadu_ps(soa.scale[2] + i);
+
+    __m256 c0[4] = {
+        _mm256_mul_ps(
+            _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))),
+            sx),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+        zero,
+    };
+    __m256 c1[4] = {
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+        _mm256_mul_ps(
+            _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))),
+            sy),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+        zero,
+    };
+    __m256 c2[4] = {
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+        _mm256_mul_ps(
+            _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))),
+            sz),
+        zero,
+    };
+    __m256 c3[4] = {
+        _mm256_loadu_ps(soa.position[0] + i),
+        _mm256_loadu_ps(soa.position[1] + i),
+        _mm256_loadu_ps(soa.position[2] + i),
+        one,
+    };
+
+    float *m = out + i * 16;
+
+    StoreColumns(c0, c1, m);
+    StoreColumns(c2, c3, m + 8);
+  }
+
+  return i;
+}
+
+bool HasAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // the OS has to save the ymm registers as well
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  // also checks that the OS saves the ymm registers
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // UTIL_TRANSFORM_X86
+
+SimdLevel DetectSimdLevel() {
+#ifdef UTIL_TRANSFORM_X86
+  return HasAVX2() ? SimdLevel::kAVX2 : SimdLevel::kSSE;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+} // namespace
+
+SimdLevel GetSimdLevel() {
+  static SimdLevel level = DetectSimdLevel();
+
+  return level;
+}
+
+const char *SimdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::kScalar:
+    return "scalar";
+  case SimdLevel::kSSE:
+    return "sse";
+  case SimdLevel::kAVX2:
+    return "avx2";
+  default:
+    return "unknown";
+  }
+}
+
+void TransformArrays::Resize(uint32_t count) {
+  for (auto &component : position) {
+    component.resize(count, 0.f);
+  }
+
+  for (uint32_t i = 0; i < 4; i++) {
+    rotation[i].resize(count, i == 3 ? 1.f : 0.f);
+  }
+
+  for (auto &component : scale) {
+    component.resize(count, 1.f);
+  }
+}
+
+TransformSoA TransformArrays::View() const {
+  TransformSoA soa{};
+
+  for (uint32_t i = 0; i < 3; i++) {
+    soa.position[i] = position[i].data();
+    soa.scale[i] = scale[i].data();
+  }
+
+  for (uint32_t i = 0; i < 4; i++) {
+    soa.rotation[i] = rotation[i].data();
+  }
+
+  return soa;
+}
+
+void BuildTransforms(const TransformSoA &soa, uint32_t count, glm::mat4 *out,
+                     SimdLevel level) {
+  auto *data = reinterpret_cast<float *>(out);
+
+  level = std::min(level, GetSimdLevel());
+
+  uint32_t done = 0;
+
+#ifdef UTIL_TRANSFORM_X86
+  if (level == SimdLevel::kAVX2) {
+    done = BuildAVX2(soa, count, data);
+  } else if (level == SimdLevel::kSSE) {
+    done = BuildSSE(soa, count, data);
+  }
+#endif
+
+  // the instances which do not fill a whole register
+  BuildScalar(soa, done, count, data);
+}
+
+} // namespace util
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace util {
+
+/**
+ * Instruction sets BuildTransforms can use, in increasing order.
+ */
+enum class SimdLevel {
+  kScalar,
+  // 4 instances per iteration
+  kSSE,
+  // 8 instances per iteration
+  kAVX2,
+};
+
+/**
+ * The best level the running CPU supports, detected once.
+ */
+SimdLevel GetSimdLevel();
+
+const char *SimdLevelName(SimdLevel level);
+
+/**
+ * Transform components of many instances, one array per component.
+ * Rotations are unit quaternions.
+ */
+struct TransformSoA {
+  // x, y, z
+  std::array<const float *, 3> position = {};
+  // x, y, z, w
+  std::array<const float *, 4> rotation = {};
+  // x, y, z
+  std::array<const float *, 3> scale = {};
+};
+
+/**
+ * Storage for TransformSoA.
+ */
+struct TransformArrays {
+  std::array<std::vector<float>, 3> position;
+  std::array<std::vector<float>, 4> rotation;
+  std::array<std::vector<float>, 3> scale;
+
+  /**
+   * New instances start at the origin, unrotated and with a scale of 1.
+   */
+  void Resize(uint32_t count);
+
+  uint32_t GetCount() const {
+    return static_cast<uint32_t>(position[0].size());
+  }
+
+  TransformSoA View() const;
+};
+
+/**
+ * out[i] = translate(position) * mat4_cast(rotation) * scale(scale), the
+ * matrix glm builds, for `count` instances.
+ *
+ * The output is packed column major mat4 as WGSL expects it, so it can be
+ * uploaded as is. The SIMD paths produce the same values as the scalar one
+ * up to rounding.
+ *
+ * @param level   clamped to GetSimdLevel()
+ */
+void BuildTransforms(const TransformSoA &soa, uint32_t count, glm::mat4 *out,
+                     SimdLevel level = GetSimdLevel());
+
+} // namespace util
@@ -1,6 +1,10 @@
 
 #include "utils.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
 namespace util {
@@ -8,15 +12,130 @@ namespace util {
 // implement in platform file
 WGPUSurface platform_get_surface(GLFWwindow *window, WGPUInstance ins);
 
-App::App(std::string title, uint32_t width, uint32_t height)
-    : m_title(std::move(title)), m_width(width), m_height(height) {}
+namespace {
 
-void App::Run() {
-  Init();
+// in seconds, how often an idle on-demand loop ticks the device
+constexpr double kOnDemandTickInterval = 0.1;
+
+// userdata of one popped frame error scope, freed by its callback
+struct FrameError {
+  App *app;
+  uint64_t frame;
+};
+
+} // namespace
+
+App::App(std::string title, uint32_t width, uint32_t height,
+         AdapterChoice adapter)
+    : m_title(std::move(title)), m_width(width), m_height(height),
+      m_adapter_choice(std::move(adapter)) {}
+
+bool App::Run(const AppOptions &options) {
+  m_options = options;
+
+  if (!m_options.capture.empty() || !m_options.capture_video.empty()) {
+    // frames are read back from the offscreen target
+    m_options.headless = true;
+  }
+
+  if (m_options.capture_video == "-") {
+    // stdout carries the video
+    spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+  }
+
+  if (m_options.headless && m_options.frames == 0) {
+    // nothing would ever stop a headless run
+    m_options.frames = 300;
+  }
+
+  if (!m_options.shader_dir.empty()) {
+    // before OnPreload, which reads the shaders
+    SetShaderDirectory(m_options.shader_dir);
+  }
+
+  m_startup.Reset();
+  m_bench.BeginInit();
+
+  if (!Init()) {
+    if (m_preload.valid()) {
+      m_preload.wait();
+    }
+    ReleaseInstance();
+    return false;
+  }
+
+  m_bench.EndInit();
 
   Loop();
 
+  if (!m_options.bench_json.empty()) {
+    WriteBench();
+  }
+
   Terminal();
+
+  return true;
+}
+
+AppOptions App::ParseOptions(int &argc, const char **argv) {
+  AppOptions options{};
+
+  int count = 1;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      options.headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      options.frames =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--bench-json") == 0 && i + 1 < argc) {
+      options.bench_json = argv[++i];
+    } else if (std::strcmp(argv[i], "--fallback-adapter") == 0) {
+      options.fallback_adapter = true;
+    } else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      options.capture = argv[++i];
+    } else if (std::strcmp(argv[i], "--capture-video") == 0 &&
+               i + 1 < argc) {
+      options.capture_video = argv[++i];
+    } else if (std::strcmp(argv[i], "--capture-raw") == 0) {
+      options.capture_raw = true;
+    } else if (std::strcmp(argv[i], "--capture-frame") == 0 && i + 1 < argc) {
+      options.capture_frame = std::strtoll(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--adapter") == 0 && i + 1 < argc) {
+      options.adapter = argv[++i];
+    } else if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+      options.cache_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+      options.cache_size =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--no-cache") == 0) {
+      options.no_cache = true;
+    } else if (std::strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc) {
+      options.shader_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--loop") == 0 && i + 1 < argc) {
+      LoopMode mode;
+      if (ParseLoopMode(argv[++i], mode)) {
+        options.loop_mode = mode;
+      } else {
+        spdlog::warn("unknown loop mode {}", argv[i]);
+      }
+    } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+      options.fps = std::strtod(argv[++i], nullptr);
+      if (!options.loop_mode) {
+        options.loop_mode = LoopMode::kCapped;
+      }
+    } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      if (!ParseRunProfile(argv[++i], options.profile)) {
+        spdlog::warn("unknown profile {}, using {}", argv[i],
+                     RunProfileName(options.profile));
+      }
+    } else {
+      argv[count++] = argv[i];
+    }
+  }
+
+  argc = count;
+
+  return options;
 }
 
 std::string App::ReadFile(std::string path) {
@@ -30,57 +149,136 @@ std::string App::ReadFile(std::string path) {
   return content;
 }
 
-void App::Init() {
-  // init window
-  glfwInit();
-  // no need OpenGL api
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  // disable resize since recreate pipeline is not ready
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-  // window
-  m_window =
-      glfwCreateWindow(m_width, m_height, m_title.c_str(), nullptr, nullptr);
+bool App::Init() {
+  // device independent loading overlaps the adapter and device requests
+  m_preload = std::async(std::launch::async, [this] {
+    auto phase = m_startup.Phase("preload", true);
+    OnPreload();
+  });
+
+  if (!m_options.headless) {
+    auto phase = m_startup.Phase("window");
+    // init window
+    glfwInit();
+    // no need OpenGL api
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    // disable resize since recreate pipeline is not ready
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    // window
+    m_window =
+        glfwCreateWindow(m_width, m_height, m_title.c_str(), nullptr, nullptr);
+  }
 
   // init wgpu instance
   {
+    auto phase = m_startup.Phase("instance");
     WGPUInstanceDescriptor desc{};
+
+    auto cache_dir = m_options.cache_dir.empty()
+                         ? PipelineCache::DefaultDirectory()
+                         : m_options.cache_dir;
+
+    if (!m_options.no_cache && !cache_dir.empty()) {
+      m_pipeline_cache = std::make_unique<PipelineCache>(
+          cache_dir, uint64_t(m_options.cache_size) << 20);
+      m_pipeline_cache->ChainInstance(desc);
+    }
+
     m_ins = wgpuCreateInstance(&desc);
   }
 
   // init wgpu surface from this window
-  m_surface = platform_get_surface(m_window, m_ins);
+  if (m_window) {
+    auto phase = m_startup.Phase("surface");
+    m_surface = platform_get_surface(m_window, m_ins);
+  }
 
   // request adatper
   {
-    WGPURequestAdapterOptions opts{};
+    auto phase = m_startup.Phase("adapter");
+    // the command line wins over what the sample asks for
+    auto choice = m_options.adapter.empty()
+                      ? m_adapter_choice
+                      : AdapterChoice::Parse(m_options.adapter);
 
-    opts.compatibleSurface = m_surface;
-    opts.powerPreference = WGPUPowerPreference_Undefined;
-    opts.forceFallbackAdapter = false;
+    m_adapter = SelectAdapter(m_ins, m_surface, choice,
+                              m_options.fallback_adapter);
 
-    // In general the options need to consider some advance constraints such as
-    // powerPerfermance and some prefered backends
-    // But most often, no matter in PC or mobile, there is only one GPU can use.
-    // So choos what adapter we meet in first.
-    wgpuInstanceRequestAdapter(m_ins, &opts, &RequestAdapterCallback, this);
+    if (m_adapter == nullptr) {
+      return false;
+    }
   }
 
   // device
   {
+    auto phase = m_startup.Phase("device");
+    DeviceRequest request{};
+    if (!NegotiateDevice(m_adapter, GetDeviceRequirements(), request)) {
+      return false;
+    }
+
     WGPUDeviceDescriptor desc{};
-    // the device is sampe, most often there is only one GPU
+    request.Apply(desc);
+
+    if (m_pipeline_cache) {
+      m_pipeline_cache->ChainDevice(desc, m_adapter);
+    }
+
+    DeviceToggles toggles(m_options.profile);
+    toggles.Chain(desc);
+
     m_device = wgpuAdapterCreateDevice(m_adapter, &desc);
+    if (m_device == nullptr) {
+      spdlog::error("device creation failed");
+      return false;
+    }
+
+    LogDeviceCapabilities(m_device);
+    spdlog::info("run profile: {}", RunProfileName(m_options.profile));
 
-    wgpuDeviceSetLoggingCallback(m_device, &DeviceLogCallback, nullptr);
-    wgpuDeviceSetUncapturedErrorCallback(m_device, &DeviceErrorCallback,
-                                         nullptr);
+    WGPUSupportedLimits limits{};
+    wgpuDeviceGetLimits(m_device, &limits);
+    m_limits = limits.limits;
 
-    wgpuDevicePushErrorScope(m_device, WGPUErrorFilter_Validation);
+    // backend messages cost a copy per call, release only takes errors
+    m_device_log = std::make_unique<DeviceLog>();
+    m_device_log->Attach(m_device, m_options.profile != RunProfile::kRelease);
   }
   // queue
   m_queue = wgpuDeviceGetQueue(m_device);
-  // swapchain
-  {
+  // render target
+  if (m_options.headless) {
+    auto phase = m_startup.Phase("target");
+    // same size and format as the swapchain, samples do not know the
+    // difference
+    WGPUTextureDescriptor desc{};
+    desc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc;
+    desc.dimension = WGPUTextureDimension_2D;
+    desc.size = {m_width, m_height, 1};
+    desc.format = WGPUTextureFormat_BGRA8Unorm;
+    desc.mipLevelCount = 1;
+    desc.sampleCount = 1;
+
+    m_target = wgpuDeviceCreateTexture(m_device, &desc);
+
+    std::unique_ptr<FrameSink> sink;
+    if (!m_options.capture_video.empty()) {
+      sink = std::make_unique<VideoSink>(
+          m_options.capture_video,
+          m_options.capture_raw ? VideoFormat::kRaw : VideoFormat::kY4M);
+    } else if (!m_options.capture.empty()) {
+      sink = std::make_unique<ImageSequenceSink>(
+          m_options.capture,
+          m_options.capture_raw ? CaptureFormat::kRaw : CaptureFormat::kPng);
+    }
+
+    if (sink) {
+      m_readback = std::make_unique<FrameReadback>(
+          m_device, m_queue, m_width, m_height, desc.format, std::move(sink));
+    }
+  } else {
+    auto phase = m_startup.Phase("swapchain");
+    // swapchain
     WGPUSwapChainDescriptor desc = {};
     desc.usage = WGPUTextureUsage_RenderAttachment;
     desc.format = WGPUTextureFormat_BGRA8Unorm;
@@ -91,63 +289,286 @@ void App::Init() {
     m_swapchain = wgpuDeviceCreateSwapChain(m_device, m_surface, &desc);
   }
 
-  OnInit();
+  {
+    auto phase = m_startup.Phase("preload wait");
+    m_preload.get();
+  }
+
+  {
+    auto phase = m_startup.Phase("OnInit");
+    OnInit();
+  }
+
+  return true;
 }
 
 void App::Loop() {
-  while (!glfwWindowShouldClose(m_window)) {
-    glfwPollEvents();
+  auto mode = m_options.loop_mode.value_or(GetLoopMode());
+  if (mode == LoopMode::kOnDemand && m_window == nullptr) {
+    mode = LoopMode::kContinuous;
+  }
+
+  std::unique_ptr<FramePacer> pacer;
+  if (mode == LoopMode::kCapped) {
+    pacer = std::make_unique<FramePacer>(m_options.fps);
+  }
 
+  if (mode == LoopMode::kOnDemand) {
+    // uncovered or restored windows need their content again
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetWindowRefreshCallback(m_window, [](GLFWwindow *window) {
+      static_cast<App *>(glfwGetWindowUserPointer(window))->Invalidate();
+    });
+  }
+
+  m_timestep = FixedTimestep(GetTimestep());
+
+  auto start = std::chrono::steady_clock::now();
+  double cpu_start = GetProcessCpuTime();
+  m_last_step = start;
+
+  uint32_t frame = 0;
+  while (m_options.frames == 0 || frame < m_options.frames) {
+    if (m_window) {
+      if (glfwWindowShouldClose(m_window)) {
+        break;
+      }
+
+      if (mode == LoopMode::kOnDemand && !m_invalid) {
+        // nothing else ticks the device while idle, map and work done
+        // callbacks would wait for the next input event
+        wgpuDeviceTick(m_device);
+        glfwWaitEventsTimeout(kOnDemandTickInterval);
+      } else {
+        glfwPollEvents();
+      }
+    }
+
+    // cleared first, OnLoop invalidates again to animate
+    if (mode == LoopMode::kOnDemand && !m_invalid.exchange(false)) {
+      continue;
+    }
+
+    RunFrame();
+    frame++;
+
+    if (pacer) {
+      pacer->Wait();
+    }
+  }
+
+  double wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  double cpu = GetProcessCpuTime() - cpu_start;
+
+  double fps = wall > 0.0 ? frame / wall : 0.0;
+  double cpu_percent = wall > 0.0 ? 100.0 * cpu / wall : 0.0;
+
+  spdlog::info("{} loop: {} frames in {:.2f} s, {:.1f} fps, {:.1f}% CPU",
+               LoopModeName(mode), frame, wall, fps, cpu_percent);
+
+  if (m_timestep.GetDroppedSteps() > 0) {
+    spdlog::info("{} simulation steps skipped on long frames",
+                 m_timestep.GetDroppedSteps());
+  }
+
+  m_bench.SetLoop(LoopModeName(mode), fps, cpu_percent);
+}
+
+void App::Invalidate() {
+  m_invalid = true;
+
+  if (m_window) {
+    // wakes glfwWaitEvents, from any thread
+    glfwPostEmptyEvent();
+  }
+}
+
+void App::RunFrame() {
+  if (m_options.bench_json.empty()) {
+    StepSimulation();
+    LoopFrame();
+    return;
+  }
+
+  m_bench.BeginFrame();
+
+  StepSimulation();
+  LoopFrame();
+
+  m_bench.EndFrame();
+
+  auto start = std::chrono::steady_clock::now();
+
+  WaitQueueIdle();
+
+  m_bench.AddGpuTime(std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count());
+}
+
+void App::StepSimulation() {
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - m_last_step).count();
+  m_last_step = now;
+
+  // headless frames advance one step each, captures do not depend on the
+  // machine
+  if (m_window == nullptr) {
+    elapsed = m_timestep.GetStep();
+  }
+
+  for (uint32_t steps = m_timestep.Advance(elapsed); steps > 0; steps--) {
+    OnUpdate(m_timestep.GetStep());
+  }
+}
+
+void App::LoopFrame() {
+  if (m_options.profile != RunProfile::kDebug) {
     OnLoop();
+    m_frame++;
+    return;
+  }
+
+  // popped in reverse, each error is reported by the innermost matching scope
+  wgpuDevicePushErrorScope(m_device, WGPUErrorFilter_OutOfMemory);
+  wgpuDevicePushErrorScope(m_device, WGPUErrorFilter_Validation);
+
+  OnLoop();
+
+  wgpuDevicePopErrorScope(m_device, &FrameErrorCallback,
+                          new FrameError{this, m_frame});
+  wgpuDevicePopErrorScope(m_device, &FrameErrorCallback,
+                          new FrameError{this, m_frame});
+
+  m_frame++;
+}
+
+void App::WaitQueueIdle() {
+  bool done = false;
+
+  wgpuQueueOnSubmittedWorkDone(
+      m_queue, 0,
+      [](WGPUQueueWorkDoneStatus status, void *userdata) {
+        *reinterpret_cast<bool *>(userdata) = true;
+      },
+      &done);
+
+  while (!done) {
+    wgpuDeviceTick(m_device);
+  }
+}
+
+void App::WriteBench() const {
+  WGPUAdapterProperties props{};
+  wgpuAdapterGetProperties(m_adapter, &props);
+
+  std::string adapter = props.name ? props.name : "unknown";
+  if (props.driverDescription && props.driverDescription[0]) {
+    adapter += " (";
+    adapter += props.driverDescription;
+    adapter += ")";
+  }
+
+  if (m_bench.WriteJson(m_options.bench_json, m_title, adapter,
+                       RunProfileName(m_options.profile))) {
+    spdlog::info("bench result written to {}", m_options.bench_json);
+  }
+}
+
+WGPUTextureView App::AcquireTargetView() {
+  if (m_target) {
+    return wgpuTextureCreateView(m_target, nullptr);
+  }
+
+  return wgpuSwapChainGetCurrentTextureView(m_swapchain);
+}
+
+void App::Present() {
+  bool capture = m_options.capture_frame < 0 ||
+                 m_frame == static_cast<uint64_t>(m_options.capture_frame);
+
+  if (m_readback && capture) {
+    m_readback->Capture(m_target, m_frame);
+  }
+
+  if (m_swapchain) {
+    wgpuSwapChainPresent(m_swapchain);
+  }
+
+  if (!m_startup.IsFinished()) {
+    m_startup.Finish("first frame");
+    m_bench.SetStartup(m_startup.GetTotal(), m_startup.GetPhases());
   }
 }
 
 void App::Terminal() {
+  // writes the frames still in flight
+  m_readback.reset();
+
   OnTerminal();
 
+  if (m_target) {
+    wgpuTextureDestroy(m_target);
+    wgpuTextureRelease(m_target);
+  }
+
+  ReleaseInstance();
+}
+
+void App::ReleaseInstance() {
+  if (m_swapchain) {
+    wgpuSwapChainRelease(m_swapchain);
+  }
+  if (m_queue) {
+    wgpuQueueRelease(m_queue);
+  }
+  if (m_device) {
+    wgpuDeviceRelease(m_device);
+  }
+
+  if (m_adapter) {
+    wgpuAdapterRelease(m_adapter);
+  }
+
   // release surface
-  wgpuSurfaceRelease(m_surface);
+  if (m_surface) {
+    wgpuSurfaceRelease(m_surface);
+  }
   // release instance
   wgpuInstanceRelease(m_ins);
 
-  glfwDestroyWindow(m_window);
-
-  glfwTerminate();
-}
+  if (m_device_log) {
+    m_device_log->LogStats();
+    m_device_log.reset();
+  }
 
-void App::RequestAdapterCallback(WGPURequestAdapterStatus status,
-                                 WGPUAdapter adapter, char const *message,
-                                 void *userdata) {
-  if (status != WGPURequestAdapterStatus_Success) {
-    exit(-1);
+  // Dawn stores into the cache until the instance is gone
+  if (m_pipeline_cache) {
+    m_pipeline_cache->GetBlobCache().LogStats();
+    m_pipeline_cache.reset();
   }
 
-  auto app = reinterpret_cast<App *>(userdata);
+  if (m_window) {
+    glfwDestroyWindow(m_window);
 
-  app->m_adapter = adapter;
+    glfwTerminate();
+  }
 }
 
-void App::DeviceLogCallback(WGPULoggingType type, char const *message,
-                            void *userdata) {
-  switch (type) {
-  case WGPULoggingType_Error:
-    spdlog::error("[ {} ]", message);
-    break;
-  case WGPULoggingType_Warning:
-    spdlog::warn("[ {} ]", message);
-    break;
-  case WGPULoggingType_Info:
-    spdlog::info("[ {} ]", message);
-    break;
-  default:
-    spdlog::info("[ {} ]", message);
-    break;
+void App::FrameErrorCallback(WGPUErrorType type, char const *message,
+                             void *userdata) {
+  std::unique_ptr<FrameError> error{static_cast<FrameError *>(userdata)};
+
+  if (type == WGPUErrorType_NoError) {
+    return;
   }
-}
 
-void App::DeviceErrorCallback(WGPUErrorType type, char const *message,
-                              void *userdata) {
-  DeviceLogCallback(WGPULoggingType_Error, message, nullptr);
+  error->app->m_device_log->Push(
+      spdlog::level::err,
+      fmt::format("frame {}: {}", error->frame, message ? message : "")
+          .c_str());
 }
 
 } // namespace util
@@ -1,29 +1,159 @@
 
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <optional>
 #include <string>
 
 #include <glm/glm.hpp>
 #include <webgpu/webgpu.h>
 
+#include "adapter_select.hpp"
+#include "device_log.hpp"
+#include "device_requirements.hpp"
+#include "fixed_timestep.hpp"
+#include "frame_bench.hpp"
+#include "frame_pacer.hpp"
+#include "frame_readback.hpp"
+#include "pipeline_cache.hpp"
+#include "run_profile.hpp"
+#include "shader_library.hpp"
+#include "startup_trace.hpp"
+
 namespace util {
 
+struct AppOptions {
+  // render into an offscreen texture, no window and no surface
+  bool headless = false;
+  // stop after this many frames, 0 runs until the window is closed
+  uint32_t frames = 0;
+  // write init and frame statistics as JSON into this file
+  std::string bench_json;
+  // ask for the software adapter, SwiftShader on Vulkan
+  bool fallback_adapter = false;
+  // write the rendered frames into this directory, implies headless
+  std::string capture;
+  // stream the rendered frames into this file or pipe, implies headless
+  std::string capture_video;
+  // capture raw RGBA8 instead of PNG or Y4M
+  bool capture_raw = false;
+  // capture only this frame, -1 captures every frame
+  int64_t capture_frame = -1;
+  // overrides the adapter choice of the sample, see AdapterChoice::Parse
+  std::string adapter;
+  // compiled shaders and pipelines, empty uses the per user cache directory
+  std::string cache_dir;
+  // in MB, least recently used entries are evicted beyond it
+  uint32_t cache_size = 256;
+  bool no_cache = false;
+  // read shaders from this directory before the embedded ones
+  std::string shader_dir;
+  // device toggles and per frame error scopes
+  RunProfile profile = DefaultRunProfile();
+  // overrides the loop mode of the sample, see App::GetLoopMode
+  std::optional<LoopMode> loop_mode;
+  // frame rate of the capped loop
+  double fps = 60.0;
+};
+
 class App {
 public:
-  App(std::string title, uint32_t width, uint32_t height);
+  App(std::string title, uint32_t width, uint32_t height,
+      AdapterChoice adapter = {});
 
   virtual ~App() = default;
 
-  void Run();
+  /**
+   * @return false if no adapter or device fits the sample
+   */
+  bool Run(const AppOptions &options = {});
 
   static std::string ReadFile(std::string path);
 
+  /**
+   * Parse the options every sample understands:
+   *
+   *   --headless           render offscreen, without window
+   *   --frames N           stop after N frames
+   *   --bench-json PATH    write benchmark results into PATH
+   *   --fallback-adapter   use the software adapter
+   *   --capture DIR        write every frame into DIR, renders headless
+   *   --capture-video PATH stream the frames as Y4M into PATH, "-" is
+   *                        stdout, renders headless
+   *   --capture-raw        write raw RGBA8 frames instead of PNG or Y4M
+   *   --capture-frame N    capture only frame N
+   *   --adapter CHOICE     default, discrete, low-power, fastest or a part
+   *                        of the adapter name
+   *   --cache-dir DIR      keep compiled shaders and pipelines in DIR
+   *   --cache-size MB      evict cache entries beyond MB, default 256
+   *   --no-cache           compile everything from scratch
+   *   --shader-dir DIR     prefer the shaders in DIR to the embedded ones
+   *   --profile PROFILE    debug, profile or release, see RunProfile
+   *   --loop MODE          continuous, capped or on-demand
+   *   --fps N              cap at N frames per second, implies --loop capped
+   *
+   * Recognized options are removed from argv, so the sample only sees its own
+   * arguments.
+   */
+  static AppOptions ParseOptions(int &argc, const char **argv);
+
 protected:
+  /**
+   * Runs on a worker thread while the window, adapter and device are created,
+   * for work that needs no device: reading shaders, decoding assets, building
+   * the scene. OnInit runs after it returned.
+   */
+  virtual void OnPreload() {}
+
   virtual void OnInit() = 0;
 
+  /**
+   * Advance the simulation by `dt` seconds, always GetTimestep(). Runs zero
+   * or more times before each OnLoop, as many steps as the frame time covers,
+   * so the simulation speed does not depend on the frame rate. OnLoop renders
+   * between the last two steps at GetUpdateAlpha().
+   */
+  virtual void OnUpdate(double dt) {}
+
   virtual void OnLoop() = 0;
 
   virtual void OnTerminal() = 0;
 
+  /**
+   * Features and limits the sample needs, asked for before OnInit. Without
+   * an override the device gets the adapter's limits and no features.
+   */
+  virtual DeviceRequirements GetDeviceRequirements() const { return {}; }
+
+  /**
+   * How the sample wants to be redrawn. Samples that draw the same frame over
+   * and over return kOnDemand and call Invalidate when something changed.
+   * Headless runs have no events to wait for and render every frame.
+   */
+  virtual LoopMode GetLoopMode() const { return LoopMode::kContinuous; }
+
+  /**
+   * Ask for a frame in the on-demand loop. Thread safe.
+   */
+  void Invalidate();
+
+  /**
+   * Seconds per OnUpdate step, 60 steps per second by default.
+   */
+  virtual double GetTimestep() const { return 1.0 / 60.0; }
+
+  /**
+   * How far the frame is past the last OnUpdate step, in [0, 1). Render
+   * `mix(previous, current, alpha)` for motion as smooth as the frame rate.
+   */
+  double GetUpdateAlpha() const { return m_timestep.GetAlpha(); }
+
+  /**
+   * Simulated seconds after the last OnUpdate step.
+   */
+  double GetSimulationTime() const { return m_timestep.GetTime(); }
+
   WGPUInstance GetInstance() const { return m_ins; }
 
   WGPUAdapter GetAdapter() const { return m_adapter; }
@@ -36,34 +166,90 @@ protected:
 
   WGPUSwapChain GetSwapChain() const { return m_swapchain; }
 
+  /**
+   * Whether the device was granted `feature`, for optional features.
+   */
+  bool HasFeature(WGPUFeatureName feature) const {
+    return wgpuDeviceHasFeature(m_device, feature);
+  }
+
+  // the limits the device was created with
+  const WGPULimits &GetLimits() const { return m_limits; }
+
+  bool IsHeadless() const { return m_options.headless; }
+
+  /**
+   * The view to render the current frame into, the swapchain texture or the
+   * offscreen target when headless. The caller releases it.
+   */
+  WGPUTextureView AcquireTargetView();
+
+  /**
+   * Show the frame, or hand it to the frame capture. Call after the frame's
+   * last submit.
+   */
+  void Present();
+
+  /**
+   * Block until the GPU finished all work submitted so far.
+   */
+  void WaitQueueIdle();
+
 private:
-  void Init();
+  bool Init();
+
+  void RunFrame();
+
+  /**
+   * The OnUpdate steps due since the last frame.
+   */
+  void StepSimulation();
+
+  /**
+   * OnLoop, inside error scopes in the debug profile.
+   */
+  void LoopFrame();
+
+  void WriteBench() const;
 
   void Loop();
 
   void Terminal();
 
-  static void RequestAdapterCallback(WGPURequestAdapterStatus status,
-                                     WGPUAdapter adapter, char const *message,
-                                     void *userdata);
-
-  static void DeviceLogCallback(WGPULoggingType type, char const *message,
-                                void *userdata);
+  void ReleaseInstance();
 
-  static void DeviceErrorCallback(WGPUErrorType type, char const *message,
-                                  void *userdata);
+  static void FrameErrorCallback(WGPUErrorType type, char const *message,
+                                 void *userdata);
 
 private:
   std::string m_title;
   uint32_t m_width;
   uint32_t m_height;
+  AdapterChoice m_adapter_choice;
   GLFWwindow *m_window = nullptr;
   WGPUInstance m_ins = nullptr;
   WGPUSurface m_surface = nullptr;
   WGPUAdapter m_adapter = nullptr;
   WGPUDevice m_device = nullptr;
   WGPUQueue m_queue = nullptr;
+  WGPULimits m_limits = {};
   WGPUSwapChain m_swapchain = nullptr;
+  // render target when headless
+  WGPUTexture m_target = nullptr;
+
+  AppOptions m_options = {};
+  FrameBench m_bench = {};
+  StartupTrace m_startup = {};
+  std::future<void> m_preload;
+  std::unique_ptr<FrameReadback> m_readback;
+  std::unique_ptr<PipelineCache> m_pipeline_cache;
+  // outlives the device, its callbacks point at it
+  std::unique_ptr<DeviceLog> m_device_log;
+  uint64_t m_frame = 0;
+  // the on-demand loop renders only when set
+  std::atomic<bool> m_invalid = {true};
+  FixedTimestep m_timestep;
+  std::chrono::steady_clock::time_point m_last_step = {};
 };
 
 } // namespace util
@@ -0,0 +1,169 @@
+// Build time WGSL check, run by webgpu_embed_shaders: compiles every file
+// through Dawn's shader module creation, so Tint parses and resolves it
+// exactly as the samples would at runtime, and fails the build on errors.
+// Runs on the Null backend, which WEBGPU_VALIDATE_SHADERS always builds, so
+// no GPU is needed.
+//
+//   wgsl-validate FILE...
+//
+// Links neither util nor its shaders, util depends on it, and builds
+// null_adapter.cc itself.
+
+#include "null_adapter.hpp"
+
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <webgpu/webgpu.h>
+
+namespace {
+
+struct Compilation {
+  bool done = false;
+  uint32_t errors = 0;
+  const char *path = nullptr;
+};
+
+struct Scope {
+  bool done = false;
+  WGPUErrorType type = WGPUErrorType_NoError;
+  std::string message;
+};
+
+void CompilationInfoCallback(WGPUCompilationInfoRequestStatus status,
+                             WGPUCompilationInfo const *info,
+                             void *userdata) {
+  auto compilation = reinterpret_cast<Compilation *>(userdata);
+  compilation->done = true;
+
+  if (status != WGPUCompilationInfoRequestStatus_Success || info == nullptr) {
+    return;
+  }
+
+  for (size_t i = 0; i < info->messageCount; i++) {
+    const auto &message = info->messages[i];
+
+    // the format compilers use, editors jump to it
+    auto text = fmt::format("{}:{}:{}: {}", compilation->path,
+                            message.lineNum, message.linePos,
+                            message.message ? message.message : "");
+
+    switch (message.type) {
+    case WGPUCompilationMessageType_Error:
+      compilation->errors++;
+      spdlog::error("{}", text);
+      break;
+    case WGPUCompilationMessageType_Warning:
+      spdlog::warn("{}", text);
+      break;
+    default:
+      spdlog::info("{}", text);
+      break;
+    }
+  }
+}
+
+void PopErrorScopeCallback(WGPUErrorType type, char const *message,
+                           void *userdata) {
+  auto scope = reinterpret_cast<Scope *>(userdata);
+  scope->done = true;
+  scope->type = type;
+  scope->message = message ? message : "";
+}
+
+bool Validate(WGPUDevice device, const char *path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    spdlog::error("{}: can not read", path);
+    return false;
+  }
+
+  std::string source((std::istreambuf_iterator<char>(file)),
+                     (std::istreambuf_iterator<char>()));
+
+  wgpuDevicePushErrorScope(device, WGPUErrorFilter_Validation);
+
+  WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+  wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+  wgsl_desc.code = source.c_str();
+
+  WGPUShaderModuleDescriptor desc{};
+  desc.label = path;
+  desc.nextInChain = &wgsl_desc.chain;
+
+  auto shader = wgpuDeviceCreateShaderModule(device, &desc);
+
+  Compilation compilation{};
+  compilation.path = path;
+  wgpuShaderModuleGetCompilationInfo(shader, &CompilationInfoCallback,
+                                     &compilation);
+
+  Scope scope{};
+  wgpuDevicePopErrorScope(device, &PopErrorScopeCallback, &scope);
+
+  while (!compilation.done || !scope.done) {
+    wgpuDeviceTick(device);
+  }
+
+  wgpuShaderModuleRelease(shader);
+
+  if (scope.type != WGPUErrorType_NoError && compilation.errors == 0) {
+    // rejected for something other than the WGSL itself
+    spdlog::error("{}: {}", path, scope.message);
+  }
+
+  return scope.type == WGPUErrorType_NoError && compilation.errors == 0;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  if (argc < 2) {
+    spdlog::error("usage: wgsl-validate FILE...");
+    return 2;
+  }
+
+  WGPUInstanceDescriptor instance_desc{};
+  auto instance = wgpuCreateInstance(&instance_desc);
+
+  // failing here fails the build, an unchecked shader would only fail once
+  // a sample runs
+  // not a request, a request for Null returns the default adapter
+  auto adapter = util::RequestNullAdapter(instance);
+  if (adapter == nullptr) {
+    spdlog::error("no Null backend adapter, is Dawn built with "
+                  "DAWN_ENABLE_NULL? Configure with "
+                  "-DWEBGPU_VALIDATE_SHADERS=OFF to skip validation");
+    wgpuInstanceRelease(instance);
+    return 1;
+  }
+
+  WGPUDeviceDescriptor device_desc{};
+  device_desc.label = "wgsl-validate";
+
+  auto device = wgpuAdapterCreateDevice(adapter, &device_desc);
+  if (device == nullptr) {
+    spdlog::error("device creation failed, can not validate WGSL");
+    wgpuAdapterRelease(adapter);
+    wgpuInstanceRelease(instance);
+    return 1;
+  }
+
+  int failed = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!Validate(device, argv[i])) {
+      failed++;
+    }
+  }
+
+  wgpuDeviceRelease(device);
+  wgpuAdapterRelease(adapter);
+  wgpuInstanceRelease(instance);
+
+  if (failed > 0) {
+    spdlog::error("{} of {} shaders invalid", failed, argc - 1);
+    return 1;
+  }
+
+  return 0;
+}
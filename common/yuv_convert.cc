@@ -0,0 +1,262 @@
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define UTIL_YUV_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace util {
+
+namespace {
+
+// BT.601 limited range in 8 bit fixed point
+constexpr int kLuma[3] = {66, 129, 25};
+constexpr int kBlue[3] = {-38, -74, 112};
+constexpr int kRed[3] = {112, -94, -18};
+
+uint8_t Luma(const uint8_t *p) {
+  return static_cast<uint8_t>(
+      ((kLuma[0] * p[0] + kLuma[1] * p[1] + kLuma[2] * p[2] + 128) >> 8) +
+      16);
+}
+
+// the bias keeps the sum positive, the result is the same as rounding down
+uint8_t Chroma(const int coeff[3], const uint8_t *p) {
+  return static_cast<uint8_t>(
+      (coeff[0] * p[0] + coeff[1] * p[1] + coeff[2] * p[2] + 128 + 32768) >>
+      8);
+}
+
+uint8_t Average(uint8_t a, uint8_t b) {
+  return static_cast<uint8_t>((a + b + 1) >> 1);
+}
+
+void LumaRowScalar(const uint8_t *row, uint32_t begin, uint32_t width,
+                   uint8_t *out) {
+  for (uint32_t x = begin; x < width; x++) {
+    out[x] = Luma(row + x * 4);
+  }
+}
+
+// the last column and row are repeated for odd sizes
+void ChromaRowScalar(const uint8_t *row0, const uint8_t *row1, uint32_t begin,
+                     uint32_t width, uint8_t *u, uint8_t *v) {
+  uint32_t chroma_width = (width + 1) / 2;
+
+  for (uint32_t cx = begin; cx < chroma_width; cx++) {
+    uint32_t x0 = cx * 2;
+    uint32_t x1 = std::min(x0 + 1, width - 1);
+
+    // vertical first, the order the SIMD path averages in
+    uint8_t block[3];
+    for (uint32_t c = 0; c < 3; c++) {
+      block[c] = Average(Average(row0[x0 * 4 + c], row1[x0 * 4 + c]),
+                         Average(row0[x1 * 4 + c], row1[x1 * 4 + c]));
+    }
+
+    u[cx] = Chroma(kBlue, block);
+    v[cx] = Chroma(kRed, block);
+  }
+}
+
+#ifdef UTIL_YUV_SSE2
+
+// c0 * R + c1 * G + c2 * B of four RGBA pixels, as 32 bit
+__m128i Dot4(__m128i pixels, __m128i coeff) {
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coeff);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coeff);
+
+  // madd leaves R + G and B + A of each pixel in neighbouring lanes
+  __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+                              _MM_SHUFFLE(3, 1, 3, 1));
+
+  return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+__m128i Coefficients(const int coeff[3]) {
+  return _mm_setr_epi16(coeff[0], coeff[1], coeff[2], 0, coeff[0], coeff[1],
+                        coeff[2], 0);
+}
+
+// 8 pixels per iteration, returns the first pixel not converted
+uint32_t LumaRowSSE2(const uint8_t *row, uint32_t width, uint8_t *out) {
+  const __m128i coeff = Coefficients(kLuma);
+  const __m128i round = _mm_set1_epi32(128);
+  const __m128i offset = _mm_set1_epi16(16);
+
+  uint32_t x = 0;
+  for (; x + 8 <= width; x += 8) {
+    auto pixels = reinterpret_cast<const __m128i *>(row + x * 4);
+
+    __m128i a = Dot4(_mm_loadu_si128(pixels), coeff);
+    __m128i b = Dot4(_mm_loadu_si128(pixels + 1), coeff);
+
+    a = _mm_srai_epi32(_mm_add_epi32(a, round), 8);
+    b = _mm_srai_epi32(_mm_add_epi32(b, round), 8);
+
+    __m128i y = _mm_add_epi16(_mm_packs_epi32(a, b), offset);
+
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x),
+                     _mm_packus_epi16(y, y));
+  }
+
+  return x;
+}
+
+// 4 chroma samples from 8 pixels of two rows per iteration
+uint32_t ChromaRowSSE2(const uint8_t *row0, const uint8_t *row1,
+                       uint32_t width, uint8_t *u, uint8_t *v) {
+  const __m128i blue = Coefficients(kBlue);
+  const __m128i red = Coefficients(kRed);
+  const __m128i round = _mm_set1_epi32(128);
+  const __m128i offset = _mm_set1_epi16(128);
+
+  uint32_t cx = 0;
+  for (; (cx + 4) * 2 <= width; cx += 4) {
+    auto p0 = reinterpret_cast<const __m128i *>(row0 + cx * 8);
+    auto p1 = reinterpret_cast<const __m128i *>(row1 + cx * 8);
+
+    __m128i a = _mm_avg_epu8(_mm_loadu_si128(p0), _mm_loadu_si128(p1));
+    __m128i b = _mm_avg_epu8(_mm_loadu_si128(p0 + 1), _mm_loadu_si128(p1 + 1));
+
+    // even and odd pixels, then their average
+    __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+                                 _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+                                _MM_SHUFFLE(3, 1, 3, 1));
+    __m128i block =
+        _mm_avg_epu8(_mm_castps_si128(even), _mm_castps_si128(odd));
+
+    __m128i us = _mm_srai_epi32(_mm_add_epi32(Dot4(block, blue), round), 8);
+    __m128i vs = _mm_srai_epi32(_mm_add_epi32(Dot4(block, red), round), 8);
+
+    __m128i uv = _mm_add_epi16(_mm_packs_epi32(us, vs), offset);
+    uv = _mm_packus_epi16(uv, uv);
+
+    int32_t packed_u = _mm_cvtsi128_si32(uv);
+    int32_t packed_v = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+
+    std::memcpy(u + cx, &packed_u, 4);
+    std::memcpy(v + cx, &packed_v, 4);
+  }
+
+  return cx;
+}
+
+#endif // UTIL_YUV_SSE2
+
+void Convert(const uint8_t *rgba, uint32_t width, uint32_t height,
+             uint8_t *yuv, bool simd) {
+  if (width == 0 || height == 0) {
+    return;
+  }
+
+  uint32_t chroma_width = (width + 1) / 2;
+  uint32_t chroma_height = (height + 1) / 2;
+
+  uint8_t *y_plane = yuv;
+  uint8_t *u_plane = y_plane + uint64_t(width) * height;
+  uint8_t *v_plane = u_plane + uint64_t(chroma_width) * chroma_height;
+
+  for (uint32_t y = 0; y < height; y++) {
+    const uint8_t *row = rgba + uint64_t(y) * width * 4;
+    uint8_t *out = y_plane + uint64_t(y) * width;
+
+    uint32_t x = 0;
+#ifdef UTIL_YUV_SSE2
+    if (simd) {
+      x = LumaRowSSE2(row, width, out);
+    }
+#endif
+    LumaRowScalar(row, x, width, out);
+  }
+
+  for (uint32_t cy = 0; cy < chroma_height; cy++) {
+    const uint8_t *row0 = rgba + uint64_t(cy * 2) * width * 4;
+    const uint8_t *row1 =
+        rgba + uint64_t(std::min(cy * 2 + 1, height - 1)) * width * 4;
+    uint8_t *u = u_plane + uint64_t(cy) * chroma_width;
+    uint8_t *v = v_plane + uint64_t(cy) * chroma_width;
+
+    uint32_t cx = 0;
+#ifdef UTIL_YUV_SSE2
+    if (simd) {
+      cx = ChromaRowSSE2(row0, row1, width, u, v);
+    }
+#endif
+    ChromaRowScalar(row0, row1, cx, width, u, v);
+  }
+}
+
+} // namespace
+
+uint64_t I420Size(uint32_t width, uint32_t height) {
+  uint64_t chroma = uint64_t((width + 1) / 2) * ((height + 1) / 2);
+
+  return uint64_t(width) * height + chroma * 2;
+}
+
+void RgbaToI420(const uint8_t *rgba, uint32_t width, uint32_t height,
+                uint8_t *yuv) {
+  Convert(rgba, width, height, yuv, true);
+}
+
+void RgbaToI420Scalar(const uint8_t *rgba, uint32_t width, uint32_t height,
+                      uint8_t *yuv) {
+  Convert(rgba, width, height, yuv, false);
+}
+
+bool CheckRgbaToI420() {
+  // luma converts 8 pixels and chroma 4 samples per SIMD iteration, so
+  // widths up to 33 leave every tail for both
+  constexpr uint32_t kMaxWidth = 33;
+  constexpr uint32_t kMaxHeight = 4;
+
+  std::vector<uint8_t> rgba(kMaxWidth * kMaxHeight * 4);
+
+  uint32_t state = 1;
+  for (auto &c : rgba) {
+    state = state * 1664525u + 1013904223u;
+    c = static_cast<uint8_t>(state >> 24);
+  }
+
+  // saturated pixels are where packing and rounding differ first
+  for (size_t i = 0; i < rgba.size(); i += 28) {
+    rgba[i] = 255;
+    rgba[i + 1] = 255;
+    rgba[i + 2] = 255;
+  }
+  for (size_t i = 12; i < rgba.size(); i += 36) {
+    rgba[i] = 0;
+    rgba[i + 1] = 0;
+    rgba[i + 2] = 0;
+  }
+
+  std::vector<uint8_t> simd(I420Size(kMaxWidth, kMaxHeight));
+  std::vector<uint8_t> scalar(simd.size());
+
+  for (uint32_t height = 1; height <= kMaxHeight; height++) {
+    for (uint32_t width = 1; width <= kMaxWidth; width++) {
+      auto size = I420Size(width, height);
+
+      RgbaToI420(rgba.data(), width, height, simd.data());
+      RgbaToI420Scalar(rgba.data(), width, height, scalar.data());
+
+      if (std::memcmp(simd.data(), scalar.data(), size) != 0) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+} // namespace util
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace util {
+
+/**
+ * Bytes of a 4:2:0 frame: a full size Y plane, then quarter size U and V
+ * planes, chroma sizes rounded up.
+ */
+uint64_t I420Size(uint32_t width, uint32_t height);
+
+/**
+ * Convert tightly packed RGBA8 rows into planar 4:2:0 YUV, BT.601 limited
+ * range as Y4M readers expect it. Chroma is the average of each 2x2 block.
+ *
+ * Uses SSE2 when available, the scalar path gives the same bytes.
+ */
+void RgbaToI420(const uint8_t *rgba, uint32_t width, uint32_t height,
+                uint8_t *yuv);
+
+/**
+ * The scalar path alone, the reference CheckRgbaToI420 compares against.
+ */
+void RgbaToI420Scalar(const uint8_t *rgba, uint32_t width, uint32_t height,
+                      uint8_t *yuv);
+
+/**
+ * Compare RgbaToI420 against RgbaToI420Scalar over odd and even sizes that
+ * leave every SIMD tail length, on pixels including the 0 and 255 extremes.
+ *
+ * @return true when both give the same bytes
+ */
+bool CheckRgbaToI420();
+
+} // namespace util
@@ -0,0 +1,421 @@
+#include "parallel_primitives.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+namespace {
+
+enum class Kernel {
+  kReduce,
+  kInclusiveScan,
+  kExclusiveScan,
+  kCompact,
+  kCount,
+};
+
+const char *KernelName(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::kReduce:
+    return "reduce";
+  case Kernel::kInclusiveScan:
+    return "inclusive scan";
+  case Kernel::kExclusiveScan:
+    return "exclusive scan";
+  case Kernel::kCompact:
+    return "compact";
+  default:
+    return "unknown";
+  }
+}
+
+// values are below kMaxValue, compaction keeps about a quarter of them
+constexpr uint32_t kMaxValue = 1024;
+constexpr uint32_t kThreshold = kMaxValue / 4;
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+} // namespace
+
+class ComputePrimitives : public util::App {
+public:
+  explicit ComputePrimitives(uint32_t count)
+      : util::App("Compute Primitives", 800, 800), m_count(count) {}
+
+  ~ComputePrimitives() override = default;
+
+  uint32_t GetFailures() const { return m_failures; }
+
+protected:
+  void OnInit() override {
+    m_primitives = std::make_unique<util::ParallelPrimitives>(
+        GetDevice(), GetQueue(), m_count);
+
+    m_count = m_primitives->GetCapacity();
+
+    InitBuffers();
+
+    Verify();
+
+    // same data for the benchmark, and the CPU numbers to compare with
+    m_data = RandomData(m_count, 1);
+    wgpuQueueWriteBuffer(GetQueue(), m_input, 0, m_data.data(),
+                         m_data.size() * sizeof(uint32_t));
+
+    BenchmarkCPU();
+  }
+
+  void OnLoop() override {
+    auto texture_view = AcquireTargetView();
+
+    Clear(texture_view);
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(Kernel::kCount); i++) {
+      auto start = std::chrono::steady_clock::now();
+
+      RunKernel(static_cast<Kernel>(i), m_count);
+
+      WaitQueueIdle();
+
+      m_gpu_time[i] += Seconds(start);
+    }
+
+    Present();
+
+    wgpuTextureViewRelease(texture_view);
+
+    if (++m_frame % 60 == 0) {
+      for (uint32_t i = 0; i < static_cast<uint32_t>(Kernel::kCount); i++) {
+        double seconds = m_gpu_time[i] / 60.0;
+
+        spdlog::info("{:>15}: {} elements {:.3f} ms {:.1f} M elements/s "
+                     "{:.2f} GB/s",
+                     KernelName(static_cast<Kernel>(i)), m_count,
+                     seconds * 1000.0, m_count / seconds / 1e6,
+                     m_count * sizeof(uint32_t) / seconds / 1e9);
+
+        m_gpu_time[i] = 0.0;
+      }
+    }
+  }
+
+  void OnTerminal() override {
+    m_primitives.reset();
+
+    wgpuBufferRelease(m_input);
+    wgpuBufferRelease(m_output);
+    wgpuBufferRelease(m_result);
+    wgpuBufferRelease(m_readback);
+  }
+
+private:
+  void InitBuffers() {
+    auto create = [this](WGPUBufferUsageFlags usage, uint64_t size) {
+      WGPUBufferDescriptor desc{};
+      desc.usage = usage;
+      desc.size = size;
+
+      return wgpuDeviceCreateBuffer(GetDevice(), &desc);
+    };
+
+    uint64_t size = std::max(m_count, 1u) * sizeof(uint32_t);
+
+    m_input = create(WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst, size);
+    m_output = create(WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc, size);
+    m_result = create(WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc,
+                      sizeof(uint32_t));
+    m_readback =
+        create(WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, size);
+  }
+
+  static std::vector<uint32_t> RandomData(uint32_t count, uint32_t seed) {
+    std::mt19937 rng{seed};
+
+    std::vector<uint32_t> data(count);
+    for (auto &v : data) {
+      v = rng() % kMaxValue;
+    }
+
+    return data;
+  }
+
+  /**
+   * Run every kernel on sizes around the block boundaries and compare with
+   * the result of the standard library.
+   */
+  void Verify() {
+    std::vector<uint32_t> sizes = {0,    1,     511,    512,    513,
+                                   1024, 4097,  262144, 262657, 1000003,
+                                   m_count};
+
+    for (auto count : sizes) {
+      if (count > m_count) {
+        continue;
+      }
+
+      auto data = RandomData(count, count);
+
+      if (count > 0) {
+        wgpuQueueWriteBuffer(GetQueue(), m_input, 0, data.data(),
+                             data.size() * sizeof(uint32_t));
+      }
+
+      // reduce
+      {
+        RunKernel(Kernel::kReduce, count);
+
+        uint32_t expected = std::accumulate(data.begin(), data.end(), 0u);
+
+        Check(Kernel::kReduce, count, ReadBuffer(m_result, 1),
+              std::vector<uint32_t>{expected});
+      }
+
+      // scans
+      {
+        std::vector<uint32_t> expected(count);
+
+        RunKernel(Kernel::kInclusiveScan, count);
+
+        std::partial_sum(data.begin(), data.end(), expected.begin());
+
+        Check(Kernel::kInclusiveScan, count, ReadBuffer(m_output, count),
+              expected);
+
+        RunKernel(Kernel::kExclusiveScan, count);
+
+        std::exclusive_scan(data.begin(), data.end(), expected.begin(), 0u);
+
+        Check(Kernel::kExclusiveScan, count, ReadBuffer(m_output, count),
+              expected);
+      }
+
+      // compaction
+      {
+        RunKernel(Kernel::kCompact, count);
+
+        std::vector<uint32_t> expected;
+        std::copy_if(data.begin(), data.end(), std::back_inserter(expected),
+                     [](uint32_t v) { return v < kThreshold; });
+
+        auto kept = ReadBuffer(m_result, 1);
+
+        if (kept[0] != expected.size()) {
+          spdlog::error("compact n = {}: kept {} values, expected {}", count,
+                        kept[0], expected.size());
+          m_failures++;
+        } else {
+          Check(Kernel::kCompact, count, ReadBuffer(m_output, kept[0]),
+                expected);
+        }
+      }
+    }
+
+    if (m_failures == 0) {
+      spdlog::info("all kernels match the CPU reference");
+    }
+  }
+
+  void Check(Kernel kernel, uint32_t count, const std::vector<uint32_t> &result,
+             const std::vector<uint32_t> &expected) {
+    if (result == expected) {
+      spdlog::info("{} n = {}: ok", KernelName(kernel), count);
+      return;
+    }
+
+    auto mismatch =
+        std::mismatch(result.begin(), result.end(), expected.begin(),
+                      expected.end());
+
+    spdlog::error("{} n = {}: mismatch at {}", KernelName(kernel), count,
+                  mismatch.first - result.begin());
+
+    m_failures++;
+  }
+
+  void BenchmarkCPU() {
+    std::vector<uint32_t> output(m_count);
+
+    std::array<double, static_cast<uint32_t>(Kernel::kCount)> times = {};
+
+    auto start = std::chrono::steady_clock::now();
+    volatile uint32_t sum = std::accumulate(m_data.begin(), m_data.end(), 0u);
+    times[0] = Seconds(start);
+    (void)sum;
+
+    start = std::chrono::steady_clock::now();
+    std::partial_sum(m_data.begin(), m_data.end(), output.begin());
+    times[1] = Seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    std::exclusive_scan(m_data.begin(), m_data.end(), output.begin(), 0u);
+    times[2] = Seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    std::copy_if(m_data.begin(), m_data.end(), output.begin(),
+                 [](uint32_t v) { return v < kThreshold; });
+    times[3] = Seconds(start);
+
+    for (uint32_t i = 0; i < times.size(); i++) {
+      spdlog::info("{:>15} (cpu): {} elements {:.3f} ms {:.1f} M elements/s",
+                   KernelName(static_cast<Kernel>(i)), m_count,
+                   times[i] * 1000.0, m_count / times[i] / 1e6);
+    }
+  }
+
+  void RunKernel(Kernel kernel, uint32_t count) {
+    auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
+    auto pass = wgpuCommandEncoderBeginComputePass(encoder, nullptr);
+
+    switch (kernel) {
+    case Kernel::kReduce:
+      m_primitives->Reduce(pass, m_input, count, m_result);
+      break;
+    case Kernel::kInclusiveScan:
+      m_primitives->InclusiveScan(pass, m_input, m_output, count);
+      break;
+    case Kernel::kExclusiveScan:
+      m_primitives->ExclusiveScan(pass, m_input, m_output, count);
+      break;
+    case Kernel::kCompact:
+      m_primitives->Compact(pass, m_input, count, kThreshold, m_output,
+                            m_result);
+      break;
+    default:
+      break;
+    }
+
+    wgpuComputePassEncoderEnd(pass);
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+
+    wgpuComputePassEncoderRelease(pass);
+    wgpuCommandEncoderRelease(encoder);
+
+    wgpuQueueSubmit(GetQueue(), 1, &cmd);
+
+    wgpuCommandBufferRelease(cmd);
+  }
+
+  std::vector<uint32_t> ReadBuffer(WGPUBuffer buffer, uint32_t count) {
+    std::vector<uint32_t> result(count);
+
+    if (count == 0) {
+      return result;
+    }
+
+    uint64_t size = count * sizeof(uint32_t);
+
+    auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, buffer, 0, m_readback, 0,
+                                         size);
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+    wgpuCommandEncoderRelease(encoder);
+
+    wgpuQueueSubmit(GetQueue(), 1, &cmd);
+    wgpuCommandBufferRelease(cmd);
+
+    struct MapState {
+      bool done = false;
+      WGPUBufferMapAsyncStatus status = WGPUBufferMapAsyncStatus_Unknown;
+    } state;
+
+    wgpuBufferMapAsync(
+        m_readback, WGPUMapMode_Read, 0, size,
+        [](WGPUBufferMapAsyncStatus status, void *userdata) {
+          auto state = reinterpret_cast<MapState *>(userdata);
+          state->status = status;
+          state->done = true;
+        },
+        &state);
+
+    while (!state.done) {
+      wgpuDeviceTick(GetDevice());
+    }
+
+    if (state.status != WGPUBufferMapAsyncStatus_Success) {
+      spdlog::error("map readback buffer failed: {}",
+                    static_cast<uint32_t>(state.status));
+      return result;
+    }
+
+    auto data = reinterpret_cast<const uint32_t *>(
+        wgpuBufferGetConstMappedRange(m_readback, 0, size));
+
+    std::copy(data, data + count, result.begin());
+
+    wgpuBufferUnmap(m_readback);
+
+    return result;
+  }
+
+  void Clear(WGPUTextureView texture_view) {
+    WGPURenderPassColorAttachment colorAttachment = {};
+    colorAttachment.view = texture_view;
+    colorAttachment.clearValue = {0.1f, 0.1f, 0.1f, 1.f};
+    colorAttachment.loadOp = WGPULoadOp_Clear;
+    colorAttachment.storeOp = WGPUStoreOp_Store;
+
+    WGPURenderPassDescriptor renderpassInfo = {};
+    renderpassInfo.colorAttachmentCount = 1;
+    renderpassInfo.colorAttachments = &colorAttachment;
+
+    auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
+    auto pass = wgpuCommandEncoderBeginRenderPass(encoder, &renderpassInfo);
+    wgpuRenderPassEncoderEnd(pass);
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+
+    wgpuRenderPassEncoderRelease(pass);
+    wgpuCommandEncoderRelease(encoder);
+
+    wgpuQueueSubmit(GetQueue(), 1, &cmd);
+
+    wgpuCommandBufferRelease(cmd);
+  }
+
+private:
+  uint32_t m_count;
+  uint32_t m_failures = 0;
+
+  std::unique_ptr<util::ParallelPrimitives> m_primitives;
+
+  WGPUBuffer m_input = nullptr;
+  WGPUBuffer m_output = nullptr;
+  WGPUBuffer m_result = nullptr;
+  WGPUBuffer m_readback = nullptr;
+
+  std::vector<uint32_t> m_data;
+
+  uint64_t m_frame = 0;
+  std::array<double, static_cast<uint32_t>(Kernel::kCount)> m_gpu_time = {};
+};
+
+int main(int argc, const char **argv) {
+  auto options = util::App::ParseOptions(argc, argv);
+
+  uint32_t count = 1 << 22;
+
+  if (argc > 1) {
+    count = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+  }
+
+  ComputePrimitives app{count};
+
+  if (!app.Run(options)) {
+    return -1;
+  }
+
+  return app.GetFailures() == 0 ? 0 : -1;
+}
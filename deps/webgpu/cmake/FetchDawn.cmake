@@ -27,9 +27,14 @@ if(NOT dawn_POPULATED)
 
 	find_package(PythonInterp 3 REQUIRED)
 
+	set(FETCH_DAWN_ARGS)
+	if(WEBGPU_ENABLE_SWIFTSHADER)
+		list(APPEND FETCH_DAWN_ARGS --use-swiftshader)
+	endif()
+
 	message(STATUS "Running fetch_dawn_dependencies:")
 	execute_process(
-		COMMAND ${PYTHON_EXECUTABLE} "${CMAKE_CURRENT_SOURCE_DIR}/tools/fetch_dawn_dependencies.py"
+		COMMAND ${PYTHON_EXECUTABLE} "${CMAKE_CURRENT_SOURCE_DIR}/tools/fetch_dawn_dependencies.py" ${FETCH_DAWN_ARGS}
 		WORKING_DIRECTORY "${CMAKE_BINARY_DIR}/_deps/dawn-src"
 	)
 
@@ -45,10 +50,18 @@ if(NOT dawn_POPULATED)
 	set(DAWN_ENABLE_D3D11 OFF)
 	set(DAWN_ENABLE_D3D12 OFF)
 	set(DAWN_ENABLE_METAL ${USE_METAL})
-	set(DAWN_ENABLE_NULL OFF)
+	# no GPU work, isolates the CPU cost of the API, see api-overhead, and
+	# validates WGSL on machines without GPU, see wgsl-validate
+	if(WEBGPU_ENABLE_NULL OR WEBGPU_VALIDATE_SHADERS)
+		set(DAWN_ENABLE_NULL ON)
+	else()
+		set(DAWN_ENABLE_NULL OFF)
+	endif()
 	set(DAWN_ENABLE_DESKTOP_GL OFF)
 	set(DAWN_ENABLE_OPENGLES OFF)
 	set(DAWN_ENABLE_VULKAN ${USE_VULKAN})
+	# software Vulkan adapter, for machines without GPU
+	set(DAWN_ENABLE_SWIFTSHADER ${WEBGPU_ENABLE_SWIFTSHADER})
 	set(TINT_BUILD_SPV_READER OFF)
 
 	# Disable unneeded parts
@@ -74,6 +74,14 @@ parser.add_argument(
     """
 )
 
+parser.add_argument(
+    '--use-swiftshader', action='store_true', default=False,
+    help="""
+    Fetch SwiftShader, the software Vulkan implementation Dawn uses as its
+    fallback adapter
+    """
+)
+
 def main(args):
     # The dependencies that we need to pull from the DEPS files.
     # Dependencies of dependencies are prefixed by their ancestors.
@@ -95,6 +103,11 @@ def main(args):
             'third_party/googletest',
         ]
 
+    if args.use_swiftshader:
+        required_submodules += [
+            'third_party/swiftshader',
+        ]
+
     root_dir = Path(args.directory).resolve()
 
     process_dir(args, root_dir, required_submodules)
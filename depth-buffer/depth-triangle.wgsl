@@ -5,9 +5,14 @@ struct VertexInput {
 };
 
 struct VertexOutput {
-    @builtin(position) position: vec4<f32>,
+    // the depth pre-pass and the main pass must produce bit identical depth
+    // for the Equal depth test
+    @invariant @builtin(position) position: vec4<f32>,
 };
 
+/// loop count of the fake lighting in fs_shaded, makes overdraw expensive
+const SHADING_ITERATIONS: i32 = 256;
+
 /// transform matrix, used in vertex stage
 @group(0) @binding(0)
 var<uniform> transform: mat4x4<f32>;
@@ -29,3 +34,16 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4<f32> {
     return color;
 }
 
+/// fs_main with an expensive loop, for the overdraw scene
+@fragment
+fn fs_shaded(in: VertexOutput) -> @location(0) vec4<f32> {
+    var shade = 0.0;
+    for (var i = 0; i < SHADING_ITERATIONS; i++) {
+        shade += sin(in.position.x * 0.01 + f32(i)) * cos(in.position.y * 0.01 - f32(i));
+    }
+
+    // stays close to the original color, the loop only has to cost something
+    let factor = 0.9 + 0.1 * clamp(shade / f32(SHADING_ITERATIONS), -1.0, 1.0);
+    return vec4<f32>(color.rgb * factor, color.a);
+}
+
@@ -1,8 +1,14 @@
 
+#include "render_pass_encoder.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <spdlog/spdlog.h>
 #include <vector>
 
 uint32_t next_offset(uint32_t curr, uint32_t size, uint32_t align) {
@@ -17,9 +23,22 @@ uint32_t next_offset(uint32_t curr, uint32_t size, uint32_t align) {
   return tail + delta;
 }
 
+// number of overlapping triangles of the overdraw scene, enough to make
+// overdraw visible in the frame time
+constexpr uint32_t kOverdrawTriangles = 64;
+
 class DepthBuffer : public util::App {
 public:
-  DepthBuffer() : util::App("Depth Buffer", 800, 800) {}
+  /**
+   * @param prepass  lay down depth in a depth only pass first, then shade
+   *                 with depthCompare Equal
+   * @param sort     draw front to back instead of the generated order
+   * @param overdraw many overlapping triangles with an expensive fragment
+   *                 shader instead of the two triangles, to compare the modes
+   */
+  DepthBuffer(bool prepass, bool sort, bool overdraw)
+      : util::App("Depth Buffer", 800, 800), m_prepass(prepass), m_sort(sort),
+        m_overdraw(overdraw) {}
 
   ~DepthBuffer() override = default;
 
@@ -31,14 +50,25 @@ protected:
   }
 
   void OnLoop() override {
+    auto start = std::chrono::steady_clock::now();
 
-    auto texture_view = wgpuSwapChainGetCurrentTextureView(GetSwapChain());
+    auto texture_view = AcquireTargetView();
 
     auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
 
+    if (m_prepass) {
+      // depth only, costs one vertex pass and no fragment shading
+      auto depth_pass = BeginDepthPass(encoder);
+
+      Draw(depth_pass, m_prepass_pipeline);
+
+      wgpuRenderPassEncoderEnd(depth_pass);
+      wgpuRenderPassEncoderRelease(depth_pass);
+    }
+
     auto render_pass = BeginRenderPass(texture_view, encoder);
 
-    Draw(render_pass);
+    Draw(render_pass, m_prepass ? m_equal_pipeline : m_pipeline);
 
     wgpuRenderPassEncoderEnd(render_pass);
 
@@ -48,18 +78,26 @@ protected:
     wgpuCommandEncoderRelease(encoder);
 
     wgpuQueueSubmit(GetQueue(), 1, &cmd);
-    wgpuSwapChainPresent(GetSwapChain());
+    Present();
 
     wgpuCommandBufferRelease(cmd);
     wgpuTextureViewRelease(texture_view);
+
+    LogFrameTime(start);
   }
 
   void OnTerminal() override {
+    for (auto &draw : m_draws) {
+      wgpuBindGroupRelease(draw.group);
+    }
+
     wgpuBufferRelease(m_vertex_buffer);
     wgpuBufferRelease(m_matrix_buffer);
 
     wgpuBindGroupLayoutRelease(m_group0_layout);
     wgpuRenderPipelineRelease(m_pipeline);
+    wgpuRenderPipelineRelease(m_prepass_pipeline);
+    wgpuRenderPipelineRelease(m_equal_pipeline);
     wgpuPipelineLayoutRelease(m_pipeline_layout);
 
     wgpuTextureViewRelease(m_depth_attachment);
@@ -91,13 +129,12 @@ private:
       auto device = GetDevice();
       // first need to calculate buffer size with uniform buffer offset
       // https://www.w3.org/TR/webgpu/#dom-supported-limits-minuniformbufferoffsetalignment
-      WGPUSupportedLimits limits{};
-      wgpuDeviceGetLimits(device, &limits);
+      auto offset = GetLimits().minUniformBufferOffsetAlignment;
 
-      auto offset = limits.limits.minUniformBufferOffsetAlignment;
+      InitDraws();
 
       /**
-       * We use one buffer for two draw call, the buffer layout is:
+       * We use one buffer for all draw calls, the buffer layout is:
        *
        *      1 - matrix
        *       align offset
@@ -106,19 +143,16 @@ private:
        *      2 - matrix
        *       align offset
        *      2 - color
+       *       ...
        */
+      uint32_t tail = 0;
+      for (auto &draw : m_draws) {
+        draw.matrix_offset = tail;
+        draw.color_offset =
+            next_offset(draw.matrix_offset, sizeof(glm::mat4), offset);
 
-      // calculate offsets
-      m_offset_1_matrix = 0;
-      m_offset_1_color =
-          next_offset(m_offset_1_matrix, sizeof(glm::mat4), offset);
-      m_offset_2_matrix =
-          next_offset(m_offset_1_color, sizeof(glm::vec4), offset);
-      m_offset_2_color =
-          next_offset(m_offset_2_matrix, sizeof(glm::mat4), offset);
-
-      // size of this g-buffer
-      uint32_t tail = next_offset(m_offset_2_color, sizeof(glm::vec4), offset);
+        tail = next_offset(draw.color_offset, sizeof(glm::vec4), offset);
+      }
 
       WGPUBufferDescriptor desc{};
       desc.label = "Uniform buffer";
@@ -127,26 +161,62 @@ private:
 
       m_matrix_buffer = wgpuDeviceCreateBuffer(device, &desc);
 
-      // fill buffer data
-      glm::mat4 mat1 = glm::translate(glm::mat4(1.f), {0.2f, 0.2f, 0.f});
+      // fill buffer data, one staging copy instead of a write per draw
+      std::vector<uint8_t> data(tail);
+      for (const auto &draw : m_draws) {
+        std::memcpy(data.data() + draw.matrix_offset, &draw.matrix,
+                    sizeof(glm::mat4));
+        std::memcpy(data.data() + draw.color_offset, &draw.color,
+                    sizeof(glm::vec4));
+      }
+
+      wgpuQueueWriteBuffer(GetQueue(), m_matrix_buffer, 0, data.data(),
+                           data.size());
+    }
+
+    // generated order is random in depth, which is the worst case for early
+    // depth test
+    if (m_sort) {
+      std::sort(m_draws.begin(), m_draws.end(),
+                [](const TriangleDraw &a, const TriangleDraw &b) {
+                  return a.depth < b.depth;
+                });
+    }
+
+    spdlog::info("triangles: {} depth pre-pass: {} front to back: {}",
+                 m_draws.size(), m_prepass ? "on" : "off",
+                 m_sort ? "on" : "off");
+  }
 
-      glm::vec4 color1{83.f / 255.f, 109.f / 255.f, 254.f / 255.f, 1.f};
+  void InitDraws() {
+    // no projection, clip space z is the view depth
+    if (!m_overdraw) {
+      m_draws.resize(2);
 
-      glm::mat4 mat2 = glm::translate(glm::mat4(1.f), {-0.2f, -0.2f, 0.5f});
+      m_draws[0].depth = 0.f;
+      m_draws[0].matrix = glm::translate(glm::mat4(1.f), {0.2f, 0.2f, 0.f});
+      m_draws[0].color = {83.f / 255.f, 109.f / 255.f, 254.f / 255.f, 1.f};
 
-      glm::vec4 color2{0.f, 137.f / 255.f, 123.f / 255.f, 1.f};
+      m_draws[1].depth = 0.5f;
+      m_draws[1].matrix =
+          glm::translate(glm::mat4(1.f), {-0.2f, -0.2f, 0.5f});
+      m_draws[1].color = {0.f, 137.f / 255.f, 123.f / 255.f, 1.f};
 
-      wgpuQueueWriteBuffer(GetQueue(), m_matrix_buffer, m_offset_1_matrix,
-                           &mat1, sizeof(mat1));
+      return;
+    }
 
-      wgpuQueueWriteBuffer(GetQueue(), m_matrix_buffer, m_offset_1_color,
-                           &color1, sizeof(color1));
+    std::mt19937 rng{2023};
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
 
-      wgpuQueueWriteBuffer(GetQueue(), m_matrix_buffer, m_offset_2_matrix,
-                           &mat2, sizeof(mat2));
+    m_draws.resize(kOverdrawTriangles);
 
-      wgpuQueueWriteBuffer(GetQueue(), m_matrix_buffer, m_offset_2_color,
-                           &color2, sizeof(color2));
+    for (auto &draw : m_draws) {
+      draw.depth = unit(rng) * 0.9f;
+      draw.matrix = glm::translate(glm::mat4(1.f),
+                                   {(unit(rng) - 0.5f) * 0.6f,
+                                    (unit(rng) - 0.5f) * 0.6f, draw.depth});
+      draw.matrix = glm::scale(draw.matrix, {2.f, 2.f, 1.f});
+      draw.color = {unit(rng), unit(rng), unit(rng), 1.f};
     }
   }
 
@@ -173,13 +243,13 @@ private:
 
   void InitPipeline() {
     // shader
-    auto raw_shader = ReadFile(ASSET_DIR "/depth-triangle.wgsl");
+    const char *raw_shader = util::GetShader("depth-triangle.wgsl");
     // shader module
     WGPUShaderModule shader = nullptr;
     {
       WGPUShaderModuleWGSLDescriptor wgsl_desc{};
       wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
-      wgsl_desc.code = raw_shader.c_str();
+      wgsl_desc.code = raw_shader;
 
       WGPUShaderModuleDescriptor desc{};
       desc.label = "Depth test triangle Shader";
@@ -221,6 +291,22 @@ private:
       m_pipeline_layout = wgpuDeviceCreatePipelineLayout(GetDevice(), &desc);
     }
 
+    m_pipeline = CreatePipeline(shader, true, WGPUCompareFunction_Less, true);
+    m_prepass_pipeline =
+        CreatePipeline(shader, false, WGPUCompareFunction_Less, true);
+    // depth is already resolved, only the visible fragment of each pixel
+    // passes, so the fragment shader runs once per pixel
+    m_equal_pipeline =
+        CreatePipeline(shader, true, WGPUCompareFunction_Equal, false);
+
+    wgpuShaderModuleRelease(shader);
+
+    CreateBindGroups();
+  }
+
+  WGPURenderPipeline CreatePipeline(WGPUShaderModule shader, bool has_fragment,
+                                    WGPUCompareFunction depth_compare,
+                                    bool depth_write) {
     // vertex layout
     WGPUVertexBufferLayout vertex_layout = {};
 
@@ -261,11 +347,13 @@ private:
 
     WGPUFragmentState fs_state{};
     fs_state.module = shader;
-    fs_state.entryPoint = "fs_main";
+    // the shading loop only runs in the overdraw scene
+    fs_state.entryPoint = m_overdraw ? "fs_shaded" : "fs_main";
     fs_state.targetCount = 1;
     fs_state.targets = &color_target;
 
-    desc.fragment = &fs_state;
+    // depth only pipeline has no fragment stage and no color target
+    desc.fragment = has_fragment ? &fs_state : nullptr;
 
     // primitive
     desc.primitive.cullMode = WGPUCullMode_None;
@@ -275,10 +363,10 @@ private:
 
     // depth stencil state
     WGPUDepthStencilState depth_stencil_state{};
-    depth_stencil_state.depthWriteEnabled = true;
+    depth_stencil_state.depthWriteEnabled = depth_write;
     depth_stencil_state.depthBias = 0;
     depth_stencil_state.depthBiasClamp = 1.f;
-    depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+    depth_stencil_state.depthCompare = depth_compare;
     depth_stencil_state.depthBiasSlopeScale = 1.f;
     depth_stencil_state.stencilReadMask = depth_stencil_state.stencilWriteMask =
         0xff;
@@ -297,7 +385,35 @@ private:
     desc.multisample.mask = 0xffffffff;
     desc.multisample.alphaToCoverageEnabled = false;
 
-    m_pipeline = wgpuDeviceCreateRenderPipeline(GetDevice(), &desc);
+    return wgpuDeviceCreateRenderPipeline(GetDevice(), &desc);
+  }
+
+  void CreateBindGroups() {
+    // offsets never change, so the groups are created once instead of every
+    // frame
+    WGPUBindGroupDescriptor desc{};
+    desc.label = "Group 0";
+    desc.layout = m_group0_layout;
+
+    std::vector<WGPUBindGroupEntry> bindings(2);
+
+    bindings[0].binding = 0;
+    bindings[0].buffer = m_matrix_buffer;
+    bindings[0].size = sizeof(glm::mat4);
+
+    bindings[1].binding = 1;
+    bindings[1].buffer = m_matrix_buffer;
+    bindings[1].size = sizeof(glm::vec4);
+
+    desc.entryCount = bindings.size();
+    desc.entries = bindings.data();
+
+    for (auto &draw : m_draws) {
+      bindings[0].offset = draw.matrix_offset;
+      bindings[1].offset = draw.color_offset;
+
+      draw.group = wgpuDeviceCreateBindGroup(GetDevice(), &desc);
+    }
   }
 
   WGPURenderPassEncoder BeginRenderPass(WGPUTextureView texture_view,
@@ -316,7 +432,9 @@ private:
     // depth attachment
     WGPURenderPassDepthStencilAttachment depthAttachment{};
     depthAttachment.depthClearValue = 1.f;
-    depthAttachment.depthLoadOp = WGPULoadOp_Clear;
+    // the pre-pass already laid down the depth of the frame
+    depthAttachment.depthLoadOp =
+        m_prepass ? WGPULoadOp_Load : WGPULoadOp_Clear;
     depthAttachment.depthStoreOp = WGPUStoreOp_Discard;
     depthAttachment.depthReadOnly = false;
     depthAttachment.view = m_depth_attachment;
@@ -326,58 +444,58 @@ private:
     return wgpuCommandEncoderBeginRenderPass(encoder, &renderpassInfo);
   }
 
-  void Draw(WGPURenderPassEncoder render_pass) {
-    wgpuRenderPassEncoderSetPipeline(render_pass, m_pipeline);
-    wgpuRenderPassEncoderSetVertexBuffer(render_pass, 0, m_vertex_buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-
-    // group for first draw call
-    WGPUBindGroup group0 = {};
-    // group for second draw call
-    WGPUBindGroup group1 = {};
-    {
-      WGPUBindGroupDescriptor desc{};
-      desc.label = "Group 0";
-      desc.layout = m_group0_layout;
-
-      std::vector<WGPUBindGroupEntry> bindings(2);
-
-      bindings[0].binding = 0;
-      bindings[0].buffer = m_matrix_buffer;
-      bindings[0].offset = m_offset_1_matrix;
-      bindings[0].size = sizeof(glm::mat4);
+  WGPURenderPassEncoder BeginDepthPass(WGPUCommandEncoder encoder) {
+    // no color attachment, matches the pipeline without fragment stage
+    WGPURenderPassDescriptor renderpassInfo = {};
 
-      bindings[1].binding = 1;
-      bindings[1].buffer = m_matrix_buffer;
-      bindings[1].offset = m_offset_1_color;
-      bindings[1].size = sizeof(glm::vec4);
+    WGPURenderPassDepthStencilAttachment depthAttachment{};
+    depthAttachment.depthClearValue = 1.f;
+    depthAttachment.depthLoadOp = WGPULoadOp_Clear;
+    // kept for the Equal test of the main pass
+    depthAttachment.depthStoreOp = WGPUStoreOp_Store;
+    depthAttachment.depthReadOnly = false;
+    depthAttachment.view = m_depth_attachment;
 
-      desc.entryCount = bindings.size();
-      desc.entries = bindings.data();
+    renderpassInfo.depthStencilAttachment = &depthAttachment;
 
-      group0 = wgpuDeviceCreateBindGroup(GetDevice(), &desc);
+    return wgpuCommandEncoderBeginRenderPass(encoder, &renderpassInfo);
+  }
 
-      bindings[0].offset = m_offset_2_matrix;
-      bindings[1].offset = m_offset_2_color;
+  void Draw(WGPURenderPassEncoder render_pass, WGPURenderPipeline pipeline) {
+    util::RenderPassEncoder pass{render_pass};
 
-      group1 = wgpuDeviceCreateBindGroup(GetDevice(), &desc);
+    // every draw sets its full state, the wrapper drops what is already bound
+    for (const auto &draw : m_draws) {
+      pass.SetPipeline(pipeline);
+      pass.SetVertexBuffer(0, m_vertex_buffer);
+      pass.SetBindGroup(0, draw.group);
+      pass.Draw(3);
     }
 
-    // first triangle
-    // light blue color with smaller depth value
-    wgpuRenderPassEncoderSetBindGroup(render_pass, 0, group0, 0, nullptr);
-    wgpuRenderPassEncoderDraw(render_pass, 3, 1, 0, 0);
-
-    // second triangle
-    // light green color with larger depth value
-    wgpuRenderPassEncoderSetBindGroup(render_pass, 0, group1, 0, nullptr);
-    wgpuRenderPassEncoderDraw(render_pass, 3, 1, 0, 0);
-
-    // we should see the second triangle is blocked by first triangle, even it
-    // is rendered last
+    m_pass_stats.push_back(pass.GetStats());
+  }
 
-    wgpuBindGroupRelease(group0);
-    wgpuBindGroupRelease(group1);
+  void LogFrameTime(std::chrono::steady_clock::time_point start) {
+    m_frame_time += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+    // the swapchain is in mailbox mode, so once the GPU is the bottleneck the
+    // frame time follows the cost of shading
+    if (++m_frame % 120 == 0) {
+      uint32_t issued = 0;
+      uint32_t skipped = 0;
+      for (const auto &stats : m_pass_stats) {
+        issued += stats.Issued();
+        skipped += stats.skipped;
+      }
+
+      spdlog::info("frame time: {:.3f} ms commands issued: {} skipped: {}",
+                   m_frame_time * 1000.0 / 120.0, issued / 120, skipped / 120);
+
+      m_frame_time = 0.0;
+      m_pass_stats.clear();
+    }
   }
 
 private:
@@ -386,19 +504,50 @@ private:
   WGPUBindGroupLayout m_group0_layout = {};
   WGPUPipelineLayout m_pipeline_layout = {};
   WGPURenderPipeline m_pipeline = {};
+  WGPURenderPipeline m_prepass_pipeline = {};
+  WGPURenderPipeline m_equal_pipeline = {};
   // texture for depth buffer in render pipeline
   WGPUTextureView m_depth_attachment = {};
 
-  uint32_t m_offset_1_matrix = 0;
-  uint32_t m_offset_1_color = 0;
-  uint32_t m_offset_2_matrix = 0;
-  uint32_t m_offset_2_color = 0;
+  struct TriangleDraw {
+    uint32_t matrix_offset = 0;
+    uint32_t color_offset = 0;
+    float depth = 0.f;
+    glm::mat4 matrix = {};
+    glm::vec4 color = {};
+    WGPUBindGroup group = {};
+  };
+
+  std::vector<TriangleDraw> m_draws;
+
+  bool m_prepass;
+  bool m_sort;
+  bool m_overdraw;
+  uint64_t m_frame = 0;
+  double m_frame_time = 0.0;
+  std::vector<util::RenderPassStats> m_pass_stats;
 };
 
 int main(int argc, const char **argv) {
-  DepthBuffer app{};
+  auto options = util::App::ParseOptions(argc, argv);
+
+  bool prepass = false;
+  bool sort = true;
+  bool overdraw = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--prepass") == 0) {
+      prepass = true;
+    } else if (std::strcmp(argv[i], "--no-sort") == 0) {
+      sort = false;
+    } else if (std::strcmp(argv[i], "--overdraw") == 0) {
+      overdraw = true;
+    } else {
+      spdlog::warn("unknown option: {}", argv[i]);
+    }
+  }
 
-  app.Run();
+  DepthBuffer app{prepass, sort, overdraw};
 
-  return 0;
+  return app.Run(options) ? 0 : -1;
 }
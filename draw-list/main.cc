@@ -0,0 +1,618 @@
+#include "draw_list.hpp"
+#include "frame_trace.hpp"
+#include "scene_store.hpp"
+#include "transform_batch.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <memory>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+namespace {
+
+constexpr uint32_t kPipelineCount = 4;
+constexpr uint32_t kMaterialCount = 16;
+constexpr uint32_t kMeshCount = 3;
+
+const char *kFragmentEntries[kPipelineCount] = {
+    "fs_flat",
+    "fs_stripes",
+    "fs_checker",
+    "fs_rings",
+};
+
+struct Object {
+  uint32_t pipeline;
+  uint32_t material;
+  uint32_t mesh;
+  float depth;
+  float angle;
+  float speed;
+  bool moving;
+};
+
+std::vector<float> MakePolygon(uint32_t sides) {
+  const float pi = 3.14159265358979f;
+
+  std::vector<float> data;
+  for (uint32_t i = 1; i + 1 < sides; i++) {
+    for (uint32_t v : {0u, i, i + 1}) {
+      float a = static_cast<float>(v) / sides * 2.f * pi;
+      data.push_back(std::cos(a));
+      data.push_back(std::sin(a));
+    }
+  }
+
+  return data;
+}
+
+} // namespace
+
+class DrawListSample : public util::App {
+public:
+  /**
+   * @param moving       percentage of the objects which rotate, only their
+   *                     transforms are uploaded every frame
+   * @param trace_path   when not empty, the first `trace_frames` frames are
+   *                     recorded into this file, see trace-replay
+   */
+  DrawListSample(uint32_t object_count, bool sort, float moving,
+                 std::string trace_path, uint32_t trace_frames)
+      : util::App("Draw List", 800, 800), m_object_count(object_count),
+        m_sort(sort), m_moving(moving), m_trace_path(std::move(trace_path)),
+        m_trace_frames(trace_frames), m_trace(!m_trace_path.empty()) {}
+
+  ~DrawListSample() override = default;
+
+protected:
+  util::DeviceRequirements GetDeviceRequirements() const override {
+    util::DeviceRequirements requirements{};
+
+    // one transform per object in a single storage binding
+    uint64_t transforms = uint64_t(m_object_count) * sizeof(glm::mat4);
+    requirements.required_limits.maxStorageBufferBindingSize = transforms;
+    requirements.required_limits.maxBufferSize = transforms;
+
+    return requirements;
+  }
+
+  void OnPreload() override {
+    InitScene();
+    m_shader_source = util::GetShader("object.wgsl");
+  }
+
+  void OnInit() override {
+    InitBuffers();
+    InitDepthAttachment();
+    InitPipeline();
+    InitBindGroups();
+  }
+
+  void OnLoop() override {
+    if (m_frame < m_trace_frames) {
+      m_trace.BeginFrame(800, 800, WGPUTextureFormat_BGRA8Unorm);
+    }
+
+    auto texture_view = AcquireTargetView();
+
+    auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
+
+    auto render_pass = BeginRenderPass(texture_view, encoder);
+
+    Draw(render_pass);
+
+    wgpuRenderPassEncoderEnd(render_pass);
+    m_trace.EndRenderPass();
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+
+    wgpuRenderPassEncoderRelease(render_pass);
+    wgpuCommandEncoderRelease(encoder);
+
+    wgpuQueueSubmit(GetQueue(), 1, &cmd);
+    m_trace.Submit();
+    Present();
+
+    wgpuCommandBufferRelease(cmd);
+    wgpuTextureViewRelease(texture_view);
+
+    if (m_trace.IsInFrame()) {
+      m_trace.EndFrame();
+
+      if (m_trace.GetFrameCount() == m_trace_frames) {
+        m_trace.Save(m_trace_path);
+      }
+    }
+  }
+
+  void OnTerminal() override {
+    for (auto group : m_material_groups) {
+      wgpuBindGroupRelease(group);
+    }
+    wgpuBindGroupRelease(m_object_group);
+
+    for (auto pipeline : m_pipelines) {
+      wgpuRenderPipelineRelease(pipeline);
+    }
+    wgpuPipelineLayoutRelease(m_layout);
+    wgpuBindGroupLayoutRelease(m_object_layout);
+    wgpuBindGroupLayoutRelease(m_material_layout);
+
+    for (auto &mesh : m_meshes) {
+      wgpuBufferRelease(mesh.buffer);
+    }
+    m_store.reset();
+    wgpuBufferRelease(m_material_buffer);
+
+    wgpuTextureViewRelease(m_depth_attachment);
+  }
+
+private:
+  struct Mesh {
+    WGPUBuffer buffer = {};
+    uint32_t vertex_count = 0;
+  };
+
+  void InitScene() {
+    std::mt19937 rng{2023};
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    // generated in random order, which is how a scene graph walk usually
+    // looks from the renderer's point of view
+    m_objects.resize(m_object_count);
+    m_transform_arrays.Resize(m_object_count);
+    for (uint32_t i = 0; i < m_object_count; i++) {
+      auto &o = m_objects[i];
+      o.pipeline = rng() % kPipelineCount;
+      o.material = rng() % kMaterialCount;
+      o.mesh = rng() % kMeshCount;
+      m_transform_arrays.position[0][i] = unit(rng) * 2.f - 1.f;
+      m_transform_arrays.position[1][i] = unit(rng) * 2.f - 1.f;
+      o.depth = unit(rng);
+      m_transform_arrays.position[2][i] = o.depth;
+      float scale = 0.02f + unit(rng) * 0.04f;
+      m_transform_arrays.scale[0][i] = scale;
+      m_transform_arrays.scale[1][i] = scale;
+      o.angle = unit(rng) * 6.28f;
+      o.speed = (unit(rng) - 0.5f) * 0.1f;
+      m_transform_arrays.rotation[2][i] = std::sin(o.angle * 0.5f);
+      m_transform_arrays.rotation[3][i] = std::cos(o.angle * 0.5f);
+    }
+
+    // own generator, the scene stays the same for every percentage
+    std::mt19937 pick{42};
+    for (auto &o : m_objects) {
+      o.moving = unit(pick) * 100.f < m_moving;
+    }
+
+    spdlog::info("scene: {} objects, sorting: {}, moving: {}%",
+                 m_object_count, m_sort ? "on" : "off", m_moving);
+  }
+
+  void InitBuffers() {
+    // meshes: triangle, quad and hexagon
+    uint32_t sides[kMeshCount] = {3, 4, 6};
+    for (uint32_t i = 0; i < kMeshCount; i++) {
+      auto data = MakePolygon(sides[i]);
+
+      WGPUBufferDescriptor desc{};
+      desc.label = "Vertex buffer";
+      desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst;
+      desc.size = data.size() * sizeof(float);
+
+      m_meshes[i].buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+      m_meshes[i].vertex_count = static_cast<uint32_t>(data.size() / 2);
+      m_trace.CreateBuffer(m_meshes[i].buffer, desc);
+
+      wgpuQueueWriteBuffer(GetQueue(), m_meshes[i].buffer, 0, data.data(),
+                           data.size() * sizeof(float));
+      m_trace.WriteBuffer(m_meshes[i].buffer, 0, data.data(),
+                          data.size() * sizeof(float));
+    }
+
+    // object transforms
+    m_store = std::make_unique<util::SceneStore>(GetDevice(), GetQueue(),
+                                                 m_object_count, &m_trace);
+    m_transform_component = m_store->AddComponent(
+        "Object buffer", sizeof(glm::mat4), WGPUBufferUsage_Storage);
+
+    // materials, one color per aligned slot
+    {
+      m_material_stride = std::max<uint32_t>(
+          sizeof(glm::vec4), GetLimits().minUniformBufferOffsetAlignment);
+
+      std::mt19937 rng{7};
+      std::uniform_real_distribution<float> unit(0.2f, 1.f);
+
+      std::vector<uint8_t> data(m_material_stride * kMaterialCount);
+      for (uint32_t i = 0; i < kMaterialCount; i++) {
+        glm::vec4 color{unit(rng), unit(rng), unit(rng), 1.f};
+        std::memcpy(data.data() + i * m_material_stride, &color, sizeof(color));
+      }
+
+      WGPUBufferDescriptor desc{};
+      desc.label = "Material buffer";
+      desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+      desc.size = data.size();
+
+      m_material_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+      m_trace.CreateBuffer(m_material_buffer, desc);
+
+      wgpuQueueWriteBuffer(GetQueue(), m_material_buffer, 0, data.data(),
+                           data.size());
+      m_trace.WriteBuffer(m_material_buffer, 0, data.data(), data.size());
+    }
+  }
+
+  void InitDepthAttachment() {
+    WGPUTextureDescriptor tex_desc{};
+    tex_desc.label = "Depth attachment";
+    tex_desc.dimension = WGPUTextureDimension_2D;
+    tex_desc.format = WGPUTextureFormat_Depth24Plus;
+    tex_desc.size.width = 800;
+    tex_desc.size.height = 800;
+    tex_desc.size.depthOrArrayLayers = 1;
+    tex_desc.sampleCount = 1;
+    tex_desc.mipLevelCount = 1;
+    tex_desc.usage = WGPUTextureUsage_RenderAttachment;
+
+    auto texture = wgpuDeviceCreateTexture(GetDevice(), &tex_desc);
+    m_trace.CreateTexture(texture, tex_desc);
+
+    m_depth_attachment = wgpuTextureCreateView(texture, nullptr);
+    m_trace.CreateTextureView(m_depth_attachment, texture, nullptr);
+
+    wgpuTextureRelease(texture);
+  }
+
+  void InitPipeline() {
+    // shader, read by OnPreload
+    const char *raw_shader = m_shader_source;
+    // shader module
+    WGPUShaderModule shader = nullptr;
+    {
+      WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+      wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+      wgsl_desc.code = raw_shader;
+
+      WGPUShaderModuleDescriptor desc{};
+      desc.label = "Draw list shader";
+
+      desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+      shader = wgpuDeviceCreateShaderModule(GetDevice(), &desc);
+      m_trace.CreateShaderModule(shader, raw_shader);
+    }
+
+    // pipeline layout
+    {
+      WGPUBindGroupLayoutEntry object_entry{};
+      object_entry.binding = 0;
+      object_entry.visibility = WGPUShaderStage_Vertex;
+      object_entry.buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+      object_entry.buffer.minBindingSize = 0;
+      object_entry.buffer.hasDynamicOffset = false;
+
+      WGPUBindGroupLayoutDescriptor object_desc{};
+      object_desc.label = "Object group layout";
+      object_desc.entryCount = 1;
+      object_desc.entries = &object_entry;
+
+      m_object_layout =
+          wgpuDeviceCreateBindGroupLayout(GetDevice(), &object_desc);
+      m_trace.CreateBindGroupLayout(m_object_layout, object_desc);
+
+      WGPUBindGroupLayoutEntry material_entry{};
+      material_entry.binding = 0;
+      material_entry.visibility = WGPUShaderStage_Fragment;
+      material_entry.buffer.type = WGPUBufferBindingType_Uniform;
+      material_entry.buffer.minBindingSize = 0;
+      material_entry.buffer.hasDynamicOffset = false;
+
+      WGPUBindGroupLayoutDescriptor material_desc{};
+      material_desc.label = "Material group layout";
+      material_desc.entryCount = 1;
+      material_desc.entries = &material_entry;
+
+      m_material_layout =
+          wgpuDeviceCreateBindGroupLayout(GetDevice(), &material_desc);
+      m_trace.CreateBindGroupLayout(m_material_layout, material_desc);
+
+      std::array<WGPUBindGroupLayout, 2> layouts{m_object_layout,
+                                                 m_material_layout};
+
+      WGPUPipelineLayoutDescriptor desc{};
+      desc.label = "Draw list pipeline layout";
+      desc.bindGroupLayoutCount = layouts.size();
+      desc.bindGroupLayouts = layouts.data();
+
+      m_layout = wgpuDeviceCreatePipelineLayout(GetDevice(), &desc);
+      m_trace.CreatePipelineLayout(m_layout, desc);
+    }
+
+    // vertex layout
+    WGPUVertexBufferLayout vertex_layout = {};
+
+    WGPUVertexAttribute attr{};
+    attr.format = WGPUVertexFormat_Float32x2;
+    attr.offset = 0;
+    attr.shaderLocation = 0;
+
+    vertex_layout.attributeCount = 1;
+    vertex_layout.attributes = &attr;
+    vertex_layout.arrayStride = 2 * sizeof(float);
+    vertex_layout.stepMode = WGPUVertexStepMode_Vertex;
+
+    for (uint32_t i = 0; i < kPipelineCount; i++) {
+      WGPURenderPipelineDescriptor desc{};
+      desc.label = "Draw list pipeline";
+
+      desc.layout = m_layout;
+
+      desc.vertex.module = shader;
+      desc.vertex.entryPoint = "vs_main";
+      desc.vertex.bufferCount = 1;
+      desc.vertex.buffers = &vertex_layout;
+
+      WGPUColorTargetState color_target{};
+      color_target.writeMask = WGPUColorWriteMask_All;
+      color_target.blend = nullptr;
+      // TODO query swapchain texture format
+      color_target.format = WGPUTextureFormat_BGRA8Unorm;
+
+      WGPUFragmentState fs_state{};
+      fs_state.module = shader;
+      fs_state.entryPoint = kFragmentEntries[i];
+      fs_state.targetCount = 1;
+      fs_state.targets = &color_target;
+
+      desc.fragment = &fs_state;
+
+      desc.primitive.cullMode = WGPUCullMode_None;
+      desc.primitive.frontFace = WGPUFrontFace_CCW;
+      desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+      desc.primitive.stripIndexFormat = WGPUIndexFormat_Undefined;
+
+      WGPUDepthStencilState depth_stencil_state{};
+      depth_stencil_state.depthWriteEnabled = true;
+      depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+      depth_stencil_state.stencilReadMask =
+          depth_stencil_state.stencilWriteMask = 0xff;
+      depth_stencil_state.stencilFront.compare = WGPUCompareFunction_Always;
+      depth_stencil_state.stencilFront.depthFailOp = WGPUStencilOperation_Keep;
+      depth_stencil_state.stencilFront.failOp = WGPUStencilOperation_Keep;
+      depth_stencil_state.stencilFront.passOp = WGPUStencilOperation_Keep;
+      depth_stencil_state.stencilBack = depth_stencil_state.stencilFront;
+      depth_stencil_state.format = WGPUTextureFormat_Depth24Plus;
+
+      desc.depthStencil = &depth_stencil_state;
+
+      desc.multisample.count = 1;
+      desc.multisample.mask = 0xffffffff;
+      desc.multisample.alphaToCoverageEnabled = false;
+
+      m_pipelines[i] = wgpuDeviceCreateRenderPipeline(GetDevice(), &desc);
+      m_trace.CreateRenderPipeline(m_pipelines[i], desc);
+    }
+
+    wgpuShaderModuleRelease(shader);
+  }
+
+  void InitBindGroups() {
+    {
+      WGPUBindGroupEntry binding0{};
+      binding0.binding = 0;
+      binding0.buffer = m_store->GetBuffer(m_transform_component);
+      binding0.offset = 0;
+      binding0.size = m_object_count * sizeof(glm::mat4);
+
+      WGPUBindGroupDescriptor desc{};
+      desc.label = "Object group";
+      desc.layout = m_object_layout;
+      desc.entryCount = 1;
+      desc.entries = &binding0;
+
+      m_object_group = wgpuDeviceCreateBindGroup(GetDevice(), &desc);
+      m_trace.CreateBindGroup(m_object_group, desc);
+    }
+
+    for (uint32_t i = 0; i < kMaterialCount; i++) {
+      WGPUBindGroupEntry binding0{};
+      binding0.binding = 0;
+      binding0.buffer = m_material_buffer;
+      binding0.offset = i * m_material_stride;
+      binding0.size = sizeof(glm::vec4);
+
+      WGPUBindGroupDescriptor desc{};
+      desc.label = "Material group";
+      desc.layout = m_material_layout;
+      desc.entryCount = 1;
+      desc.entries = &binding0;
+
+      m_material_groups[i] = wgpuDeviceCreateBindGroup(GetDevice(), &desc);
+      m_trace.CreateBindGroup(m_material_groups[i], desc);
+    }
+  }
+
+  WGPURenderPassEncoder BeginRenderPass(WGPUTextureView texture_view,
+                                        WGPUCommandEncoder encoder) {
+    WGPURenderPassDescriptor renderpassInfo = {};
+    WGPURenderPassColorAttachment colorAttachment = {};
+
+    colorAttachment.view = texture_view;
+    colorAttachment.resolveTarget = nullptr;
+    colorAttachment.clearValue = {1.f, 1.f, 1.f, 1.f};
+    colorAttachment.loadOp = WGPULoadOp_Clear;
+    colorAttachment.storeOp = WGPUStoreOp_Store;
+    renderpassInfo.colorAttachmentCount = 1;
+    renderpassInfo.colorAttachments = &colorAttachment;
+
+    WGPURenderPassDepthStencilAttachment depthAttachment{};
+    depthAttachment.depthClearValue = 1.f;
+    depthAttachment.depthLoadOp = WGPULoadOp_Clear;
+    depthAttachment.depthStoreOp = WGPUStoreOp_Discard;
+    depthAttachment.depthReadOnly = false;
+    depthAttachment.view = m_depth_attachment;
+
+    renderpassInfo.depthStencilAttachment = &depthAttachment;
+
+    m_trace.BeginRenderPass(renderpassInfo);
+
+    return wgpuCommandEncoderBeginRenderPass(encoder, &renderpassInfo);
+  }
+
+  void Draw(WGPURenderPassEncoder render_pass) {
+    auto start = std::chrono::steady_clock::now();
+
+    m_list.Clear();
+
+    for (uint32_t i = 0; i < m_object_count; i++) {
+      auto &o = m_objects[i];
+
+      if (o.moving) {
+        o.angle += o.speed;
+
+        // rotation around z as a quaternion
+        m_transform_arrays.rotation[2][i] = std::sin(o.angle * 0.5f);
+        m_transform_arrays.rotation[3][i] = std::cos(o.angle * 0.5f);
+
+        m_store->MarkDirty(m_transform_component, i);
+      }
+
+      util::DrawCommand cmd{};
+      cmd.pipeline = m_pipelines[o.pipeline];
+      cmd.bind_groups[0] = m_object_group;
+      cmd.bind_groups[1] = m_material_groups[o.material];
+      cmd.vertex_buffer = m_meshes[o.mesh].buffer;
+      cmd.count = m_meshes[o.mesh].vertex_count;
+      // selects the transform in the storage buffer
+      cmd.first_instance = i;
+
+      m_list.Add(0, o.depth, cmd);
+    }
+
+    // rebuilding the unchanged matrices costs less than finding them, only
+    // the dirty ones are uploaded
+    util::BuildTransforms(
+        m_transform_arrays.View(), m_object_count,
+        m_store->Data<glm::mat4>(m_transform_component));
+
+    auto upload = m_store->Upload();
+    m_upload_bytes += upload.bytes;
+    m_upload_dirty_bytes += upload.dirty_bytes;
+    m_upload_writes += upload.writes;
+
+    auto before = m_list.CountStateChanges();
+
+    if (m_sort) {
+      m_list.Sort();
+    }
+
+    util::RenderPassEncoder pass{render_pass, &m_trace};
+
+    m_list.Emit(pass);
+
+    const auto &after = pass.GetStats();
+
+    m_cpu_time += std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+    if (++m_frame % 120 == 0) {
+      spdlog::info("draws: {} state changes before sort: {} after: {} "
+                   "(pipeline: {} bind group: {} vertex buffer: {}) "
+                   "skipped: {} cpu: {:.3f} ms",
+                   after.draws, before.StateChanges(), after.StateChanges(),
+                   after.pipelines, after.bind_groups, after.vertex_buffers,
+                   after.skipped, m_cpu_time * 1000.0 / 120.0);
+      spdlog::info("upload: {} of {} bytes ({} changed) in {} writes per "
+                   "frame",
+                   m_upload_bytes / 120,
+                   m_store->GetSize(m_transform_component),
+                   m_upload_dirty_bytes / 120, m_upload_writes / 120);
+
+      m_cpu_time = 0.0;
+      m_upload_bytes = 0;
+      m_upload_dirty_bytes = 0;
+      m_upload_writes = 0;
+    }
+  }
+
+private:
+  uint32_t m_object_count;
+  bool m_sort;
+  float m_moving;
+  std::string m_trace_path;
+  const char *m_shader_source = nullptr;
+  uint32_t m_trace_frames;
+  util::TraceRecorder m_trace;
+
+  std::vector<Object> m_objects;
+  // position, rotation and scale of the objects
+  util::TransformArrays m_transform_arrays;
+  util::DrawList m_list;
+
+  std::unique_ptr<util::SceneStore> m_store;
+  uint32_t m_transform_component = 0;
+  std::array<Mesh, kMeshCount> m_meshes = {};
+  WGPUBuffer m_material_buffer = {};
+  uint32_t m_material_stride = 0;
+
+  WGPUBindGroupLayout m_object_layout = {};
+  WGPUBindGroupLayout m_material_layout = {};
+  WGPUPipelineLayout m_layout = {};
+  std::array<WGPURenderPipeline, kPipelineCount> m_pipelines = {};
+  WGPUBindGroup m_object_group = {};
+  std::array<WGPUBindGroup, kMaterialCount> m_material_groups = {};
+  WGPUTextureView m_depth_attachment = {};
+
+  uint64_t m_frame = 0;
+  double m_cpu_time = 0.0;
+  uint64_t m_upload_bytes = 0;
+  uint64_t m_upload_dirty_bytes = 0;
+  uint64_t m_upload_writes = 0;
+};
+
+int main(int argc, const char **argv) {
+  auto options = util::App::ParseOptions(argc, argv);
+
+  uint32_t count = 4096;
+  bool sort = true;
+  float moving = 100.f;
+  std::string trace_path;
+  uint32_t trace_frames = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--no-sort") == 0) {
+      sort = false;
+    } else if (std::strcmp(argv[i], "--moving") == 0 && i + 1 < argc) {
+      moving = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc) {
+      trace_frames =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (argv[i][0] != '\0' &&
+               std::strspn(argv[i], "0123456789") == std::strlen(argv[i])) {
+      count = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+    } else {
+      spdlog::warn("unknown option: {}", argv[i]);
+    }
+  }
+
+  DrawListSample app{count, sort, moving, trace_path,
+                     trace_path.empty() ? 0 : trace_frames};
+
+  return app.Run(options) ? 0 : -1;
+}
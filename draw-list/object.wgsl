@@ -0,0 +1,46 @@
+
+// per object transform, indexed with the instance index
+@group(0) @binding(0)
+var<storage, read> objects: array<mat4x4<f32>>;
+
+/// material color
+@group(1) @binding(0)
+var<uniform> color: vec4<f32>;
+
+struct VertexOutput {
+    @builtin(position) position: vec4<f32>,
+    @location(0) local: vec2<f32>,
+};
+
+@vertex
+fn vs_main(@location(0) position: vec2<f32>,
+           @builtin(instance_index) instance: u32) -> VertexOutput {
+    var out: VertexOutput;
+    out.position = objects[instance] * vec4<f32>(position, 0.0, 1.0);
+    out.local = position;
+    return out;
+}
+
+@fragment
+fn fs_flat(in: VertexOutput) -> @location(0) vec4<f32> {
+    return color;
+}
+
+@fragment
+fn fs_stripes(in: VertexOutput) -> @location(0) vec4<f32> {
+    let stripe = step(0.5, fract(in.local.x * 4.0));
+    return vec4<f32>(color.rgb * (0.6 + 0.4 * stripe), color.a);
+}
+
+@fragment
+fn fs_checker(in: VertexOutput) -> @location(0) vec4<f32> {
+    let cell = floor(in.local * 4.0);
+    let checker = abs(cell.x + cell.y) % 2.0;
+    return vec4<f32>(color.rgb * (0.6 + 0.4 * checker), color.a);
+}
+
+@fragment
+fn fs_rings(in: VertexOutput) -> @location(0) vec4<f32> {
+    let ring = step(0.5, fract(length(in.local) * 4.0));
+    return vec4<f32>(color.rgb * (0.6 + 0.4 * ring), color.a);
+}
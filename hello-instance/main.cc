@@ -29,9 +29,9 @@ protected:
 };
 
 int main(int argc, const char **argv) {
-  HelloInstance app{};
+  auto options = util::App::ParseOptions(argc, argv);
 
-  app.Run();
+  HelloInstance app{};
 
-  return 0;
+  return app.Run(options) ? 0 : -1;
 }
@@ -0,0 +1,412 @@
+#include "mesh_optimizer.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+namespace {
+
+// x, y, z, nx, ny, nz
+constexpr uint32_t kFloatsPerVertex = 6;
+
+/**
+ * Generate a torus, the triangles are shuffled to mimic what most exporters
+ * produce, which is far from a cache friendly order.
+ */
+void GenerateTorus(uint32_t rings, uint32_t sides, std::vector<float> &vertices,
+                   std::vector<uint32_t> &indices) {
+  const float major = 0.6f;
+  const float minor = 0.25f;
+  const float pi = 3.14159265358979f;
+
+  for (uint32_t i = 0; i <= rings; i++) {
+    float u = static_cast<float>(i) / rings * 2.f * pi;
+
+    for (uint32_t j = 0; j <= sides; j++) {
+      float v = static_cast<float>(j) / sides * 2.f * pi;
+
+      float nx = std::cos(u) * std::cos(v);
+      float ny = std::sin(u) * std::cos(v);
+      float nz = std::sin(v);
+
+      vertices.insert(vertices.end(), {
+                                          std::cos(u) * major + nx * minor,
+                                          std::sin(u) * major + ny * minor,
+                                          nz * minor,
+                                          nx,
+                                          ny,
+                                          nz,
+                                      });
+    }
+  }
+
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (uint32_t i = 0; i < rings; i++) {
+    for (uint32_t j = 0; j < sides; j++) {
+      uint32_t a = i * (sides + 1) + j;
+      uint32_t b = a + sides + 1;
+
+      triangles.push_back({a, b, a + 1});
+      triangles.push_back({a + 1, b, b + 1});
+    }
+  }
+
+  std::mt19937 rng{2023};
+  std::shuffle(triangles.begin(), triangles.end(), rng);
+
+  for (const auto &tri : triangles) {
+    indices.insert(indices.end(), tri.begin(), tri.end());
+  }
+}
+
+void LogStats(const char *step, const util::VertexCacheStats &stats) {
+  spdlog::info("{:<16} ACMR: {:.3f} ATVR: {:.3f} transformed: {}", step,
+               stats.acmr, stats.atvr, stats.vertices_transformed);
+}
+
+} // namespace
+
+class IndexedMesh : public util::App {
+public:
+  IndexedMesh() : util::App("Indexed Mesh", 800, 800) {}
+
+  ~IndexedMesh() override = default;
+
+protected:
+  void OnInit() override {
+    InitBuffers();
+    InitDepthAttachment();
+    InitPipeline();
+  }
+
+  void OnLoop() override {
+    auto texture_view = AcquireTargetView();
+
+    auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
+
+    auto render_pass = BeginRenderPass(texture_view, encoder);
+
+    Draw(render_pass);
+
+    wgpuRenderPassEncoderEnd(render_pass);
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+
+    wgpuRenderPassEncoderRelease(render_pass);
+    wgpuCommandEncoderRelease(encoder);
+
+    wgpuQueueSubmit(GetQueue(), 1, &cmd);
+    Present();
+
+    wgpuCommandBufferRelease(cmd);
+    wgpuTextureViewRelease(texture_view);
+  }
+
+  void OnTerminal() override {
+    wgpuBindGroupRelease(m_bind_group);
+    wgpuRenderPipelineRelease(m_pipeline);
+    wgpuBindGroupLayoutRelease(m_bind0_layout);
+    wgpuPipelineLayoutRelease(m_layout);
+    wgpuBufferRelease(m_vertex_buffer);
+    wgpuBufferRelease(m_index_buffer);
+    wgpuBufferRelease(m_uniform_buffer);
+    wgpuTextureViewRelease(m_depth_attachment);
+  }
+
+private:
+  void InitBuffers() {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+
+    GenerateTorus(256, 64, vertices, indices);
+
+    uint32_t vertex_count =
+        static_cast<uint32_t>(vertices.size() / kFloatsPerVertex);
+
+    spdlog::info("mesh: {} vertices {} triangles", vertex_count,
+                 indices.size() / 3);
+
+    LogStats("original", util::AnalyzeVertexCache(indices, vertex_count));
+
+    // offline optimization, in a real application this is done when cooking
+    // the asset, not at load time
+    indices = util::OptimizeVertexCache(indices, vertex_count);
+
+    LogStats("vertex cache", util::AnalyzeVertexCache(indices, vertex_count));
+
+    indices = util::OptimizeOverdraw(indices, vertices.data(), vertex_count,
+                                     kFloatsPerVertex * sizeof(float));
+
+    LogStats("overdraw", util::AnalyzeVertexCache(indices, vertex_count));
+
+    // this does not change ACMR, but makes vertex fetch linear in memory
+    vertex_count =
+        util::OptimizeVertexFetch(indices, vertices, kFloatsPerVertex);
+
+    m_index_count = static_cast<uint32_t>(indices.size());
+
+    // vertex buffer
+    {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Vertex buffer";
+      desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst;
+      desc.size = vertices.size() * sizeof(float);
+
+      m_vertex_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+
+      wgpuQueueWriteBuffer(GetQueue(), m_vertex_buffer, 0, vertices.data(),
+                           vertices.size() * sizeof(float));
+    }
+
+    // index buffer
+    {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Index buffer";
+      desc.usage = WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst;
+      desc.size = indices.size() * sizeof(uint32_t);
+
+      m_index_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+
+      wgpuQueueWriteBuffer(GetQueue(), m_index_buffer, 0, indices.data(),
+                           indices.size() * sizeof(uint32_t));
+    }
+
+    // uniform buffer
+    {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Uniform buffer";
+      desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+      // mvp and model matrix
+      desc.size = 2 * sizeof(glm::mat4);
+
+      m_uniform_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+    }
+  }
+
+  void InitDepthAttachment() {
+    WGPUTextureDescriptor tex_desc{};
+    tex_desc.label = "Depth attachment";
+    tex_desc.dimension = WGPUTextureDimension_2D;
+    tex_desc.format = WGPUTextureFormat_Depth24Plus;
+    tex_desc.size.width = 800;
+    tex_desc.size.height = 800;
+    tex_desc.size.depthOrArrayLayers = 1;
+    tex_desc.sampleCount = 1;
+    tex_desc.mipLevelCount = 1;
+    tex_desc.usage = WGPUTextureUsage_RenderAttachment;
+
+    auto texture = wgpuDeviceCreateTexture(GetDevice(), &tex_desc);
+
+    m_depth_attachment = wgpuTextureCreateView(texture, nullptr);
+
+    wgpuTextureRelease(texture);
+  }
+
+  void InitPipeline() {
+    // shader
+    const char *raw_shader = util::GetShader("mesh.wgsl");
+    // shader module
+    WGPUShaderModule shader = nullptr;
+    {
+      WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+      wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+      wgsl_desc.code = raw_shader;
+
+      WGPUShaderModuleDescriptor desc{};
+      desc.label = "Indexed mesh shader";
+
+      desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+      shader = wgpuDeviceCreateShaderModule(GetDevice(), &desc);
+    }
+
+    // pipeline layout
+    {
+      WGPUBindGroupLayoutEntry entry0{};
+      entry0.binding = 0;
+      entry0.visibility = WGPUShaderStage_Vertex;
+      entry0.buffer.type = WGPUBufferBindingType_Uniform;
+      entry0.buffer.minBindingSize = 0;
+      entry0.buffer.hasDynamicOffset = false;
+
+      WGPUBindGroupLayoutDescriptor binding_desc{};
+      binding_desc.label = "binding 0";
+      binding_desc.entryCount = 1;
+      binding_desc.entries = &entry0;
+
+      m_bind0_layout =
+          wgpuDeviceCreateBindGroupLayout(GetDevice(), &binding_desc);
+
+      WGPUPipelineLayoutDescriptor desc{};
+      desc.label = "Indexed mesh pipeline layout";
+      desc.bindGroupLayoutCount = 1;
+      desc.bindGroupLayouts = &m_bind0_layout;
+
+      m_layout = wgpuDeviceCreatePipelineLayout(GetDevice(), &desc);
+    }
+
+    // the uniform buffer never changes, so the bind group is created once
+    {
+      WGPUBindGroupEntry binding0{};
+      binding0.binding = 0;
+      binding0.buffer = m_uniform_buffer;
+      binding0.offset = 0;
+      binding0.size = 2 * sizeof(glm::mat4);
+
+      WGPUBindGroupDescriptor desc{};
+      desc.label = "Common Group";
+      desc.layout = m_bind0_layout;
+      desc.entryCount = 1;
+      desc.entries = &binding0;
+
+      m_bind_group = wgpuDeviceCreateBindGroup(GetDevice(), &desc);
+    }
+
+    // vertex layout
+    WGPUVertexBufferLayout vertex_layout = {};
+    std::array<WGPUVertexAttribute, 2> attrs{};
+    attrs[0].format = WGPUVertexFormat_Float32x3;
+    attrs[0].offset = 0;
+    attrs[0].shaderLocation = 0;
+    attrs[1].format = WGPUVertexFormat_Float32x3;
+    attrs[1].offset = 3 * sizeof(float);
+    attrs[1].shaderLocation = 1;
+
+    vertex_layout.attributeCount = attrs.size();
+    vertex_layout.attributes = attrs.data();
+    vertex_layout.arrayStride = kFloatsPerVertex * sizeof(float);
+    vertex_layout.stepMode = WGPUVertexStepMode_Vertex;
+
+    // pipeline descriptor
+    WGPURenderPipelineDescriptor desc{};
+    desc.label = "Indexed mesh pipeline";
+
+    desc.layout = m_layout;
+
+    desc.vertex.module = shader;
+    desc.vertex.entryPoint = "vs_main";
+    desc.vertex.bufferCount = 1;
+    desc.vertex.buffers = &vertex_layout;
+
+    WGPUColorTargetState color_target{};
+    color_target.writeMask = WGPUColorWriteMask_All;
+    color_target.blend = nullptr;
+    // TODO query swapchain texture format
+    color_target.format = WGPUTextureFormat_BGRA8Unorm;
+
+    WGPUFragmentState fs_state{};
+    fs_state.module = shader;
+    fs_state.entryPoint = "fs_main";
+    fs_state.targetCount = 1;
+    fs_state.targets = &color_target;
+
+    desc.fragment = &fs_state;
+
+    // primitive
+    desc.primitive.cullMode = WGPUCullMode_None;
+    desc.primitive.frontFace = WGPUFrontFace_CCW;
+    desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+    desc.primitive.stripIndexFormat = WGPUIndexFormat_Undefined;
+
+    // depth stencil state
+    WGPUDepthStencilState depth_stencil_state{};
+    depth_stencil_state.depthWriteEnabled = true;
+    depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+    depth_stencil_state.stencilReadMask = depth_stencil_state.stencilWriteMask =
+        0xff;
+    depth_stencil_state.stencilFront.compare = WGPUCompareFunction_Always;
+    depth_stencil_state.stencilFront.depthFailOp = WGPUStencilOperation_Keep;
+    depth_stencil_state.stencilFront.failOp = WGPUStencilOperation_Keep;
+    depth_stencil_state.stencilFront.passOp = WGPUStencilOperation_Keep;
+    depth_stencil_state.stencilBack = depth_stencil_state.stencilFront;
+    depth_stencil_state.format = WGPUTextureFormat_Depth24Plus;
+
+    desc.depthStencil = &depth_stencil_state;
+
+    desc.multisample.count = 1;
+    desc.multisample.mask = 0xffffffff;
+    desc.multisample.alphaToCoverageEnabled = false;
+
+    m_pipeline = wgpuDeviceCreateRenderPipeline(GetDevice(), &desc);
+
+    wgpuShaderModuleRelease(shader);
+  }
+
+  WGPURenderPassEncoder BeginRenderPass(WGPUTextureView texture_view,
+                                        WGPUCommandEncoder encoder) {
+    WGPURenderPassDescriptor renderpassInfo = {};
+    WGPURenderPassColorAttachment colorAttachment = {};
+
+    colorAttachment.view = texture_view;
+    colorAttachment.resolveTarget = nullptr;
+    colorAttachment.clearValue = {1.f, 1.f, 1.f, 1.f};
+    colorAttachment.loadOp = WGPULoadOp_Clear;
+    colorAttachment.storeOp = WGPUStoreOp_Store;
+    renderpassInfo.colorAttachmentCount = 1;
+    renderpassInfo.colorAttachments = &colorAttachment;
+
+    WGPURenderPassDepthStencilAttachment depthAttachment{};
+    depthAttachment.depthClearValue = 1.f;
+    depthAttachment.depthLoadOp = WGPULoadOp_Clear;
+    depthAttachment.depthStoreOp = WGPUStoreOp_Discard;
+    depthAttachment.depthReadOnly = false;
+    depthAttachment.view = m_depth_attachment;
+
+    renderpassInfo.depthStencilAttachment = &depthAttachment;
+
+    return wgpuCommandEncoderBeginRenderPass(encoder, &renderpassInfo);
+  }
+
+  void Draw(WGPURenderPassEncoder render_pass) {
+    m_rotation += 0.2f;
+
+    auto model = glm::rotate(glm::mat4(1.f), glm::radians(m_rotation),
+                             {1.f, 0.5f, 0.f});
+    auto view = glm::lookAt(glm::vec3{0.f, 0.f, 2.5f}, glm::vec3{0.f},
+                            glm::vec3{0.f, 1.f, 0.f});
+    auto proj = glm::perspective(glm::radians(45.f), 1.f, 0.1f, 10.f);
+
+    std::array<glm::mat4, 2> transform{proj * view * model, model};
+
+    wgpuQueueWriteBuffer(GetQueue(), m_uniform_buffer, 0, transform.data(),
+                         sizeof(transform));
+
+    wgpuRenderPassEncoderSetPipeline(render_pass, m_pipeline);
+    wgpuRenderPassEncoderSetVertexBuffer(render_pass, 0, m_vertex_buffer, 0,
+                                         WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderSetIndexBuffer(render_pass, m_index_buffer,
+                                        WGPUIndexFormat_Uint32, 0,
+                                        WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderSetBindGroup(render_pass, 0, m_bind_group, 0,
+                                      nullptr);
+
+    wgpuRenderPassEncoderDrawIndexed(render_pass, m_index_count, 1, 0, 0, 0);
+  }
+
+private:
+  WGPUBindGroupLayout m_bind0_layout = {};
+  WGPUPipelineLayout m_layout = {};
+  WGPURenderPipeline m_pipeline = {};
+  WGPUBindGroup m_bind_group = {};
+  WGPUBuffer m_vertex_buffer = {};
+  WGPUBuffer m_index_buffer = {};
+  WGPUBuffer m_uniform_buffer = {};
+  WGPUTextureView m_depth_attachment = {};
+  uint32_t m_index_count = 0;
+  float m_rotation = 0.f;
+};
+
+int main(int argc, const char **argv) {
+  auto options = util::App::ParseOptions(argc, argv);
+
+  IndexedMesh app{};
+
+  return app.Run(options) ? 0 : -1;
+}
@@ -0,0 +1,35 @@
+
+// vertex buffer
+struct VertexInput {
+    @location(0) position: vec3<f32>,
+    @location(1) normal: vec3<f32>,
+};
+
+struct VertexOutput {
+    @builtin(position) position: vec4<f32>,
+    @location(0) normal: vec3<f32>,
+};
+
+struct Transform {
+    mvp: mat4x4<f32>,
+    model: mat4x4<f32>,
+};
+
+@group(0) @binding(0)
+var<uniform> transform: Transform;
+
+@vertex
+fn vs_main(vertex: VertexInput) -> VertexOutput {
+    var out: VertexOutput;
+    out.position = transform.mvp * vec4<f32>(vertex.position, 1.0);
+    out.normal = (transform.model * vec4<f32>(vertex.normal, 0.0)).xyz;
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4<f32> {
+    let light = normalize(vec3<f32>(0.4, 0.6, 1.0));
+    let diffuse = max(dot(normalize(in.normal), light), 0.0);
+    let color = vec3<f32>(83.0 / 255.0, 109.0 / 255.0, 254.0 / 255.0);
+    return vec4<f32>(color * (0.2 + 0.8 * diffuse), 1.0);
+}
@@ -0,0 +1,410 @@
+#include "mesh_loader.hpp"
+#include "staging_belt.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+class MeshViewer : public util::App {
+public:
+  explicit MeshViewer(std::string path)
+      : util::App("Mesh Viewer", 800, 800), m_path(std::move(path)) {}
+
+  ~MeshViewer() override = default;
+
+protected:
+  void OnPreload() override {
+    m_shader_source = util::GetShader("mesh.wgsl");
+
+    auto start = std::chrono::steady_clock::now();
+
+    m_opened = m_loader.Open(m_path);
+
+    m_open_time = std::chrono::steady_clock::now() - start;
+  }
+
+  void OnInit() override {
+    InitBuffers();
+    InitDepthAttachment();
+    InitPipeline();
+  }
+
+  void OnLoop() override {
+    auto texture_view = AcquireTargetView();
+
+    auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
+
+    auto render_pass = BeginRenderPass(texture_view, encoder);
+
+    Draw(render_pass);
+
+    wgpuRenderPassEncoderEnd(render_pass);
+
+    auto cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+
+    wgpuRenderPassEncoderRelease(render_pass);
+    wgpuCommandEncoderRelease(encoder);
+
+    wgpuQueueSubmit(GetQueue(), 1, &cmd);
+    Present();
+
+    wgpuCommandBufferRelease(cmd);
+    wgpuTextureViewRelease(texture_view);
+  }
+
+  void OnTerminal() override {
+    wgpuBindGroupRelease(m_bind_group);
+    wgpuRenderPipelineRelease(m_pipeline);
+    wgpuBindGroupLayoutRelease(m_bind0_layout);
+    wgpuPipelineLayoutRelease(m_layout);
+    wgpuBufferRelease(m_uniform_buffer);
+
+    // not created when the model failed to load
+    if (m_vertex_buffer) {
+      wgpuBufferRelease(m_vertex_buffer);
+    }
+    if (m_index_buffer) {
+      wgpuBufferRelease(m_index_buffer);
+    }
+    wgpuTextureViewRelease(m_depth_attachment);
+  }
+
+private:
+  void InitBuffers() {
+    // uniform buffer
+    {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Uniform buffer";
+      desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+      // mvp and model matrix
+      desc.size = 2 * sizeof(glm::mat4);
+
+      m_uniform_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (!m_opened) {
+      return;
+    }
+
+    auto info = m_loader.GetInfo();
+
+    spdlog::info("mesh: {} vertices {} triangles", info.vertex_count,
+                 info.index_count / 3);
+
+    if (info.vertex_count == 0 || info.index_count == 0) {
+      return;
+    }
+
+    // vertex buffer
+    {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Vertex buffer";
+      desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst;
+      desc.size = info.vertex_count * 3 * sizeof(float);
+
+      m_vertex_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+    }
+
+    // index buffer
+    {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Index buffer";
+      desc.usage = WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst;
+      desc.size = info.index_count * sizeof(uint32_t);
+
+      m_index_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+    }
+
+    // chunks are uploaded as soon as a worker finishes them, so parsing and
+    // uploading overlap
+    util::StagingBelt belt{GetDevice(), GetQueue(), kChunkSize, kMaxChunks};
+
+    bool streamed =
+        m_loader.Stream([this, &belt](const util::MeshChunk &chunk) {
+          auto dst = chunk.kind == util::MeshChunk::Kind::kVertex
+                         ? m_vertex_buffer
+                         : m_index_buffer;
+
+          belt.Write(dst, chunk.offset, chunk.data.data(), chunk.data.size());
+        });
+
+    belt.Finish();
+
+    if (!streamed) {
+      // part of the buffers was never written, nothing is drawn
+      return;
+    }
+
+    info = m_loader.GetInfo();
+    m_index_count = static_cast<uint32_t>(info.index_count);
+
+    // opening overlapped the device creation, but is part of the load
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start + m_open_time;
+
+    spdlog::info("loaded {:.1f} MB in {:.3f} s ({:.1f} MB/s), uploaded {:.1f} "
+                 "MB in {} submits with {} MB of staging memory",
+                 m_loader.GetFileSize() / 1048576.0, elapsed.count(),
+                 m_loader.GetFileSize() / 1048576.0 / elapsed.count(),
+                 belt.GetBytesUploaded() / 1048576.0, belt.GetSubmitCount(),
+                 kChunkSize * kMaxChunks / 1048576);
+
+    // fit the model in view
+    glm::vec3 min{info.min[0], info.min[1], info.min[2]};
+    glm::vec3 max{info.max[0], info.max[1], info.max[2]};
+
+    m_center = (min + max) * 0.5f;
+    m_radius = std::max(glm::length(max - min) * 0.5f, 1e-3f);
+  }
+
+  void InitDepthAttachment() {
+    WGPUTextureDescriptor tex_desc{};
+    tex_desc.label = "Depth attachment";
+    tex_desc.dimension = WGPUTextureDimension_2D;
+    tex_desc.format = WGPUTextureFormat_Depth24Plus;
+    tex_desc.size.width = 800;
+    tex_desc.size.height = 800;
+    tex_desc.size.depthOrArrayLayers = 1;
+    tex_desc.sampleCount = 1;
+    tex_desc.mipLevelCount = 1;
+    tex_desc.usage = WGPUTextureUsage_RenderAttachment;
+
+    auto texture = wgpuDeviceCreateTexture(GetDevice(), &tex_desc);
+
+    m_depth_attachment = wgpuTextureCreateView(texture, nullptr);
+
+    wgpuTextureRelease(texture);
+  }
+
+  void InitPipeline() {
+    // shader, read by OnPreload
+    const char *raw_shader = m_shader_source;
+    // shader module
+    WGPUShaderModule shader = nullptr;
+    {
+      WGPUShaderModuleWGSLDescriptor wgsl_desc{};
+      wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+      wgsl_desc.code = raw_shader;
+
+      WGPUShaderModuleDescriptor desc{};
+      desc.label = "Mesh viewer shader";
+
+      desc.nextInChain = reinterpret_cast<WGPUChainedStruct *>(&wgsl_desc);
+
+      shader = wgpuDeviceCreateShaderModule(GetDevice(), &desc);
+    }
+
+    // pipeline layout
+    {
+      WGPUBindGroupLayoutEntry entry0{};
+      entry0.binding = 0;
+      entry0.visibility = WGPUShaderStage_Vertex;
+      entry0.buffer.type = WGPUBufferBindingType_Uniform;
+      entry0.buffer.minBindingSize = 0;
+      entry0.buffer.hasDynamicOffset = false;
+
+      WGPUBindGroupLayoutDescriptor binding_desc{};
+      binding_desc.label = "binding 0";
+      binding_desc.entryCount = 1;
+      binding_desc.entries = &entry0;
+
+      m_bind0_layout =
+          wgpuDeviceCreateBindGroupLayout(GetDevice(), &binding_desc);
+
+      WGPUPipelineLayoutDescriptor desc{};
+      desc.label = "Mesh viewer pipeline layout";
+      desc.bindGroupLayoutCount = 1;
+      desc.bindGroupLayouts = &m_bind0_layout;
+
+      m_layout = wgpuDeviceCreatePipelineLayout(GetDevice(), &desc);
+    }
+
+    // the uniform buffer never changes, so the bind group is created once
+    {
+      WGPUBindGroupEntry binding0{};
+      binding0.binding = 0;
+      binding0.buffer = m_uniform_buffer;
+      binding0.offset = 0;
+      binding0.size = 2 * sizeof(glm::mat4);
+
+      WGPUBindGroupDescriptor desc{};
+      desc.label = "Common Group";
+      desc.layout = m_bind0_layout;
+      desc.entryCount = 1;
+      desc.entries = &binding0;
+
+      m_bind_group = wgpuDeviceCreateBindGroup(GetDevice(), &desc);
+    }
+
+    // vertex layout
+    WGPUVertexBufferLayout vertex_layout = {};
+
+    WGPUVertexAttribute attr{};
+    attr.format = WGPUVertexFormat_Float32x3;
+    attr.offset = 0;
+    attr.shaderLocation = 0;
+
+    vertex_layout.attributeCount = 1;
+    vertex_layout.attributes = &attr;
+    vertex_layout.arrayStride = 3 * sizeof(float);
+    vertex_layout.stepMode = WGPUVertexStepMode_Vertex;
+
+    // pipeline descriptor
+    WGPURenderPipelineDescriptor desc{};
+    desc.label = "Mesh viewer pipeline";
+
+    desc.layout = m_layout;
+
+    desc.vertex.module = shader;
+    desc.vertex.entryPoint = "vs_main";
+    desc.vertex.bufferCount = 1;
+    desc.vertex.buffers = &vertex_layout;
+
+    WGPUColorTargetState color_target{};
+    color_target.writeMask = WGPUColorWriteMask_All;
+    color_target.blend = nullptr;
+    // TODO query swapchain texture format
+    color_target.format = WGPUTextureFormat_BGRA8Unorm;
+
+    WGPUFragmentState fs_state{};
+    fs_state.module = shader;
+    fs_state.entryPoint = "fs_main";
+    fs_state.targetCount = 1;
+    fs_state.targets = &color_target;
+
+    desc.fragment = &fs_state;
+
+    // primitive
+    desc.primitive.cullMode = WGPUCullMode_None;
+    desc.primitive.frontFace = WGPUFrontFace_CCW;
+    desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+    desc.primitive.stripIndexFormat = WGPUIndexFormat_Undefined;
+
+    // depth stencil state
+    WGPUDepthStencilState depth_stencil_state{};
+    depth_stencil_state.depthWriteEnabled = true;
+    depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+    depth_stencil_state.stencilReadMask = depth_stencil_state.stencilWriteMask =
+        0xff;
+    depth_stencil_state.stencilFront.compare = WGPUCompareFunction_Always;
+    depth_stencil_state.stencilFront.depthFailOp = WGPUStencilOperation_Keep;
+    depth_stencil_state.stencilFront.failOp = WGPUStencilOperation_Keep;
+    depth_stencil_state.stencilFront.passOp = WGPUStencilOperation_Keep;
+    depth_stencil_state.stencilBack = depth_stencil_state.stencilFront;
+    depth_stencil_state.format = WGPUTextureFormat_Depth24Plus;
+
+    desc.depthStencil = &depth_stencil_state;
+
+    desc.multisample.count = 1;
+    desc.multisample.mask = 0xffffffff;
+    desc.multisample.alphaToCoverageEnabled = false;
+
+    m_pipeline = wgpuDeviceCreateRenderPipeline(GetDevice(), &desc);
+
+    wgpuShaderModuleRelease(shader);
+  }
+
+  WGPURenderPassEncoder BeginRenderPass(WGPUTextureView texture_view,
+                                        WGPUCommandEncoder encoder) {
+    WGPURenderPassDescriptor renderpassInfo = {};
+    WGPURenderPassColorAttachment colorAttachment = {};
+
+    colorAttachment.view = texture_view;
+    colorAttachment.resolveTarget = nullptr;
+    colorAttachment.clearValue = {1.f, 1.f, 1.f, 1.f};
+    colorAttachment.loadOp = WGPULoadOp_Clear;
+    colorAttachment.storeOp = WGPUStoreOp_Store;
+    renderpassInfo.colorAttachmentCount = 1;
+    renderpassInfo.colorAttachments = &colorAttachment;
+
+    WGPURenderPassDepthStencilAttachment depthAttachment{};
+    depthAttachment.depthClearValue = 1.f;
+    depthAttachment.depthLoadOp = WGPULoadOp_Clear;
+    depthAttachment.depthStoreOp = WGPUStoreOp_Discard;
+    depthAttachment.depthReadOnly = false;
+    depthAttachment.view = m_depth_attachment;
+
+    renderpassInfo.depthStencilAttachment = &depthAttachment;
+
+    return wgpuCommandEncoderBeginRenderPass(encoder, &renderpassInfo);
+  }
+
+  void Draw(WGPURenderPassEncoder render_pass) {
+    if (m_index_count == 0) {
+      return;
+    }
+
+    m_rotation += 0.2f;
+
+    auto model = glm::rotate(glm::mat4(1.f), glm::radians(m_rotation),
+                             {0.f, 1.f, 0.f});
+    model = glm::translate(model, m_center * -1.f);
+
+    auto view = glm::lookAt(glm::vec3{0.f, 0.f, m_radius * 2.5f},
+                            glm::vec3{0.f}, glm::vec3{0.f, 1.f, 0.f});
+    auto proj = glm::perspective(glm::radians(45.f), 1.f, m_radius * 0.05f,
+                                 m_radius * 10.f);
+
+    std::array<glm::mat4, 2> transform{proj * view * model, model};
+
+    wgpuQueueWriteBuffer(GetQueue(), m_uniform_buffer, 0, transform.data(),
+                         sizeof(transform));
+
+    wgpuRenderPassEncoderSetPipeline(render_pass, m_pipeline);
+    wgpuRenderPassEncoderSetVertexBuffer(render_pass, 0, m_vertex_buffer, 0,
+                                         WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderSetIndexBuffer(render_pass, m_index_buffer,
+                                        WGPUIndexFormat_Uint32, 0,
+                                        WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderSetBindGroup(render_pass, 0, m_bind_group, 0,
+                                      nullptr);
+
+    wgpuRenderPassEncoderDrawIndexed(render_pass, m_index_count, 1, 0, 0, 0);
+  }
+
+private:
+  // 4 MB chunks, at most 4 of them in flight
+  static constexpr uint64_t kChunkSize = 4 * 1024 * 1024;
+  static constexpr uint32_t kMaxChunks = 4;
+
+  WGPUBindGroupLayout m_bind0_layout = {};
+  WGPUPipelineLayout m_layout = {};
+  WGPURenderPipeline m_pipeline = {};
+  WGPUBindGroup m_bind_group = {};
+  WGPUBuffer m_vertex_buffer = {};
+  WGPUBuffer m_index_buffer = {};
+  WGPUBuffer m_uniform_buffer = {};
+  WGPUTextureView m_depth_attachment = {};
+  uint32_t m_index_count = 0;
+  float m_rotation = 0.f;
+
+  std::string m_path;
+  const char *m_shader_source = nullptr;
+  util::MeshLoader m_loader{0, kChunkSize};
+  bool m_opened = false;
+  std::chrono::steady_clock::duration m_open_time = {};
+  glm::vec3 m_center = {};
+  float m_radius = 1.f;
+};
+
+int main(int argc, const char **argv) {
+  auto options = util::App::ParseOptions(argc, argv);
+
+  if (argc < 2) {
+    spdlog::error("usage: {} <model.obj | model.gltf | model.glb>", argv[0]);
+    return -1;
+  }
+
+  MeshViewer app{argv[1]};
+
+  return app.Run(options) ? 0 : -1;
+}
@@ -0,0 +1,36 @@
+
+// vertex buffer, loaded models only provide positions
+struct VertexInput {
+    @location(0) position: vec3<f32>,
+};
+
+struct VertexOutput {
+    @builtin(position) position: vec4<f32>,
+    @location(0) world: vec3<f32>,
+};
+
+struct Transform {
+    mvp: mat4x4<f32>,
+    model: mat4x4<f32>,
+};
+
+@group(0) @binding(0)
+var<uniform> transform: Transform;
+
+@vertex
+fn vs_main(vertex: VertexInput) -> VertexOutput {
+    var out: VertexOutput;
+    out.position = transform.mvp * vec4<f32>(vertex.position, 1.0);
+    out.world = (transform.model * vec4<f32>(vertex.position, 1.0)).xyz;
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4<f32> {
+    // flat shading, the face normal comes from screen space derivatives
+    let normal = normalize(cross(dpdx(in.world), dpdy(in.world)));
+    let light = normalize(vec3<f32>(0.4, 0.6, 1.0));
+    let diffuse = abs(dot(normal, light));
+    let color = vec3<f32>(0.0, 137.0 / 255.0, 123.0 / 255.0);
+    return vec4<f32>(color * (0.2 + 0.8 * diffuse), 1.0);
+}
@@ -8,6 +8,9 @@
 #include <vector>
 #include <webgpu/webgpu.h>
 
+// the old 0.1 degree per frame at 60 frames per second
+constexpr float kDegreesPerSecond = 6.f;
+
 class MSAAResolve : public util::App {
 public:
   MSAAResolve() : util::App("MSAA Resolve", 800, 800) {}
@@ -21,8 +24,13 @@ protected:
     InitMSAAResolve();
   }
 
+  void OnUpdate(double dt) override {
+    m_prev_rotation = m_rotation;
+    m_rotation += kDegreesPerSecond * static_cast<float>(dt);
+  }
+
   void OnLoop() override {
-    auto texture_view = wgpuSwapChainGetCurrentTextureView(GetSwapChain());
+    auto texture_view = AcquireTargetView();
 
     auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
 
@@ -38,7 +46,7 @@ protected:
     wgpuCommandEncoderRelease(encoder);
 
     wgpuQueueSubmit(GetQueue(), 1, &cmd);
-    wgpuSwapChainPresent(GetSwapChain());
+    Present();
 
     wgpuCommandBufferRelease(cmd);
     wgpuTextureViewRelease(texture_view);
@@ -86,13 +94,13 @@ protected:
 
   void InitPipeline() {
     // shader
-    auto raw_shader = ReadFile(ASSET_DIR "/buffer.wgsl");
+    const char *raw_shader = util::GetShader("buffer.wgsl");
     // shader module
     WGPUShaderModule shader = nullptr;
     {
       WGPUShaderModuleWGSLDescriptor wgsl_desc{};
       wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
-      wgsl_desc.code = raw_shader.c_str();
+      wgsl_desc.code = raw_shader;
 
       WGPUShaderModuleDescriptor desc{};
       desc.label = "uniform buffer shader";
@@ -210,10 +218,11 @@ protected:
   }
 
   void Draw(WGPURenderPassEncoder render_pass) {
-    m_rotation += 0.1f;
+    float rotation = glm::mix(m_prev_rotation, m_rotation,
+                              static_cast<float>(GetUpdateAlpha()));
 
     auto matrix =
-        glm::rotate(glm::mat4(1.f), glm::radians(m_rotation), {0.f, 0.f, 1.f});
+        glm::rotate(glm::mat4(1.f), glm::radians(rotation), {0.f, 0.f, 1.f});
 
     wgpuQueueWriteBuffer(GetQueue(), m_uniform_buffer, 0, &matrix,
                          sizeof(matrix));
@@ -276,13 +285,15 @@ private:
   WGPUTextureView m_msaa_texture_view = {};
   WGPUBuffer m_vertex_buffer = {};
   WGPUBuffer m_uniform_buffer = {};
+  // degrees, of the last two update steps
+  float m_prev_rotation = 0.f;
   float m_rotation = 0.f;
 };
 
 int main(int argc, const char **argv) {
-  MSAAResolve app{};
+  auto options = util::App::ParseOptions(argc, argv);
 
-  app.Run();
+  MSAAResolve app{};
 
-  return 0;
+  return app.Run(options) ? 0 : -1;
 }
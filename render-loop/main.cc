@@ -17,7 +17,7 @@ protected:
   void OnLoop() override {
     // begin render pass
     // acquire current texture
-    auto texture_view = wgpuSwapChainGetCurrentTextureView(GetSwapChain());
+    auto texture_view = AcquireTargetView();
 
     WGPURenderPassDescriptor renderpassInfo = {};
     WGPURenderPassColorAttachment colorAttachment = {};
@@ -44,7 +44,7 @@ protected:
     wgpuCommandEncoderRelease(encoder);
 
     wgpuQueueSubmit(GetQueue(), 1, &cmd);
-    wgpuSwapChainPresent(GetSwapChain());
+    Present();
 
     wgpuCommandBufferRelease(cmd);
     wgpuTextureViewRelease(texture_view);
@@ -54,9 +54,9 @@ protected:
 };
 
 int main(int argc, const char **argv) {
-  RenderLoop app{};
+  auto options = util::App::ParseOptions(argc, argv);
 
-  app.Run();
+  RenderLoop app{};
 
-  return 0;
+  return app.Run(options) ? 0 : -1;
 }
\ No newline at end of file
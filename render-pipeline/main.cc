@@ -8,16 +8,21 @@ public:
   ~RenderPipeline() override = default;
 
 protected:
+  // the triangle never changes
+  util::LoopMode GetLoopMode() const override {
+    return util::LoopMode::kOnDemand;
+  }
+
   void OnInit() override {
     // shader string
-    auto raw_shader = ReadFile(ASSET_DIR "/triangle.wgsl");
+    const char *raw_shader = util::GetShader("triangle.wgsl");
 
     // shader module
     WGPUShaderModule shader = nullptr;
     {
       WGPUShaderModuleWGSLDescriptor wgsl_desc{};
       wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
-      wgsl_desc.code = raw_shader.c_str();
+      wgsl_desc.code = raw_shader;
 
       WGPUShaderModuleDescriptor desc{};
       desc.label = "vertex shader";
@@ -96,7 +101,7 @@ protected:
   }
 
   void OnLoop() override {
-    auto texture_view = wgpuSwapChainGetCurrentTextureView(GetSwapChain());
+    auto texture_view = AcquireTargetView();
 
     WGPURenderPassDescriptor renderpassInfo = {};
     WGPURenderPassColorAttachment colorAttachment = {};
@@ -131,7 +136,7 @@ protected:
     wgpuCommandEncoderRelease(encoder);
 
     wgpuQueueSubmit(GetQueue(), 1, &cmd);
-    wgpuSwapChainPresent(GetSwapChain());
+    Present();
 
     wgpuCommandBufferRelease(cmd);
     wgpuTextureViewRelease(texture_view);
@@ -144,9 +149,9 @@ private:
 };
 
 int main(int argc, const char **argv) {
-  RenderPipeline app{};
+  auto options = util::App::ParseOptions(argc, argv);
 
-  app.Run();
+  RenderPipeline app{};
 
-  return 0;
+  return app.Run(options) ? 0 : -1;
 }
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "frame_trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+namespace {
+
+struct Summary {
+  double avg = 0.0;
+  double min = 0.0;
+  double p50 = 0.0;
+  double max = 0.0;
+};
+
+Summary Summarize(std::vector<double> values) {
+  Summary summary{};
+
+  if (values.empty()) {
+    return summary;
+  }
+
+  std::sort(values.begin(), values.end());
+
+  for (auto v : values) {
+    summary.avg += v;
+  }
+
+  summary.avg /= static_cast<double>(values.size());
+  summary.min = values.front();
+  summary.p50 = values[values.size() / 2];
+  summary.max = values.back();
+
+  return summary;
+}
+
+bool ParseBackend(const char *name, WGPUBackendType &type) {
+  struct Entry {
+    const char *name;
+    WGPUBackendType type;
+  };
+
+  static const Entry entries[] = {
+      {"null", WGPUBackendType_Null},     {"d3d11", WGPUBackendType_D3D11},
+      {"d3d12", WGPUBackendType_D3D12},   {"metal", WGPUBackendType_Metal},
+      {"vulkan", WGPUBackendType_Vulkan}, {"opengl", WGPUBackendType_OpenGL},
+  };
+
+  for (const auto &entry : entries) {
+    if (std::strcmp(entry.name, name) == 0) {
+      type = entry.type;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void RequestAdapterCallback(WGPURequestAdapterStatus status,
+                            WGPUAdapter adapter, char const *message,
+                            void *userdata) {
+  if (status != WGPURequestAdapterStatus_Success) {
+    spdlog::error("request adapter failed: {}", message ? message : "");
+    return;
+  }
+
+  *reinterpret_cast<WGPUAdapter *>(userdata) = adapter;
+}
+
+void DeviceErrorCallback(WGPUErrorType type, char const *message,
+                         void *userdata) {
+  spdlog::error("[ {} ]", message);
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  const char *trace_path = nullptr;
+  uint32_t iterations = 100;
+  WGPURequestAdapterOptions opts{};
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+      if (!ParseBackend(argv[++i], opts.backendType)) {
+        spdlog::error("unknown backend: {}", argv[i]);
+        return -1;
+      }
+    } else if (std::strcmp(argv[i], "--fallback") == 0) {
+      opts.forceFallbackAdapter = true;
+    } else {
+      trace_path = argv[i];
+    }
+  }
+
+  if (trace_path == nullptr) {
+    spdlog::error("usage: trace-replay <trace> [--iterations N] "
+                  "[--backend null|d3d11|d3d12|metal|vulkan|opengl] "
+                  "[--fallback]");
+    return -1;
+  }
+
+  // no window, the trace renders into an offscreen target
+  WGPUInstanceDescriptor ins_desc{};
+  auto instance = wgpuCreateInstance(&ins_desc);
+
+  WGPUAdapter adapter = nullptr;
+  wgpuInstanceRequestAdapter(instance, &opts, &RequestAdapterCallback,
+                             &adapter);
+
+  if (adapter == nullptr) {
+    wgpuInstanceRelease(instance);
+    return -1;
+  }
+
+  {
+    WGPUAdapterProperties props{};
+    wgpuAdapterGetProperties(adapter, &props);
+
+    spdlog::info("adapter: {} ({})", props.name ? props.name : "unknown",
+                 props.driverDescription ? props.driverDescription : "");
+  }
+
+  WGPUDeviceDescriptor device_desc{};
+  auto device = wgpuAdapterCreateDevice(adapter, &device_desc);
+
+  wgpuDeviceSetUncapturedErrorCallback(device, &DeviceErrorCallback, nullptr);
+
+  auto queue = wgpuDeviceGetQueue(device);
+
+  int ret = 0;
+
+  {
+    util::TraceReplayer replayer{device, queue};
+
+    if (replayer.Load(trace_path)) {
+      auto stats = replayer.Replay(iterations);
+
+      if (!stats.ok) {
+        spdlog::error("replay of {} failed", trace_path);
+        ret = -1;
+      }
+
+      auto cpu = Summarize(stats.cpu_encode);
+      auto gpu = Summarize(stats.gpu);
+
+      spdlog::info("replayed {} frames, {} commands", stats.frames,
+                   stats.commands);
+      spdlog::info("cpu encode ms avg: {:.3f} min: {:.3f} p50: {:.3f} "
+                   "max: {:.3f}",
+                   cpu.avg, cpu.min, cpu.p50, cpu.max);
+      spdlog::info("gpu ms        avg: {:.3f} min: {:.3f} p50: {:.3f} "
+                   "max: {:.3f}",
+                   gpu.avg, gpu.min, gpu.p50, gpu.max);
+    } else {
+      spdlog::error("can not load trace: {}", trace_path);
+      ret = -1;
+    }
+  }
+
+  wgpuQueueRelease(queue);
+  wgpuDeviceRelease(device);
+  wgpuAdapterRelease(adapter);
+  wgpuInstanceRelease(instance);
+
+  return ret;
+}
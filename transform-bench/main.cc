@@ -0,0 +1,166 @@
+#include "frame_bench.hpp"
+#include "transform_batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace {
+
+util::TransformArrays RandomTransforms(uint32_t count) {
+  std::mt19937 rng{2023};
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+  util::TransformArrays arrays;
+  arrays.Resize(count);
+
+  for (uint32_t i = 0; i < count; i++) {
+    for (auto &component : arrays.position) {
+      component[i] = unit(rng) * 100.f;
+    }
+
+    float q[4] = {unit(rng), unit(rng), unit(rng), unit(rng)};
+    float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+                             q[3] * q[3]);
+    length = std::max(length, 1e-6f);
+
+    for (uint32_t c = 0; c < 4; c++) {
+      arrays.rotation[c][i] = q[c] / length;
+    }
+
+    for (auto &component : arrays.scale) {
+      component[i] = 0.5f + std::abs(unit(rng));
+    }
+  }
+
+  return arrays;
+}
+
+// the per object loop this replaces
+void BuildGlm(const util::TransformArrays &arrays, glm::mat4 *out) {
+  uint32_t count = arrays.GetCount();
+
+  for (uint32_t i = 0; i < count; i++) {
+    glm::vec3 position{arrays.position[0][i], arrays.position[1][i],
+                       arrays.position[2][i]};
+    glm::quat rotation{arrays.rotation[3][i], arrays.rotation[0][i],
+                       arrays.rotation[1][i], arrays.rotation[2][i]};
+    glm::vec3 scale{arrays.scale[0][i], arrays.scale[1][i],
+                    arrays.scale[2][i]};
+
+    auto transform = glm::translate(glm::mat4(1.f), position);
+    transform = transform * glm::mat4_cast(rotation);
+    out[i] = glm::scale(transform, scale);
+  }
+}
+
+float MaxError(const std::vector<glm::mat4> &a,
+               const std::vector<glm::mat4> &b) {
+  float error = 0.f;
+
+  for (size_t i = 0; i < a.size(); i++) {
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) {
+        error = std::max(error, std::abs(a[i][c][r] - b[i][c][r]));
+      }
+    }
+  }
+
+  return error;
+}
+
+// milliseconds of every iteration
+template <typename F>
+util::Distribution Measure(uint32_t iterations, F &&build) {
+  std::vector<double> times;
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+
+    build();
+
+    times.emplace_back(std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count());
+  }
+
+  return util::Distribution::From(std::move(times));
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  std::vector<uint32_t> counts;
+  uint32_t iterations = 50;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else {
+      counts.emplace_back(
+          static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10)));
+    }
+  }
+
+  if (counts.empty()) {
+    counts = {10000, 100000, 1000000};
+  }
+
+  iterations = std::max(iterations, 1u);
+
+  auto best = util::GetSimdLevel();
+
+  spdlog::info("cpu supports: {}", util::SimdLevelName(best));
+
+  int ret = 0;
+
+  for (auto count : counts) {
+    auto arrays = RandomTransforms(count);
+    auto soa = arrays.View();
+
+    std::vector<glm::mat4> expected(count);
+    std::vector<glm::mat4> result(count);
+
+    auto glm_time =
+        Measure(iterations, [&] { BuildGlm(arrays, expected.data()); });
+
+    spdlog::info("{:>8} instances  glm    avg: {:7.3f} ms p50: {:7.3f} ms",
+                 count, glm_time.avg, glm_time.p50);
+
+    for (auto level :
+         {util::SimdLevel::kScalar, util::SimdLevel::kSSE,
+          util::SimdLevel::kAVX2}) {
+      if (level > best) {
+        continue;
+      }
+
+      auto time = Measure(iterations, [&] {
+        util::BuildTransforms(soa, count, result.data(), level);
+      });
+
+      float error = MaxError(expected, result);
+
+      spdlog::info("{:>8} instances  {:<6} avg: {:7.3f} ms p50: {:7.3f} ms "
+                   "speedup: {:5.2f}x max error: {:g}",
+                   count, util::SimdLevelName(level), time.avg, time.p50,
+                   glm_time.p50 / std::max(time.p50, 1e-9), error);
+
+      // positions up to 100 and the translation being added last keep the
+      // rounding differences small
+      if (error > 1e-4f) {
+        spdlog::error("{} result differs from glm", util::SimdLevelName(level));
+        ret = -1;
+      }
+    }
+  }
+
+  return ret;
+}
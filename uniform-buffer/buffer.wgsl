@@ -26,6 +26,20 @@ fn vs_main(vertex: VertexInput) -> VertexOutput {
     return out;
 }
 
+/// one transform per instance, used when drawing many objects
+@group(0) @binding(1)
+var<storage, read> transforms: array<mat4x4<f32>>;
+
+@vertex
+fn vs_instanced(vertex: VertexInput,
+                @builtin(instance_index) instance: u32) -> VertexOutput {
+    var out: VertexOutput;
+    out.position = transforms[instance] * vertex.position;
+    out.color = vertex.color;
+
+    return out;
+}
+
 @fragment
 fn fs_main(in: VertexOutput) -> @location(0) vec4<f32> {
     return vec4<f32>(in.color, 1.0);
@@ -1,16 +1,37 @@
 
+#include "transform_animator.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <random>
+#include <spdlog/spdlog.h>
 #include <vector>
 #include <webgpu/webgpu.h>
 
+// the old 0.1 degree per frame at 60 frames per second
+constexpr float kDegreesPerSecond = 6.f;
+
 class UniformBuffer : public util::App {
 public:
-  UniformBuffer() : util::App("Uniform Buffer", 800, 800) {}
+  /**
+   * One object keeps the original single uniform matrix. More objects, or
+   * `gpu_transforms`, draw instanced from a storage buffer of matrices,
+   * either computed and uploaded by the CPU every frame or generated by
+   * util::TransformAnimator in a compute pass.
+   */
+  UniformBuffer(uint32_t object_count, bool gpu_transforms)
+      : util::App("Uniform Buffer", 800, 800), m_object_count(object_count),
+        m_gpu_transforms(gpu_transforms),
+        m_instanced(object_count > 1 || gpu_transforms) {}
 
   ~UniformBuffer() override = default;
 
@@ -20,11 +41,23 @@ protected:
     InitPipeline();
   }
 
+  void OnUpdate(double dt) override {
+    m_prev_rotation = m_rotation;
+    m_rotation += kDegreesPerSecond * static_cast<float>(dt);
+  }
+
   void OnLoop() override {
-    auto texture_view = wgpuSwapChainGetCurrentTextureView(GetSwapChain());
+    auto start = std::chrono::steady_clock::now();
+
+    auto texture_view = AcquireTargetView();
 
     auto encoder = wgpuDeviceCreateCommandEncoder(GetDevice(), nullptr);
 
+    if (m_animator) {
+      m_animator->Update(encoder, Time());
+      m_upload_bytes += sizeof(float) * 4;
+    }
+
     auto render_pass = BeginRenderPass(texture_view, encoder);
 
     Draw(render_pass);
@@ -37,13 +70,36 @@ protected:
     wgpuCommandEncoderRelease(encoder);
 
     wgpuQueueSubmit(GetQueue(), 1, &cmd);
-    wgpuSwapChainPresent(GetSwapChain());
+    Present();
 
     wgpuCommandBufferRelease(cmd);
     wgpuTextureViewRelease(texture_view);
+
+    m_cpu_time += std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+    if (++m_frame % 120 == 0) {
+      spdlog::info("objects: {} transforms: {} upload: {} bytes/frame "
+                   "cpu: {:.3f} ms/frame",
+                   m_object_count, m_gpu_transforms ? "gpu" : "cpu",
+                   m_upload_bytes / 120, m_cpu_time / 120.0 * 1000.0);
+
+      m_upload_bytes = 0;
+      m_cpu_time = 0.0;
+    }
   }
 
   void OnTerminal() override {
+    m_animator.reset();
+
+    if (m_group) {
+      wgpuBindGroupRelease(m_group);
+    }
+    if (m_transform_buffer) {
+      wgpuBufferRelease(m_transform_buffer);
+    }
+
     wgpuRenderPipelineRelease(m_pipeline);
     wgpuBindGroupLayoutRelease(m_bind0_layout);
     wgpuPipelineLayoutRelease(m_layout);
@@ -80,17 +136,68 @@ protected:
 
       m_uniform_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
     }
+
+    if (!m_instanced) {
+      return;
+    }
+
+    InitAnimations();
+
+    // per instance transforms
+    if (m_gpu_transforms) {
+      m_animator = std::make_unique<util::TransformAnimator>(
+          GetDevice(), GetQueue(), m_animations);
+    } else {
+      WGPUBufferDescriptor desc{};
+      desc.label = "Transform buffer";
+      desc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+      desc.size = m_object_count * sizeof(glm::mat4);
+
+      m_transform_buffer = wgpuDeviceCreateBuffer(GetDevice(), &desc);
+
+      m_matrices.resize(m_object_count);
+    }
+  }
+
+  void InitAnimations() {
+    std::mt19937 rng{2023};
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    // objects on a grid covering the viewport
+    auto side = static_cast<uint32_t>(
+        std::ceil(std::sqrt(static_cast<float>(m_object_count))));
+    float cell = 2.f / static_cast<float>(side);
+
+    // the single object turns 0.1 degree per frame at 60 fps, like before
+    constexpr float kSpeed = 0.1f * 60.f * 3.14159265f / 180.f;
+
+    m_animations.resize(m_object_count);
+
+    for (uint32_t i = 0; i < m_object_count; i++) {
+      auto &animation = m_animations[i];
+
+      if (m_object_count == 1) {
+        animation.speed = kSpeed;
+        continue;
+      }
+
+      animation.pivot = {-1.f + cell * (static_cast<float>(i % side) + 0.5f),
+                         -1.f + cell * (static_cast<float>(i / side) + 0.5f)};
+      animation.angle = unit(rng) * 2.f * 3.14159265f;
+      animation.speed = kSpeed * (unit(rng) * 4.f - 2.f);
+      animation.scale = cell * 0.8f;
+    }
   }
 
   void InitPipeline() {
     // shader
-    auto raw_shader = ReadFile(ASSET_DIR "/buffer.wgsl");
+    const char *raw_shader = util::GetShader("buffer.wgsl");
     // shader module
     WGPUShaderModule shader = nullptr;
     {
       WGPUShaderModuleWGSLDescriptor wgsl_desc{};
       wgsl_desc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
-      wgsl_desc.code = raw_shader.c_str();
+      wgsl_desc.code = raw_shader;
 
       WGPUShaderModuleDescriptor desc{};
       desc.label = "uniform buffer shader";
@@ -110,6 +217,12 @@ protected:
       entry0.buffer.minBindingSize = 0;
       entry0.buffer.hasDynamicOffset = false;
 
+      if (m_instanced) {
+        // array of transforms, see vs_instanced
+        entry0.binding = 1;
+        entry0.buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+      }
+
       WGPUBindGroupLayoutDescriptor binding_desc{};
       binding_desc.label = "binding 0";
       binding_desc.entryCount = 1;
@@ -148,7 +261,7 @@ protected:
     desc.layout = m_layout;
 
     desc.vertex.module = shader;
-    desc.vertex.entryPoint = "vs_main";
+    desc.vertex.entryPoint = m_instanced ? "vs_instanced" : "vs_main";
     desc.vertex.bufferCount = 1;
     desc.vertex.buffers = &vertex_layout;
 
@@ -186,6 +299,23 @@ protected:
     desc.multisample.alphaToCoverageEnabled = false;
 
     m_pipeline = wgpuDeviceCreateRenderPipeline(GetDevice(), &desc);
+
+    if (m_instanced) {
+      WGPUBindGroupEntry binding1{};
+      binding1.binding = 1;
+      binding1.buffer =
+          m_animator ? m_animator->GetTransforms() : m_transform_buffer;
+      binding1.offset = 0;
+      binding1.size = WGPU_WHOLE_SIZE;
+
+      WGPUBindGroupDescriptor group_desc{};
+      group_desc.label = "Transform Group";
+      group_desc.layout = m_bind0_layout;
+      group_desc.entryCount = 1;
+      group_desc.entries = &binding1;
+
+      m_group = wgpuDeviceCreateBindGroup(GetDevice(), &group_desc);
+    }
   }
 
   WGPURenderPassEncoder BeginRenderPass(WGPUTextureView texture_view,
@@ -206,13 +336,20 @@ protected:
   }
 
   void Draw(WGPURenderPassEncoder render_pass) {
-    m_rotation += 0.1f;
+    if (m_instanced) {
+      DrawInstanced(render_pass);
+      return;
+    }
+
+    float rotation = glm::mix(m_prev_rotation, m_rotation,
+                              static_cast<float>(GetUpdateAlpha()));
 
     auto matrix =
-        glm::rotate(glm::mat4(1.f), glm::radians(m_rotation), {0.f, 0.f, 1.f});
+        glm::rotate(glm::mat4(1.f), glm::radians(rotation), {0.f, 0.f, 1.f});
 
     wgpuQueueWriteBuffer(GetQueue(), m_uniform_buffer, 0, &matrix,
                          sizeof(matrix));
+    m_upload_bytes += sizeof(matrix);
 
     wgpuRenderPassEncoderSetPipeline(render_pass, m_pipeline);
     wgpuRenderPassEncoderSetVertexBuffer(render_pass, 0, m_vertex_buffer, 0,
@@ -244,19 +381,79 @@ protected:
     wgpuBindGroupRelease(group0);
   }
 
+  void DrawInstanced(WGPURenderPassEncoder render_pass) {
+    // with gpu transforms the compute pass already wrote them
+    if (!m_animator) {
+      float time = Time();
+
+      for (uint32_t i = 0; i < m_object_count; i++) {
+        m_matrices[i] =
+            util::TransformAnimator::Evaluate(m_animations[i], time);
+      }
+
+      wgpuQueueWriteBuffer(GetQueue(), m_transform_buffer, 0, m_matrices.data(),
+                           m_matrices.size() * sizeof(glm::mat4));
+      m_upload_bytes += m_matrices.size() * sizeof(glm::mat4);
+    }
+
+    wgpuRenderPassEncoderSetPipeline(render_pass, m_pipeline);
+    wgpuRenderPassEncoderSetVertexBuffer(render_pass, 0, m_vertex_buffer, 0,
+                                         WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderSetBindGroup(render_pass, 0, m_group, 0, nullptr);
+
+    wgpuRenderPassEncoderDraw(render_pass, 3, m_object_count, 0, 0);
+  }
+
+  // simulated seconds, interpolated between the last two update steps
+  float Time() const {
+    return static_cast<float>(std::max(
+        GetSimulationTime() + (GetUpdateAlpha() - 1.0) * GetTimestep(), 0.0));
+  }
+
 private:
   WGPUBindGroupLayout m_bind0_layout = {};
   WGPUPipelineLayout m_layout = {};
   WGPURenderPipeline m_pipeline = {};
   WGPUBuffer m_vertex_buffer = {};
   WGPUBuffer m_uniform_buffer = {};
+  // degrees, of the last two update steps
+  float m_prev_rotation = 0.f;
   float m_rotation = 0.f;
+
+  uint32_t m_object_count;
+  bool m_gpu_transforms;
+  bool m_instanced;
+  std::vector<util::TransformAnimation> m_animations;
+  // cpu transforms
+  std::vector<glm::mat4> m_matrices;
+  WGPUBuffer m_transform_buffer = {};
+  // gpu transforms
+  std::unique_ptr<util::TransformAnimator> m_animator;
+  WGPUBindGroup m_group = {};
+
+  uint64_t m_frame = 0;
+  uint64_t m_upload_bytes = 0;
+  double m_cpu_time = 0.0;
 };
 
 int main(int argc, const char **argv) {
-  UniformBuffer app{};
+  auto options = util::App::ParseOptions(argc, argv);
+
+  uint32_t object_count = 1;
+  bool gpu_transforms = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--gpu-transforms") == 0) {
+      gpu_transforms = true;
+    } else if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+      object_count = std::max(
+          1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+    } else {
+      spdlog::warn("unknown option: {}", argv[i]);
+    }
+  }
 
-  app.Run();
+  UniformBuffer app{object_count, gpu_transforms};
 
-  return 0;
+  return app.Run(options) ? 0 : -1;
 }
\ No newline at end of file